@@ -0,0 +1,93 @@
+
+#include <elle/assert.hh>
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+
+#include <elle/cryptography/random.hh>
+
+#include <elle/reactor/scheduler.hh>
+
+#include <infinit/model/blocks/ImmutableBlock.hh>
+#include <infinit/model/doughnut/BlockCodec.hh>
+#include <infinit/model/doughnut/NB.hh>
+
+#include "DHT.hh" // XXX Shared with tests.
+#include "measure.hh"
+
+ELLE_LOG_COMPONENT("bench");
+
+namespace codec = infinit::model::doughnut::codec;
+
+/// Encode and decode blocks with the generic serializer and the compact
+/// codec, as nodes do storing and loading them.
+static
+void
+codec_test()
+{
+  using elle::os::getenv;
+  auto const count = getenv("INFINIT_BENCH_BLOCKS", 10000);
+  auto const size = getenv("INFINIT_BENCH_BLOCK_SIZE", 1024);
+  DHT server;
+  auto sample = std::vector<std::unique_ptr<blocks::Block>>{};
+  for (int i = 0; i < count; ++i)
+  {
+    auto data = elle::cryptography::random::generate<elle::Buffer>(size);
+    auto b = std::unique_ptr<blocks::Block>();
+    if (i % 2)
+      b = server.dht->make_block<blocks::ImmutableBlock>(std::move(data));
+    else
+      b = std::make_unique<dht::NB>(
+        *server.dht, elle::sprintf("block %s", i), std::move(data));
+    b->seal();
+    sample.emplace_back(std::move(b));
+  }
+  auto generic = std::vector<elle::Buffer>{};
+  auto const generic_encode = measure([&] {
+      for (auto const& b: sample)
+        generic.emplace_back(elle::serialization::binary::serialize(
+                               b.get(), server.dht->version()));
+    });
+  auto compact = std::vector<elle::Buffer>{};
+  auto const compact_encode = measure([&] {
+      for (auto const& b: sample)
+        compact.emplace_back(codec::encode(*b));
+    });
+  auto const generic_decode = measure([&] {
+      for (auto const& data: generic)
+        ELLE_ASSERT(codec::deserialize(data, *server.dht));
+    });
+  auto const compact_decode = measure([&] {
+      for (auto const& data: compact)
+        ELLE_ASSERT(codec::deserialize(data, *server.dht));
+    });
+  auto const bytes = [] (std::vector<elle::Buffer> const& buffers)
+    {
+      auto res = std::size_t(0);
+      for (auto const& b: buffers)
+        res += b.size();
+      return res;
+    };
+  ELLE_LOG("%s blocks of %s bytes, half CHBs, half NBs", count, size);
+  ELLE_LOG("generic: %s bytes, encode %sms, decode %sms",
+           bytes(generic), generic_encode.count(), generic_decode.count());
+  ELLE_LOG("compact: %s bytes, encode %sms, decode %sms",
+           bytes(compact), compact_encode.count(), compact_decode.count());
+}
+
+int
+main()
+{
+  elle::reactor::Scheduler sched;
+  elle::reactor::Thread main(sched, "main", &codec_test);
+  try
+  {
+    sched.run();
+  }
+  catch (elle::Error const& e)
+  {
+    ELLE_ERR("exception escaped: %s", e);
+    ELLE_ERR("%s", e.backtrace());
+    throw;
+  }
+  return 0;
+}
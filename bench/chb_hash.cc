@@ -0,0 +1,103 @@
+#include <chrono>
+
+#include <elle/IOStream.hh>
+#include <elle/assert.hh>
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+
+#include <elle/cryptography/hash.hh>
+#include <elle/cryptography/random.hh>
+
+#include <elle/reactor/Scope.hh>
+#include <elle/reactor/scheduler.hh>
+
+#include <infinit/model/doughnut/sha256.hh>
+
+#include "measure.hh"
+
+ELLE_LOG_COMPONENT("bench");
+
+namespace sha256 = infinit::model::doughnut::sha256;
+
+/// Hash data blocks the way CHB addresses them: salt, then content.
+static
+void
+hash_test()
+{
+  using elle::os::getenv;
+  auto const count = getenv("INFINIT_BENCH_BLOCKS", 64);
+  auto const size = getenv("INFINIT_BENCH_BLOCK_SIZE", 1024 * 1024);
+  auto const salt = elle::cryptography::random::generate<elle::Buffer>(32);
+  auto blocks = std::vector<elle::Buffer>{};
+  for (int i = 0; i < count; ++i)
+    blocks.emplace_back(
+      elle::cryptography::random::generate<elle::Buffer>(size));
+  ELLE_LOG("hash %s blocks of %s bytes, backend: %s",
+           count, size, sha256::backend());
+  auto reference = std::vector<elle::Buffer>{};
+  auto const stream = measure([&] {
+      for (auto const& b: blocks)
+      {
+        elle::IOStream s(salt.istreambuf_combine(b));
+        reference.emplace_back(
+          elle::cryptography::hash(s, elle::cryptography::Oneway::sha256));
+      }
+    });
+  auto messages = std::vector<sha256::Message>{};
+  for (auto const& b: blocks)
+    messages.emplace_back(sha256::Message{salt, b});
+  auto direct = std::vector<elle::Buffer>{};
+  auto const sequential = measure([&] {
+      for (auto const& m: messages)
+        direct.emplace_back(sha256::digest(m));
+    });
+  auto batch = std::vector<elle::Buffer>{};
+  auto const parallel = measure([&] { batch = sha256::digest(messages); });
+  // One thread per block, as when validating fetched or received blocks.
+  auto threads = std::vector<elle::Buffer>(messages.size());
+  auto const batched = measure([&] {
+      sha256::Batch hashes;
+      elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& s)
+      {
+        for (auto i = 0u; i < messages.size(); ++i)
+          s.run_background(
+            elle::sprintf("hash %s", i),
+            [&, i]
+            {
+              sha256::Batch::Scope scope(hashes);
+              threads[i] = hashes.digest(messages[i]);
+            });
+        elle::reactor::wait(s);
+      };
+    });
+  ELLE_ASSERT_EQ(direct, reference);
+  ELLE_ASSERT_EQ(batch, reference);
+  ELLE_ASSERT_EQ(threads, reference);
+  auto const mib = double(count) * size / 1024 / 1024;
+  auto const rate = [&] (std::chrono::milliseconds d)
+    {
+      return d.count() ? mib * 1000 / d.count() : 0.;
+    };
+  ELLE_LOG("stream: %sms (%s MiB/s)", stream.count(), rate(stream));
+  ELLE_LOG("direct: %sms (%s MiB/s)", sequential.count(), rate(sequential));
+  ELLE_LOG("batch: %sms (%s MiB/s)", parallel.count(), rate(parallel));
+  ELLE_LOG("threads: %sms (%s MiB/s)", batched.count(), rate(batched));
+}
+
+int
+main()
+{
+  elle::reactor::Scheduler sched;
+  elle::reactor::Thread main(sched, "main", &hash_test);
+  try
+  {
+    sched.run();
+  }
+  catch (elle::Error const& e)
+  {
+    ELLE_ERR("exception escaped: %s", e);
+    ELLE_ERR("%s", e.backtrace());
+    throw;
+  }
+  return 0;
+}
@@ -0,0 +1,86 @@
+
+#include <elle/assert.hh>
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+
+#include <elle/reactor/scheduler.hh>
+
+#include <infinit/model/blocks/ACLBlock.hh>
+#include <infinit/model/doughnut/Group.hh>
+#include <infinit/model/doughnut/User.hh>
+
+#include "DHT.hh" // XXX Shared with tests.
+#include "measure.hh"
+
+ELLE_LOG_COMPONENT("bench");
+
+/// Walk a tree of directories shared with a group, as `ls -R` would from a
+/// group member: every directory is an ACB only readable with group keys.
+static
+void
+traverse_test()
+{
+  using elle::os::getenv;
+  auto const directories = getenv("INFINIT_BENCH_DIRECTORIES", 200);
+  auto const rounds = getenv("INFINIT_BENCH_ROUNDS", 5);
+  auto const key_size = getenv("INFINIT_BENCH_KEY_SIZE", 2048);
+  auto const owner_keys = elle::cryptography::rsa::keypair::generate(key_size);
+  auto const reader_keys = elle::cryptography::rsa::keypair::generate(key_size);
+  DHT server(owner = owner_keys, keys = owner_keys);
+  DHT reader(owner = owner_keys,
+             keys = reader_keys,
+             storage = nullptr);
+  server.overlay->connect(*reader.overlay);
+  auto group_key = [&]
+    {
+      dht::Group g(*server.dht, "readers");
+      g.create();
+      g.add_member(dht::User(reader_keys.K(), "reader"));
+      return g.public_control_key();
+    }();
+  auto addresses = std::vector<Address>{};
+  ELLE_LOG("create %s directories", directories)
+    for (int i = 0; i < directories; ++i)
+    {
+      auto block = server.dht->make_block<blocks::ACLBlock>();
+      block->data(elle::Buffer(std::string(1024, 'a' + i % 26)));
+      block->set_permissions(dht::User(group_key, "@readers"), true, false);
+      server.dht->seal_and_insert(*block);
+      addresses.emplace_back(block->address());
+    }
+  auto walk = [&]
+    {
+      for (int r = 0; r < rounds; ++r)
+        for (auto const& address: addresses)
+          ELLE_ASSERT(!reader.dht->fetch(address)->data().empty());
+    };
+  auto& cache = reader.dht->group_key_cache();
+  auto const capacity = cache.capacity();
+  cache.capacity(0);
+  auto const uncached = measure(walk);
+  cache.capacity(std::max(capacity, 1));
+  auto const cached = measure(walk);
+  auto const fetches = directories * rounds;
+  ELLE_LOG("uncached: %s fetches in %sms", fetches, uncached.count());
+  ELLE_LOG("cached: %s fetches in %sms, hit rate %s",
+           fetches, cached.count(),
+           double(cache.hits()) / (cache.hits() + cache.misses()));
+}
+
+int
+main()
+{
+  elle::reactor::Scheduler sched;
+  elle::reactor::Thread main(sched, "main", &traverse_test);
+  try
+  {
+    sched.run();
+  }
+  catch (elle::Error const& e)
+  {
+    ELLE_ERR("exception escaped: %s", e);
+    ELLE_ERR("%s", e.backtrace());
+    throw;
+  }
+  return 0;
+}
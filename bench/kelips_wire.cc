@@ -0,0 +1,153 @@
+#include <chrono>
+
+#include <elle/assert.hh>
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+#include <elle/serialization/binary.hh>
+
+#include <infinit/overlay/kelips/Wire.hh>
+
+#include "measure.hh"
+
+ELLE_LOG_COMPONENT("bench");
+
+namespace wire = infinit::overlay::kelips::wire;
+using infinit::model::Address;
+
+namespace elle
+{
+  namespace serialization
+  {
+    // Same as Kelips.
+    template <>
+    struct Serialize<wire::Time>
+    {
+      using Type = uint64_t;
+      static uint64_t convert(wire::Time& t)
+      {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+          t.time_since_epoch()).count();
+      }
+
+      static wire::Time convert(uint64_t repr)
+      {
+        return wire::Time(std::chrono::milliseconds(repr));
+      }
+    };
+  }
+}
+
+/// The gossip payload as the generic serializer encodes it, for comparison.
+struct Gossip
+{
+  Gossip() = default;
+
+  Gossip(elle::serialization::SerializerIn& input)
+  {
+    this->serialize(input);
+  }
+
+  void
+  serialize(elle::serialization::Serializer& s)
+  {
+    s.serialize("contacts", this->contacts);
+    s.serialize("files", this->files);
+  }
+
+  wire::Contacts contacts;
+  wire::Files files;
+};
+
+int
+main()
+{
+  using elle::os::getenv;
+  auto const rounds = getenv("INFINIT_BENCH_ROUNDS", 100000);
+  auto const contacts = getenv("INFINIT_BENCH_CONTACTS", 6);
+  auto const files = getenv("INFINIT_BENCH_FILES", 6);
+  auto const batch = getenv("INFINIT_BENCH_BATCH", 4);
+  auto gossip = Gossip{};
+  auto const now = std::chrono::system_clock::now();
+  for (int i = 0; i < contacts; ++i)
+    gossip.contacts[Address::random()] = {
+      {wire::Endpoint(boost::asio::ip::address_v4(0x0a000001 + i), 4242),
+       now - std::chrono::seconds(i)},
+      {wire::Endpoint(boost::asio::ip::address_v6::loopback(), 4242),
+       now - std::chrono::seconds(2 * i)},
+    };
+  auto homes = std::vector<Address>{Address::random(), Address::random()};
+  for (int i = 0; i < files; ++i)
+    gossip.files.emplace(
+      Address::random(),
+      std::make_pair(now - std::chrono::milliseconds(100 * i), homes[i % 2]));
+  ELLE_LOG("%s rounds of %s gossips with %s contacts and %s files",
+           rounds, batch, contacts, files);
+  std::size_t decoded = 0;
+  {
+    auto size = std::size_t(0);
+    auto buffers = std::vector<elle::Buffer>(batch);
+    auto const encode = measure([&] {
+        for (int r = 0; r < rounds; ++r)
+          for (auto& b: buffers)
+            b = elle::serialization::binary::serialize(gossip, false);
+      });
+    for (auto const& b: buffers)
+      size += b.size();
+    auto const decode = measure([&] {
+        for (int r = 0; r < rounds; ++r)
+          for (auto const& b: buffers)
+            decoded += elle::serialization::binary::deserialize<Gossip>(
+              b, false).contacts.size();
+      });
+    ELLE_LOG("generic: %s bytes per datagram, encode in %sms, decode in %sms",
+             size, encode.count(), decode.count());
+  }
+  {
+    auto pool = wire::BufferPool{};
+    auto size = std::size_t(0);
+    auto const encode = measure([&] {
+        for (int r = 0; r < rounds; ++r)
+        {
+          auto datagram = pool.acquire();
+          auto w = wire::Writer(datagram);
+          for (int i = 0; i < batch; ++i)
+          {
+            auto frame = w.begin_frame(3);
+            w.contacts(gossip.contacts);
+            w.files(gossip.files);
+            w.end_frame(frame);
+          }
+          size = datagram.size();
+          pool.release(std::move(datagram));
+        }
+      });
+    auto datagram = elle::Buffer{};
+    {
+      auto w = wire::Writer(datagram);
+      for (int i = 0; i < batch; ++i)
+      {
+        auto frame = w.begin_frame(3);
+        w.contacts(gossip.contacts);
+        w.files(gossip.files);
+        w.end_frame(frame);
+      }
+    }
+    auto const decode = measure([&] {
+        for (int r = 0; r < rounds; ++r)
+        {
+          auto frames = wire::Reader(datagram);
+          while (!frames.empty())
+          {
+            uint8_t type;
+            auto payload = frames.frame(type);
+            decoded += payload.contacts().size();
+            decoded += payload.files().size();
+          }
+        }
+      });
+    ELLE_LOG("compact: %s bytes per datagram, encode in %sms, decode in %sms",
+             size, encode.count(), decode.count());
+  }
+  ELLE_ASSERT_GT(decoded, 0u);
+  return 0;
+}
@@ -0,0 +1,137 @@
+#ifdef __GLIBC__
+# include <malloc.h>
+#endif
+
+#include <random>
+
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/mem_fun.hpp>
+#include <boost/multi_index_container.hpp>
+
+#include <elle/assert.hh>
+#include <elle/log.hh>
+#include <elle/multi_index_container.hh>
+#include <elle/os/environ.hh>
+#include <elle/range.hh>
+
+#include <infinit/overlay/kouncil/AddressBook.hh>
+
+#include "measure.hh"
+
+ELLE_LOG_COMPONENT("bench");
+
+using infinit::model::Address;
+namespace bmi = boost::multi_index;
+
+/// The address book Kouncil used to rely on, for comparison.
+class Entry
+{
+public:
+  Entry(Address node, Address block)
+    : _node(std::move(node))
+    , _block(std::move(block))
+  {}
+  ELLE_ATTRIBUTE_R(Address, node);
+  ELLE_ATTRIBUTE_R(Address, block);
+};
+
+static
+std::size_t
+hash_value(Entry const& entry)
+{
+  std::size_t seed = 0;
+  boost::hash_combine(seed, entry.node());
+  boost::hash_combine(seed, entry.block());
+  return seed;
+}
+
+static
+bool
+operator ==(Entry const& lhs, Entry const& rhs)
+{
+  return lhs.node() == rhs.node() && lhs.block() == rhs.block();
+}
+
+using LegacyAddressBook = bmi::multi_index_container<
+  Entry,
+  bmi::indexed_by<
+    bmi::hashed_non_unique<
+      bmi::const_mem_fun<Entry, Address const&, &Entry::node>>,
+    bmi::hashed_non_unique<
+      bmi::const_mem_fun<Entry, Address const&, &Entry::block>>,
+    bmi::hashed_unique<bmi::identity<Entry>>>>;
+
+static
+std::size_t
+allocated()
+{
+#ifdef __GLIBC__
+  return mallinfo().uordblks;
+#else
+  return 0;
+#endif
+}
+
+int
+main()
+{
+  using elle::os::getenv;
+  auto const blocks_count = getenv("INFINIT_BENCH_BLOCKS", 200000);
+  auto const nodes_count = getenv("INFINIT_BENCH_NODES", 50);
+  auto const replicas = getenv("INFINIT_BENCH_REPLICAS", 3);
+  auto nodes = std::vector<Address>{};
+  for (int i = 0; i < nodes_count; ++i)
+    nodes.emplace_back(Address::random());
+  auto blocks = std::vector<Address>{};
+  for (int i = 0; i < blocks_count; ++i)
+    blocks.emplace_back(Address::random(
+      i % 2 ? infinit::model::flags::mutable_block
+            : infinit::model::flags::immutable_block));
+  auto rng = std::default_random_engine{};
+  auto owners = std::vector<std::vector<int>>(blocks_count);
+  for (auto& o: owners)
+    for (int r = 0; r < replicas; ++r)
+      o.emplace_back((rng() % nodes_count + r) % nodes_count);
+  ELLE_LOG("%s blocks replicated %s times over %s nodes",
+           blocks_count, replicas, nodes_count);
+  std::size_t found = 0;
+  {
+    auto const before = allocated();
+    auto book = LegacyAddressBook{};
+    auto const insert = measure([&] {
+        for (int i = 0; i < blocks_count; ++i)
+          for (auto n: owners[i])
+            book.emplace(nodes[n], blocks[i]);
+      });
+    auto const memory = allocated() - before;
+    auto const lookup = measure([&] {
+        for (auto const& b: blocks)
+          for (auto const& e: elle::equal_range(book.get<1>(), b))
+            found += bool(e.node());
+      });
+    ELLE_LOG("legacy: %s bytes (%s per replica), "
+             "insert in %sms, lookup in %sms",
+             memory, memory / book.size(), insert.count(), lookup.count());
+  }
+  {
+    auto const before = allocated();
+    auto book = infinit::overlay::kouncil::AddressBook{};
+    auto const insert = measure([&] {
+        for (int i = 0; i < blocks_count; ++i)
+          for (auto n: owners[i])
+            book.insert(nodes[n], blocks[i]);
+      });
+    auto const memory = allocated() - before;
+    auto const lookup = measure([&] {
+        for (auto const& b: blocks)
+          for (auto const& n: book.owners(b))
+            found += bool(n);
+      });
+    ELLE_LOG("compact: %s bytes (%s per replica, %s estimated), "
+             "insert in %sms, lookup in %sms",
+             memory, memory / book.size(), book.footprint(),
+             insert.count(), lookup.count());
+  }
+  ELLE_ASSERT_GT(found, 0u);
+  return 0;
+}
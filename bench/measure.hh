@@ -0,0 +1,15 @@
+#pragma once
+
+#include <chrono>
+
+/// Wall-clock time spent running @a f.
+template <typename F>
+inline
+std::chrono::milliseconds
+measure(F const& f)
+{
+  auto const start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - start);
+}
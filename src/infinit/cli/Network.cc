@@ -24,6 +24,7 @@
 #include <infinit/model/doughnut/consensus/Paxos.hh>
 #include <infinit/model/prometheus.hh>
 #include <infinit/overlay/Kalimero.hh>
+#include <infinit/overlay/Rendezvous.hh>
 #include <infinit/overlay/kelips/Kelips.hh>
 #include <infinit/overlay/kouncil/Configuration.hh>
 #include <infinit/silo/Silo.hh>
@@ -66,6 +67,7 @@ namespace infinit
                cli::kelips = false,
                cli::kalimero = false,
                cli::kouncil = false,
+               cli::rendezvous = false,
                // Kelips options,
                cli::nodes = boost::none,
                cli::k = boost::none,
@@ -360,6 +362,7 @@ namespace infinit
       bool kelips,
       bool kalimero,
       bool kouncil,
+      bool rendezvous,
       // Kelips options,
       boost::optional<int> nodes,
       boost::optional<int> k,
@@ -377,13 +380,15 @@ namespace infinit
       auto owner = cli.as_user();
       auto overlay_config = [&]{
           auto res = std::unique_ptr<infinit::overlay::Configuration>{};
-          if (1 < kalimero + kelips + kouncil)
+          if (1 < kalimero + kelips + kouncil + rendezvous)
             elle::err<CLIError>("only one overlay type must be specified");
           if (kalimero)
             res = std::make_unique<infinit::overlay::KalimeroConfiguration>();
           else if (kelips)
             res = make_kelips_config(nodes, k, kelips_contact_timeout,
                                      encrypt, protocol);
+          else if (rendezvous)
+            res = std::make_unique<infinit::overlay::RendezvousConfiguration>();
           else
             res = std::make_unique<infinit::overlay::kouncil::Configuration>();
           if (protocol)
@@ -64,6 +64,7 @@ namespace infinit
                  decltype(cli::kelips = false),
                  decltype(cli::kalimero = false),
                  decltype(cli::kouncil = false),
+                 decltype(cli::rendezvous = false),
                  // Kelips options.
                  decltype(cli::nodes = boost::optional<int>()),
                  decltype(cli::k = boost::optional<int>()),
@@ -99,6 +100,7 @@ namespace infinit
         bool kelips = false,
         bool kalimero = false,
         bool kouncil = false,
+        bool rendezvous = false,
         // Kelips options,
         boost::optional<int> nodes = boost::none,
         boost::optional<int> k = boost::none,
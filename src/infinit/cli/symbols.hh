@@ -165,6 +165,7 @@ namespace infinit
     ELLE_DAS_CLI_SYMBOL(remove_admin, '\0', "remove administrator from group", false);
     ELLE_DAS_CLI_SYMBOL(remove_group, '\0', "remove group from group", false);
     ELLE_DAS_CLI_SYMBOL(remove_user, '\0', "remove user from group", false);
+    ELLE_DAS_CLI_SYMBOL(rendezvous, 0, "use a Rendezvous overlay network, for mostly static clusters", false);
     ELLE_DAS_CLI_SYMBOL(replication_factor, 'r', "data replication factor (default: 1)", false);
     ELLE_DAS_CLI_SYMBOL(resign_on_shutdown, '\0', "rebalance blocks out when shutting down", false);
     ELLE_DAS_CLI_SYMBOL(restart, 0, "restart {object}", false);
@@ -19,6 +19,9 @@ namespace
     {"BACKTRACE", ""},
     {"BEYOND", ""},
     {"CACHE_REFRESH_BATCH_SIZE", ""},
+    {"COMPRESSION", "Compression of file data blocks: none or lz4"},
+    {"COMPRESSION_MAX_RATIO", ""},
+    {"COMPRESSION_SAMPLE_SIZE", ""},
     {"CONNECT_TIMEOUT", ""},
     {"CRASH", "Generate a crash"},
     {"CRASH_REPORT", "Activate crash-reporting (new name)"},
@@ -26,13 +29,34 @@ namespace
     {"CRASH_REPORT_HOST", ""},
     {"DATA_HOME", ""},
     {"DISABLE_BALANCED_TRANSFERS", ""},
+    {"DISABLE_BLOCK_CODEC", ""},
     {"DISABLE_SIGNAL_HANDLER", ""},
+    {"FAT_INDIRECT_THRESHOLD", ""},
+    {"FAT_PAGE_SIZE", ""},
+    {"FETCH_HEADERS_BATCH_SIZE", ""},
+    {"FETCH_HEDGE_DELAY_MS", ""},
+    {"FETCH_HEDGE_MAX", ""},
     {"FIRST_BLOCK_DATA_SIZE", ""},
+    {"FS_CACHE_CLEANUP_INTERVAL_MS", ""},
+    {"FS_CACHE_SIZE", "Filesystem metadata caches size in bytes"},
+    {"GROUP_KEY_CACHE_SIZE", ""},
     {"HOME", ""},
     {"HOME_OVERRIDE", ""},
-    {"KELIPS_ASYNC", ""},
+    {"INLINE_DIRECTORY_SIZE",
+     "Size of the inline files of a directory past which files get blocks"},
+    {"INLINE_FILE_SIZE",
+     "Size under which new files are stored in their directory"},
     {"KELIPS_ASYNC_SEND", ""},
+    {"KELIPS_BATCH_DELAY_MS", ""},
+    {"KELIPS_BATCH_SIZE", ""},
     {"KELIPS_NO_SNUB", ""},
+    {"KELIPS_QUEUE_SIZE", ""},
+    {"KELIPS_WORKERS", ""},
+    {"KOUNCIL_ANTI_ENTROPY_INTERVAL", ""},
+    {"KOUNCIL_BROADCAST_DELAY_MS", ""},
+    {"KOUNCIL_LOOKUP_FANOUT", ""},
+    {"KOUNCIL_LOOKUP_HEDGE_DELAY_MS", ""},
+    {"LIST_DIRECTORY_ATTRIBUTES", ""},
     {"LOG_REACHABILITY", ""},
     {"LOOKAHEAD_BLOCKS", ""},
     {"LOOKAHEAD_THREADS", ""},
@@ -43,17 +67,26 @@ namespace
     {"NO_IPV6", "Disable IPv6"},
     {"NO_PREEMPT_DECODE", ""},
     {"PAXOS_LENIENT_FETCH", ""},
+    {"PREFETCH_CACHE_PRESSURE", ""},
     {"PREFETCH_DEPTH", ""},
     {"PREFETCH_GROUP", ""},
+    {"PREFETCH_QUEUE_SIZE", ""},
     {"PREFETCH_TASKS", ""},
     {"PREFETCH_THREADS", ""},
     {"PRESERVE_ACLS", ""},
     {"PROMETHEUS_ENDPOINT", ""},
     {"RDV", ""},
+    {"RENDEZVOUS_RECONNECT_INTERVAL", ""},
+    {"RPC_BULK", ""},
+    {"RPC_BULK_STANDBY", ""},
     {"RPC_DISABLE_CRYPTO", ""},
     {"RPC_SERVE_THREADS", ""},
+    {"RPC_SLOW_PERCENTILE", ""},
+    {"SECRET_CACHE_SIZE", ""},
+    {"SIGNATURE_CACHE_SIZE", ""},
     {"SOFTFAIL_RUNNING", ""},
     {"SOFTFAIL_TIMEOUT", ""},
+    {"TRUSTED_STORAGE", ""},
     {"USER", ""},
     {"UTP", ""},
   };
@@ -5,7 +5,7 @@
 
 #include <boost/algorithm/string/predicate.hpp>
 
-#include <elle/bench.hh>
+#include <elle/algorithm.hh>
 #include <elle/cast.hh>
 #include <elle/os/environ.hh>
 #include <elle/serialization/binary.hh>
@@ -62,6 +62,39 @@ namespace infinit
       return FileSystem::clock::now();
     }
 
+    /// Record the inline content of @a op target, if any.
+    static
+    void
+    replay_inline(DirectoryData::InlineFiles& files, Operation const& op)
+    {
+      if (op.inline_file)
+        files[op.target] = *op.inline_file;
+      else
+        files.erase(op.target);
+    }
+
+    /// The content of the block of @a directory, in the format of the
+    /// @a model version.
+    static
+    elle::Buffer
+    serialize_directory(DirectoryData& directory, model::Model const& model)
+    {
+      elle::Buffer res;
+      {
+        elle::IOStream os(res.ostreambuf());
+        auto version = model.version();
+        auto versions =
+          elle::serialization::_details::dependencies<
+            typename FileData::serialization_tag>(version, 42);
+        versions.emplace(
+          elle::type_info<typename FileData::serialization_tag>(),
+          version);
+        elle::serialization::binary::SerializerOut output(os, versions, true);
+        output.serialize_forward(directory);
+      }
+      return res;
+    }
+
     std::unique_ptr<Block>
     resolve_directory_conflict(Block& b,
                                Block& current,
@@ -93,6 +126,7 @@ namespace infinit
          }
          ELLE_TRACE("insert: Overriding entry %s", op.target);
          d._files[op.target] = std::make_pair(op.entry_type, op.address);
+         replay_inline(d._inline_files, op);
          break;
 
        case OperationType::update:
@@ -122,7 +156,9 @@ namespace infinit
              op.target, "", op.target);
            // FIXME update cached entry
          }
-         else if (d._files[op.target].second != op.address)
+         // Inline files are updated or promoted in place.
+         else if (d._files[op.target].second != op.address
+                  && !elle::contains(d._inline_files, op.target))
          {
            ELLE_LOG("Conflict: the object %s was replaced remotely,"
              " your changes will be dropped.",
@@ -133,21 +169,16 @@ namespace infinit
          {
            ELLE_TRACE("update: Overriding entry %s", op.target);
            d._files[op.target] = std::make_pair(op.entry_type, op.address);
+           replay_inline(d._inline_files, op);
          }
          break;
 
        case OperationType::remove:
          d._files.erase(op.target);
+         d._inline_files.erase(op.target);
          break;
        }
-       elle::Buffer data = [&d]
-         {
-           elle::Buffer res;
-           elle::IOStream os(res.ostreambuf());
-           elle::serialization::binary::SerializerOut output(os);
-           output.serialize_forward(d);
-           return res;
-         }();
+       auto data = serialize_directory(d, model);
        auto res = elle::cast<ACLBlock>::runtime(current.clone());
        res->data(data);
        return std::move(res);
@@ -207,6 +238,8 @@ namespace infinit
       s.serialize("optarget", _op.target);
       s.serialize("opaddr", _op.address);
       s.serialize("opetype", _op.entry_type, elle::serialization::as<int>());
+      if (version >= elle::Version(0, 9, 0))
+        s.serialize("opinline", _op.inline_file);
     }
 
     struct ConflictContent
@@ -302,7 +335,6 @@ namespace infinit
       : _address{address}
       , _block_version{-1}
       , _inherit_auth{false}
-      , _prefetching{false}
       , _last_used{FileSystem::now()}
       , _path{path}
     {}
@@ -331,6 +363,64 @@ namespace infinit
       s.serialize("header", this->_header);
       s.serialize("content", this->_files);
       s.serialize("inherit_auth", this->_inherit_auth);
+      // Last, so that older readers ignore it.
+      if (v >= elle::Version(0, 9, 0))
+        s.serialize("inline_files", this->_inline_files);
+    }
+
+    std::size_t
+    DirectoryData::footprint() const
+    {
+      // Account for an average entry name length rather than walking the
+      // entries.
+      auto const entry_size = sizeof(Files::value_type) + 32;
+      auto inline_size = std::size_t(0);
+      for (auto const& f: this->_inline_files)
+        inline_size += sizeof(InlineFiles::value_type) + f.second.data.size();
+      return sizeof(DirectoryData)
+        + this->_path.native().size()
+        + this->_files.size() * entry_size
+        + inline_size;
+    }
+
+    FileHeader
+    DirectoryData::inline_header(std::string const& name) const
+    {
+      auto res = this->_inline_files.at(name).header;
+      res.mode = (res.mode & ~0606) | (this->_header.mode & 0606);
+      return res;
+    }
+
+    std::size_t
+    DirectoryData::inline_size() const
+    {
+      auto res = std::size_t(0);
+      for (auto const& f: this->_inline_files)
+        res += f.second.data.size();
+      return res;
+    }
+
+    /*-----------.
+    | InlineFile |
+    `-----------*/
+
+    InlineFile::InlineFile(FileHeader header, elle::Buffer data)
+      : header(std::move(header))
+      , data(std::move(data))
+    {}
+
+    InlineFile::InlineFile(elle::serialization::SerializerIn& s,
+                           elle::Version const& v)
+    {
+      this->serialize(s, v);
+    }
+
+    void
+    InlineFile::serialize(elle::serialization::Serializer& s,
+                          elle::Version const& v)
+    {
+      s.serialize("header", this->header);
+      s.serialize("data", this->data);
     }
 
     static
@@ -362,7 +452,6 @@ namespace infinit
                  _block_version,
                  new_version,
                  block.address());
-      _last_used = FileSystem::now();
 
       bool empty = false;
       elle::IOStream is(
@@ -387,6 +476,7 @@ namespace infinit
         try
         {
           _files.clear();
+          _inline_files.clear();
           _header.xattrs.clear();
           input.serialize_forward(*this);
         }
@@ -428,19 +518,7 @@ namespace infinit
         ELLE_DEBUG_SCOPE("set mtime");
         _header.mtime = time(nullptr);
       }
-      elle::Buffer data;
-      {
-        elle::IOStream os(data.ostreambuf());
-        auto version = model.version();
-        auto versions =
-          elle::serialization::_details::dependencies<typename FileData::serialization_tag>(
-            version, 42);
-        versions.emplace(
-          elle::type_info<typename FileData::serialization_tag>(),
-          version);
-        elle::serialization::binary::SerializerOut output(os, versions, true);
-        output.serialize_forward(*this);
-      }
+      auto data = serialize_directory(*this, model);
       try
       {
         int version = 0;
@@ -557,244 +635,52 @@ namespace infinit
       return _owner.path((_data->_path / name).string());
     }
 
-    struct PrefetchEntry
+    void
+    DirectoryData::_prefetch(
+      FileSystem& fs,
+      std::unordered_map<std::string, FileHeader> const& fetched)
     {
-      PrefetchEntry(std::string name, Address address,
-                    int level, bool is_dir,
-                    boost::optional<int> cached_version)
-        : name{std::move(name)}
-        , address{std::move(address)}
-        , level{level}
-        , is_dir{is_dir}
-        , cached_version{std::move(cached_version)}
-      {}
-
-      std::string name;
-      Address address;
-      int level;
-      bool is_dir;
-      boost::optional<int> cached_version;
-    };
+      if (FileSystem::now() - this->_last_prefetch < std::chrono::seconds(15))
+        return;
+      this->_last_prefetch = FileSystem::now();
+      fs.prefetch(*this, fetched);
+    }
 
     static
-    boost::optional<int>
-    cached_version(FileSystem& fs, Address addr, EntryType type)
+    void
+    header_stat(FileSystem& fs,
+                FileHeader const& h,
+                std::pair<EntryType, Address> const& entry,
+                struct stat* st)
     {
-      if (type == EntryType::directory)
+      Node::header_stat(h, st);
+      if (entry.first == EntryType::directory)
       {
-        auto it = fs.directory_cache().find(addr);
-        if (it != fs.directory_cache().end())
-          return (*it)->block_version();
+        st->st_mode |= S_IFDIR;
+        if (st->st_mode & 0400)
+          st->st_mode |= 0100;
       }
       else
       {
-        auto it = fs.file_cache().find(addr);
-        if (it != fs.file_cache().end())
-          return (*it)->block_version();
+        st->st_mode |= S_IFREG;
+        if (auto size = File::open_size(fs, entry.second))
+          st->st_size = *size;
       }
-      return {};
-    }
-
-    void
-    DirectoryData::_prefetch(FileSystem& fs,
-                             std::shared_ptr<DirectoryData> self)
-    {
-      ELLE_ASSERT_EQ(self.get(), this);
-      using elle::os::getenv;
-      static int prefetch_threads = getenv("INFINIT_PREFETCH_THREADS", 3);
-      static int prefetch_depth = getenv("INFINIT_PREFETCH_DEPTH", 2);
-      static int prefetch_group = getenv("INFINIT_PREFETCH_GROUP", 5);
-      static int prefetch_tasks = getenv("INFINIT_PREFETCH_TASKS", 5);
-      // Disable prefetching if we have no cache
-      static bool have_cache =
-        model::doughnut::consensus::StackedConsensus::find<
-          model::doughnut::consensus::Cache>(
-            dynamic_cast<model::doughnut::Doughnut&>(
-              *fs.block_store()).consensus().get());
-      if (prefetch_threads && !have_cache)
-      {
-        ELLE_TRACE("Disabling directory prefetching since cache is disabled.");
-        prefetch_threads = 0;
-      }
-      int group_size = prefetch_group;
-      int nthreads = prefetch_threads;
-      if (this->_prefetching ||
-          nthreads == 0 ||
-          (FileSystem::now() - this->_last_prefetch) < std::chrono::seconds(15) ||
-          fs.prefetching() >= prefetch_tasks)
-        return;
-      this->_last_prefetch = FileSystem::now();
-      fs.prefetching()++;
-      auto files = std::make_shared<std::vector<PrefetchEntry>>();
-      for (auto const& f: this->_files)
-        files->emplace_back(
-          f.first, f.second.second, 0,
-          f.second.first == EntryType::directory,
-          cached_version(fs, f.second.second, f.second.first));
-      this->_prefetching = true;
-      auto running = std::make_shared<int>(nthreads);
-      auto parked = std::make_shared<int>(0);
-      auto available = std::make_shared<elle::reactor::Barrier>("files_prefetchable");
-      if (!files->empty())
-        available->open();
-      auto prefetch_task =
-        [self, files, fs = &fs, running,
-         parked, nthreads, group_size, available]
-        {
-          static elle::Bench bench("bench.fs.prefetch", std::chrono::seconds(10000));
-          elle::Bench::BenchScope bs(bench);
-          auto start_time = boost::posix_time::microsec_clock::universal_time();
-          int nf = 0;
-          bool should_exit = false;
-          while (true)
-          {
-            while (files->empty())
-            {
-              ELLE_DEBUG("parking");
-              ++*parked;
-              if (*parked == nthreads)
-              {
-                ELLE_DEBUG("all threads parked");
-                available->open();
-                should_exit = true;
-                break;
-              }
-              else
-                ELLE_DEBUG("%s/%s threads parked", *parked, nthreads);
-              available->close();
-              elle::reactor::wait(*available);
-              --*parked;
-            }
-            if (should_exit)
-              break;
-            auto addresses = std::vector<model::Model::AddressVersion>{};
-            auto recurse =std::unordered_map<Address, int>{};
-            do
-            {
-              ++nf;
-              auto e = files->back();
-              ELLE_TRACE_SCOPE("%s: prefetch \"%s\"", *self, e.name);
-              files->pop_back();
-              Address addr(e.address.value(),
-                model::flags::mutable_block, false);
-              addresses.emplace_back(addr, e.cached_version);
-              if (e.is_dir && e.level + 1 < prefetch_depth)
-                recurse.insert(std::make_pair(addr, e.level));;
-            }
-            while (signed(addresses.size()) < group_size && !files->empty());
-            if (files->empty())
-              available->close();
-            if (addresses.size() == 1)
-            {
-              std::unique_ptr<model::blocks::Block> block;
-              try
-              {
-                Address addr = addresses.front().first;
-                block = fs->block_store()->fetch(addr, addresses.front().second);
-                if (!recurse.empty())
-                {
-                  std::shared_ptr<DirectoryData> d;
-                  if (block)
-                    d = std::shared_ptr<DirectoryData>(
-                      new DirectoryData({}, *block, {true, true}));
-                  else
-                    d = *(fs->directory_cache().find(addr));
-                  for (auto const& f: d->_files)
-                  {
-                    files->emplace_back(
-                      f.first, f.second.second, recurse.at(addr) + 1,
-                      f.second.first == EntryType::directory,
-                      cached_version(*fs, f.second.second, f.second.first));
-                    available->open();
-                  }
-                }
-              }
-              catch (elle::Error const& e)
-              {
-                ELLE_TRACE("Exception while prefeching: %s", e.what());
-              }
-              catch (std::out_of_range const& e)
-              {
-                ELLE_TRACE("Entry vanished from cache: %s", e.what());
-              }
-            }
-            else
-            { // multifetch
-              // FIXME: pass local versions
-              fs->block_store()->multifetch(addresses,
-                  [&](Address addr, std::unique_ptr<model::blocks::Block> block,
-                      std::exception_ptr exception)
-                  {
-                    if (recurse.find(addr) != recurse.end()
-                        && recurse.at(addr) + 1 < prefetch_depth)
-                    {
-                      try
-                      {
-                        std::shared_ptr<DirectoryData> d;
-                        if (block)
-                          d = std::shared_ptr<DirectoryData>(
-                            new DirectoryData({}, *block, {true, true}));
-                        else
-                        {
-                          auto it = fs->directory_cache().find(addr);
-                          if (it == fs->directory_cache().end())
-                            elle::err("directory at %f vanished from cache", addr);
-                          d = *it;
-                        }
-                        for (auto const& f: d->_files)
-                          files->emplace_back(
-                            f.first, f.second.second, recurse.at(addr) + 1,
-                            f.second.first == EntryType::directory,
-                            cached_version(*fs, f.second.second, f.second.first));
-                        available->open();
-                      }
-                      catch (elle::Error const& e)
-                      {
-                        ELLE_TRACE("Exception while prefeching: %s", e.what());
-                      }
-                    }
-                  });
-            }
-          }
-          ELLE_TRACE("prefetched %s entries in %s us",
-                   nf,
-                   (boost::posix_time::microsec_clock::universal_time() - start_time)
-                     .total_microseconds());
-          if (!(--(*running)))
-          {
-            self->_prefetching = false;
-            fs->prefetching()--;
-          }
-          auto* self = elle::reactor::scheduler().current();
-          auto& running = fs->running();
-          auto it = std::find_if(running.begin(), running.end(),
-            [self](elle::reactor::Thread::unique_ptr const& p)
-            {
-              return p.get() == self;
-            });
-          if (it != running.end())
-          {
-            (*it)->dispose(true);
-            it->release();
-            std::swap(running.back(), *it);
-            running.pop_back();
-          }
-          else
-            ELLE_WARN("Thread %s not found in running list", self);
-      };
-      for (int i = 0; i < nthreads; ++i)
-        fs.running().emplace_back(
-          new elle::reactor::Thread(
-            elle::sprintf("prefetcher %x-%x-%s", (void*)&fs, (void*)parked.get(), i),
-            prefetch_task
-            ));
+      st->st_ino = (unsigned short)std::hash<Address>()(entry.second);
     }
 
     void
     Directory::list_directory(rfs::OnDirectoryEntry cb)
     {
       ELLE_TRACE_SCOPE("%s: list", *this);
-      _data->_prefetch(_owner, _data);
+      static bool const fetch_headers =
+        elle::os::getenv("INFINIT_LIST_DIRECTORY_ATTRIBUTES", true);
+      // Fetch all entries headers by batches, so subsequent stats are served
+      // from the caches.
+      auto headers = std::unordered_map<std::string, FileHeader>{};
+      if (fetch_headers)
+        headers = _owner.fetch_headers(*_data);
+      _data->_prefetch(_owner, headers);
       struct stat st;
       st.st_size  = 0;
       st.st_atime = 0;
@@ -805,6 +691,13 @@ namespace infinit
       cb("..", &st);
       for (auto const& e: _data->_files)
       {
+        auto it = headers.find(e.first);
+        if (it != headers.end())
+        {
+          header_stat(this->_owner, it->second, e.second, &st);
+          cb(e.first, &st);
+          continue;
+        }
         switch(e.second.first)
         {
         case EntryType::pending:
@@ -903,6 +796,9 @@ namespace infinit
     void
     Directory::chmod(mode_t mode)
     {
+      // Other permissions are mapped to the world permissions.
+      if (this->_owner.map_other_permissions())
+        this->_promote_inline_files();
       Node::chmod(mode);
     }
 
@@ -951,6 +847,7 @@ namespace infinit
         else if (*special == "fsck.deref")
         {
           this->_data->_files.erase(value);
+          this->_data->_inline_files.erase(value);
           this->_data->write(_owner,
                              {OperationType::remove, value},
                              DirectoryData::null_block,
@@ -993,7 +890,10 @@ namespace infinit
           auto it = _data->_files.find(value);
           if (it == _data->_files.end())
             THROW_NOENT();
-          File f(_owner, it->second.second, {}, _data, value);
+          auto data = elle::contains(_data->_inline_files, value)
+            ? std::make_shared<FileData>(_data->_path / value, _data, value)
+            : nullptr;
+          File f(_owner, it->second.second, data, _data, value);
           try
           {
             f.unlink();
@@ -1004,16 +904,32 @@ namespace infinit
               "%s: unlink of %s failed with %s, forcibly remove from parent",
               *this, value, e.what());
             this->_data->_files.erase(value);
+            this->_data->_inline_files.erase(value);
             this->_data->write(_owner,
                                Operation{OperationType::remove, value},
                                DirectoryData::null_block, true);
           }
           return;
         }
+        else if (boost::starts_with(*special, "auth.")
+                 || *special == "auth_others")
+          this->_promote_inline_files();
       }
       Node::setxattr(name, value, flags);
     }
 
+    void
+    Directory::_promote_inline_files()
+    {
+      // Files created in a directory inheriting its permissions get a copy
+      // of them, whereas inline files have none of their own and follow
+      // the directory ones: move them out so they keep their permissions.
+      auto const names = elle::make_vector(
+        this->_data->_inline_files, [] (auto const& f) { return f.first; });
+      ELLE_DEBUG("%s: promote inline files %s", *this, names);
+      File::_promote(this->_owner, this->_data, names);
+    }
+
     std::string
     Directory::getxattr(std::string const& key)
     {
@@ -82,6 +82,9 @@ namespace infinit
       FileHeader& _header() override;
       void move_recurse(bfs::path const& current,
           bfs::path const& where);
+      /// Move inline files to blocks of their own, before the directory
+      /// permissions change.
+      void _promote_inline_files();
       friend class Unknown;
       friend class File;
       friend class Symlink;
@@ -13,9 +13,6 @@
 #include <elle/cast.hh>
 #include <elle/os/environ.hh>
 
-#include <elle/cryptography/random.hh>
-#include <elle/cryptography/SecretKey.hh>
-
 #ifdef INFINIT_WINDOWS
 #undef stat
 #endif
@@ -24,9 +21,11 @@
 
 #include <infinit/filesystem/Directory.hh>
 #include <infinit/filesystem/FileHandle.hh>
+#include <infinit/filesystem/compression.hh>
 #include <infinit/filesystem/umbrella.hh>
 #include <infinit/filesystem/xattribute.hh>
 
+#include <elle/algorithm.hh>
 #include <elle/bench.hh>
 #include <elle/cast.hh>
 #include <elle/os/environ.hh>
@@ -34,6 +33,7 @@
 #include <infinit/model/MissingBlock.hh>
 #include <infinit/model/doughnut/Doughnut.hh>
 #include <infinit/model/doughnut/User.hh>
+#include <infinit/model/doughnut/sha256.hh>
 
 ELLE_LOG_COMPONENT("infinit.filesystem.File");
 
@@ -43,6 +43,24 @@ namespace infinit
   {
     namespace
     {
+      /// Number of FAT entries per indirect page.
+      auto const fat_page_size = std::size_t(
+        std::max(1, elle::os::getenv("INFINIT_FAT_PAGE_SIZE", 1024)));
+      /// FAT size above which entries are stored in indirect pages.
+      auto const fat_indirect_threshold =
+        std::size_t(elle::os::getenv("INFINIT_FAT_INDIRECT_THRESHOLD", 1024));
+
+      /// Key of an inline file among open files, which have no block
+      /// address.
+      Address
+      inline_address(Address const& directory, std::string const& name)
+      {
+        auto const digest = model::doughnut::sha256::digest(
+          {elle::ConstWeakBuffer(directory.value(), sizeof(Address::Value)),
+           elle::ConstWeakBuffer(name.data(), name.size())});
+        return Address(digest.contents());
+      }
+
       std::string print_mode(int m)
       {
         auto res = std::string{};
@@ -87,14 +105,7 @@ namespace infinit
       auto od = FileData(_path, b, {true, true}, 0);
       od.merge(cd, _target);
       // write od data into current block
-      elle::Buffer serdata;
-      {
-        elle::IOStream os(serdata.ostreambuf());
-        elle::serialization::binary::SerializerOut output(os);
-        output.serialize("header", od._header);
-        output.serialize("fat", od._fat);
-        output.serialize("data", od._data);
-      }
+      auto serdata = od._serialize(*this->_model);
       auto block = elle::cast<MutableBlock>::runtime(current.clone());
       if (_target & WriteTarget::perms)
       {
@@ -148,6 +159,11 @@ namespace infinit
     File::chmod(mode_t mode)
     {
       ELLE_DEBUG("chmod to %s", print_mode(mode));
+      // Inline files have the world permissions of their directory.
+      if (this->_filedata && this->_filedata->is_inline()
+          && this->_owner.map_other_permissions()
+          && (mode & 06) != (this->_filedata->_header.mode & 06))
+        this->_ensure_first_block();
       Node::chmod(mode);
       ELLE_DEBUG("current mode: %s", print_mode(_filedata->_header.mode));
     }
@@ -251,10 +267,10 @@ namespace infinit
         try
         {
           _fat.clear();
+          _fat_pages.clear();
+          _fat_dirty_pages.clear();
           _header.xattrs.clear();
-          input.serialize("header", _header);
-          input.serialize("fat", _fat);
-          input.serialize("data", _data);
+          input.serialize_forward(*this);
         }
         catch(elle::serialization::Error const& e)
         {
@@ -274,9 +290,9 @@ namespace infinit
           _header.mode |= 0200;
       }
       this->_block_version = dynamic_cast<ACLBlock&>(block).version();
-      ELLE_DEBUG("%s: updated from %f: sz=%s, links=%s, mode=%s, fatsize=%s, firstblocksize=%s",
+      ELLE_DEBUG("%s: updated from %f: sz=%s, links=%s, mode=%s, fatsize=%s, fatpages=%s, firstblocksize=%s",
                  this, _address, _header.size, _header.links, print_mode(_header.mode),
-                 _fat.size(), _data.size());
+                 _fat_size, _fat_pages.size(), _data.size());
     }
 
     FileData::FileData(bfs::path path, Address address, int mode, int block_size)
@@ -291,6 +307,30 @@ namespace infinit
       );
     }
 
+    FileData::FileData(bfs::path path,
+                       std::shared_ptr<DirectoryData> parent,
+                       std::string name)
+      : _address(inline_address(parent->address(), name))
+      , _block_version(-1)
+      , _last_used(FileSystem::now())
+      , _header(parent->inline_header(name))
+      , _data(parent->inline_files().at(name).data)
+      , _path(std::move(path))
+      , _inline_parent(std::move(parent))
+      , _inline_name(std::move(name))
+    {}
+
+    std::size_t
+    FileData::footprint() const
+    {
+      auto const fat_entry_size = sizeof(FatEntry)
+        + (this->_fat.empty() ? 0 : this->_fat.front().second.size());
+      return sizeof(FileData)
+        + this->_path.native().size()
+        + this->_data.size()
+        + (this->_fat.size() + this->_fat_pages.size()) * fat_entry_size;
+    }
+
     void
     FileData::merge(const FileData& previous, WriteTarget target)
     {
@@ -313,6 +353,10 @@ namespace infinit
         if (previous._header.block_size)
           _header.block_size = previous._header.block_size;
         _fat = previous._fat;
+        _fat_pages = previous._fat_pages;
+        _fat_size = previous._fat_size;
+        _fat_loaded = previous._fat_loaded;
+        _fat_dirty_pages.clear();
         _data = elle::Buffer(previous._data.contents(), previous._data.size());
       }
       if (! (target & WriteTarget::times))
@@ -344,6 +388,8 @@ namespace infinit
       ELLE_DEBUG("%s: write at %f: sz=%s, links=%s, mode=%s, fatsize=%s, firstblocksize=%s",
                  this, _address,
                  _header.size, _header.links, print_mode(_header.mode), _fat.size(), _data.size());
+      if (this->_inline_parent && this->_write_inline(fs))
+        return;
       auto& model = *fs.block_store();
       std::unique_ptr<ACLBlock> myblock_;
       auto& block = (&block_ == &DirectoryData::null_block) ? myblock_ : block_;
@@ -370,22 +416,40 @@ namespace infinit
                    _header.size, _header.links, print_mode(_header.mode), _fat.size(), block->get_world_permissions(),
                    block->version());
       }
-      elle::Buffer serdata;
-      {
-        elle::IOStream os(serdata.ostreambuf());
-        auto version = model.version();
-        auto versions =
-          elle::serialization::_details::dependencies<typename FileData::serialization_tag>(
-            version, 42);
-        versions.emplace(
-          elle::type_info<typename FileData::serialization_tag>(),
-          version);
-        elle::serialization::binary::SerializerOut output(os,
-          versions, true);
-        output.serialize("header", _header);
-        output.serialize("fat", _fat);
-        output.serialize("data", _data);
-      }
+      auto obsolete_pages = std::vector<Address>{};
+      auto stored_pages = std::vector<Address>{};
+      auto const fat_pages = this->_fat_pages;
+      auto const fat_size = this->_fat_size;
+      auto const fat_dirty_pages = this->_fat_dirty_pages;
+      // Pages stored for a file block that could not be committed are
+      // referenced by nothing, remove them and go back to the committed ones.
+      auto drop_pages = [&]
+        {
+          for (auto const& page: stored_pages)
+            try
+            {
+              unchecked_remove_chb(model, page, this->_address);
+            }
+            catch (elle::Error const& e)
+            {
+              ELLE_WARN("%s: unable to remove FAT page %f: %s",
+                        this, page, e);
+            }
+          this->_fat_pages = fat_pages;
+          this->_fat_size = fat_size;
+          this->_fat_dirty_pages = fat_dirty_pages;
+        };
+      if (target & WriteTarget::data)
+        try
+        {
+          obsolete_pages = this->_store_fat_pages(model, stored_pages);
+        }
+        catch (elle::Error const&)
+        {
+          drop_pages();
+          throw;
+        }
+      auto serdata = this->_serialize(model);
       try
       {
         ELLE_ASSERT(block);
@@ -406,10 +470,13 @@ namespace infinit
           else
             model.seal_and_update(*block, std::move(resolver));
         }
+        for (auto const& page: obsolete_pages)
+          unchecked_remove_chb(model, page, this->_address);
       }
       catch (infinit::model::doughnut::ValidationFailed const& e)
       {
         ELLE_TRACE("permission exception: %s", e.what());
+        drop_pages();
         // We made changes to filedata that couldn't be pushed, evict from cache
         fs._file_cache.erase(_address);
         throw rfs::Error(EACCES, elle::sprintf("%s", e.what()));
@@ -417,12 +484,14 @@ namespace infinit
       catch (model::MissingBlock const&)
       {
         ELLE_WARN("%s: unable to commit as file was deleted", this);
+        drop_pages();
         return;
       }
       catch(elle::Error const& e)
       {
         ELLE_WARN("unexpected exception storing %f: %s",
           _address, e);
+        drop_pages();
         throw rfs::Error(EIO, e.what());
       }
     }
@@ -432,6 +501,9 @@ namespace infinit
     {
       ELLE_ASSERT(this->_filedata);
       _filedata->write(_owner, target, _first_block);
+      // The file may have outgrown its directory.
+      if (!this->_filedata->is_inline())
+        this->_address = this->_filedata->address();
     }
 
     void
@@ -439,10 +511,50 @@ namespace infinit
     {
       if (this->_first_block)
         return;
+      if (this->_filedata && this->_filedata->is_inline())
+      {
+        // Promote through open handles first, so they write to the new
+        // block.
+        auto it = _owner.file_buffers().find(this->_filedata->address());
+        if (it != _owner.file_buffers().end())
+          if (auto buffer = it->second.lock())
+            buffer->_file.promote(this->_owner);
+        this->_first_block = this->_filedata->promote(this->_owner);
+        this->_address = this->_filedata->address();
+        if (this->_first_block)
+          return;
+      }
       this->_filedata.reset();
      _fetch();
     }
 
+    void
+    File::_promote(FileSystem& fs,
+                   std::shared_ptr<DirectoryData> const& parent,
+                   std::vector<std::string> const& names)
+    {
+      auto files = std::vector<FileData*>{};
+      auto datas = std::vector<std::shared_ptr<FileData>>{};
+      auto buffers = std::vector<std::shared_ptr<FileBuffer>>{};
+      for (auto const& name: names)
+      {
+        auto data = std::make_shared<FileData>(parent->_path / name,
+                                               parent, name);
+        // Promote through open handles, so they write to the new block.
+        auto it = fs.file_buffers().find(data->address());
+        if (it != fs.file_buffers().end())
+          if (auto buffer = it->second.lock())
+          {
+            files.emplace_back(&buffer->_file);
+            buffers.emplace_back(std::move(buffer));
+            continue;
+          }
+        files.emplace_back(data.get());
+        datas.emplace_back(std::move(data));
+      }
+      FileData::promote(fs, files);
+    }
+
     void
     File::link(bfs::path const& where)
     {
@@ -468,6 +580,26 @@ namespace infinit
     void
     File::unlink()
     {
+      if (this->_filedata && this->_filedata->is_inline())
+      {
+        if (!(_parent->_header.mode & 0200))
+          THROW_ACCES();
+        auto info = _parent->_files.at(_name);
+        auto content = _parent->_inline_files.at(_name);
+        elle::SafeFinally revert([&] {
+            _parent->_files[_name] = info;
+            _parent->_inline_files[_name] = content;
+        });
+        _parent->_files.erase(_name);
+        _parent->_inline_files.erase(_name);
+        _parent->write(
+          _owner,
+          {OperationType::remove, _name},
+          DirectoryData::null_block,
+          true);
+        revert.abort();
+        return;
+      }
       _ensure_first_block();
       if ( !(_filedata->_header.mode & 0200)
         || !(_parent->_header.mode & 0200))
@@ -500,11 +632,17 @@ namespace infinit
         }
         else
         {
+          _filedata->load_fat(*_owner.block_store());
           for (unsigned i=0; i<_filedata->_fat.size(); ++i)
           {
             ELLE_DEBUG_SCOPE("removing %s: %f", i, _filedata->_fat[i].first);
             _owner.unchecked_remove(_filedata->_fat[i].first);
           }
+          for (auto const& page: _filedata->_fat_pages)
+          {
+            ELLE_DEBUG_SCOPE("removing FAT page %f", page.first);
+            _owner.unchecked_remove(page.first);
+          }
           ELLE_DEBUG_SCOPE("removing first block at %f", _first_block->address());
           _owner.unchecked_remove(_first_block->address());
         }
@@ -515,6 +653,14 @@ namespace infinit
     File::rename(bfs::path const& where)
     {
       ELLE_TRACE_SCOPE("%s: rename to %s", *this, where);
+      // Inline files have the permissions of their directory, keep them
+      // when moving to another one. Open handles find inline files by
+      // name.
+      if (this->_filedata && this->_filedata->is_inline()
+          && (where.parent_path() != this->_parent->_path
+              || elle::contains(this->_owner.file_buffers(),
+                                this->_filedata->address())))
+        this->_ensure_first_block();
       Node::rename(where);
     }
 
@@ -549,14 +695,21 @@ namespace infinit
         ELLE_WARN("unexpected exception on stat: %s", e);
         throw rfs::Error(EIO, elle::sprintf("%s", e));
       }
-      auto it = _owner.file_buffers().find(_filedata->address());
-      if (it != _owner.file_buffers().end())
+      if (auto size = File::open_size(this->_owner, _filedata->address()))
+      {
+        ELLE_DEBUG("open file size overwrite: %s -> %s", st->st_size, *size);
+        st->st_size = *size;
+      }
+    }
+
+    boost::optional<uint64_t>
+    File::open_size(FileSystem& fs, Address const& address)
+    {
+      auto it = fs.file_buffers().find(address);
+      if (it != fs.file_buffers().end())
         if (auto fh = it->second.lock())
-        {
-          ELLE_DEBUG("open file size overwrite: %s -> %s",
-                     st->st_size, fh->_file._header.size);
-          st->st_size = fh->_file._header.size;
-        }
+          return fh->_file._header.size;
+      return boost::none;
     }
 
     void
@@ -609,6 +762,377 @@ namespace infinit
       _register_nbr("NewBlockResolver");
     }
 
+    /*-------------.
+    | Indirect FAT |
+    `-------------*/
+
+    void
+    FileData::serialize(elle::serialization::Serializer& s,
+                        elle::Version const& v)
+    {
+      // Indirect pages are only written from 0.9.0 on, see
+      // _store_fat_pages.
+      auto const paged = v >= elle::Version(0, 9, 0);
+      ELLE_ASSERT(s.in() || paged || this->_fat_pages.empty());
+      s.serialize("header", this->_header);
+      if (s.out() && !this->_fat_pages.empty())
+      {
+        auto inline_fat = std::vector<FatEntry>{};
+        s.serialize("fat", inline_fat);
+      }
+      else
+        s.serialize("fat", this->_fat);
+      s.serialize("data", this->_data);
+      if (paged)
+      {
+        s.serialize("fat_pages", this->_fat_pages);
+        if (s.out() && this->_fat_pages.empty())
+          this->_fat_size = this->_fat.size();
+        s.serialize("fat_size", this->_fat_size);
+      }
+      if (s.in())
+      {
+        this->_fat_loaded = this->_fat_pages.empty();
+        if (this->_fat_loaded)
+          this->_fat_size = this->_fat.size();
+      }
+    }
+
+    elle::Buffer
+    FileData::_serialize(model::Model const& model)
+    {
+      elle::Buffer res;
+      {
+        elle::IOStream os(res.ostreambuf());
+        auto version = model.version();
+        auto versions =
+          elle::serialization::_details::dependencies<
+            typename FileData::serialization_tag>(version, 42);
+        versions.emplace(
+          elle::type_info<typename FileData::serialization_tag>(),
+          version);
+        elle::serialization::binary::SerializerOut output(os, versions, true);
+        output.serialize_forward(*this);
+      }
+      return res;
+    }
+
+    void
+    FileData::set_fat_entry(int index, FatEntry entry)
+    {
+      this->_fat.at(index) = std::move(entry);
+      this->_fat_dirty_pages.insert(index / fat_page_size);
+    }
+
+    void
+    FileData::load_fat(model::Model& model)
+    {
+      if (this->_fat_loaded)
+        return;
+      ELLE_TRACE_SCOPE("%s: load %s FAT pages of %s", this,
+                       this->_fat_pages.size(), this->_path);
+      auto addresses = std::vector<model::Model::AddressVersion>{};
+      auto indexes = std::unordered_multimap<Address, int>{};
+      for (int i = 0; i < signed(this->_fat_pages.size()); ++i)
+      {
+        auto const& address = this->_fat_pages[i].first;
+        if (!elle::contains(indexes, address))
+          addresses.emplace_back(address, boost::none);
+        indexes.emplace(address, i);
+      }
+      auto pages = std::vector<std::vector<FatEntry>>(this->_fat_pages.size());
+      std::exception_ptr error;
+      model.multifetch(
+        addresses,
+        [&] (Address address,
+             std::unique_ptr<model::blocks::Block> block,
+             std::exception_ptr exception)
+        {
+          if (exception)
+          {
+            error = exception;
+            return;
+          }
+          auto range = indexes.equal_range(address);
+          for (auto it = range.first; it != range.second; ++it)
+          {
+            auto const plain = decode_data_block(
+              elle::Buffer(block->data()), this->_fat_pages[it->second].second);
+            elle::IOStream is(plain.istreambuf());
+            elle::serialization::binary::SerializerIn input(is);
+            input.serialize("entries", pages[it->second]);
+          }
+        });
+      if (error)
+        std::rethrow_exception(error);
+      auto fat = std::vector<FatEntry>{};
+      fat.reserve(this->_fat_size);
+      for (auto& page: pages)
+        std::move(page.begin(), page.end(), std::back_inserter(fat));
+      if (fat.size() != this->_fat_size)
+        throw rfs::Error(
+          EIO, elle::sprintf("FAT pages hold %s entries instead of %s",
+                             fat.size(), this->_fat_size));
+      this->_fat = std::move(fat);
+      this->_fat_loaded = true;
+    }
+
+    std::vector<Address>
+    FileData::_store_fat_pages(model::Model& model,
+                               std::vector<Address>& stored)
+    {
+      auto res = std::vector<Address>{};
+      if (!this->_fat_loaded)
+        return res;
+      auto const size = this->_fat.size();
+      // Older clients would not find the indirect pages.
+      if (size <= fat_indirect_threshold
+          || model.version() < elle::Version(0, 9, 0))
+      {
+        for (auto const& page: this->_fat_pages)
+          res.emplace_back(page.first);
+        this->_fat_pages.clear();
+      }
+      else
+      {
+        auto const encrypt =
+          dynamic_cast<model::doughnut::Doughnut const&>(model)
+          .encrypt_options().encrypt_at_rest;
+        auto const count = (size + fat_page_size - 1) / fat_page_size;
+        // Pages past the shortest of the previous and current FAT changed
+        // size.
+        auto const resized = this->_fat_size != size
+          ? std::min<std::size_t>(this->_fat_size, size) / fat_page_size
+          : count;
+        for (auto i = count; i < this->_fat_pages.size(); ++i)
+          res.emplace_back(this->_fat_pages[i].first);
+        this->_fat_pages.resize(count);
+        for (auto i = 0u; i < count; ++i)
+        {
+          auto& page = this->_fat_pages[i];
+          if (page.first != Address::null
+              && i < resized
+              && !elle::contains(this->_fat_dirty_pages, i))
+            continue;
+          ELLE_DEBUG_SCOPE("%s: store FAT page %s", this, i);
+          auto entries = std::vector<FatEntry>(
+            this->_fat.begin() + i * fat_page_size,
+            this->_fat.begin() + std::min(size, (i + 1) * fat_page_size));
+          elle::Buffer serdata;
+          {
+            elle::IOStream os(serdata.ostreambuf());
+            elle::serialization::binary::SerializerOut output(os);
+            output.serialize("entries", entries);
+          }
+          auto encoded =
+            encode_data_block(serdata, encrypt, Compression::none);
+          auto block = model.make_block<ImmutableBlock>(
+            std::move(encoded.first), this->_address);
+          auto const address = block->address();
+          model.insert(std::move(block),
+                       std::make_unique<NewBlockResolver>(
+                         this->_path.string(), this->_address));
+          stored.emplace_back(address);
+          if (page.first != Address::null)
+            res.emplace_back(page.first);
+          page = FatEntry(address, std::move(encoded.second));
+        }
+      }
+      this->_fat_dirty_pages.clear();
+      this->_fat_size = size;
+      return res;
+    }
+
+    /*-------------.
+    | Inline files |
+    `-------------*/
+
+    bool
+    FileData::is_inline() const
+    {
+      return bool(this->_inline_parent);
+    }
+
+    std::unique_ptr<ACLBlock>
+    FileData::promote(FileSystem& fs)
+    {
+      return std::move(FileData::promote(fs, {this}).front());
+    }
+
+    std::vector<std::unique_ptr<ACLBlock>>
+    FileData::promote(FileSystem& fs, std::vector<FileData*> const& files)
+    {
+      ELLE_TRACE_SCOPE("move %s inline files to their own block",
+                       files.size());
+      auto& model = *fs.block_store();
+      auto res = std::vector<std::unique_ptr<ACLBlock>>(files.size());
+      auto const parents = elle::make_vector(
+        files, [] (FileData* f) { return f->_inline_parent; });
+      auto const names = elle::make_vector(
+        files, [] (FileData* f) { return f->_inline_name; });
+      auto const inline_addresses = elle::make_vector(
+        files, [] (FileData* f) { return f->_address; });
+      auto moved = std::vector<std::size_t>{};
+      // Put back the files not moved yet, should one fail.
+      auto restore = [&] (std::size_t from)
+        {
+          for (auto j = from; j < moved.size(); ++j)
+          {
+            auto const i = moved[j];
+            files[i]->_inline_parent = parents[i];
+            files[i]->_inline_name = names[i];
+            files[i]->_address = inline_addresses[i];
+          }
+        };
+      std::unique_ptr<ACLBlock> parent_block;
+      for (auto i = 0u; i < files.size(); ++i)
+      {
+        auto& file = *files[i];
+        auto const& parent = parents[i];
+        auto const& name = names[i];
+        ELLE_DEBUG("%s: move inline file %s to its own block",
+                   &file, file._path);
+        file._inline_parent.reset();
+        file._inline_name.clear();
+        if (!elle::contains(parent->_inline_files, name))
+        {
+          auto entry = parent->_files.find(name);
+          if (entry == parent->_files.end()
+              || entry->second.second == Address::null)
+          {
+            restore(0);
+            THROW_NOENT();
+          }
+          ELLE_DEBUG("%s: inline file was already moved to %f",
+                     &file, entry->second.second);
+          file._address = entry->second.second;
+          file._move_buffer(fs, inline_addresses[i]);
+          continue;
+        }
+        moved.emplace_back(i);
+        try
+        {
+          if (!parent_block)
+            parent_block = umbrella([&] {
+                return elle::cast<ACLBlock>::runtime(
+                  model.fetch(parent->address()));
+              });
+          auto block = model.make_block<ACLBlock>();
+          umbrella([&] { parent_block->copy_permissions(*block); });
+          file._address = block->address();
+          block->data(file._serialize(model));
+          res[i] = std::move(block);
+        }
+        catch (...)
+        {
+          restore(0);
+          throw;
+        }
+      }
+      // Encrypt and sign the new blocks in parallel: storing them below
+      // does not seal them again.
+      model.seal(elle::make_vector(
+        moved, [&] (std::size_t i) -> model::blocks::Block*
+        {
+          return res[i].get();
+        }));
+      for (auto j = 0u; j < moved.size(); ++j)
+      {
+        auto const i = moved[j];
+        auto& file = *files[i];
+        auto const& parent = parents[i];
+        auto const& name = names[i];
+        try
+        {
+          fs.store_or_die(
+            *res[i], true,
+            std::make_unique<FileConflictResolver>(
+              file._path, &model, WriteTarget::all));
+        }
+        catch (...)
+        {
+          restore(j);
+          throw;
+        }
+        auto const content = parent->_inline_files.at(name);
+        elle::SafeFinally revert([&] {
+            parent->_files[name] =
+              std::make_pair(EntryType::file, Address::null);
+            parent->_inline_files[name] = content;
+            unchecked_remove(model, file._address);
+            restore(j);
+        });
+        parent->_inline_files.erase(name);
+        parent->_files[name] = std::make_pair(EntryType::file, file._address);
+        parent->write(
+          fs, {OperationType::update, name, EntryType::file, file._address});
+        revert.abort();
+        file._move_buffer(fs, inline_addresses[i]);
+      }
+      return res;
+    }
+
+    void
+    FileData::_move_buffer(FileSystem& fs, Address const& inline_address) const
+    {
+      auto& buffers = fs.file_buffers();
+      auto it = buffers.find(inline_address);
+      if (it == buffers.end())
+        return;
+      if (!it->second.expired())
+      {
+        ELLE_DEBUG("%s: move buffer from %f to %f",
+                   this, inline_address, this->_address);
+        buffers[this->_address] = it->second;
+      }
+      buffers.erase(inline_address);
+    }
+
+    bool
+    FileData::_write_inline(FileSystem& fs)
+    {
+      auto& parent = *this->_inline_parent;
+      auto const& name = this->_inline_name;
+      if (!elle::contains(parent._inline_files, name))
+      {
+        auto it = parent._files.find(name);
+        if (it == parent._files.end() || it->second.second == Address::null)
+        {
+          ELLE_WARN("%s: unable to commit as file was deleted", this);
+          return true;
+        }
+        // Moved through another copy of the file.
+        this->promote(fs);
+        return false;
+      }
+      auto const outgrown = [&]
+        {
+          if (signed(this->_header.size) > fs.inline_file_size()
+              || this->_header.links > 1)
+            return true;
+          auto const others = parent.inline_size()
+            - parent._inline_files.at(name).data.size();
+          if (signed(others + this->_data.size()) > fs.inline_directory_size())
+            return true;
+          for (auto const& e: this->_fat)
+            if (e.first != Address::null)
+              return true;
+          return false;
+        }();
+      if (outgrown)
+      {
+        this->promote(fs);
+        return true;
+      }
+      ELLE_DEBUG("%s: write inline file of %s bytes to %f",
+                 this, this->_header.size, parent.address());
+      auto file = InlineFile(this->_header, elle::Buffer(this->_data));
+      parent._inline_files[name] = file;
+      parent.write(fs, {OperationType::update, name, EntryType::file,
+                        Address::null, std::move(file)});
+      return true;
+    }
+
     void
     File::truncate(off_t new_size)
     {
@@ -623,6 +1147,7 @@ namespace infinit
         h->close();
         return;
       }
+      _filedata->load_fat(*_owner.block_store());
       uint64_t first_block_size = _filedata->_data.size();
       // Remove fat blocks starting from the end
       for (int i = _filedata->_fat.size()-1; i >= 0; --i)
@@ -645,15 +1170,15 @@ namespace infinit
           if (_filedata->_fat[i].first == Address::null)
             continue;
           auto targetsize = new_size - offset;
-          elle::cryptography::SecretKey sk(_filedata->_fat[i].second);
+          auto const key = _filedata->_fat[i].second;
           auto block = _owner.fetch_or_die(_filedata->_fat[i].first, {}, this->full_path());
-          elle::Buffer buf(sk.decipher(block->data()));
+          auto buf = decode_data_block(block->take_data(), key);
           if (buf.size() > targetsize)
             buf.size(targetsize);
           auto newblock = _owner.block_store()->make_block<ImmutableBlock>(
-            sk.encipher(buf), _address);
+            encode_data_block(buf, key), _address);
           unchecked_remove_chb(*_owner.block_store(), _filedata->_fat[i].first, this->_address);
-          _filedata->_fat[i].first = newblock->address();
+          _filedata->set_fat_entry(i, {newblock->address(), key});
           this->_owner.store_or_die(
             std::move(newblock), true,
             std::make_unique<NewBlockResolver>(this->_name, this->_address));
@@ -745,8 +1270,11 @@ namespace infinit
     }
 
     model::blocks::ACLBlock*
-    File::_header_block(bool)
+    File::_header_block(bool force)
     {
+      // Inline files have no block until promoted.
+      if (!force && this->_filedata && this->_filedata->is_inline())
+        return nullptr;
       _ensure_first_block();
       return dynamic_cast<model::blocks::ACLBlock*>(_first_block.get());
     }
@@ -782,6 +1310,7 @@ namespace infinit
             if (*special == "fat")
             {
               this->_fetch();
+              this->_filedata->load_fat(*this->_owner.block_store());
               auto const fat
                 = elle::make_vector(this->_filedata->_fat,
                                     [](auto const& entry)
@@ -792,6 +1321,12 @@ namespace infinit
             }
             else if (*special == "auth")
             {
+              // Inline files have the permissions of their directory.
+              if (this->_filedata && this->_filedata->is_inline())
+                return this->perms_to_json(
+                  *elle::cast<ACLBlock>::runtime(
+                    this->_owner.block_store()->fetch(
+                      this->_parent->address())));
               this->_ensure_first_block();
               return this->perms_to_json(
                 dynamic_cast<ACLBlock&>(*this->_first_block));
@@ -808,11 +1343,14 @@ namespace infinit
       if (auto special = xattr_special(name))
       {
         ELLE_DEBUG("found special %s", *special);
-        if (*special == "fsck.nullentry")
+        if (boost::starts_with(*special, "auth"))
+          this->_ensure_first_block();
+        else if (*special == "fsck.nullentry")
         {
           _fetch();
+          _filedata->load_fat(*_owner.block_store());
           int idx = std::stoi(value);
-          _filedata->_fat[idx] = std::make_pair(model::Address::null, "");
+          _filedata->set_fat_entry(idx, {model::Address::null, ""});
           _commit(WriteTarget::data);
           return;
         }
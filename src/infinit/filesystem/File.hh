@@ -54,6 +54,12 @@ namespace infinit
       bool allow_cache() override;
       void print(std::ostream& output) const override;
 
+      /// Size of the file at @a address as written through its open handles,
+      /// if any.
+      static
+      boost::optional<uint64_t>
+      open_size(FileSystem& fs, Address const& address);
+
       static const unsigned long default_block_size;
     private:
       friend class FileHandle;
@@ -65,6 +71,13 @@ namespace infinit
       ELLE_ATTRIBUTE_R(std::shared_ptr<FileData>, filedata);
 
       void _ensure_first_block();
+      /// Promote the inline files @a names of @a parent together, through
+      /// their open handles if any.
+      static
+      void
+      _promote(FileSystem& fs,
+               std::shared_ptr<DirectoryData> const& parent,
+               std::vector<std::string> const& names);
       void _fetch() override;
       void _commit(WriteTarget target) override;
       FileHeader& _header() override;
@@ -4,10 +4,9 @@
 #include <boost/range/algorithm/min_element.hpp>
 
 #include <elle/algorithm.hh>
-#include <elle/cryptography/SecretKey.hh>
-#include <elle/cryptography/random.hh>
 
 #include <infinit/filesystem/Directory.hh>
+#include <infinit/filesystem/compression.hh>
 #include <elle/cast.hh>
 #include <elle/os/environ.hh>
 #include <elle/serialization/binary.hh>
@@ -51,7 +50,8 @@ namespace infinit
       if (!this->_buffer)
       {
         this->_buffer = std::make_shared<FileBuffer>(owner, data, dirty);
-        owner.file_buffers().insert(std::make_pair(data.address(), this->_buffer));
+        // Replace expired buffers.
+        owner.file_buffers()[data.address()] = this->_buffer;
       }
       else
       {
@@ -66,19 +66,23 @@ namespace infinit
       : _dirty(dirty)
       , _fs(fs)
       , _file(std::move(data))
-    {}
+    {
+      this->_file.load_fat(*fs.block_store());
+    }
 
     FileHandle::~FileHandle()
     {
       try
       {
-        auto addr = this->_buffer->_file.address();
         if (!this->_close_failure)
           this->_buffer->close(this);
-        std::weak_ptr<FileBuffer> fb = this->_buffer;
+        // Closing may promote inline files to a new address.
+        auto addr = this->_buffer->_file.address();
         this->_buffer.reset();
-        if (!fb.lock())
-          this->_owner.file_buffers().erase(addr);
+        auto& buffers = this->_owner.file_buffers();
+        auto it = buffers.find(addr);
+        if (it != buffers.end() && it->second.expired())
+          buffers.erase(it);
       }
       catch (elle::Error const& e)
       {
@@ -100,6 +104,11 @@ namespace infinit
           ELLE_DEBUG_SCOPE("removing %s: %f", i, this->_file._fat[i].first);
           unchecked_remove_chb(*this->_fs.block_store(), this->_file._fat[i].first, this->_file.address());
         }
+        for (auto const& page: this->_file.fat_pages())
+        {
+          ELLE_DEBUG_SCOPE("removing FAT page %f", page.first);
+          unchecked_remove_chb(*this->_fs.block_store(), page.first, this->_file.address());
+        }
         ELLE_DEBUG_SCOPE("removing first block at %f", this->_file.address());
         unchecked_remove(*this->_fs.block_store(), this->_file.address());
       }
@@ -519,14 +528,8 @@ namespace infinit
         });
         auto block = fetch_or_die(*_fs.block_store(), addr, {},
                                   this->_file.path() / elle::sprintf("<%f>", addr));
-        auto crypted = block->take_data();
-        if (secret.empty())
-          c.block = std::make_shared<elle::Buffer>(std::move(crypted));
-        else
-        {
-          auto const sk = elle::cryptography::SecretKey(secret);
-          c.block = std::make_shared<elle::Buffer>(sk.decipher(crypted));
-        }
+        c.block = std::make_shared<elle::Buffer>(
+          decode_data_block(block->take_data(), secret));
       }
       c.last_use = now();
       c.dirty = false; // we just fetched or inserted it
@@ -577,13 +580,19 @@ namespace infinit
             return;
           }
           ELLE_TRACE("Prefetcher inserting value at %s", idx);
-          auto crypted = bl->take_data();
           std::shared_ptr<elle::Buffer> b;
-          if (key.empty())
-            b = std::make_shared<elle::Buffer>(std::move(crypted));
-          else
+          try
+          {
             b = std::make_shared<elle::Buffer>(
-              elle::cryptography::SecretKey(key).decipher(crypted));
+              decode_data_block(bl->take_data(), key));
+          }
+          catch (elle::Error const& e)
+          {
+            ELLE_WARN("Prefetcher error decoding %x: %s", addr, e);
+            --this->_prefetchers_count;
+            this->_blocks[idx].ready.open();
+            return;
+          }
           this->_blocks[idx].last_use = now();
           this->_blocks[idx].block = b;
           this->_blocks[idx].ready.open();
@@ -656,6 +665,10 @@ namespace infinit
     std::function<void ()>
     FileBuffer::_flush_block(int id, CacheEntry& entry)
     {
+      // Data blocks are owned by the file block: move inline files out of
+      // their directory first.
+      if (entry.dirty && this->_file.is_inline())
+        this->_file.promote(this->_fs);
       if (entry.dirty)
         return [this, id, data_ = elle::Buffer(*entry.block)] () mutable
         {
@@ -681,20 +694,18 @@ namespace infinit
           });
           bool encrypt = dynamic_cast<model::doughnut::Doughnut const&>(*this->_fs.block_store())
             .encrypt_options().encrypt_at_rest;
+          auto const compression = this->_fs.compression();
           std::string key;
           elle::Buffer cdata;
-          if (encrypt)
-          {
-            key = elle::cryptography::random::generate<elle::Buffer>(32).string();
-            if (data_.size() >= 262144)
-              elle::reactor::background([&] {
-                cdata = elle::cryptography::SecretKey(key).encipher(data_);
-              });
-            else
-              cdata = elle::cryptography::SecretKey(key).encipher(data_);
-          }
+          auto encode = [&] {
+            std::tie(cdata, key) =
+              encode_data_block(data_, encrypt, compression);
+          };
+          if ((encrypt || compression != Compression::none)
+              && data_.size() >= 262144)
+            elle::reactor::background(encode);
           else
-            cdata = elle::Buffer(data_.contents(), data_.size());
+            encode();
           auto block = this->_fs.block_store()->make_block<ImmutableBlock>(
             std::move(cdata), this->_file._address);
           auto baddr = block->address();
@@ -704,7 +715,7 @@ namespace infinit
           auto prev = Address::null;
           if (signed(this->_file._fat.size()) > id)
             prev = _file._fat.at(id).first;
-          this->_file._fat[id] = FileData::FatEntry(baddr, key);
+          this->_file.set_fat_entry(id, FileData::FatEntry(baddr, key));
           this->_fat_changed = true;
           if (prev != Address::null)
             unchecked_remove(*this->_fs.block_store(), prev);
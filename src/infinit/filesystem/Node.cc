@@ -205,13 +205,20 @@ namespace infinit
         ELLE_DEBUG("removed move target %s", where);
       }
       auto data = this->_parent->_files.at(this->_name);
+      auto content = boost::optional<InlineFile>{};
+      auto it = this->_parent->_inline_files.find(this->_name);
+      if (it != this->_parent->_inline_files.end())
+        content = it->second;
 
       dir->_data->_files.insert(std::make_pair(newname, data));
+      if (content)
+        dir->_data->_inline_files[newname] = *content;
       dir->_data->write(
         this->_owner,
-        {OperationType::insert, newname, data.first, data.second});
+        {OperationType::insert, newname, data.first, data.second, content});
 
       this->_parent->_files.erase(_name);
+      this->_parent->_inline_files.erase(_name);
       this->_parent->write(this->_owner,
                             {OperationType::remove, this->_name});
 
@@ -253,7 +260,7 @@ namespace infinit
           && gid < gid_start + gid_count
           && acl_save[gid - gid_start])
       {
-        auto block = this->_header_block();
+        auto block = this->_header_block(true);
         // clear current perms
         auto perms = block->list_permissions({});
         for (auto const& p: perms)
@@ -354,6 +361,7 @@ namespace infinit
               s, false);
           model::doughnut::UB ub(dht.get(), *name, p, false);
           model::doughnut::UB rub(dht.get(), *name, p, true);
+          dht->seal({&ub, &rub});
           this->_owner.block_store()->seal_and_insert(
             ub, std::make_unique<model::doughnut::UserBlockUpserter>(*name));
           this->_owner.block_store()->seal_and_insert(
@@ -540,7 +548,7 @@ namespace infinit
           if (!block)
           {
             this->_fetch();
-            block = this->_header_block();
+            block = this->_header_block(true);
             ELLE_ASSERT(block);
           }
           return elle::serialization::json::serialize(block).string();
@@ -755,48 +763,48 @@ namespace infinit
     }
 
     void
-    Node::stat(struct stat* st)
+    Node::header_stat(FileHeader const& h, struct stat* st)
     {
       memset(st, 0, sizeof(struct stat));
 #ifndef INFINIT_WINDOWS
       st->st_blksize = 16384;
-      st->st_blocks = this->_header().size / 512;
+      st->st_blocks = h.size / 512;
 #endif
-      auto h = this->_header();
       st->st_mode  = h.mode;
       st->st_size  = h.size;
       st->st_atime = h.atime;
       st->st_mtime = h.mtime;
       st->st_ctime = h.ctime;
       st->st_nlink = h.links;
-      st->st_uid   =
 #ifdef INFINIT_WINDOWS
-        0;
+      st->st_uid   = 0;
+      st->st_gid   = 0;
 #else
-        getuid();
+      st->st_uid   = getuid();
+      st->st_gid   = getgid();
 #endif
-      this->_fetch();
-      if (!acl_preserver)
-        st->st_gid =
-#ifdef INFINIT_WINDOWS
-        0;
-#else
-        getgid();
+      st->st_dev = 1;
+#ifdef INFINIT_MACOSX
+      st->st_birthtime = h.btime;
 #endif
-      else
+    }
+
+    void
+    Node::stat(struct stat* st)
+    {
+      auto h = this->_header();
+      Node::header_stat(h, st);
+      this->_fetch();
+      if (acl_preserver)
       {
-        auto block = this->_header_block();
+        auto block = this->_header_block(true);
         acl_save[gid_position] = block->clone();
         dynamic_cast<model::blocks::MutableBlock*>(
           acl_save[gid_position].get())->data(elle::Buffer());
         st->st_gid = gid_start + gid_position;
         gid_position = (gid_position + 1) % gid_count;
       }
-      st->st_dev = 1;
       st->st_ino = (unsigned short)(uint64_t)(void*)this;
-#ifdef INFINIT_MACOSX
-      st->st_birthtime = h.btime;
-#endif
       ELLE_DEBUG("%s: stat mode=%x size=%s links=%s",
                  *this, h.mode&0777, h.size, h.links);
     }
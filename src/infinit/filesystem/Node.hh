@@ -64,6 +64,10 @@ namespace infinit
       chown(int uid, int gid);
       void
       stat(struct stat* st);
+      /// Fill @a st from @a header, the type bits aside.
+      static
+      void
+      header_stat(FileHeader const& header, struct stat* st);
       std::string
       getxattr(std::string const& key);
       void
@@ -1,5 +1,6 @@
 #include <infinit/filesystem/Unknown.hh>
 
+#include <elle/algorithm.hh>
 #include <elle/cast.hh>
 
 #include <infinit/filesystem/FileHandle.hh>
@@ -194,6 +195,34 @@ namespace infinit
       return handle;
     }
 
+    std::unique_ptr<rfs::Handle>
+    Unknown::create_inline(int flags, mode_t mode)
+    {
+      ELLE_TRACE_SCOPE("%s: create inline file", *this);
+      auto parent_block = this->_owner.block_store()->fetch(_parent->address());
+      _owner.ensure_permissions(*parent_block, true, true);
+      auto now = time(nullptr);
+      auto file = InlineFile(
+        FileHeader(0, 1, S_IFREG | (mode & 0700), now, now, now, now,
+                   _owner.block_size().value_or(File::default_block_size)),
+        {});
+      _parent->_files[_name] = std::make_pair(EntryType::file, Address::null);
+      _parent->_inline_files[_name] = file;
+      elle::SafeFinally revert([&] {
+          _parent->_files.erase(_name);
+          _parent->_inline_files.erase(_name);
+      });
+      _parent->write(_owner,
+                     Operation{
+                       (flags & O_EXCL) ? OperationType::insert_exclusive : OperationType::insert,
+                       _name, EntryType::file, Address::null, std::move(file)},
+                     DirectoryData::null_block,
+                     true);
+      revert.abort();
+      return std::unique_ptr<rfs::Handle>(
+        new FileHandle(_owner, FileData(_parent->_path / _name, _parent, _name),
+                       true));
+    }
 
     std::unique_ptr<rfs::Handle>
     Unknown::create(int flags, mode_t mode)
@@ -206,9 +235,17 @@ namespace infinit
         if (flags & O_EXCL)
           THROW_EXIST();
         ELLE_WARN("File %s exists where it should not", _name);
-        File f(_owner, _parent->_files.at(_name).second, {}, _parent, _name);
+        auto data = elle::contains(_parent->_inline_files, _name)
+          ? std::make_shared<FileData>(_parent->_path / _name, _parent, _name)
+          : nullptr;
+        File f(_owner, _parent->_files.at(_name).second, data, _parent, _name);
         return f.open(flags, mode);
       }
+      // Inline files have the permissions of their directory, which files
+      // only get when inheriting them.
+      if (_owner.inline_file_size() > 0 && _parent->inherit_auth()
+          && signed(_parent->inline_size()) < _owner.inline_directory_size())
+        return this->create_inline(flags, mode);
       if (_owner.block_store()->version() >= elle::Version(0, 7, 0))
         return this->create_0_7(flags, mode);
       auto parent_block = this->_owner.block_store()->fetch(_parent->address());
@@ -45,6 +45,8 @@ namespace infinit
       void
       print(std::ostream& stream) const override;
       std::unique_ptr<rfs::Handle> create_0_7(int flags, mode_t mode);
+      /// Create a file stored in the parent directory block.
+      std::unique_ptr<rfs::Handle> create_inline(int flags, mode_t mode);
     private:
     };
   }
@@ -0,0 +1,354 @@
+#include <infinit/filesystem/compression.hh>
+
+#include <cstring>
+#include <vector>
+
+#include <elle/assert.hh>
+#include <elle/err.hh>
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+
+#include <elle/cryptography/SecretKey.hh>
+#include <elle/cryptography/random.hh>
+
+ELLE_LOG_COMPONENT("infinit.filesystem.compression");
+
+namespace
+{
+  using elle::os::getenv;
+  /// Number of leading bytes compressed to estimate the block ratio.
+  auto const sample_size = getenv("INFINIT_COMPRESSION_SAMPLE_SIZE", 65536);
+  /// Maximum compressed/original size ratio, in percent, for a block to be
+  /// stored compressed.
+  auto const max_ratio = getenv("INFINIT_COMPRESSION_MAX_RATIO", 90);
+  /// Blocks smaller than this are not worth compressing.
+  auto const min_size = 256;
+
+  /*----.
+  | LZ4 |
+  `----*/
+
+  // Implementation of the LZ4 block format, prefixed with the little endian
+  // 32-bit size of the original data.
+
+  auto const min_match = 4;
+  auto const last_literals = 5;
+  auto const match_limit = 12;
+  auto const max_offset = 65535;
+  auto const hash_log = 12;
+  /// A sequence expands at most 255 times the bytes encoding it.
+  auto const max_expansion = 255;
+  /// Far above any data block size, bounds what a corrupted prefix can make
+  /// us allocate.
+  auto const max_size = std::size_t(256) << 20;
+
+  uint32_t
+  read32(uint8_t const* p)
+  {
+    uint32_t res;
+    std::memcpy(&res, p, sizeof res);
+    return res;
+  }
+
+  uint32_t
+  hash(uint32_t sequence)
+  {
+    return (sequence * 2654435761u) >> (32 - hash_log);
+  }
+
+  uint8_t*
+  write_length(uint8_t* out, std::size_t length)
+  {
+    for (; length >= 255; length -= 255)
+      *out++ = 255;
+    *out++ = static_cast<uint8_t>(length);
+    return out;
+  }
+
+  uint8_t*
+  write_sequence(uint8_t* out,
+                 uint8_t const* literals,
+                 std::size_t literals_length,
+                 std::size_t match_length)
+  {
+    auto token = out++;
+    *token = std::min<std::size_t>(literals_length, 15) << 4
+      | std::min<std::size_t>(match_length, 15);
+    if (literals_length >= 15)
+      out = write_length(out, literals_length - 15);
+    std::memcpy(out, literals, literals_length);
+    return out + literals_length;
+  }
+
+  elle::Buffer
+  lz4_compress(elle::ConstWeakBuffer data)
+  {
+    auto const size = data.size();
+    auto const src = data.contents();
+    auto const end = src + size;
+    auto res = elle::Buffer{};
+    res.size(4 + size + size / 255 + 16);
+    auto out = res.mutable_contents();
+    for (int i = 0; i < 4; ++i)
+      *out++ = (uint64_t(size) >> (8 * i)) & 0xff;
+    auto anchor = src;
+    if (size > std::size_t(match_limit))
+    {
+      auto table = std::vector<uint32_t>(1 << hash_log, 0);
+      auto const match_end = end - match_limit;
+      auto const limit = end - last_literals;
+      auto in = src;
+      while (in < match_end)
+      {
+        auto const h = hash(read32(in));
+        auto const ref = src + table[h];
+        table[h] = in - src;
+        if (ref < in && in - ref <= max_offset && read32(ref) == read32(in))
+        {
+          auto match = in + min_match;
+          auto previous = ref + min_match;
+          while (match < limit && *match == *previous)
+          {
+            ++match;
+            ++previous;
+          }
+          auto const match_length = std::size_t(match - in) - min_match;
+          out = write_sequence(out, anchor, in - anchor, match_length);
+          auto const offset = in - ref;
+          *out++ = offset & 0xff;
+          *out++ = offset >> 8;
+          if (match_length >= 15)
+            out = write_length(out, match_length - 15);
+          in = anchor = match;
+        }
+        else
+          ++in;
+      }
+    }
+    out = write_sequence(out, anchor, end - anchor, 0);
+    res.size(out - res.mutable_contents());
+    return res;
+  }
+
+  elle::Buffer
+  lz4_decompress(elle::ConstWeakBuffer data)
+  {
+    auto corrupted = [] { elle::err("corrupted LZ4 payload"); };
+    if (data.size() < 5)
+      corrupted();
+    auto in = data.contents();
+    auto const in_end = in + data.size();
+    auto size = std::size_t(0);
+    for (int i = 0; i < 4; ++i)
+      size |= std::size_t(*in++) << (8 * i);
+    if (size > max_size || size > (data.size() - 4) * max_expansion)
+      elle::err("corrupted LZ4 payload: %s bytes from %s",
+                size, data.size() - 4);
+    auto res = elle::Buffer{};
+    res.size(size);
+    auto const out_start = res.mutable_contents();
+    auto const out_end = out_start + size;
+    auto out = out_start;
+    auto read_length = [&] (std::size_t& length)
+      {
+        uint8_t b;
+        do
+        {
+          if (in >= in_end)
+            corrupted();
+          b = *in++;
+          length += b;
+        }
+        while (b == 255);
+      };
+    while (true)
+    {
+      if (in >= in_end)
+        corrupted();
+      auto const token = *in++;
+      auto literals = std::size_t(token >> 4);
+      if (literals == 15)
+        read_length(literals);
+      if (std::size_t(in_end - in) < literals
+          || std::size_t(out_end - out) < literals)
+        corrupted();
+      std::memcpy(out, in, literals);
+      in += literals;
+      out += literals;
+      // The last sequence only holds literals.
+      if (in == in_end)
+        break;
+      if (in_end - in < 2)
+        corrupted();
+      auto const offset = std::size_t(in[0] | in[1] << 8);
+      in += 2;
+      if (offset == 0 || offset > std::size_t(out - out_start))
+        corrupted();
+      auto length = std::size_t(token & 15);
+      if (length == 15)
+        read_length(length);
+      length += min_match;
+      if (std::size_t(out_end - out) < length)
+        corrupted();
+      // Matches may overlap the output, copy bytewise.
+      auto ref = out - offset;
+      for (std::size_t i = 0; i < length; ++i)
+        out[i] = ref[i];
+      out += length;
+    }
+    if (out != out_end)
+      corrupted();
+    return res;
+  }
+
+  bool
+  worth_it(std::size_t compressed, std::size_t original)
+  {
+    return compressed * 100 <= original * max_ratio;
+  }
+}
+
+namespace infinit
+{
+  namespace filesystem
+  {
+    std::ostream&
+    operator <<(std::ostream& out, Compression compression)
+    {
+      switch (compression)
+      {
+      case Compression::none:
+        return out << "none";
+      case Compression::lz4:
+        return out << "lz4";
+      }
+      elle::unreachable();
+    }
+
+    Compression
+    compression_from_string(std::string const& name)
+    {
+      if (name == "none" || name.empty())
+        return Compression::none;
+      else if (name == "lz4")
+        return Compression::lz4;
+      else
+        elle::err("unknown compression: %s", name);
+    }
+
+    boost::optional<elle::Buffer>
+    compress(Compression compression, elle::ConstWeakBuffer data)
+    {
+      if (compression == Compression::none || data.size() < min_size)
+        return boost::none;
+      if (data.size() > std::size_t(sample_size))
+      {
+        auto const sample = lz4_compress(data.range(0, sample_size));
+        if (!worth_it(sample.size(), sample_size))
+        {
+          ELLE_DEBUG("skip incompressible block (sample ratio %s/%s)",
+                     sample.size(), sample_size);
+          return boost::none;
+        }
+      }
+      auto res = lz4_compress(data);
+      if (!worth_it(res.size(), data.size()))
+      {
+        ELLE_DEBUG("skip incompressible block (ratio %s/%s)",
+                   res.size(), data.size());
+        return boost::none;
+      }
+      ELLE_DUMP("compressed block from %s to %s bytes",
+                data.size(), res.size());
+      return res;
+    }
+
+    elle::Buffer
+    decompress(Compression compression, elle::ConstWeakBuffer data)
+    {
+      switch (compression)
+      {
+      case Compression::none:
+        return elle::Buffer(data.contents(), data.size());
+      case Compression::lz4:
+        return lz4_decompress(data);
+      }
+      elle::unreachable();
+    }
+
+    /*-----------.
+    | FAT blocks |
+    `-----------*/
+
+    Compression
+    fat_key_compression(std::string const& key)
+    {
+      if (key.size() % 2 == 0)
+        return Compression::none;
+      auto const res = static_cast<Compression>(uint8_t(key.back()));
+      if (res != Compression::lz4)
+        elle::err("unknown compression in FAT entry: %s", int(key.back()));
+      return res;
+    }
+
+    std::string
+    fat_key_secret(std::string const& key)
+    {
+      if (key.size() % 2 == 0)
+        return key;
+      return key.substr(0, key.size() - 1);
+    }
+
+    std::string
+    fat_key(std::string secret, Compression compression)
+    {
+      if (compression != Compression::none)
+        secret.push_back(static_cast<char>(compression));
+      return secret;
+    }
+
+    std::pair<elle::Buffer, std::string>
+    encode_data_block(elle::Buffer const& data,
+                      bool encrypt,
+                      Compression compression)
+    {
+      auto secret = std::string{};
+      if (encrypt)
+        secret = elle::cryptography::random::generate<elle::Buffer>(32).string();
+      auto const compressed = compress(compression, data);
+      auto key = fat_key(
+        secret, compressed ? compression : Compression::none);
+      auto const& plain = compressed ? *compressed : data;
+      if (encrypt)
+        return {elle::cryptography::SecretKey(secret).encipher(plain),
+                std::move(key)};
+      else
+        return {elle::Buffer(plain.contents(), plain.size()), std::move(key)};
+    }
+
+    elle::Buffer
+    encode_data_block(elle::Buffer const& data, std::string const& key)
+    {
+      auto const secret = fat_key_secret(key);
+      auto const compression = fat_key_compression(key);
+      auto plain = compression == Compression::none
+        ? elle::Buffer(data.contents(), data.size())
+        : lz4_compress(data);
+      if (secret.empty())
+        return plain;
+      return elle::cryptography::SecretKey(secret).encipher(plain);
+    }
+
+    elle::Buffer
+    decode_data_block(elle::Buffer payload, std::string const& key)
+    {
+      auto const secret = fat_key_secret(key);
+      if (!secret.empty())
+        payload = elle::cryptography::SecretKey(secret).decipher(payload);
+      auto const compression = fat_key_compression(key);
+      if (compression == Compression::none)
+        return payload;
+      return decompress(compression, payload);
+    }
+  }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+
+#include <boost/optional.hpp>
+
+#include <elle/Buffer.hh>
+
+namespace infinit
+{
+  namespace filesystem
+  {
+    /// Compression applied to file data blocks before encryption.
+    enum class Compression
+    {
+      none = 0,
+      lz4 = 1,
+    };
+
+    std::ostream&
+    operator <<(std::ostream& out, Compression compression);
+
+    /// Parse a compression name ("none", "lz4").
+    ///
+    /// @throws elle::Error if the name is unknown.
+    Compression
+    compression_from_string(std::string const& name);
+
+    /// Compress @a data with @a compression.
+    ///
+    /// A sample of the data is compressed first, and the whole buffer is only
+    /// compressed if the sample ratio is worth it.
+    ///
+    /// @return The compressed payload, or none if @a data is incompressible.
+    boost::optional<elle::Buffer>
+    compress(Compression compression, elle::ConstWeakBuffer data);
+
+    /// Decompress @a data compressed with @a compression.
+    ///
+    /// @throws elle::Error if the payload is corrupted.
+    elle::Buffer
+    decompress(Compression compression, elle::ConstWeakBuffer data);
+
+    /*-----------.
+    | FAT blocks |
+    `-----------*/
+
+    /// FAT entries key field holds the block secret (empty if the volume does
+    /// not encrypt at rest), followed by one byte naming the compression if
+    /// the block payload is compressed. Secrets are either empty or 32 bytes
+    /// long, so an odd key size denotes a compressed block, and keys of
+    /// uncompressed blocks are unchanged.
+    Compression
+    fat_key_compression(std::string const& key);
+
+    /// The secret part of a FAT entry key.
+    std::string
+    fat_key_secret(std::string const& key);
+
+    /// Build a FAT entry key from @a secret and @a compression.
+    std::string
+    fat_key(std::string secret, Compression compression);
+
+    /// Compress then encipher @a data for storage in an ImmutableBlock.
+    ///
+    /// @param data        The block plain data.
+    /// @param encrypt     Whether to encipher the data with a fresh secret.
+    /// @param compression The compression to try.
+    /// @return The payload and the FAT entry key to read it back.
+    std::pair<elle::Buffer, std::string>
+    encode_data_block(elle::Buffer const& data,
+                      bool encrypt,
+                      Compression compression);
+
+    /// Re-encode @a data with an existing FAT entry @a key.
+    elle::Buffer
+    encode_data_block(elle::Buffer const& data, std::string const& key);
+
+    /// Decipher then decompress a block payload given its FAT entry @a key.
+    elle::Buffer
+    decode_data_block(elle::Buffer payload, std::string const& key);
+  }
+}
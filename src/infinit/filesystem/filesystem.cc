@@ -9,6 +9,7 @@
 #include <boost/filesystem/fstream.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include <elle/algorithm.hh>
 #include <elle/bench.hh>
 #include <elle/cast.hh>
 #include <elle/log.hh>
@@ -94,6 +95,26 @@ namespace infinit
     }
 
 
+    namespace
+    {
+      FileSystem::CacheMetrics
+      make_cache_metrics(std::string const& cache)
+      {
+        static auto* events = prometheus::make_counter_family(
+          "infinit_filesystem_cache_events",
+          "How many hits, misses and evictions the filesystem caches had");
+        static auto* bytes = prometheus::make_gauge_family(
+          "infinit_filesystem_cache_bytes",
+          "How many bytes the filesystem caches use");
+        return {
+          prometheus::make(events, {{"cache", cache}, {"event", "hit"}}),
+          prometheus::make(events, {{"cache", cache}, {"event", "miss"}}),
+          prometheus::make(events, {{"cache", cache}, {"event", "eviction"}}),
+          prometheus::make(bytes, {{"cache", cache}}),
+        };
+      }
+    }
+
     FileSystem::FileSystem(
         std::string volume_name,
         std::shared_ptr<model::Model> model,
@@ -102,7 +123,8 @@ namespace infinit
         boost::optional<bfs::path> mountpoint,
         bool allow_root_creation,
         bool map_other_permissions,
-        boost::optional<int> block_size)
+        boost::optional<int> block_size,
+        Compression compression)
       : _block_store(std::move(model))
       , _single_mount(false)
       , _owner(owner)
@@ -112,15 +134,51 @@ namespace infinit
       , _root_address(Address::null)
       , _allow_root_creation(allow_root_creation)
       , _map_other_permissions(map_other_permissions)
-      , _prefetching(0)
       , _block_size(block_size)
+      , _compression(compression)
+      , _inline_file_size(elle::os::getenv("INFINIT_INLINE_FILE_SIZE", 0))
+      , _inline_directory_size(
+        elle::os::getenv("INFINIT_INLINE_DIRECTORY_SIZE", 64 * 1024))
       , _file_buffers()
+      , _cache_size(std::size_t(
+          elle::os::getenv("INFINIT_FS_CACHE_SIZE", 64 * 1024 * 1024)))
+      , _cache_bytes(0)
+      , _file_cache_metrics(make_cache_metrics("file"))
+      , _directory_cache_metrics(make_cache_metrics("directory"))
+      , _prefetch_depth(elle::os::getenv("INFINIT_PREFETCH_DEPTH", 2))
+      , _prefetch_queue_size(
+        elle::os::getenv("INFINIT_PREFETCH_QUEUE_SIZE", 10000))
+      , _prefetched(0)
+      , _prefetching(0)
+      , _cache_cleanup_thread(
+        new elle::reactor::Thread(elle::sprintf("%s cache cleanup", this),
+                                  [this] { this->_cache_cleanup(); }))
     {
       auto& dht = dynamic_cast<model::doughnut::Doughnut&>(
         *this->_block_store.get());
       auto passport = dht.passport();
       this->_read_only = !passport.allow_write();
       this->_network_name = passport.network();
+      static auto const compression_env =
+        elle::os::getenv("INFINIT_COMPRESSION", "");
+      if (!compression_env.empty())
+        this->_compression = compression_from_string(compression_env);
+      // Older clients would not know how to read compressed blocks.
+      if (this->_compression != Compression::none
+          && dht.version() < elle::Version(0, 9, 0))
+      {
+        ELLE_WARN("%s: compression requires network version 0.9.0, "
+                  "disabling it", this);
+        this->_compression = Compression::none;
+      }
+      // Older clients would not find files stored in directories.
+      if (this->_inline_file_size > 0
+          && dht.version() < elle::Version(0, 9, 0))
+      {
+        ELLE_WARN("%s: inline files require network version 0.9.0, "
+                  "disabling them", this);
+        this->_inline_file_size = 0;
+      }
     }
 
     void
@@ -591,7 +649,7 @@ namespace infinit
         try
         {
           model::doughnut::Group g(dn, e.key);
-          auto keys = g.group_keys();
+          auto keys = g.group_keys(acb->group_version()[idx]);
           if (acb->group_version()[idx] < signed(keys.size()))
           {
             r = r || e.read;
@@ -624,14 +682,6 @@ namespace infinit
     std::shared_ptr<elle::reactor::filesystem::Path>
     FileSystem::path(std::string const& path)
     {
-      // cache cleanup, this place is as good as any
-      if (max_cache_size >= 0)
-      {
-        while (_file_cache.size() > unsigned(max_cache_size))
-          _file_cache.get<1>().erase(_file_cache.get<1>().begin());
-        while (_directory_cache.size() > unsigned(max_cache_size))
-          _directory_cache.get<1>().erase(_directory_cache.get<1>().begin());
-      }
       ELLE_ASSERT(!path.empty() && path[0] == '/');
       std::vector<std::string> components;
       boost::algorithm::split(components, path, boost::algorithm::is_any_of("/\\"));
@@ -706,8 +756,12 @@ namespace infinit
         return std::shared_ptr<rfs::Path>(new Symlink(*this, address, d, name));
       case EntryType::file:
         {
-          static auto bench =
-            elle::Bench("bench.filesystem.filecache.hit", std::chrono::seconds(1000));
+          if (elle::contains(d->inline_files(), name))
+          {
+            auto fd = std::make_shared<FileData>(current_path / name, d, name);
+            return std::shared_ptr<rfs::Path>(
+              new File(*this, Address::null, fd, d, name));
+          }
           ELLE_DEBUG("fetching %f from file cache", address);
           auto fit = _file_cache.find(address);
           boost::optional<int> version;
@@ -736,31 +790,12 @@ namespace infinit
             else
               throw e;
           }
-          fit = _file_cache.find(address);
-          std::shared_ptr<FileData> fd;
-          bench.add(block ? 0 : 1);
-          std::pair<bool, bool> perms;
-          if (block)
-            perms = get_permissions(*_block_store, *block);
-          if (!block)
-          {
-            fd = *fit;
-            _file_cache.modify(fit,
-              [](std::shared_ptr<FileData>& d) {d->_last_used = now();});
-          }
-          else if (fit != _file_cache.end())
-          {
-            fd = *fit;
-            _file_cache.modify(fit,
-              [](std::shared_ptr<FileData>& d) {d->_last_used = now();});
-            (*fit)->update(*block, perms, block_size().value_or(File::default_block_size));
-          }
-          else
-          {
-            fd = std::make_shared<FileData>(current_path / name, *block, perms,
-              block_size().value_or(File::default_block_size));
-            _file_cache.insert(fd);
-          }
+          auto fd = this->_cache_file(current_path / name, address,
+                                      std::move(block));
+          // The entry may have been evicted while fetching.
+          if (!fd)
+            fd = this->_cache_file(current_path / name, address,
+                                   fetch_or_die(address, {}, current_path));
         return std::shared_ptr<rfs::Path>(new File(*this, address, fd, d, name));
         }
       case EntryType::directory:
@@ -794,40 +829,476 @@ namespace infinit
     FileSystem::get(bfs::path path, model::Address address)
     {
       ELLE_DEBUG_SCOPE("%s: get directory at %f", this, address);
+      auto version = this->_cached_version(address, EntryType::directory);
+      auto block = fetch_or_die(address, version, path);
+      auto res = this->_cache_directory(path, address, std::move(block));
+      // The entry may have been evicted while fetching.
+      if (!res)
+        res = this->_cache_directory(path, address,
+                                     fetch_or_die(address, {}, path));
+      return res;
+    }
+
+    boost::optional<int>
+    FileSystem::_cached_version(Address address, EntryType type) const
+    {
+      if (type == EntryType::directory)
+      {
+        auto it = this->_directory_cache.find(address);
+        if (it != this->_directory_cache.end())
+          return (*it)->block_version();
+      }
+      else
+      {
+        auto it = this->_file_cache.find(address);
+        if (it != this->_file_cache.end())
+          return (*it)->block_version();
+      }
+      return {};
+    }
+
+    std::shared_ptr<FileData>
+    FileSystem::_cache_file(bfs::path path,
+                            Address address,
+                            std::unique_ptr<model::blocks::Block> block)
+    {
       static auto bench =
-         elle::Bench("bench.filesystem.dircache.hit", std::chrono::seconds(1000));
-      boost::optional<int> version;
-      auto it = _directory_cache.find(address);
-      if (it != _directory_cache.end())
-        version = (*it)->block_version();
-      auto block = fetch_or_die(address, version, path); //invalidates 'it'
-      it = _directory_cache.find(address);
+        elle::Bench("bench.filesystem.filecache.hit", std::chrono::seconds(1000));
+      bench.add(block ? 0 : 1);
+      prometheus::increment(block ? this->_file_cache_metrics.misses
+                                  : this->_file_cache_metrics.hits);
       std::pair<bool, bool> perms;
       if (block)
-        perms = get_permissions(*_block_store, *block);
-      if (!block)
+        perms = get_permissions(*this->_block_store, *block);
+      auto it = this->_file_cache.find(address);
+      if (it == this->_file_cache.end())
       {
-        bench.add(1);
-        ELLE_ASSERT(it != _directory_cache.end());
-        _directory_cache.modify(it,
-          [](std::shared_ptr<DirectoryData>& d) {d->_last_used = now();});
-        return *it;
+        if (!block)
+          return nullptr;
+        auto fd = std::make_shared<FileData>(
+          path, *block, perms,
+          this->block_size().value_or(File::default_block_size));
+        this->_file_cache.insert(fd);
+        this->_cache_bytes += fd->footprint();
+        return fd;
       }
-      bench.add(0);
-      if (it != _directory_cache.end())
-      {
-        _directory_cache.modify(it,
-          [](std::shared_ptr<DirectoryData>& d) {d->_last_used = now();});
-        (*it)->update(*block, perms);
-      }
-      else
+      this->_file_cache.modify(it,
+        [](std::shared_ptr<FileData>& d) {d->_last_used = now();});
+      if (block)
+        (*it)->update(*block, perms,
+                      this->block_size().value_or(File::default_block_size));
+      return *it;
+    }
+
+    std::shared_ptr<DirectoryData>
+    FileSystem::_cache_directory(bfs::path path,
+                                 Address address,
+                                 std::unique_ptr<model::blocks::Block> block)
+    {
+      static auto bench =
+        elle::Bench("bench.filesystem.dircache.hit", std::chrono::seconds(1000));
+      bench.add(block ? 0 : 1);
+      prometheus::increment(block ? this->_directory_cache_metrics.misses
+                                  : this->_directory_cache_metrics.hits);
+      std::pair<bool, bool> perms;
+      if (block)
+        perms = get_permissions(*this->_block_store, *block);
+      auto it = this->_directory_cache.find(address);
+      if (it == this->_directory_cache.end())
       {
+        if (!block)
+          return nullptr;
         auto dd = std::make_shared<DirectoryData>(path, *block, perms);
-        _directory_cache.insert(dd);
+        this->_directory_cache.insert(dd);
+        this->_cache_bytes += dd->footprint();
         return dd;
       }
+      this->_directory_cache.modify(it,
+        [](std::shared_ptr<DirectoryData>& d) {d->_last_used = now();});
+      if (block)
+        (*it)->update(*block, perms);
       return *it;
     }
+
+    std::unordered_map<std::string, FileHeader>
+    FileSystem::fetch_headers(DirectoryData const& directory)
+    {
+      static elle::Bench bench(
+        "bench.fs.fetch_headers", std::chrono::seconds(10000));
+      elle::Bench::BenchScope bs(bench);
+      static auto const batch_size =
+        elle::os::getenv("INFINIT_FETCH_HEADERS_BATCH_SIZE", 256);
+      ELLE_TRACE_SCOPE("%s: fetch headers of %s entries of %f",
+                       this, directory.files().size(), directory.address());
+      // Snapshot the entries, the directory may change while we fetch.
+      using Entry = std::pair<EntryType, std::vector<std::string>>;
+      auto entries = std::unordered_map<Address, Entry>{};
+      auto addresses = std::vector<model::Model::AddressVersion>{};
+      auto res = std::unordered_map<std::string, FileHeader>{};
+      for (auto const& f: directory.files())
+      {
+        auto const type = f.second.first;
+        if (type != EntryType::file && type != EntryType::directory)
+          continue;
+        if (elle::contains(directory.inline_files(), f.first))
+        {
+          res.emplace(f.first, directory.inline_header(f.first));
+          continue;
+        }
+        auto const address = Address(
+          f.second.second.value(), model::flags::mutable_block, false);
+        auto& entry = entries[address];
+        // Hard links share the same block.
+        if (entry.second.empty())
+          addresses.emplace_back(address, this->_cached_version(address, type));
+        entry.first = type;
+        entry.second.emplace_back(f.first);
+      }
+      for (int i = 0; i < signed(addresses.size()); i += batch_size)
+      {
+        auto const end = std::min(i + batch_size, signed(addresses.size()));
+        this->_block_store->multifetch(
+          std::vector<model::Model::AddressVersion>(
+            addresses.begin() + i, addresses.begin() + end),
+          [&] (Address addr,
+               std::unique_ptr<model::blocks::Block> block,
+               std::exception_ptr exception)
+          {
+            auto it = entries.find(addr);
+            if (it == entries.end())
+              return;
+            auto const& names = it->second.second;
+            if (exception)
+            {
+              ELLE_DEBUG("%s: unable to fetch \"%s\": %s",
+                         this, names.front(), elle::exception_string(exception));
+              return;
+            }
+            try
+            {
+              auto const path = directory.path() / names.front();
+              auto header = boost::optional<FileHeader>{};
+              if (it->second.first == EntryType::file)
+              {
+                if (auto fd = this->_cache_file(path, addr, std::move(block)))
+                  header = fd->header();
+              }
+              else if (auto dd =
+                       this->_cache_directory(path, addr, std::move(block)))
+                header = dd->header();
+              if (header)
+                for (auto const& name: names)
+                  res.emplace(name, *header);
+            }
+            catch (elle::Error const& e)
+            {
+              ELLE_DEBUG("%s: unable to read \"%s\": %s",
+                         this, names.front(), e.what());
+            }
+          });
+      }
+      ELLE_DEBUG("%s: fetched %s headers", this, res.size());
+      return res;
+    }
+
+    /*------.
+    | Cache |
+    `------*/
+
+    void
+    FileSystem::cache_evict()
+    {
+      static auto bench_file = elle::Bench(
+        "bench.filesystem.filecache.evict", std::chrono::seconds(1000));
+      static auto bench_directory = elle::Bench(
+        "bench.filesystem.dircache.evict", std::chrono::seconds(1000));
+      static auto bench_bytes = elle::Bench(
+        "bench.filesystem.cache.bytes", std::chrono::seconds(1000));
+      // Footprints change as cached entries are updated in place, recompute
+      // them.
+      auto file_bytes = std::size_t(0);
+      for (auto const& f: this->_file_cache)
+        file_bytes += f->footprint();
+      auto directory_bytes = std::size_t(0);
+      for (auto const& d: this->_directory_cache)
+        directory_bytes += d->footprint();
+      auto& files = this->_file_cache.get<1>();
+      auto& directories = this->_directory_cache.get<1>();
+      int file_evictions = 0;
+      int directory_evictions = 0;
+      // Evict from both caches in least recently used order.
+      while (file_bytes + directory_bytes > this->_cache_size)
+      {
+        if (files.empty() && directories.empty())
+          break;
+        if (directories.empty() ||
+            (!files.empty() &&
+             (*files.begin())->last_used() <=
+             (*directories.begin())->last_used()))
+        {
+          file_bytes -= (*files.begin())->footprint();
+          files.erase(files.begin());
+          ++file_evictions;
+          prometheus::increment(this->_file_cache_metrics.evictions);
+        }
+        else
+        {
+          directory_bytes -= (*directories.begin())->footprint();
+          directories.erase(directories.begin());
+          ++directory_evictions;
+          prometheus::increment(this->_directory_cache_metrics.evictions);
+        }
+      }
+      if (file_evictions || directory_evictions)
+        ELLE_DEBUG("%s: evicted %s files and %s directories from cache",
+                   this, file_evictions, directory_evictions);
+      bench_file.add(file_evictions);
+      bench_directory.add(directory_evictions);
+      this->_cache_bytes = file_bytes + directory_bytes;
+      bench_bytes.add(this->_cache_bytes);
+#if INFINIT_ENABLE_PROMETHEUS
+      if (auto g = this->_file_cache_metrics.bytes.get())
+        g->Set(file_bytes);
+      if (auto g = this->_directory_cache_metrics.bytes.get())
+        g->Set(directory_bytes);
+#endif
+    }
+
+    void
+    FileSystem::_cache_cleanup()
+    {
+      static auto const interval =
+        elle::os::getenv("INFINIT_FS_CACHE_CLEANUP_INTERVAL_MS", 1000);
+      while (true)
+      {
+        this->cache_evict();
+        elle::reactor::sleep(boost::posix_time::milliseconds(interval));
+      }
+    }
+
+    /*------------.
+    | Prefetching |
+    `------------*/
+
+    namespace
+    {
+      using elle::os::getenv;
+      auto const prefetch_threads = getenv("INFINIT_PREFETCH_THREADS", 3);
+      /// Number of blocks requested by each multifetch.
+      auto const prefetch_group = getenv("INFINIT_PREFETCH_GROUP", 64);
+      /// Metadata caches fill ratio, in percent, above which prefetching
+      /// stops.
+      auto const prefetch_cache_pressure =
+        getenv("INFINIT_PREFETCH_CACHE_PRESSURE", 90);
+    }
+
+    void
+    FileSystem::prefetch(
+      DirectoryData const& directory,
+      std::unordered_map<std::string, FileHeader> const& fetched)
+    {
+      // Disable prefetching if we have no cache
+      bool const have_cache =
+        model::doughnut::consensus::StackedConsensus::find<
+          model::doughnut::consensus::Cache>(
+            dynamic_cast<model::doughnut::Doughnut&>(
+              *this->_block_store).consensus().get());
+      if (!prefetch_threads || !have_cache)
+      {
+        ELLE_DUMP("%s: prefetching is disabled", this);
+        return;
+      }
+      if (this->_prefetch_pressure())
+      {
+        ELLE_DEBUG("%s: skip prefetching under cache pressure", this);
+        return;
+      }
+      this->_prefetch_enqueue(directory, 0, fetched);
+    }
+
+    void
+    FileSystem::_prefetch_enqueue(
+      DirectoryData const& directory,
+      int level,
+      std::unordered_map<std::string, FileHeader> const& fetched)
+    {
+      if (signed(this->_prefetch_queue.size()) <= level)
+        this->_prefetch_queue.resize(level + 1);
+      auto& queue = this->_prefetch_queue[level];
+      int queued = 0;
+      for (auto const& q: this->_prefetch_queue)
+        queued += signed(q.size());
+      // Iterate in readdir order, so entries are fetched in the order they are
+      // likely to be stat'ed.
+      int count = 0;
+      auto fetched_directories = std::vector<Address>{};
+      for (auto const& f: directory.files())
+      {
+        if (queued >= this->_prefetch_queue_size)
+        {
+          ELLE_DEBUG("%s: prefetch queue is full", this);
+          break;
+        }
+        if (elle::contains(directory.inline_files(), f.first))
+          continue;
+        auto const address = Address(
+          f.second.second.value(), model::flags::mutable_block, false);
+        if (elle::contains(fetched, f.first))
+        {
+          if (f.second.first == EntryType::directory &&
+              level + 1 < this->_prefetch_depth)
+            fetched_directories.emplace_back(address);
+          continue;
+        }
+        if (!this->_prefetch_pending.insert(address).second)
+          continue;
+        queue.push_back(PrefetchEntry{
+          address, level, f.second.first == EntryType::directory,
+          this->_cached_version(address, f.second.first)});
+        ++queued;
+        ++count;
+      }
+      ELLE_TRACE("%s: queue %s entries of %s for prefetching at level %s",
+                 this, count, directory.address(), level);
+      // Their blocks are cached already, only recurse in them.
+      for (auto const& address: fetched_directories)
+      {
+        auto it = this->_directory_cache.find(address);
+        if (it != this->_directory_cache.end())
+          this->_prefetch_enqueue(**it, level + 1);
+      }
+      auto const wanted = std::min<int>(
+        prefetch_threads, (queued + prefetch_group - 1) / prefetch_group);
+      for (; this->_prefetching < wanted; ++this->_prefetching)
+        this->_running.emplace_back(
+          new elle::reactor::Thread(
+            elle::sprintf("%s prefetcher %s", this, this->_prefetching),
+            [this] { this->_prefetcher(); }));
+    }
+
+    bool
+    FileSystem::_prefetch_pressure() const
+    {
+      return this->_cache_bytes * 100 >=
+        this->_cache_size * prefetch_cache_pressure;
+    }
+
+    std::vector<FileSystem::PrefetchEntry>
+    FileSystem::_prefetch_batch()
+    {
+      auto res = std::vector<PrefetchEntry>{};
+      if (this->_prefetch_pressure())
+      {
+        ELLE_DEBUG("%s: cancel prefetching under cache pressure", this);
+        for (auto& queue: this->_prefetch_queue)
+        {
+          for (auto const& e: queue)
+            this->_prefetch_pending.erase(e.address);
+          queue.clear();
+        }
+        return res;
+      }
+      // Shallowest levels first, they are most likely to be accessed.
+      for (auto& queue: this->_prefetch_queue)
+        while (!queue.empty() && signed(res.size()) < prefetch_group)
+        {
+          res.emplace_back(std::move(queue.front()));
+          queue.pop_front();
+        }
+      return res;
+    }
+
+    void
+    FileSystem::_prefetcher()
+    {
+      static elle::Bench bench("bench.fs.prefetch", std::chrono::seconds(10000));
+      elle::Bench::BenchScope bs(bench);
+      auto const start = now();
+      int count = 0;
+      while (true)
+      {
+        auto const batch = this->_prefetch_batch();
+        if (batch.empty())
+          break;
+        ELLE_TRACE_SCOPE("%s: prefetch %s entries", this, batch.size());
+        auto addresses = std::vector<model::Model::AddressVersion>{};
+        auto recurse = std::unordered_map<Address, int>{};
+        for (auto const& e: batch)
+        {
+          addresses.emplace_back(e.address, e.cached_version);
+          if (e.is_dir && e.level + 1 < this->_prefetch_depth)
+            recurse.emplace(e.address, e.level);
+        }
+        try
+        {
+          // The consensus resolves the owners of the whole batch at once and
+          // fetches from each of them concurrently.
+          this->_block_store->multifetch(
+            addresses,
+            [&] (Address addr,
+                 std::unique_ptr<model::blocks::Block> block,
+                 std::exception_ptr exception)
+            {
+              this->_prefetch_pending.erase(addr);
+              ++count;
+              ++this->_prefetched;
+              if (exception)
+              {
+                ELLE_TRACE("%s: unable to prefetch %f: %s",
+                           this, addr, elle::exception_string(exception));
+                return;
+              }
+              auto it = recurse.find(addr);
+              if (it == recurse.end())
+                return;
+              try
+              {
+                if (block)
+                  this->_prefetch_enqueue(
+                    DirectoryData({}, *block, {true, true}), it->second + 1);
+                else
+                {
+                  auto cached = this->_directory_cache.find(addr);
+                  if (cached == this->_directory_cache.end())
+                    elle::err("directory at %f vanished from cache", addr);
+                  this->_prefetch_enqueue(**cached, it->second + 1);
+                }
+              }
+              catch (elle::Error const& e)
+              {
+                ELLE_TRACE("%s: exception while prefetching: %s",
+                           this, e.what());
+              }
+            });
+        }
+        catch (elle::Error const& e)
+        {
+          ELLE_TRACE("%s: exception while prefetching: %s", this, e.what());
+          for (auto const& a: addresses)
+            this->_prefetch_pending.erase(a.first);
+        }
+      }
+      ELLE_TRACE("%s: prefetched %s entries in %s ms", this, count,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                   now() - start).count());
+      --this->_prefetching;
+      auto* self = elle::reactor::scheduler().current();
+      auto it = std::find_if(
+        this->_running.begin(), this->_running.end(),
+        [self] (elle::reactor::Thread::unique_ptr const& p)
+        {
+          return p.get() == self;
+        });
+      if (it != this->_running.end())
+      {
+        (*it)->dispose(true);
+        it->release();
+        std::swap(this->_running.back(), *it);
+        this->_running.pop_back();
+      }
+      else
+        ELLE_WARN("%s: thread %s not found in running list", this, self);
+    }
   }
 }
 
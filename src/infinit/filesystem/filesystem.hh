@@ -1,6 +1,9 @@
 #pragma once
 
 #include <chrono>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/identity.hpp>
@@ -15,8 +18,10 @@
 #include <elle/reactor/Thread.hh>
 
 #include <infinit/filesystem/FileHeader.hh>
+#include <infinit/filesystem/compression.hh>
 #include <infinit/filesystem/fwd.hh>
 #include <infinit/model/Model.hh>
+#include <infinit/model/prometheus.hh>
 
 namespace infinit
 {
@@ -51,12 +56,27 @@ namespace infinit
     std::ostream&
     operator <<(std::ostream& out, OperationType operation);
 
+    /// A small file stored in its directory block.
+    struct InlineFile
+    {
+      InlineFile() = default;
+      InlineFile(FileHeader header, elle::Buffer data);
+      InlineFile(elle::serialization::SerializerIn& s, elle::Version const& v);
+      void
+      serialize(elle::serialization::Serializer& s, elle::Version const& v);
+      using serialization_tag = infinit::serialization_tag;
+      FileHeader header;
+      elle::Buffer data;
+    };
+
     struct Operation
     {
       OperationType type;
       std::string target;
       EntryType entry_type;
       Address address;
+      /// The content of target if it is an inline file.
+      boost::optional<InlineFile> inline_file;
     };
 
     class DirectoryData
@@ -77,24 +97,43 @@ namespace infinit
             std::unique_ptr<model::blocks::ACLBlock>&block = null_block,
             bool set_mtime = false,
             bool first_write = false);
+      /// Schedule prefetching of the directory entries, see
+      /// FileSystem::prefetch.
       void
-      _prefetch(FileSystem& fs, std::shared_ptr<DirectoryData> self);
+      _prefetch(FileSystem& fs,
+                std::unordered_map<std::string, FileHeader> const& fetched =
+                {});
       void
       serialize(elle::serialization::Serializer&, elle::Version const& v);
+      /// Approximate memory used, in bytes.
+      std::size_t
+      footprint() const;
       using serialization_tag = infinit::serialization_tag;
       ELLE_ATTRIBUTE_R(model::Address, address);
       ELLE_ATTRIBUTE_R(int, block_version);
       using Files = elle::unordered_map<std::string, std::pair<EntryType, model::Address>>;
       ELLE_ATTRIBUTE_R(FileHeader, header);
       ELLE_ATTRIBUTE_R(Files, files);
+      /// Files stored in the directory block rather than in blocks of their
+      /// own, see FileSystem::inline_file_size. They are listed in files too,
+      /// with a null address. They have the directory permissions, and are
+      /// moved to blocks of their own before these change.
+      using InlineFiles = elle::unordered_map<std::string, InlineFile>;
+      ELLE_ATTRIBUTE_R(InlineFiles, inline_files);
+      /// The header of inline file @a name, with the directory permissions.
+      FileHeader
+      inline_header(std::string const& name) const;
+      /// Total size of the inline files contents.
+      std::size_t
+      inline_size() const;
       ELLE_ATTRIBUTE_R(bool, inherit_auth);
-      ELLE_ATTRIBUTE_R(bool, prefetching);
       ELLE_ATTRIBUTE_R(clock::time_point, last_prefetch);
       ELLE_ATTRIBUTE_R(clock::time_point, last_used);
       ELLE_ATTRIBUTE_R(bfs::path, path);
       friend class Unknown;
       friend class Directory;
       friend class File;
+      friend class FileData;
       friend class Node;
       friend class FileSystem;
       friend class Symlink;
@@ -147,6 +186,10 @@ namespace infinit
       FileData(bfs::path path,
                model::Address address, int mode,
                int block_size);
+      /// Construct the inline file @a name of @a parent.
+      FileData(bfs::path path,
+               std::shared_ptr<DirectoryData> parent,
+               std::string name);
       void
       update(model::blocks::Block& block,
              std::pair<bool, bool> perms,
@@ -158,6 +201,9 @@ namespace infinit
             bool first_write = false);
       void
       merge(const FileData& previous, WriteTarget target);
+      /// Approximate memory used, in bytes.
+      std::size_t
+      footprint() const;
       ELLE_ATTRIBUTE_R(model::Address, address);
       ELLE_ATTRIBUTE_R(int, block_version);
       ELLE_ATTRIBUTE_R(clock::time_point, last_used);
@@ -166,7 +212,75 @@ namespace infinit
       ELLE_ATTRIBUTE_R(std::vector<FatEntry>, fat);
       ELLE_ATTRIBUTE_R(elle::Buffer, data);
       ELLE_ATTRIBUTE_R(bfs::path, path);
+      /// Serialize the file block content in the format of version @a v.
+      void
+      serialize(elle::serialization::Serializer& s, elle::Version const& v);
       using serialization_tag = infinit::serialization_tag;
+
+    /*-------------.
+    | Indirect FAT |
+    `-------------*/
+    public:
+      /// Fetch the indirect FAT pages, if not done yet.
+      void
+      load_fat(model::Model& model);
+      /// Replace FAT entry @a index, marking its indirect page dirty.
+      void
+      set_fat_entry(int index, FatEntry entry);
+      /// Large FATs are split in pages of entries stored in immutable blocks,
+      /// the file block only holding the pages addresses and keys. Writing a
+      /// block of a huge file then only rewrites its FAT page and the file
+      /// block.
+      ELLE_ATTRIBUTE_R(std::vector<FatEntry>, fat_pages);
+    private:
+      /// The file block content, in the format of the @a model version.
+      elle::Buffer
+      _serialize(model::Model const& model);
+      /// Store modified FAT pages, recording them in @a stored.
+      ///
+      /// @return The addresses of the replaced pages, to remove once the
+      ///         file block is committed.
+      std::vector<Address>
+      _store_fat_pages(model::Model& model, std::vector<Address>& stored);
+      /// Number of FAT entries, as last read or written.
+      uint64_t _fat_size = 0;
+      /// Whether _fat holds the content of the indirect pages.
+      bool _fat_loaded = true;
+      std::unordered_set<int> _fat_dirty_pages;
+
+    /*-------------.
+    | Inline files |
+    `-------------*/
+    public:
+      /// Whether the file is stored in its directory block.
+      bool
+      is_inline() const;
+      /// Move an inline file to a block of its own, pointing its directory
+      /// entry to it. Open buffers follow the file to its new address.
+      ///
+      /// @return The new file block.
+      std::unique_ptr<ACLBlock>
+      promote(FileSystem& fs);
+      /// Promote several inline files, sealing their new blocks together.
+      ///
+      /// @return The new file blocks, null for files already moved.
+      static
+      std::vector<std::unique_ptr<ACLBlock>>
+      promote(FileSystem& fs, std::vector<FileData*> const& files);
+    private:
+      /// Register the buffer of the inline file at @a inline_address under
+      /// its new address.
+      void
+      _move_buffer(FileSystem& fs, Address const& inline_address) const;
+      /// Store an inline file in its directory, promoting it if it outgrew
+      /// it.
+      ///
+      /// @return Whether the file was written, false if it was promoted
+      ///         through another copy and must be written to its block.
+      bool
+      _write_inline(FileSystem& fs);
+      ELLE_ATTRIBUTE(std::shared_ptr<DirectoryData>, inline_parent);
+      ELLE_ATTRIBUTE(std::string, inline_name);
       friend class FileSystem;
       friend class File;
       friend class FileHandle;
@@ -193,6 +307,7 @@ namespace infinit
                     model::blocks::Block const& block);
     ELLE_DAS_SYMBOL(allow_root_creation);
     ELLE_DAS_SYMBOL(block_size);
+    ELLE_DAS_SYMBOL(compression);
     ELLE_DAS_SYMBOL(model);
     ELLE_DAS_SYMBOL(map_other_permissions);
     ELLE_DAS_SYMBOL(mountpoint);
@@ -215,6 +330,14 @@ namespace infinit
     `------*/
     public:
       using clock = std::chrono::high_resolution_clock;
+      /// Metadata cache metrics exported to Prometheus.
+      struct CacheMetrics
+      {
+        prometheus::CounterPtr hits;
+        prometheus::CounterPtr misses;
+        prometheus::CounterPtr evictions;
+        prometheus::GaugePtr bytes;
+      };
 
     /*-------------.
     | Construction |
@@ -230,7 +353,8 @@ namespace infinit
         boost::optional<bfs::path> mountpoint = {},
         bool allow_root_creation = false,
         bool map_other_permissions = true,
-        boost::optional<int> block_size = {});
+        boost::optional<int> block_size = {},
+        Compression compression = Compression::none);
       ~FileSystem() override;
     private:
       struct Init;
@@ -270,12 +394,33 @@ namespace infinit
       boost::signals2::signal<void()> on_root_block_create;
       std::shared_ptr<DirectoryData>
       get(bfs::path path, model::Address address);
+      /// Fetch the blocks of @a directory files and subdirectories by
+      /// batches, refreshing the metadata caches.
+      ///
+      /// @return The header of each readable entry, by name.
+      std::unordered_map<std::string, FileHeader>
+      fetch_headers(DirectoryData const& directory);
       void filesystem(elle::reactor::filesystem::FileSystem* fs) override;
       elle::reactor::filesystem::FileSystem* filesystem();
 
     private:
       Address
       root_address();
+      boost::optional<int>
+      _cached_version(Address address, EntryType type) const;
+      /// Refresh the cached file at @a address with @a block if any.
+      ///
+      /// @return The cached file, or null if @a block is null and the file is
+      ///         not cached.
+      std::shared_ptr<FileData>
+      _cache_file(bfs::path path,
+                  Address address,
+                  std::unique_ptr<model::blocks::Block> block);
+      /// Refresh the cached directory at @a address with @a block if any.
+      std::shared_ptr<DirectoryData>
+      _cache_directory(bfs::path path,
+                       Address address,
+                       std::unique_ptr<model::blocks::Block> block);
 
     public:
       elle::cryptography::rsa::PublicKey const&
@@ -322,11 +467,87 @@ namespace infinit
               >>;
       ELLE_ATTRIBUTE_R(FileCache, file_cache);
       ELLE_ATTRIBUTE_RX(std::vector<elle::reactor::Thread::unique_ptr>, running);
-      ELLE_ATTRIBUTE_RX(int, prefetching);
       ELLE_ATTRIBUTE_RW(boost::optional<int>, block_size);
+      /// Compression applied to file data blocks.
+      ELLE_ATTRIBUTE_RW(Compression, compression);
+      /// Size under which new files of directories inheriting their
+      /// permissions are stored in the directory block, zero to disable.
+      /// Defaults to INFINIT_INLINE_FILE_SIZE.
+      ELLE_ATTRIBUTE_RW(int, inline_file_size);
+      /// Total size of the inline files of a directory, past which files are
+      /// moved to blocks of their own. Defaults to
+      /// INFINIT_INLINE_DIRECTORY_SIZE.
+      ELLE_ATTRIBUTE_RW(int, inline_directory_size);
       using FileBuffers = std::unordered_map<Address, std::weak_ptr<FileBuffer>>;
       ELLE_ATTRIBUTE_RX(FileBuffers, file_buffers);
-      static const int max_cache_size = 10000;
+
+    /*------.
+    | Cache |
+    `------*/
+    public:
+      /// Evict least recently used files and directories until the metadata
+      /// caches fit in cache_size bytes.
+      void
+      cache_evict();
+    private:
+      void
+      _cache_cleanup();
+      /// Memory budget of the file and directory caches, in bytes.
+      ELLE_ATTRIBUTE_RW(std::size_t, cache_size);
+      /// Approximate memory used by the file and directory caches, in bytes.
+      ELLE_ATTRIBUTE_R(std::size_t, cache_bytes);
+      ELLE_ATTRIBUTE(CacheMetrics, file_cache_metrics);
+      ELLE_ATTRIBUTE(CacheMetrics, directory_cache_metrics);
+
+    /*------------.
+    | Prefetching |
+    `------------*/
+    public:
+      /// Queue the entries of @a directory for prefetching.
+      ///
+      /// Entries of all listed directories are fetched breadth-first in
+      /// readdir order, by batches shared between directories, recursing in
+      /// subdirectories up to INFINIT_PREFETCH_DEPTH levels. Pending work is
+      /// dropped when the metadata caches are under pressure.
+      ///
+      /// Entries in @a fetched were just fetched, see fetch_headers: they are
+      /// not fetched again, only the contents of those directories are.
+      void
+      prefetch(DirectoryData const& directory,
+               std::unordered_map<std::string, FileHeader> const& fetched =
+               {});
+      /// Number of directory levels prefetched, see INFINIT_PREFETCH_DEPTH.
+      ELLE_ATTRIBUTE_RW(int, prefetch_depth);
+      /// Maximum number of queued entries, see INFINIT_PREFETCH_QUEUE_SIZE.
+      ELLE_ATTRIBUTE_RW(int, prefetch_queue_size);
+      /// Number of entries prefetched so far.
+      ELLE_ATTRIBUTE_R(int, prefetched);
+    private:
+      struct PrefetchEntry
+      {
+        Address address;
+        int level;
+        bool is_dir;
+        boost::optional<int> cached_version;
+      };
+      void
+      _prefetch_enqueue(
+        DirectoryData const& directory,
+        int level,
+        std::unordered_map<std::string, FileHeader> const& fetched = {});
+      std::vector<PrefetchEntry>
+      _prefetch_batch();
+      bool
+      _prefetch_pressure() const;
+      void
+      _prefetcher();
+      /// Entries waiting to be fetched, one queue per depth level.
+      ELLE_ATTRIBUTE(std::vector<std::deque<PrefetchEntry>>, prefetch_queue);
+      /// Addresses queued or being fetched, across all directories.
+      ELLE_ATTRIBUTE_R(std::unordered_set<Address>, prefetch_pending);
+      /// Number of running prefetcher threads.
+      ELLE_ATTRIBUTE_RX(int, prefetching);
+      ELLE_ATTRIBUTE(elle::reactor::Thread::unique_ptr, cache_cleanup_thread);
       friend class FileData;
       friend class DirectoryData;
     };
@@ -12,6 +12,7 @@ namespace infinit
       bool allow_root_creation;
       bool map_other_permissions;
       boost::optional<int> block_size;
+      Compression compression;
 
       static
       Init
@@ -22,7 +23,8 @@ namespace infinit
            boost::optional<bfs::path> mountpoint,
            bool allow_root_creation,
            bool map_other_permissions,
-           boost::optional<int> block_size)
+           boost::optional<int> block_size,
+           Compression compression)
       {
         return Init{
           std::move(volume_name),
@@ -33,6 +35,7 @@ namespace infinit
           std::move(allow_root_creation),
           std::move(map_other_permissions),
           std::move(block_size),
+          std::move(compression),
         };
       }
     };
@@ -47,7 +50,8 @@ namespace infinit
                      filesystem::mountpoint = boost::none,
                      filesystem::allow_root_creation = false,
                      filesystem::map_other_permissions = true,
-                     filesystem::block_size = boost::none)
+                     filesystem::block_size = boost::none,
+                     filesystem::compression = Compression::none)
                    .call(&Init::init, std::forward<Args>(args)...))
     {}
 
@@ -60,7 +64,8 @@ namespace infinit
                    std::move(init.mountpoint),
                    std::move(init.allow_root_creation),
                    std::move(init.map_other_permissions),
-                   std::move(init.block_size))
+                   std::move(init.block_size),
+                   std::move(init.compression))
     {}
   }
 }
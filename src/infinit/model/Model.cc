@@ -1,4 +1,5 @@
 #include <elle/log.hh>
+#include <elle/reactor/Scope.hh>
 
 #include <infinit/model/Conflict.hh>
 #include <infinit/model/MissingBlock.hh>
@@ -221,16 +222,37 @@ namespace infinit
                       ReceiveBlock res) const
     {
       ELLE_TRACE_SCOPE("%s: fetch %s blocks", this, addresses.size());
-      this->_fetch(addresses, [&](Address addr,
-                                  std::unique_ptr<blocks::Block> block,
-                                  std::exception_ptr exception)
-        {
-          if (block && !block->validate(*this, false))
-            res(addr, {},
-                std::make_exception_ptr(elle::Error("invalid block")));
-          else
-            res(addr, std::move(block), exception);
-        });
+      // Validate blocks concurrently as they arrive, so that fetching the
+      // keys a validation depends on does not delay the other blocks.
+      elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& s)
+      {
+        this->_fetch(addresses, [&](Address addr,
+                                    std::unique_ptr<blocks::Block> block,
+                                    std::exception_ptr exception)
+          {
+            if (!block)
+              return res(addr, std::move(block), exception);
+            auto b = std::make_shared<std::unique_ptr<blocks::Block>>(
+              std::move(block));
+            s.run_background(
+              elle::sprintf("validate %f", addr),
+              [&, addr, b, exception]
+              {
+                if (this->_validate_fetched(**b))
+                  res(addr, std::move(*b), exception);
+                else
+                  res(addr, {},
+                      std::make_exception_ptr(elle::Error("invalid block")));
+              });
+          });
+        elle::reactor::wait(s);
+      };
+    }
+
+    blocks::ValidationResult
+    Model::_validate_fetched(blocks::Block const& block) const
+    {
+      return block.validate(*this, false);
     }
 
     void
@@ -271,6 +293,25 @@ namespace infinit
       return this->_update(std::move(copy), std::move(resolver));
     }
 
+    void
+    Model::seal(std::vector<blocks::Block*> const& blocks)
+    {
+      ELLE_TRACE_SCOPE("%s: seal %s blocks", *this, blocks.size());
+      if (blocks.size() < 2)
+      {
+        for (auto b: blocks)
+          b->seal();
+        return;
+      }
+      elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& s)
+      {
+        for (auto b: blocks)
+          s.run_background(elle::sprintf("seal %f", b->address()),
+                           [b] { b->seal(); });
+        elle::reactor::wait(s);
+      };
+    }
+
     void
     Model::print(std::ostream& out) const
     {
@@ -230,6 +230,13 @@ namespace infinit
       void
       seal_and_update(blocks::Block& block,
                       std::unique_ptr<ConflictResolver> = {});
+      /// Seal @a blocks concurrently.
+      ///
+      /// Encryption and signatures of all blocks run in parallel on the
+      /// background pool. Sealing a block again afterwards, for instance
+      /// through seal_and_insert, is free unless it was modified.
+      void
+      seal(std::vector<blocks::Block*> const& blocks);
       /// Remove an existing block.
       elle::das::named::Function<
         void (
@@ -244,6 +251,11 @@ namespace infinit
                   boost::optional<bool> decrypt_data
                   ) const;
     protected:
+      /// Validate @a block, fetched by multifetch along with other blocks
+      /// validated concurrently.
+      virtual
+      blocks::ValidationResult
+      _validate_fetched(blocks::Block const& block) const;
       template <typename Block, typename ... Args>
       static
       std::unique_ptr<Block>
@@ -10,6 +10,7 @@
 #include <elle/reactor/Scope.hh>
 
 #include <infinit/model/doughnut/Doughnut.hh>
+#include <infinit/model/doughnut/KeyTable.hh>
 
 ELLE_LOG_COMPONENT("infinit.model.MonitoringServer");
 
@@ -212,10 +213,15 @@ namespace infinit
               {
                 auto res = elle::json::Object{
                   {"consensus", this->_owner.consensus()->stats()},
+                  {"connections", this->_owner.dock().stats()},
+                  {"groups", this->_owner.group_key_cache().stats()},
+                  {"keys", doughnut::KeyTable::instance().stats()},
                   {"overlay", this->_owner.overlay()->stats()},
                   {"peers", this->_owner.overlay()->peer_list()},
                   {"protocol", elle::sprintf("%s", this->_owner.protocol())},
                   {"redundancy", this->_owner.consensus()->redundancy()},
+                  {"secrets", this->_owner.secret_cache().stats()},
+                  {"signatures", this->_owner.signature_cache().stats()},
                 };
                 return std::make_unique<MonitorResponse>(true, boost::none, res);
               }
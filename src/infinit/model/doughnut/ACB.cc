@@ -9,6 +9,7 @@
 #include <elle/cast.hh>
 #include <elle/log.hh>
 #include <elle/os/environ.hh>
+#include <elle/serialization/binary.hh>
 #include <elle/serialization/json.hh>
 #include <elle/utility/Move.hh>
 
@@ -20,6 +21,7 @@
 #include <elle/cryptography/SecretKey.hh>
 #include <elle/cryptography/hash.hh>
 
+#include <elle/reactor/BackgroundFuture.hh>
 #include <elle/reactor/exception.hh>
 
 #include <infinit/model/Conflict.hh>
@@ -28,6 +30,8 @@
 #include <infinit/model/blocks/GroupBlock.hh>
 #include <infinit/model/doughnut/Doughnut.hh>
 #include <infinit/model/doughnut/Group.hh>
+#include <infinit/model/doughnut/Local.hh>
+#include <infinit/model/doughnut/Remote.hh>
 #include <infinit/model/doughnut/ValidationFailed.hh>
 #include <infinit/model/doughnut/User.hh>
 #include <infinit/model/doughnut/UB.hh>
@@ -177,6 +181,7 @@ namespace infinit
         , _deleted(other._deleted)
         , _sign_key(other._sign_key)
         , _seal_version(other._seal_version)
+        , _packed_permissions(other._packed_permissions)
       {}
 
       /*--------.
@@ -211,27 +216,47 @@ namespace infinit
           target = use_encrypt ? k.decrypt(src, acb_padding) : k.open(src);
       }
 
+      /// Unwrap the secret of @a token for @a K, reusing it if cached.
+      static
+      void
+      cached_open(Doughnut& dht,
+                  elle::Buffer& target,
+                  elle::Buffer const& token,
+                  elle::cryptography::rsa::PublicKey const& K,
+                  elle::cryptography::rsa::PrivateKey const& k,
+                  bool use_encrypt)
+      {
+        target = dht.secret_cache().get(token, K, [&]
+          {
+            auto secret = elle::Buffer{};
+            background_open(secret, token, k, use_encrypt);
+            return secret;
+          });
+      }
+
       template <typename Block>
       elle::Buffer
       BaseACB<Block>::_decrypt_data(elle::Buffer const& data) const
       {
         if (this->world_readable())
           return this->_data;
+        this->_unpack_permissions();
         bool use_encrypt = this->_seal_version >= elle::Version(0, 7, 0);
         elle::Buffer secret_buffer;
         if (this->owner_private_key())
         {
           ELLE_DEBUG("%s: we are owner", *this);
-          background_open(secret_buffer, this->_owner_token,
-                          *this->owner_private_key(), use_encrypt);
+          cached_open(*this->doughnut(), secret_buffer, this->_owner_token,
+                      *this->owner_key(), *this->owner_private_key(),
+                      use_encrypt);
         }
         else if (!this->_acl_entries.empty())
         {
           // FIXME: factor searching the token
           for (auto const& e: this->_acl_entries)
             if (e.key == this->doughnut()->keys().K())
-              background_open(secret_buffer, e.token,
-                              this->doughnut()->keys().k(), use_encrypt);
+              cached_open(*this->doughnut(), secret_buffer, e.token,
+                          e.key, this->doughnut()->keys().k(), use_encrypt);
         }
         if (secret_buffer.empty())
         {
@@ -241,8 +266,8 @@ namespace infinit
             try
             {
               Group g(*this->doughnut(), e.key);
-              auto keys = g.group_keys();
               int v = this->_group_version[idx];
+              auto keys = g.group_keys(v);
               if (v >= signed(keys.size()))
               {
                 ELLE_DEBUG("announced version %s bigger than size %s",
@@ -250,7 +275,8 @@ namespace infinit
                 ++idx;
                 continue;
               }
-              background_open(secret_buffer, e.token, keys[v].k(), use_encrypt);
+              cached_open(*this->doughnut(), secret_buffer, e.token,
+                          keys[v].K(), keys[v].k(), use_encrypt);
             }
             catch (elle::Error const& e)
             {
@@ -323,6 +349,7 @@ namespace infinit
         bool read,
         bool write)
       {
+        this->_unpack_permissions();
         ELLE_TRACE_SCOPE("%s: set permisions for %s: %s, %s",
                          *this, key, read, write);
         auto& acl_entries = this->_acl_group_entries;
@@ -397,6 +424,7 @@ namespace infinit
                            bool read,
                            bool write)
       {
+        this->_unpack_permissions();
         ELLE_TRACE_SCOPE("%s: set permisions for %s: %s, %s",
                          *this, key, read, write);
         if (key == *this->owner_key())
@@ -495,6 +523,7 @@ namespace infinit
       void
       BaseACB<Block>::_copy_permissions(blocks::ACLBlock& to)
       {
+        this->_unpack_permissions();
         Self* other = dynamic_cast<Self*>(&to);
         if (!other)
           elle::err("Other block is not an ACB");
@@ -519,6 +548,7 @@ namespace infinit
       BaseACB<Block>::_list_permissions(
         boost::optional<Model const&> model) const
       {
+        this->_unpack_permissions();
         auto make_user =
           [&] (elle::cryptography::rsa::PublicKey const& k)
           -> std::unique_ptr<infinit::model::User>
@@ -602,6 +632,7 @@ namespace infinit
       blocks::ValidationResult
       BaseACB<Block>::_validate(Model const& model, bool writing) const
       {
+        this->_unpack_permissions();
         static elle::Bench bench("bench.acb._validate", std::chrono::seconds(10000));
         elle::Bench::BenchScope scope(bench);
         bool disable_signature = !this->doughnut()->encrypt_options().validate_signatures;
@@ -652,15 +683,17 @@ namespace infinit
               try
               {
                 Group g(*this->doughnut(), entry->key);
-                auto pubkeys = g.group_public_keys();
                 if (group_index >= signed(this->_group_version.size()))
                   return blocks::ValidationResult::failure("group_version array too short");
                 auto key_index = this->_group_version[group_index];
+                auto pubkeys = g.group_public_keys(key_index);
                 if (key_index >= signed(pubkeys.size()))
                   return blocks::ValidationResult::failure("group key out of range");
                 auto& key = pubkeys[key_index];
                 ELLE_DEBUG("validating with group key %s: %s", key_index, key);
-                if (!key.verify(this->data_signature(), *this->_data_sign()))
+                if (!this->doughnut()->signature_cache().verify(
+                      key, this->data_signature(), *this->_data_sign(),
+                      this->doughnut()->version()))
                 {
                   ELLE_DEBUG("%s: group author signature invalid", *this);
                   return blocks::ValidationResult::failure("Invalid group key signature");
@@ -675,7 +708,9 @@ namespace infinit
             else
             {
               auto& key = entry ? entry->key : *this->owner_key();
-              if (!key.verify(this->data_signature(), *this->_data_sign()))
+              if (!this->doughnut()->signature_cache().verify(
+                    key, this->data_signature(), *this->_data_sign(),
+                    this->doughnut()->version()))
               {
                 ELLE_DEBUG("%s: author signature invalid", *this);
                 return blocks::ValidationResult::failure
@@ -696,6 +731,7 @@ namespace infinit
       blocks::ValidationResult
       BaseACB<Block>::_validate_admin_keys(Model const& model) const
       {
+        this->_unpack_permissions();
         // check for admin keys
         auto const& aks = dynamic_cast<Doughnut const&>(model).admin_keys();
         for (auto const& k: aks.r)
@@ -728,6 +764,8 @@ namespace infinit
         auto acb = dynamic_cast<Self const*>(&new_block);
         if (!acb)
           return blocks::ValidationResult::failure("New block is not an ACB");
+        this->_unpack_permissions();
+        acb->_unpack_permissions();
         // check non-regression of group signature indexes
         if (acb->_group_version.size() != acb->_acl_group_entries.size())
           return blocks::ValidationResult::failure("Mismatch size in group entries");
@@ -778,6 +816,7 @@ namespace infinit
       BaseACB<Block>::_seal(boost::optional<int> version,
                             boost::optional<elle::cryptography::SecretKey const&> key)
       {
+        this->_unpack_permissions();
         static elle::Bench bench("bench.acb.seal", std::chrono::seconds(10000));
         elle::Bench::BenchScope scope(bench);
         if (!version && this->Super::_seal_version && *this->Super::_seal_version)
@@ -852,14 +891,33 @@ namespace infinit
             secret_buffer = key.get().password().string();
           this->_seal_version = seal_version;
           bool use_encrypt = seal_version >= elle::Version(0, 7, 0);
-          this->_owner_token = use_encrypt ?
-            this->owner_key()->encrypt(secret_buffer, acb_padding)
-            : this->owner_key()->seal(secret_buffer);
+          // Encrypt the payload and the user tokens on the background pool
+          // while group tokens, which may fetch blocks, are computed here.
+          using Future = elle::reactor::BackgroundFuture<elle::Buffer>;
+          auto cipher = std::shared_ptr<Future>{};
+          if (!this->_world_readable)
+            cipher = std::make_shared<Future>(
+              [secret = key.get(), plain = this->data_plain()]
+              {
+                return secret.encipher(plain);
+              });
+          auto const encrypt_token =
+            [&] (elle::cryptography::rsa::PublicKey const& k)
+            {
+              return std::make_shared<Future>(
+                [k, secret_buffer, use_encrypt]
+                {
+                  return use_encrypt ?
+                    k.encrypt(secret_buffer, acb_padding)
+                    : k.seal(secret_buffer);
+                });
+            };
+          auto owner_token = encrypt_token(*this->owner_key());
+          auto tokens = std::vector<std::shared_ptr<Future>>{};
           int idx = 0;
           for (auto& e: this->_acl_entries)
           {
-            if (e.read)
-              e.token = use_encrypt ? e.key.encrypt(secret_buffer, acb_padding) : e.key.seal(secret_buffer);
+            tokens.emplace_back(e.read ? encrypt_token(e.key) : nullptr);
             if (!sign_key && e.key == this->doughnut()->keys().K())
             {
               ELLE_DEBUG("we are editor %s", idx);
@@ -907,9 +965,12 @@ namespace infinit
             ELLE_DEBUG("block is world writable");
             sign_key = this->doughnut()->keys().private_key();
           }
-          if (!this->_world_readable)
-            this->blocks::MutableBlock::data(
-              key->encipher(this->data_plain()));
+          this->_owner_token = owner_token->value();
+          for (auto i = 0u; i < tokens.size(); ++i)
+            if (tokens[i])
+              this->_acl_entries[i].token = tokens[i]->value();
+          if (cipher)
+            this->blocks::MutableBlock::data(cipher->value());
           else
             this->blocks::MutableBlock::data(this->data_plain());
           this->_data_changed = false;
@@ -1006,6 +1067,30 @@ namespace infinit
         return this->_data_signature->value();
       }
 
+      template <typename Block>
+      std::vector<ACLEntry> const&
+      BaseACB<Block>::acl_entries() const
+      {
+        this->_unpack_permissions();
+        return this->_acl_entries;
+      }
+
+      template <typename Block>
+      std::vector<ACLEntry> const&
+      BaseACB<Block>::acl_group_entries() const
+      {
+        this->_unpack_permissions();
+        return this->_acl_group_entries;
+      }
+
+      template <typename Block>
+      std::vector<int> const&
+      BaseACB<Block>::group_version() const
+      {
+        this->_unpack_permissions();
+        return this->_group_version;
+      }
+
       template <typename Block>
       BaseACB<Block>::OwnerSignature::OwnerSignature(BaseACB<Block> const& b)
         : Super::OwnerSignature(b)
@@ -1158,6 +1243,11 @@ namespace infinit
       BaseACB<Block>::operator ==(blocks::Block const& rhs) const
       {
         auto that = dynamic_cast<Self const*>(&rhs);
+        if (that)
+        {
+          this->_unpack_permissions();
+          that->_unpack_permissions();
+        }
         return (that
                 && this->_editor == that->_editor
                 && this->_owner_token == that->_owner_token
@@ -1174,6 +1264,106 @@ namespace infinit
       | Serialization |
       `--------------*/
 
+      /// Whether permission tables are serialized as one nested buffer, which
+      /// is kept as is and decoded on first access.
+      static
+      bool
+      packs_permissions(elle::serialization::Serializer const& s,
+                        elle::Version const& version)
+      {
+        using namespace elle::serialization;
+        return version >= elle::Version(0, 9, 0) &&
+          (dynamic_cast<binary::SerializerIn const*>(&s) ||
+           dynamic_cast<binary::SerializerOut const*>(&s));
+      }
+
+      /// Whether keys are serialized as indexes into a peer's key table.
+      static
+      bool
+      peer_keys(elle::serialization::Serializer const& s)
+      {
+        return s.context().has<Local*>() || s.context().has<Remote*>();
+      }
+
+      static
+      void
+      copy_key_context(elle::serialization::Serializer const& from,
+                       elle::serialization::Serializer& to)
+      {
+        auto& context = elle::unconst(from.context());
+        Doughnut* dht = nullptr;
+        context.get(dht, (Doughnut*)nullptr);
+        if (dht)
+          to.set_context<Doughnut*>(dht);
+        Local* local = nullptr;
+        context.get(local, (Local*)nullptr);
+        if (local)
+          to.set_context<Local*>(local);
+        Remote* remote = nullptr;
+        context.get(remote, (Remote*)nullptr);
+        if (remote)
+          to.set_context<Remote*>(remote);
+      }
+
+      template <typename Block>
+      void
+      BaseACB<Block>::_serialize_permissions(elle::serialization::Serializer& s)
+      {
+        if (s.in())
+        {
+          auto packed = elle::Buffer();
+          s.serialize("permissions", packed);
+          this->_packed_permissions = std::move(packed);
+          this->_acl_entries.clear();
+          this->_acl_group_entries.clear();
+          this->_group_version.clear();
+          // Indexes are only meaningful while the peer is around.
+          if (peer_keys(s))
+          {
+            elle::IOStream is(this->_packed_permissions->istreambuf());
+            elle::serialization::binary::SerializerIn input(is, false);
+            copy_key_context(s, input);
+            input.serialize("acl", this->_acl_entries);
+            input.serialize("group_acl", this->_acl_group_entries);
+            input.serialize("group_version", this->_group_version);
+            this->_packed_permissions.reset();
+          }
+        }
+        else if (this->_packed_permissions && !peer_keys(s))
+          s.serialize("permissions", *this->_packed_permissions);
+        else
+        {
+          this->_unpack_permissions();
+          auto packed = elle::Buffer();
+          {
+            elle::IOStream os(packed.ostreambuf());
+            elle::serialization::binary::SerializerOut output(os, false);
+            copy_key_context(s, output);
+            output.serialize("acl", this->_acl_entries);
+            output.serialize("group_acl", this->_acl_group_entries);
+            output.serialize("group_version", this->_group_version);
+          }
+          s.serialize("permissions", packed);
+        }
+      }
+
+      template <typename Block>
+      void
+      BaseACB<Block>::_unpack_permissions() const
+      {
+        if (!this->_packed_permissions)
+          return;
+        ELLE_DUMP("%s: unpack permissions", this);
+        auto self = const_cast<Self*>(this);
+        elle::IOStream is(self->_packed_permissions->istreambuf());
+        elle::serialization::binary::SerializerIn input(is, false);
+        input.set_context<Doughnut*>(this->doughnut());
+        input.serialize("acl", self->_acl_entries);
+        input.serialize("group_acl", self->_acl_group_entries);
+        input.serialize("group_version", self->_group_version);
+        self->_packed_permissions.reset();
+      }
+
       template <typename Block>
       BaseACB<Block>::BaseACB(elle::serialization::SerializerIn& input,
                               elle::Version const& version)
@@ -1208,7 +1398,15 @@ namespace infinit
           this->_data_signature = std::make_shared<typename Super::SignFuture>();
         s.serialize("editor", this->_editor);
         s.serialize("owner_token", this->_owner_token);
-        s.serialize("acl", this->_acl_entries);
+        bool const packed = packs_permissions(s, version);
+        if (packed)
+          this->_serialize_permissions(s);
+        else
+        {
+          if (s.out())
+            this->_unpack_permissions();
+          s.serialize("acl", this->_acl_entries);
+        }
         s.serialize("data_version", this->_data_version);
         if (version < elle::Version(0, 4, 0))
           if (s.out())
@@ -1277,8 +1475,11 @@ namespace infinit
         {
           s.serialize("world_readable", this->_world_readable);
           s.serialize("world_writable", this->_world_writable);
-          s.serialize("group_acl", this->_acl_group_entries);
-          s.serialize("group_version", this->_group_version);
+          if (!packed)
+          {
+            s.serialize("group_acl", this->_acl_group_entries);
+            s.serialize("group_version", this->_group_version);
+          }
           s.serialize("deleted", this->_deleted);
         }
         if (version >= elle::Version(0, 7, 0))
@@ -76,9 +76,9 @@ namespace infinit
         ELLE_ATTRIBUTE_R(int, editor);
         ELLE_ATTRIBUTE_R(elle::Buffer, owner_token);
         ELLE_ATTRIBUTE(bool, acl_changed, protected);
-        ELLE_ATTRIBUTE_R(std::vector<ACLEntry>, acl_entries);
-        ELLE_ATTRIBUTE_R(std::vector<ACLEntry>, acl_group_entries);
-        ELLE_ATTRIBUTE_R(std::vector<int>, group_version);
+        ELLE_ATTRIBUTE(std::vector<ACLEntry>, acl_entries);
+        ELLE_ATTRIBUTE(std::vector<ACLEntry>, acl_group_entries);
+        ELLE_ATTRIBUTE(std::vector<int>, group_version);
         ELLE_ATTRIBUTE_R(int, data_version, protected);
         ELLE_ATTRIBUTE(std::shared_ptr<elle::reactor::BackgroundFuture<elle::Buffer>>,
                        data_signature);
@@ -88,6 +88,13 @@ namespace infinit
         ELLE_ATTRIBUTE_R(std::shared_ptr<elle::cryptography::rsa::PrivateKey>, sign_key);
         // Version used for tokens and secrets. Can differ from block version
         ELLE_ATTRIBUTE_R(elle::Version, seal_version);
+      public:
+        std::vector<ACLEntry> const&
+        acl_entries() const;
+        std::vector<ACLEntry> const&
+        acl_group_entries() const;
+        std::vector<int> const&
+        group_version() const;
       protected:
         elle::Buffer const& data_signature() const;
 
@@ -143,6 +150,14 @@ namespace infinit
         _admin_user(elle::cryptography::rsa::PublicKey const& key) const;
         bool
         _admin_group(elle::cryptography::rsa::PublicKey const& key) const;
+        /// Decode the permission tables if they are still packed.
+        void
+        _unpack_permissions() const;
+        /// The permission tables as last deserialized, decoded on first
+        /// access. Only set when decoding needs nothing but the Doughnut:
+        /// tables received from a peer refer to its keys by index and are
+        /// decoded right away.
+        ELLE_ATTRIBUTE(boost::optional<elle::Buffer>, packed_permissions);
 
       /*-----------.
       | Validation |
@@ -214,6 +229,8 @@ namespace infinit
         void
         _serialize(elle::serialization::Serializer& input,
                    elle::Version const& version);
+        void
+        _serialize_permissions(elle::serialization::Serializer& s);
       };
 
       using ACB = BaseACB<blocks::ACLBlock>;
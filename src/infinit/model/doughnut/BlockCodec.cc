@@ -0,0 +1,336 @@
+#include <infinit/model/doughnut/BlockCodec.hh>
+
+#include <cstring>
+#include <typeinfo>
+
+#include <elle/err.hh>
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+#include <elle/serialization/binary.hh>
+
+#include <elle/cryptography/rsa/PublicKey.hh>
+
+#include <infinit/model/doughnut/CHB.hh>
+#include <infinit/model/doughnut/Doughnut.hh>
+#include <infinit/model/doughnut/KeyTable.hh>
+#include <infinit/model/doughnut/NB.hh>
+#include <infinit/model/doughnut/UB.hh>
+
+ELLE_LOG_COMPONENT("infinit.model.doughnut.BlockCodec");
+
+namespace infinit
+{
+  namespace model
+  {
+    namespace doughnut
+    {
+      namespace codec
+      {
+        namespace
+        {
+          bool const disabled =
+            elle::os::getenv("INFINIT_DISABLE_BLOCK_CODEC", false);
+
+          /// Generic serializations start with the major version, zero.
+          uint8_t constexpr marker = 0xff;
+          uint8_t constexpr layout = 1;
+
+          enum class Type: uint8_t
+          {
+            chb = 1,
+            nb = 2,
+            ub = 3,
+          };
+
+          class Writer
+          {
+          public:
+            Writer(elle::Buffer& buffer)
+              : _buffer(buffer)
+            {}
+
+            void
+            byte(uint8_t b)
+            {
+              this->raw(&b, 1);
+            }
+
+            void
+            varint(uint64_t v)
+            {
+              uint8_t encoded[10];
+              auto size = 0;
+              do
+              {
+                encoded[size++] = (v & 0x7f) | (v > 0x7f ? 0x80 : 0);
+                v >>= 7;
+              }
+              while (v);
+              this->raw(encoded, size);
+            }
+
+            void
+            raw(void const* data, std::size_t size)
+            {
+              auto const offset = this->_buffer.size();
+              this->_buffer.size(offset + size);
+              std::memcpy(this->_buffer.mutable_contents() + offset, data, size);
+            }
+
+            void
+            address(Address const& address)
+            {
+              this->raw(address.value(), sizeof(Address::Value));
+            }
+
+            void
+            bytes(elle::ConstWeakBuffer data)
+            {
+              this->varint(data.size());
+              this->raw(data.contents(), data.size());
+            }
+
+          private:
+            elle::Buffer& _buffer;
+          };
+
+          class Reader
+          {
+          public:
+            Reader(elle::ConstWeakBuffer data)
+              : _position(data.contents())
+              , _end(data.contents() + data.size())
+            {}
+
+            uint8_t
+            byte()
+            {
+              return *this->_take(1);
+            }
+
+            uint64_t
+            varint()
+            {
+              auto res = uint64_t(0);
+              for (int shift = 0; shift < 64; shift += 7)
+              {
+                auto const b = this->byte();
+                res |= uint64_t(b & 0x7f) << shift;
+                if (!(b & 0x80))
+                  return res;
+              }
+              elle::err("invalid varint in compact block");
+            }
+
+            Address
+            address()
+            {
+              return Address(this->_take(sizeof(Address::Value)));
+            }
+
+            elle::ConstWeakBuffer
+            bytes()
+            {
+              auto const size = this->varint();
+              if (size > std::size_t(this->_end - this->_position))
+                elle::err("truncated compact block");
+              return elle::ConstWeakBuffer(this->_take(size), size);
+            }
+
+            elle::Buffer
+            buffer()
+            {
+              auto const res = this->bytes();
+              return elle::Buffer(res.contents(), res.size());
+            }
+
+            void
+            finish() const
+            {
+              if (this->_position != this->_end)
+                elle::err("%s trailing bytes in compact block",
+                          this->_end - this->_position);
+            }
+
+          private:
+            uint8_t const*
+            _take(std::size_t size)
+            {
+              if (std::size_t(this->_end - this->_position) < size)
+                elle::err("truncated compact block");
+              auto const res = this->_position;
+              this->_position += size;
+              return res;
+            }
+
+            uint8_t const* _position;
+            uint8_t const* _end;
+          };
+
+          std::shared_ptr<elle::cryptography::rsa::PublicKey>
+          _owner(elle::ConstWeakBuffer der)
+          {
+            // Skip parsing keys already known to the process.
+            return KeyTable::instance().intern_der(der);
+          }
+        }
+
+        bool
+        supported(blocks::Block const& block)
+        {
+          auto const& type = typeid(block);
+          return type == typeid(CHB) || type == typeid(NB) ||
+            type == typeid(UB);
+        }
+
+        bool
+        enabled(blocks::Block const& block, Doughnut const& dht)
+        {
+          return !disabled && supported(block) &&
+            dht.version() >= elle::Version(0, 9, 0);
+        }
+
+        bool
+        compact(elle::ConstWeakBuffer data)
+        {
+          return data.size() > 0 && data.contents()[0] == marker;
+        }
+
+        elle::Buffer
+        encode(blocks::Block const& block)
+        {
+          auto res = elle::Buffer();
+          auto w = Writer(res);
+          w.byte(marker);
+          w.byte(layout);
+          if (auto chb = dynamic_cast<CHB const*>(&block))
+          {
+            w.byte(uint8_t(Type::chb));
+            w.address(chb->address());
+            w.bytes(chb->data());
+            w.bytes(chb->salt());
+            w.address(chb->owner());
+          }
+          else if (auto nb = dynamic_cast<NB const*>(&block))
+          {
+            w.byte(uint8_t(Type::nb));
+            w.address(nb->address());
+            w.bytes(nb->data());
+            w.bytes(elle::cryptography::rsa::publickey::der::encode(
+                      *nb->owner()));
+            w.bytes(elle::ConstWeakBuffer(nb->name().data(),
+                                          nb->name().size()));
+            w.bytes(nb->signature());
+          }
+          else if (auto ub = dynamic_cast<UB const*>(&block))
+          {
+            w.byte(uint8_t(Type::ub));
+            w.address(ub->address());
+            w.bytes(elle::ConstWeakBuffer(ub->name().data(),
+                                          ub->name().size()));
+            w.bytes(elle::cryptography::rsa::publickey::der::encode(
+                      ub->key()));
+            w.byte(ub->reverse());
+            w.byte(bool(ub->passport()));
+            if (ub->passport())
+              w.bytes(elle::serialization::binary::serialize(
+                        *ub->passport(), false));
+          }
+          else
+            elle::err("no compact encoding for %f", block);
+          return res;
+        }
+
+        std::unique_ptr<blocks::Block>
+        decode(elle::ConstWeakBuffer data, Doughnut& dht)
+        {
+          auto r = Reader(data);
+          if (r.byte() != marker)
+            elle::err("not a compact block");
+          auto const l = r.byte();
+          if (l != layout)
+            elle::err("unknown compact block layout: %s", int(l));
+          auto res = std::unique_ptr<blocks::Block>();
+          switch (Type(r.byte()))
+          {
+            case Type::chb:
+            {
+              auto const address = r.address();
+              auto data = r.buffer();
+              auto salt = r.buffer();
+              auto const owner = r.address();
+              res = std::make_unique<CHB>(
+                address, std::move(data), std::move(salt), owner);
+              break;
+            }
+            case Type::nb:
+            {
+              auto const address = r.address();
+              auto data = r.buffer();
+              auto owner = _owner(r.bytes());
+              auto name = r.bytes().string();
+              auto signature = r.buffer();
+              res = std::make_unique<NB>(
+                dht, address, std::move(owner), std::move(name),
+                std::move(data), std::move(signature));
+              break;
+            }
+            case Type::ub:
+            {
+              auto const address = r.address();
+              auto name = r.bytes().string();
+              auto const key = _owner(r.bytes());
+              auto const reverse = bool(r.byte());
+              auto passport = boost::optional<Passport>();
+              if (r.byte())
+              {
+                elle::serialization::Context ctx;
+                ctx.set<Doughnut*>(&dht);
+                passport.emplace(
+                  elle::serialization::binary::deserialize<Passport>(
+                    r.buffer(), false, ctx));
+              }
+              res = std::make_unique<UB>(
+                &dht, address, std::move(name), *key, reverse,
+                std::move(passport));
+              break;
+            }
+            default:
+              elle::err("unknown compact block type");
+          }
+          r.finish();
+          return res;
+        }
+
+        elle::Buffer
+        serialize(blocks::Block const& block, Doughnut const& dht)
+        {
+          if (enabled(block, dht))
+            return encode(block);
+          auto res = elle::Buffer();
+          {
+            elle::IOStream s(res.ostreambuf());
+            elle::serialization::binary::SerializerOut output(s);
+            auto ptr = &block;
+            output.serialize_forward(ptr);
+          }
+          return res;
+        }
+
+        std::unique_ptr<blocks::Block>
+        deserialize(elle::Buffer const& data, Doughnut& dht)
+        {
+          if (compact(data))
+          {
+            ELLE_DUMP("decode compact block of %s bytes", data.size());
+            return decode(data, dht);
+          }
+          elle::serialization::Context ctx;
+          ctx.set<Doughnut*>(&dht);
+          return elle::serialization::binary::deserialize<
+            std::unique_ptr<blocks::Block>>(data, true, ctx);
+        }
+      }
+    }
+  }
+}
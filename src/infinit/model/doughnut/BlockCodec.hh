@@ -0,0 +1,60 @@
+#pragma once
+
+#include <memory>
+
+#include <elle/Buffer.hh>
+
+#include <infinit/model/blocks/Block.hh>
+#include <infinit/model/doughnut/fwd.hh>
+
+namespace infinit
+{
+  namespace model
+  {
+    namespace doughnut
+    {
+      /// Compact binary encoding of stored blocks.
+      ///
+      /// Immutable blocks are the bulk of what nodes store and cache, and the
+      /// generic serializer spells out field names and type tags for each of
+      /// them. Content hash, named and user blocks are laid out here as raw
+      /// fields behind a one byte marker no generic serialization starts
+      /// with, so readers tell both encodings apart and blocks stored by
+      /// older versions remain readable. Blocks are only written compact from
+      /// network version 0.9.0 on, unless INFINIT_DISABLE_BLOCK_CODEC is set.
+      ///
+      /// Mutable blocks always use the generic serializer: under Paxos they
+      /// are stored within the decision state rather than on their own, and
+      /// the content their signatures cover is the versioned generic
+      /// serialization, with pending signatures and key hashes resolved
+      /// through the serialization context. Blocks exchanged over RPC are
+      /// not compacted either, as peers agree on a network version but not
+      /// on a storage layout.
+      namespace codec
+      {
+        /// Whether @a block has a compact encoding.
+        bool
+        supported(blocks::Block const& block);
+        /// Whether @a block is compact encoded when stored on behalf of
+        /// @a dht.
+        bool
+        enabled(blocks::Block const& block, Doughnut const& dht);
+        /// Whether @a data is compact encoded.
+        bool
+        compact(elle::ConstWeakBuffer data);
+        /// The compact encoding of @a block, which must be supported.
+        elle::Buffer
+        encode(blocks::Block const& block);
+        /// The block compact encoded in @a data.
+        std::unique_ptr<blocks::Block>
+        decode(elle::ConstWeakBuffer data, Doughnut& dht);
+        /// The encoding of @a block to store on behalf of @a dht.
+        elle::Buffer
+        serialize(blocks::Block const& block, Doughnut const& dht);
+        /// The block encoded in @a data, whatever the encoding.
+        std::unique_ptr<blocks::Block>
+        deserialize(elle::Buffer const& data, Doughnut& dht);
+      }
+    }
+  }
+}
@@ -1,8 +1,6 @@
 #include <elle/bench.hh>
 #include <elle/log.hh>
 
-#include <elle/cryptography/hash.hh>
-
 #include <elle/reactor/duration.hh>
 #include <elle/reactor/scheduler.hh>
 
@@ -10,6 +8,7 @@
 #include <infinit/model/doughnut/ACB.hh>
 #include <infinit/model/doughnut/Doughnut.hh>
 #include <infinit/model/doughnut/Group.hh>
+#include <infinit/model/doughnut/sha256.hh>
 
 ELLE_LOG_COMPONENT("infinit.model.doughnut.CHB")
 
@@ -36,6 +35,15 @@ namespace infinit
           this->_owner = Address::null;
       }
 
+      CHB::CHB(Address address,
+               elle::Buffer data,
+               elle::Buffer salt,
+               Address owner)
+        : Super(address, std::move(data))
+        , _salt(std::move(salt))
+        , _owner(owner)
+      {}
+
       CHB::CHB(CHB const& other)
         : Super(other)
         , _salt(other._salt)
@@ -70,9 +78,12 @@ namespace infinit
       CHB::_validate(Model const& model, bool writing) const
       {
         ELLE_DEBUG_SCOPE("%s: validate", *this);
+        // Blocks validated concurrently are hashed together.
+        auto const dht = dynamic_cast<Doughnut const*>(&model);
+        auto const batch = dht ? &elle::unconst(dht)->hash_batch() : nullptr;
         auto expected_address =
           CHB::_hash_address(this->data(), this->_owner,
-                             this->_salt, model.version());
+                             this->_salt, model.version(), batch);
         if (!equal_unflagged(this->address(), expected_address))
         {
           auto reason =
@@ -244,7 +255,7 @@ namespace infinit
           {
             // group has access, now check the key is indeed a group key
             Group g(dht, *sig.group_key);
-            auto pubs = g.group_public_keys();
+            auto pubs = g.group_public_keys(*sig.group_index);
             ELLE_TRACE("checking with group key %s/%s", *sig.group_index,
               pubs.size());
             if (signed(pubs.size()) > *sig.group_index
@@ -258,26 +269,30 @@ namespace infinit
       Address
       CHB::_hash_address(elle::Buffer const& content,
                          Address owner, elle::Buffer const& salt,
-                         elle::Version const& version)
+                         elle::Version const& version,
+                         sha256::Batch* batch)
       {
         static elle::Bench bench("bench.chb.hash", std::chrono::seconds(10000));
         elle::Bench::BenchScope bs(bench);
-        elle::Buffer saltowner(salt);
         if (version < elle::Version(0, 4, 0))
           owner = Address::null;
+        auto message = sha256::Message{salt};
         if (owner)
-          saltowner.append(owner.value(), sizeof(Address::Value));
-        elle::IOStream stream(saltowner.istreambuf_combine(content));
+          message.emplace_back(owner.value(), sizeof(Address::Value));
+        message.emplace_back(content);
         elle::Buffer hash;
+        if (batch)
+          hash = batch->digest(message);
         // FIXME: scheduler::run?
-        if (content.size() > 262144 && elle::reactor::Scheduler::scheduler())
+        else if (content.size() > 262144 &&
+                 elle::reactor::Scheduler::scheduler())
         {
           elle::reactor::background([&] {
-              hash = elle::cryptography::hash(stream, elle::cryptography::Oneway::sha256);
+              hash = sha256::digest(message);
             });
         }
         else
-          hash = elle::cryptography::hash(stream, elle::cryptography::Oneway::sha256);
+          hash = sha256::digest(message);
         return {hash.contents(),
                 flags::immutable_block,
                 version >= elle::Version(0, 5, 0)};
@@ -28,6 +28,11 @@ namespace infinit
             elle::Buffer data,
             elle::Buffer salt,
             Address owner = Address::null);
+        /// Restore a stored block, trusting @a address.
+        CHB(Address address,
+            elle::Buffer data,
+            elle::Buffer salt,
+            Address owner);
         CHB(CHB const& other);
         CHB(CHB&& other);
 
@@ -76,8 +81,9 @@ namespace infinit
         Address
         _hash_address(elle::Buffer const& content, Address owner,
                       elle::Buffer const& salt,
-                      elle::Version const& version);
-        ELLE_ATTRIBUTE(elle::Buffer, salt);
+                      elle::Version const& version,
+                      sha256::Batch* batch = nullptr);
+        ELLE_ATTRIBUTE_R(elle::Buffer, salt);
         ELLE_ATTRIBUTE_R(Address, owner); // owner ACB address or null
       };
     }
@@ -12,6 +12,7 @@
 #include <elle/serialization/binary.hh>
 
 #include <infinit/model/MissingBlock.hh>
+#include <infinit/model/doughnut/BlockCodec.hh>
 #include <infinit/model/doughnut/Doughnut.hh>
 #include <infinit/model/doughnut/Local.hh>
 #include <infinit/model/doughnut/OKB.hh>
@@ -290,10 +291,15 @@ namespace infinit
               ELLE_DEBUG("disk cache hit on %f", address);
               bench_disk_hit.add(1);
               auto path = *this->_disk_cache_path / elle::sprintf("%x", address);
-              boost::filesystem::ifstream is(path, std::ios::binary);
-              elle::serialization::binary::SerializerIn sin(is);
-              sin.set_context<Doughnut*>(&this->doughnut());
-              auto block = sin.deserialize<std::unique_ptr<blocks::Block>>();
+              auto data = elle::Buffer(boost::filesystem::file_size(path));
+              {
+                boost::filesystem::ifstream is(path, std::ios::binary);
+                is.read(reinterpret_cast<char*>(data.mutable_contents()),
+                        data.size());
+                if (is.gcount() != signed(data.size()))
+                  elle::err("truncated disk cache entry %s", path);
+              }
+              auto block = codec::deserialize(data, this->doughnut());
               this->_disk_cache.modify(disk_hit,
                 [](CachedCHB& b) { b.last_used(now());});
               return block;
@@ -405,10 +411,10 @@ namespace infinit
           auto path = *this->_disk_cache_path
             / elle::sprintf("%x", block.address());
           {
+            auto const data = codec::serialize(block, this->doughnut());
             boost::filesystem::ofstream ofs(path, std::ios::binary);
-            elle::serialization::binary::SerializerOut sout(ofs);
-            sout.set_context<Doughnut*>(&this->doughnut());
-            sout.serialize_forward(&block);
+            ofs.write(reinterpret_cast<char const*>(data.contents()),
+                      data.size());
           }
           auto sz = boost::filesystem::file_size(path);
           this->_disk_cache.emplace(CachedCHB{block.address(), sz, now()});
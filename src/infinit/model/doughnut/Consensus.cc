@@ -12,10 +12,22 @@
 #include <elle/reactor/Channel.hh>
 #include <elle/reactor/Scope.hh>
 #include <elle/reactor/scheduler.hh>
+#include <elle/reactor/signal.hh>
 #include <elle/reactor/network/Error.hh>
 
 ELLE_LOG_COMPONENT("infinit.model.doughnut.consensus.Consensus");
 
+namespace
+{
+  /// Delay after which another replica is asked for a block, when the
+  /// latency of the first one is unknown.
+  auto const hedge_delay = elle::reactor::Duration(
+    boost::posix_time::milliseconds(
+      elle::os::getenv("INFINIT_FETCH_HEDGE_DELAY_MS", 1000)));
+  /// Maximum number of replicas asked for a block at once.
+  auto const hedge_max = elle::os::getenv("INFINIT_FETCH_HEDGE_MAX", 2);
+}
+
 namespace infinit
 {
   namespace model
@@ -244,64 +256,79 @@ namespace infinit
                                       Address address,
                                       boost::optional<int> local_version)
         {
-          bool hit = false;
-          // try connecting to all peers in parallel
-          auto connected_peers = MemberGenerator(
-            [&](MemberGenerator::yielder yield)
-            {
-              elle::With<elle::reactor::Scope>() <<
-              [&peers,&yield,&hit] (elle::reactor::Scope& s)
+          auto members = std::vector<std::shared_ptr<Peer>>{};
+          for (auto wp: peers)
+            if (auto p = wp.lock())
+              members.emplace_back(std::move(p));
+            else
+              ELLE_TRACE("peer was deleted while fetching");
+          // Read from the closest replica first, and only ask another one if
+          // it fails or is slower than usual, to avoid wasting bandwidth.
+          sort_by_latency(members);
+          auto res = std::unique_ptr<blocks::Block>{};
+          auto found = false;
+          auto next = 0;
+          auto running = 0;
+          auto done = elle::reactor::Signal{};
+          elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& s)
+          {
+            auto fetch = [&]
               {
-                for (auto wp: peers)
-                  if (auto p = wp.lock())
+                auto peer = members[next++];
+                ++running;
+                s.run_background(
+                  elle::sprintf("fetch from %s", peer),
+                  [&, peer]
                   {
-                    hit = true;
-                    s.run_background(elle::sprintf("connect to %s", *p),
-                    [p,&yield]
+                    try
                     {
-                      try
+                      ELLE_TRACE_SCOPE("fetch from %s", peer);
+                      auto block = peer->fetch(address, local_version);
+                      if (!found)
                       {
-                        if (auto remote = std::dynamic_pointer_cast<Remote>(p))
-                          remote->safe_perform("connect", [&] { yield(p);});
-                        else
-                          yield(p);
+                        found = true;
+                        res = std::move(block);
                       }
-                      catch (elle::Error const& e)
-                      {
-                        ELLE_TRACE("connect to peer %s failed: %s", p, e.what());
-                      }
-                    });
-                  }
-                  else
-                    ELLE_TRACE("peer was deleted while fetching");
-
-                elle::reactor::wait(s);
+                    }
+                    // FIXME: get rid of that
+                    catch (elle::Error const& e)
+                    {
+                      ELLE_TRACE("attempt fetching %f from %s failed: %s",
+                                 address, *peer, e.what());
+                    }
+                    --running;
+                    done.signal();
+                  });
               };
-          });
-          // try to get on all connected peers sequentially to avoid wasting
-          // bandwidth
-          int attempt = 0;
-          for (auto wpeer: connected_peers)
-            if (auto peer = wpeer.lock())
-            {
-              ++attempt;
-              try
+            while (!found)
+              if (running == 0)
               {
-                ELLE_TRACE_SCOPE("fetch from %s", peer);
-                return peer->fetch(address, local_version);
+                if (next == signed(members.size()))
+                  break;
+                fetch();
               }
-              // FIXME: get rid of that
-              catch (elle::Error const& e)
+              else
               {
-                ELLE_TRACE("attempt fetching %f from %s failed: %s",
-                           address, *peer, e.what());
+                auto const slow = members[next - 1]->slow_latency();
+                auto const delay = slow ?
+                  elle::reactor::Duration(
+                    boost::posix_time::microseconds(slow->count())) :
+                  hedge_delay;
+                if (!elle::reactor::wait(done, delay) && !found &&
+                    running < hedge_max && next < signed(members.size()))
+                {
+                  ELLE_TRACE("%s is slow, also fetch from %s",
+                             members[next - 1], members[next]);
+                  fetch();
+                }
               }
-            }
-            else
-              ELLE_TRACE("peer was deleted while fetching");
+            s.terminate_now();
+          };
+          if (found)
+            return res;
           // Some overlays may return peers even if they don't have the block,
           // so we have to return MissingBlock here.
-          ELLE_TRACE("all %s peers failed fetching %f", attempt, address);
+          ELLE_TRACE("all %s peers failed fetching %f", next, address);
           throw MissingBlock(address);
         }
 
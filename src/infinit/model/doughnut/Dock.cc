@@ -4,10 +4,12 @@
 
 #include <elle/find.hh>
 #include <elle/log.hh>
+#include <elle/make-vector.hh>
 #include <elle/multi_index_container.hh>
 #include <elle/network/Interface.hh>
 #include <elle/os.hh>
 #include <elle/range.hh>
+#include <elle/utils.hh>
 
 #include <elle/reactor/network/utp-server.hh>
 
@@ -127,7 +129,9 @@ namespace infinit
             if (auto c = connecting.lock())
               if (c->_thread)
                 c->_thread->terminate();
-          auto connected_copy = this->_connected;
+          auto connected_copy = elle::make_vector(this->_connected);
+          for (auto const& c: this->_bulk_connected)
+            connected_copy.emplace_back(c);
           for (auto& connected: connected_copy)
             if (auto c = connected.lock())
               if (c->_thread)
@@ -196,14 +200,39 @@ namespace infinit
       std::shared_ptr<Dock::Connection>
       Dock::connect(NodeLocation l, bool no_remote)
       {
-        ELLE_TRACE_SCOPE("%s: connect to %f", this, l);
+        return this->_connect(std::move(l), Traffic::control, no_remote);
+      }
+
+      std::shared_ptr<Dock::Connection>
+      Dock::connect_bulk(NodeLocation l)
+      {
+        ELLE_ASSERT(l.id());
+        return this->_connect(std::move(l), Traffic::bulk, true);
+      }
+
+      auto
+      Dock::_connected_for(Traffic traffic)
+        -> Connected<Connection>&
+      {
+        if (traffic == Traffic::bulk)
+          return this->_bulk_connected;
+        else
+          return this->_connected;
+      }
+
+      std::shared_ptr<Dock::Connection>
+      Dock::_connect(NodeLocation l, Traffic traffic, bool no_remote)
+      {
+        ELLE_TRACE_SCOPE("%s: connect to %f for %s", this, l, traffic);
+        auto& metrics = this->metrics(traffic);
         // Check if we already have a connection to that peer.
         if (l.id())
         {
-          if (auto i = elle::find(this->_connected, l.id()))
+          if (auto i = elle::find(this->_connected_for(traffic), l.id()))
           {
             auto res = ELLE_ENFORCE(i->lock());
             ELLE_TRACE("%s: already connected %f: %s", this, l, res);
+            ++metrics.reused;
             return res;
           }
           else
@@ -217,17 +246,19 @@ namespace infinit
           for (auto wc: connecting)
           {
             auto c = ELLE_ENFORCE(wc.lock());
-            if (c->id() == l.id())
+            if (c->id() == l.id() && c->traffic() == traffic)
             {
               ELLE_TRACE("already connecting to %f: %s", l, c);
+              ++metrics.reused;
               return c;
             }
           }
         }
         // Otherwise start connection.
         {
-          auto connection = Connection::make(*this, std::move(l));
+          auto connection = Connection::make(*this, std::move(l), traffic);
           ELLE_TRACE_SCOPE("initiate %s", connection);
+          ++metrics.opened;
           connection->init();
           if (!no_remote)
             connection->on_connection().connect(
@@ -246,9 +277,11 @@ namespace infinit
 
       Dock::Connection::Connection(
         Dock& dock,
-        NodeLocation l)
+        NodeLocation l,
+        Traffic traffic)
         : _dock(dock)
         , _location(l)
+        , _traffic(traffic)
         , _socket(nullptr)
         , _connected(false)
         , _disconnected(false)
@@ -256,11 +289,12 @@ namespace infinit
       {}
 
       auto
-      Dock::Connection::make(Dock& dock, NodeLocation loc)
+      Dock::Connection::make(Dock& dock, NodeLocation loc, Traffic traffic)
         -> std::shared_ptr<Connection>
       {
         // Cannot use make_shared.
-        auto res = std::shared_ptr<Dock::Connection>(new Connection(dock, loc));
+        auto res = std::shared_ptr<Dock::Connection>(
+          new Connection(dock, loc, traffic));
         res->_self = res;
         return res;
       }
@@ -422,7 +456,8 @@ namespace infinit
             // Check for duplicates.
             auto const id = this->_location.id();
             ELLE_ASSERT(id);
-            if (elle::contains(this->_dock._connected, id))
+            auto& connected = this->_dock._connected_for(this->_traffic);
+            if (elle::contains(connected, id))
             {
               ELLE_TRACE("drop duplicate");
               this->_disconnected = true;
@@ -437,13 +472,13 @@ namespace infinit
             this->_connected = true;
             ELLE_TRACE("connected through %s", this->_connected_endpoint);
             this->_connected_it =
-              this->_dock._connected.insert(this->shared_from_this()).first;
+              connected.insert(this->shared_from_this()).first;
             this->_dock._connecting.erase(connecting_it);
             auto const cleanup = [&]
               {
                 if (this->_connected_it)
                 {
-                  this->_dock._connected.erase(this->_connected_it.get());
+                  connected.erase(this->_connected_it.get());
                   this->_connected_it.reset();
                 }
                 this->_disconnected = true;
@@ -459,7 +494,10 @@ namespace infinit
               };
             try
             {
-              this->_dock.on_connection()(*this);
+              if (this->_traffic == Traffic::bulk)
+                this->_declare_bulk();
+              else
+                this->_dock.on_connection()(*this);
               ELLE_DEBUG("invoke connected hook")
               {
                 auto hold = this->shared_from_this();
@@ -500,7 +538,8 @@ namespace infinit
       {
         if (this->_connected_it)
         {
-          this->_dock._connected.erase(this->_connected_it.get());
+          this->_dock._connected_for(this->_traffic).erase(
+            this->_connected_it.get());
           this->_connected_it.reset();
         }
         // Delay termination from destructor.
@@ -533,6 +572,19 @@ namespace infinit
                       reinterpret_cast<void const*>(this),
                       this->_dock.doughnut().id(),
                       this->_location.id());
+        if (this->_traffic == Traffic::bulk)
+          out << "[bulk]";
+      }
+
+      void
+      Dock::Connection::_declare_bulk()
+      {
+        ELLE_TRACE_SCOPE("%s: declare bulk traffic", this);
+        using Bulk = auto () -> void;
+        auto bulk = RPC<Bulk>("bulk", this->_channels.get(),
+                              this->_dock.doughnut().version(),
+                              &this->_credentials);
+        bulk();
       }
 
       namespace
@@ -730,6 +782,50 @@ namespace infinit
           return res;
         }
       }
+
+      /*--------.
+      | Metrics |
+      `--------*/
+
+      auto
+      Dock::metrics(Traffic traffic)
+        -> Metrics&
+      {
+        return this->_metrics[static_cast<int>(traffic)];
+      }
+
+      elle::json::Object
+      Dock::stats() const
+      {
+        auto res = elle::json::Object{};
+        for (auto traffic: {Traffic::control, Traffic::bulk})
+        {
+          auto const& m = this->_metrics[static_cast<int>(traffic)];
+          auto& connected = elle::unconst(this)->_connected_for(traffic);
+          res[elle::sprintf("%s", traffic)] = elle::json::Object{
+            {"connected", connected.size()},
+            {"opened", m.opened},
+            {"reused", m.reused},
+            {"rpcs", m.rpcs},
+            {"fallbacks", m.fallbacks},
+            {"failures", m.failures},
+          };
+        }
+        return res;
+      }
+
+      std::ostream&
+      operator <<(std::ostream& out, Dock::Traffic traffic)
+      {
+        switch (traffic)
+        {
+          case Dock::Traffic::control:
+            return out << "control";
+          case Dock::Traffic::bulk:
+            return out << "bulk";
+        }
+        elle::unreachable();
+      }
     }
   }
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include <elle/reactor/asio.hh>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/global_fun.hpp>
@@ -28,6 +30,14 @@ namespace infinit
       `-------------*/
       public:
         class Connection;
+        /// Kind of traffic carried by a connection.
+        enum class Traffic
+        {
+          /// Latency-sensitive messages, e.g. Paxos.
+          control,
+          /// Large transfers, e.g. data blocks.
+          bulk,
+        };
         Dock(Doughnut& dht,
              Protocol protocol = {},
              boost::optional<int> port = {},
@@ -89,11 +99,12 @@ namespace infinit
           : public elle::Printable::as<Connection>
         {
         private:
-          Connection(Dock& dock, NodeLocation loc);
+          Connection(Dock& dock, NodeLocation loc, Traffic traffic);
         public:
           static
           std::shared_ptr<Connection>
-          make(Dock& dock, NodeLocation loc);
+          make(Dock& dock, NodeLocation loc,
+               Traffic traffic = Traffic::control);
           std::shared_ptr<Connection>
           shared_from_this();
           // Workaround shared_from_this in the constructor. Always build
@@ -103,6 +114,7 @@ namespace infinit
           ~Connection() noexcept(false);
           ELLE_ATTRIBUTE_R(Dock&, dock);
           ELLE_ATTRIBUTE_R(NodeLocation, location);
+          ELLE_ATTRIBUTE_R(Traffic, traffic);
           ELLE_attribute_r(Address, id);
           ELLE_attribute_r(Endpoints, endpoints);
           ELLE_ATTRIBUTE(std::unique_ptr<std::iostream>, socket);
@@ -137,6 +149,10 @@ namespace infinit
         private:
           void
           _key_exchange(elle::protocol::ChanneledStream& channels);
+          /// Tell the peer this connection carries bulk traffic, so it does
+          /// not broadcast on it.
+          void
+          _declare_bulk();
           friend class Dock;
         };
 
@@ -152,8 +168,23 @@ namespace infinit
         /// @param no_remote Do not automatically create a remote on this conneciton
         std::shared_ptr<Connection>
         connect(NodeLocation l, bool no_remote = false);
+        /// Get a bulk connection to the given location.
+        ///
+        /// Bulk connections carry large transfers apart from the control
+        /// connection, so they do not delay latency-sensitive RPCs. They are
+        /// never bound to a Remote, whose bulk connection they become.
+        ///
+        /// @param l Location of the peer to connect to, with a set id.
+        std::shared_ptr<Connection>
+        connect_bulk(NodeLocation l);
         ELLE_ATTRIBUTE_R(Connecting<Connection>, connecting);
         ELLE_ATTRIBUTE(Connected<Connection>, connected);
+        ELLE_ATTRIBUTE(Connected<Connection>, bulk_connected);
+      private:
+        std::shared_ptr<Connection>
+        _connect(NodeLocation l, Traffic traffic, bool no_remote);
+        Connected<Connection>&
+        _connected_for(Traffic traffic);
 
       /*-----.
       | Peer |
@@ -174,7 +205,37 @@ namespace infinit
                               &weak_access<Peer, Address const&, &Peer::id>>>>>;
         ELLE_ATTRIBUTE_R(PeerCache, peer_cache);
         friend class Remote;
+
+      /*--------.
+      | Metrics |
+      `--------*/
+      public:
+        /// Connection usage of a traffic class.
+        struct Metrics
+        {
+          /// Connections opened.
+          int opened = 0;
+          /// Connection requests served by an existing connection.
+          int reused = 0;
+          /// RPCs sent.
+          int rpcs = 0;
+          /// RPCs sent on the control connection because no connection of
+          /// this class was ready.
+          int fallbacks = 0;
+          /// RPCs retried on the control connection because the connection
+          /// of this class failed.
+          int failures = 0;
+        };
+        Metrics&
+        metrics(Traffic traffic);
+        elle::json::Object
+        stats() const;
+      private:
+        ELLE_ATTRIBUTE((std::array<Metrics, 2>), metrics);
       };
+
+      std::ostream&
+      operator <<(std::ostream& out, Dock::Traffic traffic);
     }
   }
 }
@@ -33,6 +33,7 @@
 #include <infinit/model/doughnut/UB.hh>
 #include <infinit/model/doughnut/User.hh>
 #include <infinit/model/doughnut/Group.hh>
+#include <infinit/model/doughnut/KeyTable.hh>
 #include <infinit/model/doughnut/Consensus.hh>
 #include <infinit/model/doughnut/Async.hh>
 #include <infinit/model/doughnut/Cache.hh>
@@ -522,6 +523,17 @@ namespace infinit
         this->_consensus->fetch(addresses, res);
       }
 
+      blocks::ValidationResult
+      Doughnut::_validate_fetched(blocks::Block const& block) const
+      {
+        // Sibling blocks are validated concurrently: let their signatures
+        // be verified and their contents hashed in parallel.
+        SignatureCache::Background background(
+          elle::unconst(this)->signature_cache());
+        sha256::Batch::Scope batch(elle::unconst(this)->hash_batch());
+        return Model::_validate_fetched(block);
+      }
+
       void
       Doughnut::_insert(std::unique_ptr<blocks::Block> block,
                         std::unique_ptr<ConflictResolver> resolver)
@@ -674,7 +686,8 @@ namespace infinit
         if (it == this->_key_cache.get<0>().end())
         {
           int index = this->_key_cache.get<0>().size();
-          this->_key_cache.insert(KeyHash(index, k));
+          this->_key_cache.insert(
+            KeyHash(index, KeyTable::instance().intern(k)));
           return index;
         }
         else
@@ -20,7 +20,11 @@
 #include <infinit/model/Model.hh>
 #include <infinit/model/doughnut/Consensus.hh>
 #include <infinit/model/doughnut/Dock.hh>
+#include <infinit/model/doughnut/GroupKeyCache.hh>
 #include <infinit/model/doughnut/Passport.hh>
+#include <infinit/model/doughnut/SecretCache.hh>
+#include <infinit/model/doughnut/SignatureCache.hh>
+#include <infinit/model/doughnut/sha256.hh>
 #include <infinit/model/prometheus.hh>
 #include <infinit/overlay/Overlay.hh>
 
@@ -218,6 +222,14 @@ namespace infinit
 
       public:
         ELLE_ATTRIBUTE_R(KeyCache, key_cache);
+        /// Secrets unwrapped from ACB tokens.
+        ELLE_ATTRIBUTE_RX(SecretCache, secret_cache);
+        /// Signatures already verified.
+        ELLE_ATTRIBUTE_RX(SignatureCache, signature_cache);
+        /// Block contents hashed together.
+        ELLE_ATTRIBUTE_RX(sha256::Batch, hash_batch);
+        /// Group keys, by group.
+        ELLE_ATTRIBUTE_RX(GroupKeyCache, group_key_cache);
 
       protected:
         std::unique_ptr<blocks::MutableBlock>
@@ -250,6 +262,9 @@ namespace infinit
         _fetch(std::vector<AddressVersion> const& addresses,
                ReceiveBlock res) const override;
 
+        blocks::ValidationResult
+        _validate_fetched(blocks::Block const& block) const override;
+
         void
         _insert(std::unique_ptr<blocks::Block> block,
                 std::unique_ptr<ConflictResolver> resolver) override;
@@ -132,6 +132,7 @@ namespace infinit
             *gb->owner_key(), true);
           auto hub = std::make_unique<UB>(
             &_dht, ':' + UB::hash(*gb->owner_key()).string(), *gb->owner_key());
+          _dht.seal({hub.get(), ub.get(), rub.get(), gb.get()});
           // FIXME
           auto const name = elle::sprintf("@%s", this->_name);
           _dht.insert(std::move(hub),
@@ -338,6 +339,8 @@ namespace infinit
           std::make_unique<GroupConflictResolver>(
             GroupConflictResolver::Action::remove_member,
             user));
+        // Removing a member rotates the group key, drop the cached ones.
+        this->_dht.group_key_cache().invalidate(this->public_control_key());
       }
 
       void
@@ -377,18 +380,38 @@ namespace infinit
       Group::group_keys()
       {
         return filesystem::umbrella([&] {
-            return this->block().all_keys();
+            return this->_dht.group_key_cache().update(
+              this->public_control_key(), this->block(), true).keys;
         });
       }
 
+      std::vector<elle::cryptography::rsa::KeyPair>
+      Group::group_keys(int version)
+      {
+        auto& cache = this->_dht.group_key_cache();
+        if (auto keys = cache.get(this->public_control_key(), version, true))
+          return keys->keys;
+        return this->group_keys();
+      }
+
       std::vector<elle::cryptography::rsa::PublicKey>
       Group::group_public_keys()
       {
         return filesystem::umbrella([&] {
-            return this->block().all_public_keys();
+            return this->_dht.group_key_cache().update(
+              this->public_control_key(), this->block(), false).public_keys;
         });
       }
 
+      std::vector<elle::cryptography::rsa::PublicKey>
+      Group::group_public_keys(int version)
+      {
+        auto& cache = this->_dht.group_key_cache();
+        if (auto keys = cache.get(this->public_control_key(), version, false))
+          return keys->public_keys;
+        return this->group_public_keys();
+      }
+
       boost::optional<std::string> const&
       Group::description() const
       {
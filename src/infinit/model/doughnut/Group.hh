@@ -54,10 +54,20 @@ namespace infinit
         remove_admin(model::User const& user);
         void
         remove_admin(elle::Buffer const& user_data);
+        /// The group keys, fetching the group block.
         std::vector<elle::cryptography::rsa::KeyPair>
         group_keys();
+        /// The group keys, from the Doughnut cache if they include
+        /// @a version.
+        std::vector<elle::cryptography::rsa::KeyPair>
+        group_keys(int version);
+        /// The group public keys, fetching the group block.
         std::vector<elle::cryptography::rsa::PublicKey>
         group_public_keys();
+        /// The group public keys, from the Doughnut cache if they include
+        /// @a version.
+        std::vector<elle::cryptography::rsa::PublicKey>
+        group_public_keys(int version);
         void
         destroy();
         void
@@ -0,0 +1,193 @@
+#include <infinit/model/doughnut/GroupKeyCache.hh>
+
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+
+#include <infinit/model/doughnut/GB.hh>
+
+ELLE_LOG_COMPONENT("infinit.model.doughnut.GroupKeyCache");
+
+namespace
+{
+  int const default_capacity =
+    elle::os::getenv("INFINIT_GROUP_KEY_CACHE_SIZE", 256);
+}
+
+namespace infinit
+{
+  namespace model
+  {
+    namespace doughnut
+    {
+      /*-------------.
+      | Construction |
+      `-------------*/
+
+      GroupKeyCache::GroupKeyCache()
+        : GroupKeyCache(default_capacity)
+      {}
+
+      GroupKeyCache::GroupKeyCache(int capacity)
+        : _capacity(std::max(capacity, 0))
+        , _hits(0)
+        , _misses(0)
+        , _invalidations(0)
+      {}
+
+      GroupKeyCache::~GroupKeyCache()
+      {
+        this->clear();
+      }
+
+      /*--------.
+      | Content |
+      `--------*/
+
+      GroupKeyCache::Keys const*
+      GroupKeyCache::get(PublicKey const& group, int version, bool private_keys)
+      {
+        auto it = this->_index.find(group);
+        if (it != this->_index.end())
+        {
+          auto const& keys = it->second->keys;
+          auto const available =
+            private_keys ? keys.keys.size() : keys.public_keys.size();
+          if (version >= 0 && version < signed(available))
+          {
+            ELLE_DUMP("%s: hit for %s version %s", this, group, version);
+            ++this->_hits;
+            this->_entries.splice(
+              this->_entries.begin(), this->_entries, it->second);
+            return &keys;
+          }
+        }
+        ++this->_misses;
+        return nullptr;
+      }
+
+      GroupKeyCache::Keys const&
+      GroupKeyCache::update(PublicKey const& group,
+                            GB const& block,
+                            bool private_keys)
+      {
+        auto it = this->_index.find(group);
+        if (it != this->_index.end())
+        {
+          // Keys of a newer block, maybe fetched from an up to date replica,
+          // include those of older ones.
+          auto& keys = it->second->keys;
+          if (keys.block_version >= block.version() &&
+              (!private_keys || !keys.keys.empty()))
+            return keys;
+        }
+        auto keys = Keys{block.version(), block.all_public_keys(), {}};
+        if (private_keys)
+          keys.keys = block.all_keys();
+        else if (it != this->_index.end() &&
+                 it->second->keys.block_version == block.version())
+          keys.keys = std::move(it->second->keys.keys);
+        if (!this->_capacity)
+        {
+          this->_wipe(this->_uncached);
+          return this->_uncached = std::move(keys);
+        }
+        if (it != this->_index.end())
+        {
+          if (it->second->keys.block_version != block.version())
+          {
+            ELLE_DEBUG("%s: group %s changed from version %s to %s",
+                       this, group,
+                       it->second->keys.block_version, block.version());
+            ++this->_invalidations;
+          }
+          this->_wipe(it->second->keys);
+          it->second->keys = std::move(keys);
+          this->_entries.splice(
+            this->_entries.begin(), this->_entries, it->second);
+        }
+        else
+        {
+          this->_entries.push_front(Entry{group, std::move(keys)});
+          this->_index.emplace(group, this->_entries.begin());
+          this->_shrink();
+        }
+        return this->_entries.front().keys;
+      }
+
+      void
+      GroupKeyCache::invalidate(PublicKey const& group)
+      {
+        auto it = this->_index.find(group);
+        if (it == this->_index.end())
+          return;
+        ELLE_DEBUG("%s: invalidate %s", this, group);
+        ++this->_invalidations;
+        this->_erase(it->second);
+      }
+
+      void
+      GroupKeyCache::_shrink()
+      {
+        while (signed(this->_entries.size()) > this->_capacity)
+          this->_erase(std::prev(this->_entries.end()));
+      }
+
+      void
+      GroupKeyCache::_erase(Entries::iterator it)
+      {
+        this->_wipe(it->keys);
+        this->_index.erase(it->group);
+        this->_entries.erase(it);
+      }
+
+      void
+      GroupKeyCache::_wipe(Keys& keys)
+      {
+        for (auto const& k: keys.keys)
+          this->_on_wipe(k);
+        keys.keys.clear();
+      }
+
+      void
+      GroupKeyCache::clear()
+      {
+        for (auto& entry: this->_entries)
+          this->_wipe(entry.keys);
+        this->_wipe(this->_uncached);
+        this->_index.clear();
+        this->_entries.clear();
+      }
+
+      void
+      GroupKeyCache::capacity(int capacity)
+      {
+        this->_capacity = std::max(capacity, 0);
+        this->_shrink();
+      }
+
+      std::size_t
+      GroupKeyCache::size() const
+      {
+        return this->_entries.size();
+      }
+
+      /*-----------.
+      | Monitoring |
+      `-----------*/
+
+      elle::json::Object
+      GroupKeyCache::stats() const
+      {
+        auto const lookups = this->_hits + this->_misses;
+        return elle::json::Object{
+          {"capacity", this->_capacity},
+          {"size", this->_entries.size()},
+          {"hits", this->_hits},
+          {"misses", this->_misses},
+          {"invalidations", this->_invalidations},
+          {"hit_rate", lookups ? double(this->_hits) / lookups : 0.},
+        };
+      }
+    }
+  }
+}
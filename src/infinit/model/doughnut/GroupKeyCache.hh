@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/signals2.hpp>
+
+#include <elle/attribute.hh>
+#include <elle/cryptography/rsa/KeyPair.hh>
+#include <elle/cryptography/rsa/PublicKey.hh>
+#include <elle/json/json.hh>
+
+namespace infinit
+{
+  namespace model
+  {
+    namespace doughnut
+    {
+      class GB;
+
+      /// Bounded cache of group keys, by group public control key.
+      ///
+      /// Reading or validating a block shared with a group requires the
+      /// group keys, which costs fetching and decrypting the group block.
+      /// Group keys are only ever appended, so the key of a given group
+      /// version never changes: a block is handled with the cached keys as
+      /// long as they include its version, and the group block is fetched
+      /// again only past them. Keys recorded from another version of the
+      /// group block replace the cached ones. Key pairs are released as soon
+      /// as they are evicted or replaced, OpenSSL clearing private keys as
+      /// it frees them.
+      class GroupKeyCache
+      {
+      /*------.
+      | Types |
+      `------*/
+      public:
+        using Self = GroupKeyCache;
+        using PublicKey = elle::cryptography::rsa::PublicKey;
+        using KeyPair = elle::cryptography::rsa::KeyPair;
+        /// The keys of a group as of a group block version.
+        struct Keys
+        {
+          int block_version;
+          std::vector<PublicKey> public_keys;
+          /// The key pairs, empty unless unwrapped.
+          std::vector<KeyPair> keys;
+        };
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+      public:
+        /// Construct a cache holding INFINIT_GROUP_KEY_CACHE_SIZE groups.
+        GroupKeyCache();
+        /// Construct a cache holding @a capacity groups, zero to disable.
+        GroupKeyCache(int capacity);
+        GroupKeyCache(GroupKeyCache const&) = delete;
+        ~GroupKeyCache();
+
+      /*--------.
+      | Content |
+      `--------*/
+      public:
+        /// The keys of @a group, if they include group version @a version.
+        ///
+        /// @arg private_keys  Whether the key pairs are required.
+        Keys const*
+        get(PublicKey const& group, int version, bool private_keys);
+        /// Record the keys of @a block, the group block of @a group.
+        ///
+        /// @arg private_keys  Whether to unwrap the key pairs.
+        Keys const&
+        update(PublicKey const& group, GB const& block, bool private_keys);
+        /// Forget the keys of @a group, when its keys are known to have
+        /// changed.
+        void
+        invalidate(PublicKey const& group);
+        void
+        clear();
+        /// Change the number of groups held, evicting as needed.
+        void
+        capacity(int capacity);
+        std::size_t
+        size() const;
+        ELLE_ATTRIBUTE_R(int, capacity);
+        /// Emitted with each key pair dropped from the cache, before it is
+        /// released.
+        ELLE_ATTRIBUTE_RX(
+          boost::signals2::signal<void (KeyPair const&)>, on_wipe);
+      private:
+        struct Entry
+        {
+          PublicKey group;
+          Keys keys;
+        };
+        using Entries = std::list<Entry>;
+        void
+        _shrink();
+        void
+        _erase(Entries::iterator it);
+        /// Release the key pairs of @a keys.
+        void
+        _wipe(Keys& keys);
+        /// Most recently used first.
+        ELLE_ATTRIBUTE(Entries, entries);
+        ELLE_ATTRIBUTE((std::unordered_map<PublicKey, Entries::iterator>),
+                       index);
+        /// Keys of the last update when the cache is disabled.
+        ELLE_ATTRIBUTE(Keys, uncached);
+
+      /*-----------.
+      | Monitoring |
+      `-----------*/
+      public:
+        elle::json::Object
+        stats() const;
+        ELLE_ATTRIBUTE_R(int64_t, hits);
+        ELLE_ATTRIBUTE_R(int64_t, misses);
+        ELLE_ATTRIBUTE_R(int64_t, invalidations);
+      };
+    }
+  }
+}
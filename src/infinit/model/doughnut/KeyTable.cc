@@ -0,0 +1,177 @@
+#include <infinit/model/doughnut/KeyTable.hh>
+
+#include <elle/log.hh>
+
+#include <elle/cryptography/hash.hh>
+
+#include <infinit/model/doughnut/sha256.hh>
+
+ELLE_LOG_COMPONENT("infinit.model.doughnut.KeyTable");
+
+namespace infinit
+{
+  namespace model
+  {
+    namespace doughnut
+    {
+      namespace
+      {
+        auto constexpr minimum_purge_threshold = 1024u;
+      }
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+
+      KeyTable::KeyTable()
+        : _purge_threshold(minimum_purge_threshold)
+        , _hits(0)
+        , _misses(0)
+      {}
+
+      KeyTable&
+      KeyTable::instance()
+      {
+        static KeyTable res;
+        return res;
+      }
+
+      /*----------.
+      | Interning |
+      `----------*/
+
+      Address
+      KeyTable::hash(PublicKey const& key)
+      {
+        return Address(
+          elle::cryptography::hash(
+            elle::cryptography::rsa::publickey::der::encode(key),
+            elle::cryptography::Oneway::sha256).contents());
+      }
+
+      std::shared_ptr<KeyTable::PublicKey>
+      KeyTable::intern(PublicKey const& key)
+      {
+        return this->_intern(
+          hash(key), [&] { return std::make_shared<PublicKey>(key); });
+      }
+
+      std::shared_ptr<KeyTable::PublicKey>
+      KeyTable::intern(std::shared_ptr<PublicKey> key)
+      {
+        return this->_intern(hash(*key), [&] { return std::move(key); });
+      }
+
+      std::shared_ptr<KeyTable::PublicKey>
+      KeyTable::intern_der(elle::ConstWeakBuffer der)
+      {
+        auto const hash = sha256::digest(sha256::Message{der});
+        return this->_intern(
+          Address(hash.contents()),
+          [&]
+          {
+            return std::make_shared<PublicKey>(
+              elle::cryptography::rsa::publickey::der::decode(der));
+          });
+      }
+
+      std::shared_ptr<KeyTable::PublicKey>
+      KeyTable::_intern(Address const& hash,
+                        std::function<std::shared_ptr<PublicKey> ()> const& make)
+      {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        auto it = this->_keys.find(hash);
+        if (it != this->_keys.end())
+        {
+          ++this->_hits;
+          return it->second;
+        }
+        ++this->_misses;
+        // Only insert once the key is built, so keys failing to parse leave
+        // no entry behind.
+        auto res = make();
+        ELLE_DUMP("intern %s as %f", *res, hash);
+        this->_keys.emplace(hash, res);
+        if (this->_keys.size() > this->_purge_threshold)
+          this->_purge();
+        return res;
+      }
+
+      std::shared_ptr<KeyTable::PublicKey>
+      KeyTable::find(Address const& hash) const
+      {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        auto it = this->_keys.find(hash);
+        if (it == this->_keys.end())
+          return nullptr;
+        return it->second;
+      }
+
+      void
+      KeyTable::_purge()
+      {
+        for (auto it = this->_keys.begin(); it != this->_keys.end();)
+          if (it->second.use_count() == 1)
+            it = this->_keys.erase(it);
+          else
+            ++it;
+        // Purge again once the used keys doubled, so interning stays
+        // amortized constant.
+        this->_purge_threshold =
+          std::max<std::size_t>(2 * this->_keys.size(),
+                                minimum_purge_threshold);
+        ELLE_DEBUG("purged unused keys, %s left", this->_keys.size());
+      }
+
+      std::size_t
+      KeyTable::size() const
+      {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        return this->_keys.size();
+      }
+
+      /*--------------.
+      | Serialization |
+      `--------------*/
+
+      KeyTable::Serialized::Serialized(std::shared_ptr<PublicKey> key)
+        : key(std::move(key))
+      {}
+
+      void
+      KeyTable::Serialized::serialize(elle::serialization::Serializer& s)
+      {
+        // Same layout as PublicKey::serialize.
+        if (s.in())
+        {
+          auto der = elle::Buffer();
+          s.serialize("rsa", der);
+          this->key = KeyTable::instance().intern_der(der);
+        }
+        else
+        {
+          auto der =
+            elle::cryptography::rsa::publickey::der::encode(*this->key);
+          s.serialize("rsa", der);
+        }
+      }
+
+      /*-----------.
+      | Monitoring |
+      `-----------*/
+
+      elle::json::Object
+      KeyTable::stats() const
+      {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        auto const lookups = this->_hits + this->_misses;
+        return elle::json::Object{
+          {"size", this->_keys.size()},
+          {"hits", this->_hits},
+          {"misses", this->_misses},
+          {"hit_rate", lookups ? double(this->_hits) / lookups : 0.},
+        };
+      }
+    }
+  }
+}
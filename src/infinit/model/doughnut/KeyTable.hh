@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <elle/Buffer.hh>
+#include <elle/attribute.hh>
+#include <elle/cryptography/rsa/PublicKey.hh>
+#include <elle/json/json.hh>
+#include <elle/serialization/Serializer.hh>
+
+#include <infinit/model/Address.hh>
+
+namespace infinit
+{
+  namespace model
+  {
+    namespace doughnut
+    {
+      /// Process-wide table of interned public keys.
+      ///
+      /// Owner keys, ACL entries, user blocks and passports refer to the same
+      /// few keys over and over. Interned keys are held once per process,
+      /// whatever the number of blocks, Doughnuts and connections referring
+      /// to them, and are identified by a stable hash: the SHA-256 of their
+      /// DER encoding, as computed by UB::hash. Copies of an interned key
+      /// share its parsed OpenSSL key. Keys only referenced by the table are
+      /// dropped as it grows.
+      class KeyTable
+      {
+      /*------.
+      | Types |
+      `------*/
+      public:
+        using Self = KeyTable;
+        using PublicKey = elle::cryptography::rsa::PublicKey;
+        /// A public key serialized the way PublicKey is, interned when
+        /// deserialized without parsing keys already known.
+        struct Serialized
+        {
+          Serialized() = default;
+          Serialized(std::shared_ptr<PublicKey> key);
+          void
+          serialize(elle::serialization::Serializer& s);
+          std::shared_ptr<PublicKey> key;
+        };
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+      public:
+        KeyTable();
+        KeyTable(KeyTable const&) = delete;
+        /// The table of this process.
+        static
+        KeyTable&
+        instance();
+
+      /*----------.
+      | Interning |
+      `----------*/
+      public:
+        /// The stable hash of @a key.
+        static
+        Address
+        hash(PublicKey const& key);
+        /// The shared instance of @a key.
+        std::shared_ptr<PublicKey>
+        intern(PublicKey const& key);
+        /// The shared instance of @a key, which becomes it if unknown.
+        std::shared_ptr<PublicKey>
+        intern(std::shared_ptr<PublicKey> key);
+        /// The shared key DER encoded as @a der, only parsed if unknown.
+        std::shared_ptr<PublicKey>
+        intern_der(elle::ConstWeakBuffer der);
+        /// The key with stable hash @a hash, if interned.
+        std::shared_ptr<PublicKey>
+        find(Address const& hash) const;
+        std::size_t
+        size() const;
+      private:
+        std::shared_ptr<PublicKey>
+        _intern(Address const& hash,
+                std::function<std::shared_ptr<PublicKey> ()> const& make);
+        /// Drop keys only referenced by the table.
+        void
+        _purge();
+        ELLE_ATTRIBUTE((std::unordered_map<Address, std::shared_ptr<PublicKey>>),
+                       keys);
+        /// Size past which unused keys are purged.
+        ELLE_ATTRIBUTE(std::size_t, purge_threshold);
+        ELLE_ATTRIBUTE(std::mutex, mutex, mutable);
+
+      /*-----------.
+      | Monitoring |
+      `-----------*/
+      public:
+        elle::json::Object
+        stats() const;
+        ELLE_ATTRIBUTE_R(int64_t, hits);
+        ELLE_ATTRIBUTE_R(int64_t, misses);
+      };
+    }
+  }
+}
@@ -1,5 +1,7 @@
 #include <infinit/model/doughnut/Local.hh>
 
+#include <cstring>
+
 #include <elle/log.hh>
 #include <elle/make-vector.hh>
 #include <elle/network/Interface.hh>
@@ -19,10 +21,12 @@
 #include <infinit/model/Model.hh>
 #include <infinit/model/blocks/MutableBlock.hh>
 #include <infinit/model/doughnut/ACB.hh>
+#include <infinit/model/doughnut/BlockCodec.hh>
 #include <infinit/model/doughnut/Doughnut.hh>
 #include <infinit/model/doughnut/OKB.hh>
 #include <infinit/model/doughnut/Remote.hh>
 #include <infinit/model/doughnut/ValidationFailed.hh>
+#include <infinit/model/doughnut/sha256.hh>
 #include <infinit/model/doughnut/HandshakeFailed.hh>
 #include <infinit/silo/MissingKey.hh>
 
@@ -34,6 +38,14 @@ namespace
 {
   auto const ipv4_enabled = !elle::os::getenv("INFINIT_NO_IPV4", false);
   auto const ipv6_enabled = !elle::os::getenv("INFINIT_NO_IPV6", false);
+  auto const trusted_storage = elle::os::getenv("INFINIT_TRUSTED_STORAGE", false);
+
+  /// Starts the validation header prepended to stored blocks. Generic
+  /// serializations start with their major version, zero, and compact
+  /// blocks with 0xff, so no stored content can be mistaken for a header.
+  uint8_t constexpr header_magic = 0xfe;
+  /// Size of the validation header: the magic, then SHA-256 of the data.
+  auto constexpr header_size = 1 + 32;
 }
 
 namespace infinit
@@ -62,6 +74,7 @@ namespace infinit
                    boost::optional<boost::asio::ip::address> listen_address)
         : Super(dht, std::move(id))
         , _storage(std::move(storage))
+        , _trusted_storage(trusted_storage)
       {
         auto p = dht.protocol();
         std::unique_ptr<elle::reactor::network::TCPServer> old_server;
@@ -187,11 +200,8 @@ namespace infinit
             throw ValidationFailed(res.reason());
         try
         {
-          auto previous_buffer = this->_storage->get(block.address());
-          elle::IOStream s(previous_buffer.istreambuf());
-          typename elle::serialization::binary::SerializerIn input(s);
-          input.set_context<Doughnut*>(&this->_doughnut);
-          auto previous = input.deserialize<std::unique_ptr<blocks::Block>>();
+          auto previous = codec::deserialize(
+            this->_load_data(block.address()), this->_doughnut);
           if (auto* mblock = dynamic_cast<blocks::MutableBlock const*>(&block))
           {
             auto mprevious =
@@ -213,18 +223,11 @@ namespace infinit
         }
         catch (silo::MissingKey const&)
         {}
-        elle::Buffer data = [&block]
-          {
-            elle::Buffer res;
-            elle::IOStream s(res.ostreambuf());
-            Serializer::SerializerOut output(s);
-            auto ptr = &block;
-            output.serialize_forward(ptr);
-            return res;
-          }();
+        auto data = codec::serialize(block, this->_doughnut);
         try
         {
-          this->_storage->set(block.address(), data,
+          this->_storage->set(block.address(),
+                              this->_store_data(std::move(data)),
                               mode == STORE_INSERT,
                               mode == STORE_UPDATE);
         }
@@ -240,19 +243,19 @@ namespace infinit
       {
         ELLE_TRACE_SCOPE("%s: fetch %f", this, address);
         elle::Buffer data;
+        bool trusted = false;
         try
         {
-          data = this->_storage->get(address);
+          data = this->_load_data(address, &trusted);
         }
         catch (silo::MissingKey const& e)
         {
           throw MissingBlock(e.key());
         }
         ELLE_DUMP("data: %s", data.string());
-        elle::serialization::Context ctx;
-        ctx.set<Doughnut*>(&this->_doughnut);
-        auto res = elle::serialization::binary::deserialize<
-          std::unique_ptr<blocks::Block>>(data, true, ctx);
+        auto res = codec::deserialize(data, this->_doughnut);
+        if (trusted)
+          res->validated(true);
         this->_on_fetch(address, res);
         return res;
       }
@@ -265,11 +268,8 @@ namespace infinit
         {
           if (this->_doughnut.version() >= elle::Version(0, 4, 0))
           {
-            auto previous_buffer = this->_storage->get(address);
-            elle::IOStream s(previous_buffer.istreambuf());
-            typename elle::serialization::binary::SerializerIn input(s);
-            input.set_context<Doughnut*>(&this->_doughnut);
-            auto previous = input.deserialize<std::unique_ptr<blocks::Block>>();
+            auto previous =
+              codec::deserialize(this->_load_data(address), this->_doughnut);
             auto val = previous->validate_remove(this->doughnut(), rs);
             if (!val)
               if (val.conflict())
@@ -286,6 +286,45 @@ namespace infinit
         this->_on_remove(address);
       }
 
+      elle::Buffer
+      Local::_load_data(Address address, bool* trusted) const
+      {
+        auto data = this->_storage->get(address);
+        if (trusted)
+          *trusted = false;
+        if (data.size() == 0 || data.contents()[0] != header_magic)
+          return data;
+        if (signed(data.size()) < header_size)
+          elle::err("truncated validation header for %f", address);
+        auto payload =
+          elle::Buffer(data.contents() + header_size,
+                       data.size() - header_size);
+        if (trusted && this->_trusted_storage)
+        {
+          auto const digest = sha256::digest(sha256::Message{payload});
+          if (elle::ConstWeakBuffer(data.contents() + 1, 32) == digest)
+            *trusted = true;
+          else
+            ELLE_WARN("%s: validation header mismatch for %f, validate it",
+                      this, address);
+        }
+        return payload;
+      }
+
+      elle::Buffer
+      Local::_store_data(elle::Buffer data) const
+      {
+        if (!this->_trusted_storage)
+          return data;
+        auto const digest = sha256::digest(sha256::Message{data});
+        auto res = elle::Buffer(header_size + data.size());
+        res.mutable_contents()[0] = header_magic;
+        std::memcpy(res.mutable_contents() + 1, digest.contents(), 32);
+        std::memcpy(res.mutable_contents() + header_size,
+                    data.contents(), data.size());
+        return res;
+      }
+
       /*-----.
       | Keys |
       `-----*/
@@ -506,6 +545,14 @@ namespace infinit
         rpcs.add(
           "resolve_all_keys",
           [this]() { return this->_resolve_all_keys(); });
+        if (this->doughnut().version() >= elle::Version(0, 9, 0))
+          rpcs.add(
+            "bulk",
+            [&connection] ()
+            {
+              ELLE_TRACE("%s: bulk connection", connection);
+              connection._bulk = true;
+            });
         if (!this->doughnut().encrypt_options().encrypt_rpc)
           connection.ready()();
       }
@@ -602,6 +649,7 @@ namespace infinit
                       false)
         , _channels{this->_serializer}
         , _rpcs(this->_local.doughnut().version())
+        , _bulk(false)
       {
         this->_local._register_rpcs(*this);
         this->_local._on_connect(this->_rpcs);
@@ -65,6 +65,20 @@ namespace infinit
         std::unique_ptr<blocks::Block>
         _fetch(Address address,
                boost::optional<int> local_version) const override;
+        /// Read @a address from storage, without its validation header.
+        ///
+        /// @arg trusted  If not null, set to whether storage is trusted and
+        ///               the content bears a matching validation header.
+        elle::Buffer
+        _load_data(Address address, bool* trusted = nullptr) const;
+        /// @a data as to be stored, behind a validation header if storage
+        /// is trusted.
+        elle::Buffer
+        _store_data(elle::Buffer data) const;
+      public:
+        /// Whether blocks validated before being written can be read back
+        /// without validating them again, see INFINIT_TRUSTED_STORAGE.
+        ELLE_ATTRIBUTE_RW(bool, trusted_storage);
 
       /*-----.
       | Keys |
@@ -124,6 +138,8 @@ namespace infinit
           ELLE_ATTRIBUTE_R(elle::protocol::ChanneledStream, channels);
           ELLE_ATTRIBUTE_RX(RPCServer, rpcs);
           ELLE_ATTRIBUTE_R(Address, id);
+          /// Whether the peer uses this connection for bulk transfers only.
+          ELLE_ATTRIBUTE_R(bool, bulk);
           ELLE_ATTRIBUTE_RX(boost::signals2::signal<void()>, ready);
         };
         ELLE_ATTRIBUTE(std::unique_ptr<elle::reactor::network::TCPServer>, server);
@@ -17,6 +17,9 @@ namespace infinit
         // Copy peers to hold connections refcount, as for_each_parallel
         // captures values by ref.
         auto peers = this->_peers;
+        // Peers listen for broadcasts on their control connection only.
+        peers.remove_if(
+          [] (std::shared_ptr<Connection> const& c) { return c->bulk(); });
         auto clear = [&]
           {
             // Delay termination from destructor.
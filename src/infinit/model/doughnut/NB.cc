@@ -43,6 +43,19 @@ namespace infinit
              std::move(signature))
       {}
 
+      NB::NB(Doughnut& doughnut,
+             Address address,
+             std::shared_ptr<elle::cryptography::rsa::PublicKey> owner,
+             std::string name,
+             elle::Buffer data,
+             elle::Buffer signature)
+        : Super(address, std::move(data))
+        , _doughnut(doughnut)
+        , _owner(std::move(owner))
+        , _name(std::move(name))
+        , _signature(std::move(signature))
+      {}
+
       NB::NB(NB const& other)
         : Super(other)
         , _doughnut(other._doughnut)
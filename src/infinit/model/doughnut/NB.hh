@@ -38,6 +38,13 @@ namespace infinit
            std::string name,
            elle::Buffer data,
            elle::Buffer signature = {});
+        /// Restore a stored block, trusting @a address.
+        NB(Doughnut& doughnut,
+           Address address,
+           std::shared_ptr<elle::cryptography::rsa::PublicKey> owner,
+           std::string name,
+           elle::Buffer data,
+           elle::Buffer signature);
         NB(NB const& other);
         ELLE_ATTRIBUTE_R(Doughnut&, doughnut);
         ELLE_ATTRIBUTE_R(std::shared_ptr<elle::cryptography::rsa::PublicKey>,
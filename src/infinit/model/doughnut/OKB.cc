@@ -17,6 +17,7 @@
 #include <infinit/model/blocks/MutableBlock.hh>
 #include <infinit/model/blocks/GroupBlock.hh>
 #include <infinit/model/doughnut/Doughnut.hh>
+#include <infinit/model/doughnut/KeyTable.hh>
 #include <infinit/model/doughnut/Local.hh>
 #include <infinit/model/doughnut/Remote.hh>
 #include <infinit/model/doughnut/UB.hh>
@@ -33,6 +34,8 @@ namespace infinit
       /// using key hashes instead of ids.
       using KeyOrHash
         = elle::Option<elle::cryptography::rsa::PublicKey, elle::Buffer, int>;
+      /// KeyOrHash as deserialized, with interned keys.
+      using KeyOrHashIn = elle::Option<KeyTable::Serialized, elle::Buffer, int>;
 
       elle::cryptography::rsa::PublicKey
       deserialize_key_hash(elle::serialization::SerializerIn& s,
@@ -41,21 +44,24 @@ namespace infinit
                            Doughnut* dn)
       {
         if (v < elle::Version(0, 7, 0))
-          return s.deserialize<elle::cryptography::rsa::PublicKey>(field_name);
-        auto koh = s.deserialize<KeyOrHash>(field_name + "_koh");
+          return *s.deserialize<KeyTable::Serialized>(field_name).key;
+        auto koh = s.deserialize<KeyOrHashIn>(field_name + "_koh");
         if (koh.is<elle::Buffer>())
         {
           if (!dn)
             elle::unconst(s.context()).get<Doughnut*>(dn, nullptr);
           ELLE_ASSERT(dn);
           auto buf = koh.get<elle::Buffer>();
+          if (buf.size() == sizeof(Address::Value))
+            if (auto key = KeyTable::instance().find(Address(buf.contents())))
+              return *key;
           ELLE_WARN("Key hash spotted in block: %x, resolving...", buf);
           auto const addr = UB::hash_address(':' + buf.string(), *dn);
           try
           {
             auto block = dn->fetch(addr);
             auto ub = elle::cast<UB>::runtime(block);
-            return ub->key();
+            return *KeyTable::instance().intern(ub->key());
           }
           catch (elle::Error const& e)
           {
@@ -76,7 +82,7 @@ namespace infinit
         }
         else
         {
-          return std::move(koh.get<elle::cryptography::rsa::PublicKey>());
+          return *koh.get<KeyTable::Serialized>().key;
         }
       }
 
@@ -226,7 +232,8 @@ namespace infinit
       OKBHeader::OKBHeader(elle::serialization::SerializerIn& s,
                            elle::Version const& v)
         : _salt()
-        , _owner_key(std::make_shared(deserialize_key_hash(s, v, "key")))
+        , _owner_key(
+          KeyTable::instance().intern(deserialize_key_hash(s, v, "key")))
         , _signature()
       {
         s.serialize_context<Doughnut*>(this->_doughnut);
@@ -418,8 +425,13 @@ namespace infinit
         {
           ELLE_DEBUG_SCOPE("%s: data changed, seal", *this);
           ELLE_DUMP("%s: data: %s", *this, this->_data_plain);
-          auto encrypted =
-            this->doughnut()->keys().K().seal(this->_data_plain);
+          // Encrypt in the background so blocks sealed concurrently
+          // overlap.
+          auto encrypted = elle::reactor::BackgroundFuture<elle::Buffer>(
+            [key = this->doughnut()->keys().K(), plain = this->_data_plain]
+            {
+              return key.seal(plain);
+            }).value();
           ELLE_DUMP("%s: encrypted data: %s", *this, encrypted);
           this->Block::data(std::move(encrypted));
           this->_seal_okb(version);
@@ -473,7 +485,9 @@ namespace infinit
         {
           ELLE_ASSERT(this->signature() != elle::Buffer());
           auto sign = this->_sign();
-          if (!this->_owner_key->verify(this->signature(), *sign))
+          if (!this->doughnut()->signature_cache().verify(
+                *this->_owner_key, this->signature(), *sign,
+                this->doughnut()->version()))
           {
             ELLE_TRACE("invalid signature for version %s: %x",
               this->_version, this->signature());
@@ -497,7 +511,7 @@ namespace infinit
       {
         ELLE_DUMP("%s: check %f signs %s with %s",
                   *this, signature, data, key);
-        if (!key.verify(signature, data))
+        if (!this->doughnut()->signature_cache().verify(key, signature, data))
         {
           ELLE_TRACE("%s: %s signature is invalid", *this, name);
           return false;
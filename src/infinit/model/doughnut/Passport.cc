@@ -3,6 +3,7 @@
 
 #include <infinit/model/doughnut/Passport.hh>
 #include <infinit/model/doughnut/Doughnut.hh>
+#include <infinit/model/doughnut/KeyTable.hh>
 
 ELLE_LOG_COMPONENT("infinit.model.doughnut.Passport");
 
@@ -42,7 +43,7 @@ namespace infinit
       }
 
       Passport::Passport(elle::serialization::SerializerIn& s)
-        : _user(s.deserialize<elle::cryptography::rsa::PublicKey>("user"))
+        : _user(*s.deserialize<KeyTable::Serialized>("user").key)
         , _network(s.deserialize<std::string>("network"))
         , _signature(s.deserialize<elle::Buffer>("signature"))
         , _allow_write(true)
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <elle/log.hh>
 
 #include <infinit/model/doughnut/Peer.hh>
@@ -73,6 +75,40 @@ namespace infinit
         return this->_resolve_all_keys();
       }
 
+      /*-----------.
+      | Statistics |
+      `-----------*/
+
+      std::chrono::microseconds
+      Peer::expected_latency() const
+      {
+        return std::chrono::microseconds(0);
+      }
+
+      boost::optional<std::chrono::microseconds>
+      Peer::slow_latency() const
+      {
+        return boost::none;
+      }
+
+      void
+      sort_by_latency(std::vector<std::shared_ptr<Peer>>& peers)
+      {
+        // Latencies change as requests are sent, snapshot them.
+        auto latencies = std::vector<
+          std::pair<std::chrono::microseconds, std::shared_ptr<Peer>>>{};
+        latencies.reserve(peers.size());
+        for (auto& p: peers)
+          latencies.emplace_back(p->expected_latency(), std::move(p));
+        std::stable_sort(
+          latencies.begin(), latencies.end(),
+          [] (auto const& lhs, auto const& rhs)
+          {
+            return lhs.first < rhs.first;
+          });
+        for (int i = 0; i < signed(peers.size()); ++i)
+          peers[i] = std::move(latencies[i].second);
+      }
 
       /*----------.
       | Printable |
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
+#include <vector>
 
 #include <boost/signals2.hpp>
 
@@ -78,6 +80,21 @@ namespace infinit
         std::unordered_map<int, elle::cryptography::rsa::PublicKey>
         _resolve_all_keys() = 0;
 
+      /*-----------.
+      | Statistics |
+      `-----------*/
+      public:
+        /// Expected delay for this peer to answer a new request, accounting
+        /// for the requests it is already processing. Zero for local peers.
+        virtual
+        std::chrono::microseconds
+        expected_latency() const;
+        /// Delay past which a request to this peer is slower than usual, if
+        /// known.
+        virtual
+        boost::optional<std::chrono::microseconds>
+        slow_latency() const;
+
       /*----------.
       | Printable |
       `----------*/
@@ -86,6 +103,10 @@ namespace infinit
         void
         print(std::ostream& stream) const override;
       };
+
+      /// Sort @a peers by expected latency, closest first.
+      void
+      sort_by_latency(std::vector<std::shared_ptr<Peer>>& peers);
     }
   }
 }
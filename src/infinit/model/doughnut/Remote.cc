@@ -1,5 +1,7 @@
 #include <infinit/model/doughnut/Remote.hh>
 
+#include <algorithm>
+
 #include <elle/algorithm.hh>
 #include <elle/bench.hh>
 #include <elle/find.hh>
@@ -14,9 +16,36 @@
 #include <elle/reactor/Thread.hh>
 
 #include <infinit/RPC.hh>
+#include <infinit/model/doughnut/KeyTable.hh>
 
 ELLE_LOG_COMPONENT("infinit.model.doughnut.Remote")
 
+namespace
+{
+  /// Number of recent round trip times kept to estimate percentiles.
+  auto const rtt_samples_size = 64;
+  /// Percentile of round trip times past which a request is deemed slow.
+  auto const slow_percentile =
+    elle::os::getenv("INFINIT_RPC_SLOW_PERCENTILE", 95);
+  /// Whether to move bulk transfers to a second connection.
+  auto const bulk_connection = elle::os::getenv("INFINIT_RPC_BULK", true);
+  /// Whether to establish the bulk connection along the control one, rather
+  /// than upon the first bulk transfer.
+  auto const bulk_standby = elle::os::getenv("INFINIT_RPC_BULK_STANDBY", true);
+}
+
+namespace
+{
+  /// Immutable blocks hold file data, mutable ones are small and go through
+  /// Paxos.
+  infinit::model::doughnut::Dock::Traffic
+  traffic(infinit::model::Address const& address)
+  {
+    using Traffic = infinit::model::doughnut::Dock::Traffic;
+    return address.mutable_block() ? Traffic::control : Traffic::bulk;
+  }
+}
+
 #define BENCH(name)                                                     \
   static auto bench = elle::Bench{"bench.remote." name, std::chrono::seconds(10000)};     \
   elle::Bench::BenchScope bs(bench)
@@ -47,6 +76,10 @@ namespace infinit
                      std::shared_ptr<Dock::Connection> connection)
         : Super(dht, connection->location().id())
         , _connecting_since(std::chrono::system_clock::now())
+        , _rtt(0)
+        , _in_flight(0)
+        , _rtt_count(0)
+        , _rtt_samples_next(0)
       {
         ELLE_TRACE_SCOPE("%s: construct", this);
         ELLE_ASSERT(connection->location().id());
@@ -57,6 +90,8 @@ namespace infinit
             if (opened)
             {
               this->_disconnected_exception = {};
+              if (bulk_standby)
+                this->_connect_bulk();
               if (!this->_connected.exception())
                 this->Peer::connected()();
             }
@@ -132,6 +167,8 @@ namespace infinit
       Remote::_cleanup()
       {
         this->_connection->disconnect();
+        if (this->_bulk_connection)
+          this->_bulk_connection->disconnect();
       }
 
       Endpoints const&
@@ -192,6 +229,51 @@ namespace infinit
       Remote::disconnect()
       {
         this->_connection->disconnect();
+        if (this->_bulk_connection)
+          this->_bulk_connection->disconnect();
+      }
+
+      void
+      Remote::_connect_bulk()
+      {
+        if (!bulk_connection ||
+            this->_doughnut.version() < elle::Version(0, 9, 0))
+          return;
+        if (this->_bulk_connection && !this->_bulk_connection->disconnected())
+          return;
+        ELLE_TRACE("%s: open bulk connection", this);
+        this->_bulk_connection =
+          this->_doughnut.dock().connect_bulk(this->_connection->location());
+      }
+
+      std::shared_ptr<Dock::Connection>
+      Remote::_connection_for(Dock::Traffic traffic)
+      {
+        auto& metrics = this->_doughnut.dock().metrics(traffic);
+        ++metrics.rpcs;
+        if (traffic == Dock::Traffic::bulk)
+        {
+          auto const& bulk = this->_bulk_connection;
+          if (bulk && bulk->connected() && !bulk->disconnected())
+            return bulk;
+          // Do not wait for it, the control connection is up.
+          ++metrics.fallbacks;
+          this->_connect_bulk();
+        }
+        return this->_connection;
+      }
+
+      void
+      Remote::_bulk_failed(std::shared_ptr<Dock::Connection> const& bulk,
+                           std::exception_ptr e)
+      {
+        ELLE_TRACE("%s: bulk connection failed, retry on control: %s",
+                   this, elle::exception_string(e));
+        ++this->_doughnut.dock().metrics(Dock::Traffic::bulk).failures;
+        bulk->disconnect();
+        // Unless a new one was opened meanwhile.
+        if (this->_bulk_connection == bulk)
+          this->_bulk_connection.reset();
       }
 
       /*-------.
@@ -205,7 +287,7 @@ namespace infinit
         ELLE_ASSERT(&block);
         ELLE_TRACE_SCOPE("%s: store %f", *this, block);
         using Store = auto (blocks::Block const&, StoreMode) -> void;
-        auto store = this->make_rpc<Store>("store");
+        auto store = this->make_rpc<Store>("store", traffic(block.address()));
         store.set_context<Doughnut*>(&this->_doughnut);
         store(block, mode);
       }
@@ -217,7 +299,8 @@ namespace infinit
         BENCH("fetch");
         using Fetch = auto (Address, boost::optional<int>)
           -> std::unique_ptr<blocks::Block>;
-        auto fetch = elle::unconst(this)->make_rpc<Fetch>("fetch");
+        auto fetch = elle::unconst(this)->make_rpc<Fetch>(
+          "fetch", traffic(address));
         fetch.set_context<Doughnut*>(&this->_doughnut);
         return fetch(std::move(address), std::move(local_version));
       }
@@ -264,9 +347,10 @@ namespace infinit
           {
             bench.add(0);
             ELLE_TRACE("%s: fetch %s keys by ids", this, missing.size());
+            // Read the keys as interned DER, to skip parsing known ones.
             using ResolveKeys =
               auto (std::vector<int> const&)
-              -> std::vector<elle::cryptography::rsa::PublicKey>;
+              -> std::vector<KeyTable::Serialized>;
             auto rpc = this->make_rpc<ResolveKeys>("resolve_keys");
             auto missing_keys = rpc(missing);
             if (missing_keys.size() != missing.size())
@@ -275,7 +359,7 @@ namespace infinit
             auto id_it = missing.begin();
             auto key_it = missing_keys.begin();
             for (; id_it != missing.end(); ++id_it, ++key_it)
-              this->key_hash_cache().emplace(*id_it, std::move(*key_it));
+              this->key_hash_cache().emplace(*id_it, key_it->key);
           }
         }
         return elle::make_vector(ids, [this] (auto id) {
@@ -289,12 +373,17 @@ namespace infinit
       Remote::_resolve_all_keys()
       {
         using ResolveAllKeys =
-          auto () -> std::unordered_map<int, elle::cryptography::rsa::PublicKey>;
-        auto res = this->make_rpc<ResolveAllKeys>("resolve_all_keys")();
+          auto () -> std::unordered_map<int, KeyTable::Serialized>;
+        auto keys = this->make_rpc<ResolveAllKeys>("resolve_all_keys")();
+        auto res =
+          std::unordered_map<int, elle::cryptography::rsa::PublicKey>{};
         auto& kcache = this->key_hash_cache();
-        for (auto const& key: res)
+        for (auto const& key: keys)
+        {
           if (!elle::find(kcache.get<1>(), key.first))
-            kcache.emplace(key.first, key.second);
+            kcache.emplace(key.first, key.second.key);
+          res.emplace(key.first, *key.second.key);
+        }
         return res;
       }
 
@@ -309,6 +398,64 @@ namespace infinit
       {
         return ELLE_ENFORCE(this->_connection)->key_hash_cache();
       }
+
+      /*-----------.
+      | Statistics |
+      `-----------*/
+
+      std::chrono::microseconds
+      Remote::expected_latency() const
+      {
+        // Unmeasured peers are deemed fast, so they get a chance to be
+        // measured.
+        return std::max(this->_rtt, std::chrono::microseconds(1)) *
+          (1 + this->_in_flight);
+      }
+
+      boost::optional<std::chrono::microseconds>
+      Remote::slow_latency() const
+      {
+        if (signed(this->_rtt_samples.size()) < rtt_samples_size / 4)
+          return boost::none;
+        auto samples = this->_rtt_samples;
+        auto const nth =
+          samples.begin() + (samples.size() - 1) * slow_percentile / 100;
+        std::nth_element(samples.begin(), nth, samples.end());
+        return *nth;
+      }
+
+      Remote::InFlight::InFlight(Remote& remote)
+        : _remote(remote)
+        , _start(std::chrono::steady_clock::now())
+      {
+        ++this->_remote._in_flight;
+      }
+
+      Remote::InFlight::~InFlight()
+      {
+        --this->_remote._in_flight;
+      }
+
+      void
+      Remote::InFlight::_measure()
+      {
+        auto const rtt = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - this->_start);
+        auto& r = this->_remote;
+        // Same smoothing as TCP.
+        if (r._rtt.count() == 0)
+          r._rtt = rtt;
+        else
+          r._rtt = (7 * r._rtt + rtt) / 8;
+        if (signed(r._rtt_samples.size()) < rtt_samples_size)
+          r._rtt_samples.emplace_back(rtt);
+        else
+        {
+          r._rtt_samples[r._rtt_samples_next] = rtt;
+          r._rtt_samples_next = (r._rtt_samples_next + 1) % rtt_samples_size;
+        }
+        ++r._rtt_count;
+      }
     }
   }
 }
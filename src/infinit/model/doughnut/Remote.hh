@@ -71,6 +71,8 @@ namespace infinit
         void
         connection(std::shared_ptr<Dock::Connection> connection);
         ELLE_ATTRIBUTE_R(std::shared_ptr<Dock::Connection>, connection);
+        /// Connection for bulk transfers, if any.
+        ELLE_ATTRIBUTE_R(std::shared_ptr<Dock::Connection>, bulk_connection);
         ELLE_attribute_r(Endpoints, endpoints);
         ELLE_attribute_r(elle::Buffer, credentials);
         ELLE_ATTRIBUTE(Dock::PeerCache::iterator, cache_iterator);
@@ -87,6 +89,17 @@ namespace infinit
         void
         disconnect();
       private:
+        /// Start the bulk connection unless it is up or connecting.
+        void
+        _connect_bulk();
+        /// The connection to run an RPC of class @a traffic on.
+        std::shared_ptr<Dock::Connection>
+        _connection_for(Dock::Traffic traffic);
+        /// Drop the bulk connection @a bulk after a failed transfer, leaving
+        /// the control connection untouched.
+        void
+        _bulk_failed(std::shared_ptr<Dock::Connection> const& bulk,
+                     std::exception_ptr e);
         ELLE_ATTRIBUTE(elle::reactor::Barrier, connected);
         ELLE_ATTRIBUTE(
           std::chrono::system_clock::time_point, connecting_since);
@@ -99,9 +112,12 @@ namespace infinit
       `-----------*/
       public:
         /// Build a remote procedure named `name`, with `F` as signature.
+        ///
+        /// Bulk RPCs run on a separate connection when possible.
         template <typename F>
         RemoteRPC<F>
-        make_rpc(std::string const& name);
+        make_rpc(std::string const& name,
+                 Dock::Traffic traffic = Dock::Traffic::control);
         template <typename Op>
         auto
         safe_perform(std::string const& name, Op op)
@@ -131,6 +147,49 @@ namespace infinit
         std::unordered_map<int, elle::cryptography::rsa::PublicKey>
         _resolve_all_keys() override;
         ELLE_attribute_rx(KeyCache, key_hash_cache);
+
+      /*-----------.
+      | Statistics |
+      `-----------*/
+      public:
+        std::chrono::microseconds
+        expected_latency() const override;
+        /// The configured percentile of recent round trip times.
+        boost::optional<std::chrono::microseconds>
+        slow_latency() const override;
+        /// Smoothed round trip time of RPCs, zero until one succeeded.
+        ELLE_ATTRIBUTE_R(std::chrono::microseconds, rtt);
+        /// Number of RPCs currently running.
+        ELLE_ATTRIBUTE_R(int, in_flight);
+        /// Number of round trip times measured.
+        ELLE_ATTRIBUTE_R(int, rtt_count);
+      private:
+        /// Count an RPC in flight and measure its round trip time.
+        class InFlight
+        {
+        public:
+          InFlight(Remote& remote);
+          ~InFlight();
+          /// Run @a op, measuring its round trip time if it succeeds: failed
+          /// requests would only measure timeouts.
+          template <typename Op>
+          auto
+          run(Op& op)
+            -> std::enable_if_t<std::is_void<decltype(op())>::value>;
+          template <typename Op>
+          auto
+          run(Op& op)
+            -> std::enable_if_t<!std::is_void<decltype(op())>::value,
+                                decltype(op())>;
+        private:
+          void
+          _measure();
+          Remote& _remote;
+          std::chrono::steady_clock::time_point _start;
+        };
+        /// Recent round trip times, as a ring buffer.
+        ELLE_ATTRIBUTE(std::vector<std::chrono::microseconds>, rtt_samples);
+        ELLE_ATTRIBUTE(int, rtt_samples_next);
       };
 
       template <typename F>
@@ -139,11 +198,12 @@ namespace infinit
       {
       public:
         using Super = RPC<F>;
-        RemoteRPC(std::string name, Remote* remote);
+        RemoteRPC(std::string name, Remote* remote, Dock::Traffic traffic);
         template<typename ...Args>
         typename Super::result_type
         operator()(Args const& ... args);
         Remote* _remote;
+        Dock::Traffic _traffic;
       };
     }
   }
@@ -29,18 +29,66 @@ namespace infinit
             ELLE_LOG_COMPONENT("infinit.model.doughnut.Remote");
             // Hold a reference to the connection, in case we
             // disconnect/reconnect concurrently.
-            auto connection = this->_remote->_connection;
-            this->_channels = connection->channels().get();
-            auto creds = _remote->credentials();
-            if (!creds.empty())
+            auto connection = this->_remote->_connection_for(this->_traffic);
+            auto run = [&]
+              {
+                this->_channels = connection->channels().get();
+                auto creds = connection->credentials();
+                if (!creds.empty())
+                {
+                  elle::Buffer c(creds);
+                  this->key().emplace(std::move(c));
+                }
+                return helper();
+              };
+            if (connection != this->_remote->_connection)
             {
-              elle::Buffer c(creds);
-              this->key().emplace(std::move(c));
+              // Network errors on the bulk connection must not reach
+              // safe_perform, which would reconnect the control connection.
+              auto error = std::exception_ptr{};
+              try
+              {
+                return run();
+              }
+              catch (elle::reactor::network::TimeOut const&)
+              {
+                throw;
+              }
+              catch (elle::reactor::network::Error const&)
+              {
+                error = std::current_exception();
+              }
+              catch (elle::protocol::Serializer::EOF const&)
+              {
+                error = std::current_exception();
+              }
+              this->_remote->_bulk_failed(connection, error);
+              connection = this->_remote->_connection;
             }
-            return helper();
+            return run();
         });
       }
 
+      template <typename Op>
+      auto
+      Remote::InFlight::run(Op& op)
+        -> std::enable_if_t<std::is_void<decltype(op())>::value>
+      {
+        op();
+        this->_measure();
+      }
+
+      template <typename Op>
+      auto
+      Remote::InFlight::run(Op& op)
+        -> std::enable_if_t<!std::is_void<decltype(op())>::value,
+                            decltype(op())>
+      {
+        decltype(auto) res = op();
+        this->_measure();
+        return res;
+      }
+
       template <typename Op>
       auto
       Remote::safe_perform(std::string const& name, Op op)
@@ -108,7 +156,10 @@ namespace infinit
                     }
                   });
               ELLE_TRACE("%s: run \"%s\"", this, name)
-                return op();
+              {
+                InFlight in_flight(*this);
+                return in_flight.run(op);
+              }
             }
             else
             {
@@ -150,21 +201,24 @@ namespace infinit
       }
 
       template <typename F>
-      RemoteRPC<F>::RemoteRPC(std::string name, Remote* remote)
+      RemoteRPC<F>::RemoteRPC(std::string name,
+                              Remote* remote,
+                              Dock::Traffic traffic)
         : Super{std::move(name),
                 remote->_connection->channels().get(),
                 remote->doughnut().version(),
                 elle::unconst(&remote->credentials())}
         , _remote(remote)
+        , _traffic(traffic)
       {
         this->set_context(remote);
       }
 
       template <typename F>
       RemoteRPC<F>
-      Remote::make_rpc(std::string const& name)
+      Remote::make_rpc(std::string const& name, Dock::Traffic traffic)
       {
-        return RemoteRPC<F>(name, this);
+        return RemoteRPC<F>(name, this, traffic);
       }
     }
   }
@@ -0,0 +1,158 @@
+#include <infinit/model/doughnut/SecretCache.hh>
+
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+
+#include <elle/cryptography/hash.hh>
+
+ELLE_LOG_COMPONENT("infinit.model.doughnut.SecretCache");
+
+namespace
+{
+  int const default_capacity =
+    elle::os::getenv("INFINIT_SECRET_CACHE_SIZE", 4096);
+
+  /// Overwrite @a buffer, in a way the compiler cannot elide.
+  void
+  wipe(elle::Buffer& buffer)
+  {
+    auto volatile* p = buffer.mutable_contents();
+    for (auto i = 0u; i < buffer.size(); ++i)
+      p[i] = 0;
+  }
+}
+
+namespace infinit
+{
+  namespace model
+  {
+    namespace doughnut
+    {
+      /*-------------.
+      | Construction |
+      `-------------*/
+
+      SecretCache::SecretCache()
+        : SecretCache(default_capacity)
+      {}
+
+      SecretCache::SecretCache(int capacity)
+        : _capacity(std::max(capacity, 0))
+        , _hits(0)
+        , _misses(0)
+        , _evictions(0)
+      {}
+
+      SecretCache::~SecretCache()
+      {
+        this->clear();
+      }
+
+      /*--------.
+      | Content |
+      `--------*/
+
+      elle::Buffer
+      SecretCache::get(elle::Buffer const& token, PublicKey const& key,
+                       Unwrap const& unwrap)
+      {
+        if (!this->_capacity)
+          return unwrap();
+        auto const digest = Address(
+          elle::cryptography::hash(
+            token, elle::cryptography::Oneway::sha256).contents());
+        auto it = this->_index.find(digest);
+        if (it != this->_index.end() && it->second->key == key)
+        {
+          ELLE_DUMP("%s: hit for %s", this, digest);
+          ++this->_hits;
+          this->_entries.splice(
+            this->_entries.begin(), this->_entries, it->second);
+          return it->second->secret;
+        }
+        ELLE_DUMP("%s: miss for %s", this, digest);
+        ++this->_misses;
+        // Unwrapping may yield, the cache is only updated once it returns.
+        auto secret = unwrap();
+        if (!secret.empty())
+          this->_insert(digest, key, secret);
+        return secret;
+      }
+
+      void
+      SecretCache::_insert(Address const& token, PublicKey const& key,
+                           elle::Buffer const& secret)
+      {
+        auto it = this->_index.find(token);
+        if (it != this->_index.end())
+          this->_erase(it->second);
+        this->_entries.push_front(Entry{token, key, secret});
+        this->_index.emplace(token, this->_entries.begin());
+        while (signed(this->_entries.size()) > this->_capacity)
+        {
+          ++this->_evictions;
+          this->_erase(std::prev(this->_entries.end()));
+        }
+      }
+
+      void
+      SecretCache::_erase(Entries::iterator it)
+      {
+        this->_wipe(*it);
+        this->_index.erase(it->token);
+        this->_entries.erase(it);
+      }
+
+      void
+      SecretCache::_wipe(Entry& entry)
+      {
+        wipe(entry.secret);
+        this->_on_wipe(entry.secret);
+      }
+
+      void
+      SecretCache::clear()
+      {
+        for (auto& e: this->_entries)
+          this->_wipe(e);
+        this->_index.clear();
+        this->_entries.clear();
+      }
+
+      void
+      SecretCache::capacity(int capacity)
+      {
+        this->_capacity = std::max(capacity, 0);
+        while (signed(this->_entries.size()) > this->_capacity)
+        {
+          ++this->_evictions;
+          this->_erase(std::prev(this->_entries.end()));
+        }
+      }
+
+      std::size_t
+      SecretCache::size() const
+      {
+        return this->_entries.size();
+      }
+
+      /*-----------.
+      | Monitoring |
+      `-----------*/
+
+      elle::json::Object
+      SecretCache::stats() const
+      {
+        auto const lookups = this->_hits + this->_misses;
+        return elle::json::Object{
+          {"capacity", this->_capacity},
+          {"size", this->_entries.size()},
+          {"hits", this->_hits},
+          {"misses", this->_misses},
+          {"evictions", this->_evictions},
+          {"hit_rate", lookups ? double(this->_hits) / lookups : 0.},
+        };
+      }
+    }
+  }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+#include <boost/signals2.hpp>
+
+#include <elle/Buffer.hh>
+#include <elle/attribute.hh>
+#include <elle/cryptography/rsa/PublicKey.hh>
+#include <elle/json/json.hh>
+
+#include <infinit/model/Address.hh>
+
+namespace infinit
+{
+  namespace model
+  {
+    namespace doughnut
+    {
+      /// Bounded cache of the secrets unwrapped from ACB tokens.
+      ///
+      /// Reading an ACB requires to decrypt the token of the reader with
+      /// its private key, a costly RSA operation that yields the symmetric
+      /// secret of the block. Tokens only change when the block is resealed
+      /// with a new secret, so the unwrapped secret is kept, keyed by the
+      /// token digest and the public key it was addressed to. The least
+      /// recently used secrets are evicted first and wiped from memory.
+      class SecretCache
+      {
+      /*------.
+      | Types |
+      `------*/
+      public:
+        using Self = SecretCache;
+        using PublicKey = elle::cryptography::rsa::PublicKey;
+        using Unwrap = std::function<elle::Buffer ()>;
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+      public:
+        /// Construct a cache holding INFINIT_SECRET_CACHE_SIZE secrets.
+        SecretCache();
+        /// Construct a cache holding @a capacity secrets, zero to disable.
+        SecretCache(int capacity);
+        SecretCache(SecretCache const&) = delete;
+        ~SecretCache();
+
+      /*--------.
+      | Content |
+      `--------*/
+      public:
+        /// The secret wrapped in @a token for @a key.
+        ///
+        /// @arg unwrap  Decrypt @a token, called on cache miss.
+        elle::Buffer
+        get(elle::Buffer const& token, PublicKey const& key,
+            Unwrap const& unwrap);
+        /// Wipe and forget every secret.
+        void
+        clear();
+        /// Change the number of secrets held, evicting as needed.
+        void
+        capacity(int capacity);
+        std::size_t
+        size() const;
+        ELLE_ATTRIBUTE_R(int, capacity);
+        /// Emitted with each secret once wiped, before it is released.
+        ELLE_ATTRIBUTE_RX(
+          boost::signals2::signal<void (elle::Buffer const&)>, on_wipe);
+      private:
+        struct Entry
+        {
+          Address token;
+          PublicKey key;
+          elle::Buffer secret;
+        };
+        using Entries = std::list<Entry>;
+        void
+        _insert(Address const& token, PublicKey const& key,
+                elle::Buffer const& secret);
+        void
+        _erase(Entries::iterator it);
+        void
+        _wipe(Entry& entry);
+        /// Most recently used first.
+        ELLE_ATTRIBUTE(Entries, entries);
+        ELLE_ATTRIBUTE((std::unordered_map<Address, Entries::iterator>), index);
+
+      /*-----------.
+      | Monitoring |
+      `-----------*/
+      public:
+        elle::json::Object
+        stats() const;
+        ELLE_ATTRIBUTE_R(int64_t, hits);
+        ELLE_ATTRIBUTE_R(int64_t, misses);
+        ELLE_ATTRIBUTE_R(int64_t, evictions);
+      };
+    }
+  }
+}
@@ -0,0 +1,177 @@
+#include <infinit/model/doughnut/SignatureCache.hh>
+
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+#include <elle/reactor/Thread.hh>
+#include <elle/reactor/scheduler.hh>
+
+#include <elle/cryptography/hash.hh>
+
+ELLE_LOG_COMPONENT("infinit.model.doughnut.SignatureCache");
+
+namespace
+{
+  int const default_capacity =
+    elle::os::getenv("INFINIT_SIGNATURE_CACHE_SIZE", 16384);
+}
+
+namespace infinit
+{
+  namespace model
+  {
+    namespace doughnut
+    {
+      /*-------------.
+      | Construction |
+      `-------------*/
+
+      SignatureCache::SignatureCache()
+        : SignatureCache(default_capacity)
+      {}
+
+      SignatureCache::SignatureCache(int capacity)
+        : _capacity(std::max(capacity, 0))
+        , _hits(0)
+        , _misses(0)
+        , _failures(0)
+      {}
+
+      /*-------------.
+      | Verification |
+      `-------------*/
+
+      bool
+      SignatureCache::verify(PublicKey const& key,
+                             elle::Buffer const& signature,
+                             elle::Buffer const& data)
+      {
+        return this->_verify(
+          this->_capacity ? _digest(key, signature, data) : Address::null,
+          [&] { return key.verify(signature, data); });
+      }
+
+      bool
+      SignatureCache::_verify(Address const& digest,
+                              std::function<bool ()> const& check)
+      {
+        if (this->_capacity)
+        {
+          auto it = this->_index.find(digest);
+          if (it != this->_index.end())
+          {
+            ELLE_DUMP("%s: hit for %s", this, digest);
+            ++this->_hits;
+            this->_entries.splice(
+              this->_entries.begin(), this->_entries, it->second);
+            return true;
+          }
+        }
+        ++this->_misses;
+        auto valid = false;
+        if (this->_background.count(elle::reactor::scheduler().current()))
+          // The job refers to this frame: let it complete.
+          elle::With<elle::reactor::Thread::NonInterruptible>() << [&]
+          {
+            elle::reactor::background([&] { valid = check(); });
+          };
+        else
+          valid = check();
+        if (!valid)
+          ++this->_failures;
+        else if (this->_capacity)
+          this->_insert(digest);
+        return valid;
+      }
+
+      SignatureCache::Background::Background(SignatureCache& cache)
+        : _cache(cache)
+        , _thread(elle::reactor::scheduler().current())
+      {
+        this->_cache._background.insert(this->_thread);
+      }
+
+      SignatureCache::Background::~Background()
+      {
+        this->_cache._background.erase(this->_thread);
+      }
+
+      Address
+      SignatureCache::_digest(PublicKey const& key,
+                              elle::Buffer const& signature,
+                              elle::Buffer const& data)
+      {
+        // The DER key is self delimiting and the signature size is
+        // determined by the key, so the concatenation is unambiguous.
+        auto triple = elle::cryptography::rsa::publickey::der::encode(key);
+        triple.append(signature.contents(), signature.size());
+        triple.append(
+          elle::cryptography::hash(
+            data, elle::cryptography::Oneway::sha256).contents(),
+          32);
+        return Address(
+          elle::cryptography::hash(
+            triple, elle::cryptography::Oneway::sha256).contents());
+      }
+
+      void
+      SignatureCache::_insert(Address const& digest)
+      {
+        // Another verification of the same triple may have completed while
+        // this one yielded.
+        if (this->_index.find(digest) != this->_index.end())
+          return;
+        this->_entries.push_front(digest);
+        this->_index.emplace(digest, this->_entries.begin());
+        this->_shrink();
+      }
+
+      void
+      SignatureCache::_shrink()
+      {
+        while (signed(this->_entries.size()) > this->_capacity)
+        {
+          this->_index.erase(this->_entries.back());
+          this->_entries.pop_back();
+        }
+      }
+
+      void
+      SignatureCache::clear()
+      {
+        this->_index.clear();
+        this->_entries.clear();
+      }
+
+      void
+      SignatureCache::capacity(int capacity)
+      {
+        this->_capacity = std::max(capacity, 0);
+        this->_shrink();
+      }
+
+      std::size_t
+      SignatureCache::size() const
+      {
+        return this->_entries.size();
+      }
+
+      /*-----------.
+      | Monitoring |
+      `-----------*/
+
+      elle::json::Object
+      SignatureCache::stats() const
+      {
+        auto const lookups = this->_hits + this->_misses;
+        return elle::json::Object{
+          {"capacity", this->_capacity},
+          {"size", this->_entries.size()},
+          {"hits", this->_hits},
+          {"misses", this->_misses},
+          {"failures", this->_failures},
+          {"hit_rate", lookups ? double(this->_hits) / lookups : 0.},
+        };
+      }
+    }
+  }
+}
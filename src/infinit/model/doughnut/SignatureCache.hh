@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <elle/Buffer.hh>
+#include <elle/attribute.hh>
+#include <elle/cryptography/rsa/PublicKey.hh>
+#include <elle/json/json.hh>
+#include <elle/reactor/fwd.hh>
+
+#include <infinit/model/Address.hh>
+
+namespace infinit
+{
+  namespace model
+  {
+    namespace doughnut
+    {
+      /// Bounded cache of successfully verified signatures.
+      ///
+      /// A block is validated when stored locally, when accepted by Paxos,
+      /// when fetched and when inserted in the cache, each time verifying
+      /// the same RSA signatures. Verified (key, data, signature) triples are
+      /// remembered by digest so the same block version is verified once.
+      /// Only successes are cached: an invalid signature is checked again.
+      ///
+      /// Signed payloads are serialized on the calling thread. Within a
+      /// Background scope, the RSA checks of cache misses then run on the
+      /// background pool, so concurrent validations verify in parallel.
+      class SignatureCache
+      {
+      /*------.
+      | Types |
+      `------*/
+      public:
+        using Self = SignatureCache;
+        using PublicKey = elle::cryptography::rsa::PublicKey;
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+      public:
+        /// Construct a cache holding INFINIT_SIGNATURE_CACHE_SIZE signatures.
+        SignatureCache();
+        /// Construct a cache holding @a capacity signatures, zero to disable.
+        SignatureCache(int capacity);
+        SignatureCache(SignatureCache const&) = delete;
+
+      /*-------------.
+      | Verification |
+      `-------------*/
+      public:
+        /// Whether @a signature of @a data is valid for @a key.
+        bool
+        verify(PublicKey const& key,
+               elle::Buffer const& signature,
+               elle::Buffer const& data);
+        /// Whether @a signature of the serialized @a o is valid for @a key.
+        ///
+        /// @arg version  The version @a o was serialized with when signed.
+        template <typename T>
+        bool
+        verify(PublicKey const& key,
+               elle::Buffer const& signature,
+               T const& o,
+               elle::Version const& version);
+        void
+        clear();
+        /// Change the number of signatures held, evicting as needed.
+        void
+        capacity(int capacity);
+        std::size_t
+        size() const;
+        ELLE_ATTRIBUTE_R(int, capacity);
+
+        /// Verify cache misses of the current thread in the background
+        /// while alive.
+        class Background
+        {
+        public:
+          Background(SignatureCache& cache);
+          Background(Background const&) = delete;
+          ~Background();
+        private:
+          ELLE_ATTRIBUTE(SignatureCache&, cache);
+          ELLE_ATTRIBUTE(elle::reactor::Thread*, thread);
+        };
+
+      private:
+        /// Digest identifying the triple, independent of its layout.
+        static
+        Address
+        _digest(PublicKey const& key,
+                elle::Buffer const& signature,
+                elle::Buffer const& data);
+        /// Run @a check unless @a digest is known to be valid.
+        bool
+        _verify(Address const& digest, std::function<bool ()> const& check);
+        void
+        _insert(Address const& digest);
+        void
+        _shrink();
+        /// Most recently used first.
+        ELLE_ATTRIBUTE(std::list<Address>, entries);
+        ELLE_ATTRIBUTE((std::unordered_map<Address, std::list<Address>::iterator>),
+                       index);
+        /// Threads within a Background scope.
+        ELLE_ATTRIBUTE((std::unordered_set<elle::reactor::Thread*>),
+                       background);
+
+      /*-----------.
+      | Monitoring |
+      `-----------*/
+      public:
+        elle::json::Object
+        stats() const;
+        ELLE_ATTRIBUTE_R(int64_t, hits);
+        ELLE_ATTRIBUTE_R(int64_t, misses);
+        ELLE_ATTRIBUTE_R(int64_t, failures);
+      };
+    }
+  }
+}
+
+#include <infinit/model/doughnut/SignatureCache.hxx>
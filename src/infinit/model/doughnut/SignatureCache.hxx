@@ -0,0 +1,25 @@
+#pragma once
+
+#include <elle/serialization/binary.hh>
+
+namespace infinit
+{
+  namespace model
+  {
+    namespace doughnut
+    {
+      template <typename T>
+      bool
+      SignatureCache::verify(PublicKey const& key,
+                             elle::Buffer const& signature,
+                             T const& o,
+                             elle::Version const& version)
+      {
+        // Serialize once, as signed, for both the digest and the check.
+        auto const payload =
+          elle::serialization::binary::serialize(o, version, false);
+        return this->verify(key, signature, payload);
+      }
+    }
+  }
+}
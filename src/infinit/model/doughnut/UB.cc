@@ -8,6 +8,8 @@
 
 #include <elle/serialization/json.hh>
 
+#include <infinit/model/doughnut/KeyTable.hh>
+
 ELLE_LOG_COMPONENT("infinit.model.doughnut.UB");
 
 namespace infinit
@@ -41,6 +43,20 @@ namespace infinit
         , _doughnut(dn)
       {}
 
+      UB::UB(Doughnut* dn,
+             Address address,
+             std::string name,
+             elle::cryptography::rsa::PublicKey key,
+             bool reverse,
+             boost::optional<Passport> passport)
+        : Super(address)
+        , _name(std::move(name))
+        , _key(std::move(key))
+        , _reverse(reverse)
+        , _passport(std::move(passport))
+        , _doughnut(dn)
+      {}
+
       UB::UB(UB const& other)
         : Super(other)
         , _name{other._name}
@@ -176,7 +192,7 @@ namespace infinit
              elle::Version const& version)
         : Super(input, version)
         , _name(input.deserialize<std::string>("name"))
-        , _key(input.deserialize<elle::cryptography::rsa::PublicKey>("key"))
+        , _key(*input.deserialize<KeyTable::Serialized>("key").key)
         , _reverse(input.deserialize<bool>("reverse"))
       {
         input.serialize_context<Doughnut*>(this->_doughnut);
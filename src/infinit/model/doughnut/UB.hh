@@ -36,6 +36,13 @@ namespace infinit
         UB(Doughnut* dht, std::string name,
            elle::cryptography::rsa::PublicKey key,
            bool reverse = false);
+        /// Restore a stored block, trusting @a address.
+        UB(Doughnut* dht,
+           Address address,
+           std::string name,
+           elle::cryptography::rsa::PublicKey key,
+           bool reverse,
+           boost::optional<Passport> passport);
         UB(UB const& other);
         static
         Address
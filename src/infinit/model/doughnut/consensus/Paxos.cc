@@ -30,6 +30,7 @@
 #include <infinit/model/doughnut/Remote.hh>
 #include <infinit/model/doughnut/DummyPeer.hh>
 #include <infinit/model/doughnut/ACB.hh>
+#include <infinit/model/doughnut/BlockCodec.hh>
 #include <infinit/model/blocks/ImmutableBlock.hh>
 #include <infinit/model/doughnut/OKB.hh>
 #include <infinit/model/doughnut/ValidationFailed.hh>
@@ -126,6 +127,15 @@ namespace infinit
           , paxos(p, [] (Paxos::LocalPeer::Decision*) {})
         {}
 
+        BlockOrPaxos::BlockOrPaxos(std::unique_ptr<blocks::Block> b)
+          : block(b.release(),
+                  [] (blocks::Block* p)
+                  {
+                    std::default_delete<blocks::Block>()(p);
+                  })
+          , paxos()
+        {}
+
         BlockOrPaxos::BlockOrPaxos(elle::serialization::SerializerIn& s)
           : block(nullptr,
                   [] (blocks::Block* p)
@@ -551,14 +561,7 @@ namespace infinit
           else
           {
             ELLE_TRACE_SCOPE("%s: load %f from storage", *this, address);
-            auto buffer = this->storage()->get(address);
-            elle::serialization::Context context;
-            context.set<Doughnut*>(&this->doughnut());
-            context.set<elle::Version>(
-              elle_serialization_version(this->doughnut().version()));
-            auto stored =
-              elle::serialization::binary::deserialize<BlockOrPaxos>(
-                buffer, true, context);
+            auto stored = this->_deserialize(this->_load_data(address));
             if (stored.block)
             {
               if (this->_rebalance_auto_expand)
@@ -596,6 +599,19 @@ namespace infinit
           }
         }
 
+        BlockOrPaxos
+        Paxos::LocalPeer::_deserialize(elle::Buffer const& data) const
+        {
+          if (codec::compact(data))
+            return BlockOrPaxos(codec::decode(data, this->doughnut()));
+          elle::serialization::Context context;
+          context.set<Doughnut*>(&this->doughnut());
+          context.set<elle::Version>(
+            elle_serialization_version(this->doughnut().version()));
+          return elle::serialization::binary::deserialize<BlockOrPaxos>(
+            data, true, context);
+        }
+
         Paxos::LocalPeer::Decision&
         Paxos::LocalPeer::_load_paxos(
           Address address,
@@ -1066,7 +1082,9 @@ namespace infinit
           BlockOrPaxos data(&decision);
           this->storage()->set(
             address,
-            elle::serialization::binary::serialize(data, this->doughnut().version()),
+            this->_store_data(
+              elle::serialization::binary::serialize(
+                data, this->doughnut().version())),
             true, true);
           return res;
         }
@@ -1106,8 +1124,9 @@ namespace infinit
             BlockOrPaxos data(&decision);
             this->storage()->set(
               address,
-              elle::serialization::binary::serialize(
-                data, this->doughnut().version()),
+              this->_store_data(
+                elle::serialization::binary::serialize(
+                  data, this->doughnut().version())),
               true, true);
           }
           if (block)
@@ -1147,7 +1166,8 @@ namespace infinit
                   data, this->doughnut().version());
                 return res;
               }();
-              this->storage()->set(address, ser, true, true);
+              this->storage()->set(
+                address, this->_store_data(std::move(ser)), true, true);
             }
             auto const& quorum = decision.paxos.current_quorum();
             if (!contains(quorum, this->doughnut().id()))
@@ -1274,18 +1294,16 @@ namespace infinit
         {
           if (this->doughnut().version() >= elle::Version(0, 5, 0))
           {
-            elle::serialization::Context context;
-            context.set<Doughnut*>(&this->doughnut());
-            context.set<elle::Version>(
-              elle_serialization_version(this->doughnut().version()));
+            bool trusted = false;
             auto data =
-              elle::serialization::binary::deserialize<BlockOrPaxos>(
-                this->storage()->get(address), true, context);
+              this->_deserialize(this->_load_data(address, &trusted));
             if (!data.block)
             {
               ELLE_TRACE("%s: plain fetch called on mutable block", *this);
               elle::err("plain fetch called on mutable block %f", address);
             }
+            if (trusted)
+              data.block->validated(true);
             return std::unique_ptr<blocks::Block>(data.block.release());
           }
           // Backward compatibility pre-0.5.0
@@ -1293,13 +1311,7 @@ namespace infinit
           if (decision == this->_addresses.end())
             try
             {
-              elle::serialization::Context context;
-              context.set<Doughnut*>(&this->doughnut());
-              context.set<elle::Version>(
-                elle_serialization_version(this->doughnut().version()));
-              auto data =
-                elle::serialization::binary::deserialize<BlockOrPaxos>(
-                  this->storage()->get(address), true, context);
+              auto data = this->_deserialize(this->_load_data(address));
               if (data.block)
               {
                 ELLE_DEBUG("loaded immutable block from storage");
@@ -1351,9 +1363,10 @@ namespace infinit
                 BlockOrPaxos data(const_cast<Decision*>(&decision->second));
                 this->storage()->set(
                   address,
-                  elle::serialization::binary::serialize(
-                    data,
-                    this->doughnut().version()),
+                  this->_store_data(
+                    elle::serialization::binary::serialize(
+                      data,
+                      this->doughnut().version())),
                   true, true);
               }
               // ELLE_ASSERT(block.unique());
@@ -1375,20 +1388,20 @@ namespace infinit
         {
           ELLE_TRACE_SCOPE("%s: store %f", *this, block);
           ELLE_DEBUG("%s: validate block", *this)
+          {
+            // Blocks received concurrently, for instance from rebalancing
+            // peers, are hashed together.
+            sha256::Batch::Scope batch(this->doughnut().hash_batch());
             if (auto res = block.validate(this->doughnut(), true)); else
               throw ValidationFailed(res.reason());
+          }
           if (!dynamic_cast<blocks::ImmutableBlock const*>(&block))
             throw ValidationFailed("bypassing Paxos for a mutable block");
           // validate with previous version
           try
           {
-            auto previous_buffer = this->storage()->get(block.address());
-            elle::IOStream s(previous_buffer.istreambuf());
-            typename elle::serialization::binary::SerializerIn input(s);
-            input.set_context<Doughnut*>(&this->doughnut());
-            input.set_context<elle::Version>(
-              elle_serialization_version(this->doughnut().version()));
-            auto stored = input.deserialize<BlockOrPaxos>();
+            auto stored =
+              this->_deserialize(this->_load_data(block.address()));
             if (!stored.block)
               throw ValidationFailed(
                 elle::sprintf("storing immutable block on mutable block %f",
@@ -1408,15 +1421,19 @@ namespace infinit
           elle::Buffer data =
             [&]
             {
+              // Immutable blocks need no Paxos state, store them compact.
+              if (codec::enabled(block, this->doughnut()))
+                return codec::encode(block);
               BlockOrPaxos b(const_cast<blocks::Block&>(block));
               auto res = elle::serialization::binary::serialize(
                 b, this->doughnut().version());
               b.block.release();
               return res;
             }();
-          this->storage()->set(block.address(), data,
-                              mode == STORE_INSERT,
-                              mode == STORE_UPDATE);
+          this->storage()->set(block.address(),
+                               this->_store_data(std::move(data)),
+                               mode == STORE_INSERT,
+                               mode == STORE_UPDATE);
           this->on_store()(block);
         }
 
@@ -1703,8 +1720,21 @@ namespace infinit
             {
               try
               {
-                auto block = this->_fetch(
-                  p.first, std::move(p.second), versions.at(p.first));
+                auto block = [&]
+                {
+                  try
+                  {
+                    return this->_fetch(
+                      p.first, std::move(p.second), versions.at(p.first));
+                  }
+                  catch (MissingBlock const&)
+                  {
+                    if (!this->doughnut().overlay()->computed_placement())
+                      throw;
+                    return this->_fetch_next_ranked(
+                      p.first, versions.at(p.first));
+                  }
+                }();
                 res(p.first, std::move(block), {});
               }
               catch (elle::Error const& e)
@@ -1724,7 +1754,16 @@ namespace infinit
             return fetch_from_members(peers, address, std::move(local_version));
           }
           auto peers = this->_peers(address, local_version);
-          return _fetch(address, std::move(peers), local_version);
+          try
+          {
+            return _fetch(address, std::move(peers), local_version);
+          }
+          catch (MissingBlock const&)
+          {
+            if (!this->doughnut().overlay()->computed_placement())
+              throw;
+            return this->_fetch_next_ranked(address, local_version);
+          }
         }
 
         std::unique_ptr<blocks::Block>
@@ -1831,6 +1870,36 @@ namespace infinit
           return peers;
         }
 
+        std::unique_ptr<blocks::Block>
+        Paxos::_fetch_next_ranked(Address address,
+                                  boost::optional<int> local_version)
+        {
+          // Members that joined after the block was stored may rank first
+          // without holding it: try the following ones, factor at a time.
+          // Mutable blocks are redirected to their quorum by its members.
+          for (int skip = this->_factor; true; skip += this->_factor)
+          {
+            auto peers = PaxosClient::Peers{};
+            auto ranked = 0;
+            for (auto peer: this->doughnut().overlay()->lookup(
+                   address, skip + this->_factor, address.mutable_block()))
+              if (ranked++ >= skip)
+                if (auto lock = peer.lock())
+                  peers.emplace_back(std::make_unique<PaxosPeer>(
+                                       peer, address, local_version, false));
+            if (ranked <= skip)
+              throw MissingBlock(address);
+            ELLE_DEBUG_SCOPE("fetch %f from members ranked after %s: %f",
+                             address, skip, peers);
+            try
+            {
+              return this->_fetch(address, std::move(peers), local_version);
+            }
+            catch (MissingBlock const&)
+            {}
+          }
+        }
+
         Paxos::PaxosClient
         Paxos::_client(Address const& address)
         {
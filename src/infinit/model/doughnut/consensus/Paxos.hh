@@ -115,6 +115,11 @@ namespace infinit
           PaxosClient::Peers
           _peers(Address const& address,
                  boost::optional<int> local_version = {});
+          /// Fetch @a address from the members ranked after its owners, for
+          /// overlays with computed placement.
+          std::unique_ptr<blocks::Block>
+          _fetch_next_ranked(Address address,
+                             boost::optional<int> local_version);
           PaxosClient
           _client(Address const& addr);
           PaxosClient::State
@@ -303,6 +308,10 @@ namespace infinit
             _remove(Address address);
             BlockOrPaxos
             _load(Address address);
+            /// The stored @a data: a compact encoded immutable block or a
+            /// serialized BlockOrPaxos.
+            BlockOrPaxos
+            _deserialize(elle::Buffer const& data) const;
             Decision&
             _load_paxos(Address address,
                         boost::optional<PaxosServer::Quorum> peers = {});
@@ -462,6 +471,8 @@ namespace infinit
           explicit
           BlockOrPaxos(blocks::Block& b);
           explicit
+          BlockOrPaxos(std::unique_ptr<blocks::Block> b);
+          explicit
           BlockOrPaxos(Paxos::LocalPeer::Decision* p);
           explicit
           BlockOrPaxos(elle::serialization::SerializerIn& s);
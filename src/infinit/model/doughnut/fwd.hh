@@ -14,6 +14,10 @@ namespace infinit
       class Local;
       class Peer;
       class Remote;
+      namespace sha256
+      {
+        class Batch;
+      }
       using elle::das::operator <<;
     }
   }
@@ -0,0 +1,203 @@
+#include <infinit/model/doughnut/sha256.hh>
+
+#include <memory>
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <cpuid.h>
+#endif
+
+#include <openssl/evp.h>
+
+#include <elle/err.hh>
+#include <elle/log.hh>
+
+#include <elle/reactor/Barrier.hh>
+#include <elle/reactor/Scope.hh>
+#include <elle/reactor/Thread.hh>
+#include <elle/reactor/scheduler.hh>
+
+ELLE_LOG_COMPONENT("infinit.model.doughnut.sha256");
+
+namespace infinit
+{
+  namespace model
+  {
+    namespace doughnut
+    {
+      namespace sha256
+      {
+        namespace
+        {
+          /// Below this size, hashing costs less than a background job.
+          auto constexpr background_threshold = 262144u;
+
+          std::string
+          _detect()
+          {
+#if defined(__x86_64__) || defined(__i386__)
+            unsigned int eax, ebx, ecx, edx;
+            if (__get_cpuid_max(0, nullptr) >= 7)
+            {
+              __cpuid_count(7, 0, eax, ebx, ecx, edx);
+              if (ebx & (1u << 29))
+                return "sha-ni";
+              if (ebx & (1u << 5))
+                return "avx2";
+            }
+#endif
+            return "generic";
+          }
+
+          std::size_t
+          _size(Message const& message)
+          {
+            auto res = std::size_t(0);
+            for (auto const& part: message)
+              res += part.size();
+            return res;
+          }
+        }
+
+        std::string const&
+        backend()
+        {
+          static auto const res = []
+            {
+              auto res = _detect();
+              ELLE_TRACE("SHA-256 backend: %s", res);
+              return res;
+            }();
+          return res;
+        }
+
+        elle::Buffer
+        digest(Message const& message)
+        {
+          auto res = elle::Buffer(EVP_MD_size(EVP_sha256()));
+          auto ctx = std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX*)>(
+            EVP_MD_CTX_create(), [] (EVP_MD_CTX* c) { EVP_MD_CTX_destroy(c); });
+          if (!ctx ||
+              !EVP_DigestInit_ex(ctx.get(), EVP_sha256(), nullptr))
+            elle::err("unable to initialize SHA-256");
+          for (auto const& part: message)
+            if (!EVP_DigestUpdate(ctx.get(), part.contents(), part.size()))
+              elle::err("unable to hash with SHA-256");
+          if (!EVP_DigestFinal_ex(ctx.get(), res.mutable_contents(), nullptr))
+            elle::err("unable to finalize SHA-256");
+          return res;
+        }
+
+        std::vector<elle::Buffer>
+        digest(std::vector<Message> const& messages)
+        {
+          auto res = std::vector<elle::Buffer>(messages.size());
+          auto size = std::size_t(0);
+          for (auto const& m: messages)
+            size += _size(m);
+          if (size < background_threshold ||
+              !elle::reactor::Scheduler::scheduler())
+          {
+            for (auto i = 0u; i < messages.size(); ++i)
+              res[i] = digest(messages[i]);
+            return res;
+          }
+          ELLE_DEBUG("hash %s messages of %s bytes in parallel",
+                     messages.size(), size);
+          elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& s)
+          {
+            for (auto i = 0u; i < messages.size(); ++i)
+              s.run_background(
+                elle::sprintf("sha256 %s", i),
+                [&, i]
+                {
+                  // The job refers to the results, let it complete.
+                  elle::With<elle::reactor::Thread::NonInterruptible>() << [&]
+                  {
+                    elle::reactor::background(
+                      [&] { res[i] = digest(messages[i]); });
+                  };
+                });
+            elle::reactor::wait(s);
+          };
+          return res;
+        }
+
+        /*------.
+        | Batch |
+        `------*/
+
+        struct Batch::Round
+        {
+          std::vector<Message> messages;
+          std::vector<elle::Buffer> digests;
+          std::exception_ptr error;
+          elle::reactor::Barrier done;
+        };
+
+        Batch::Batch()
+        {}
+
+        Batch::~Batch()
+        {}
+
+        elle::Buffer
+        Batch::digest(Message const& message)
+        {
+          auto const thread = elle::reactor::Scheduler::scheduler()
+            ? elle::reactor::scheduler().current()
+            : nullptr;
+          if (!thread || !this->_threads.count(thread))
+            return sha256::digest(std::vector<Message>{message})[0];
+          if (auto round = this->_round)
+          {
+            auto const index = round->messages.size();
+            round->messages.emplace_back(message);
+            // The round refers to our message, let it complete.
+            elle::With<elle::reactor::Thread::NonInterruptible>() << [&]
+            {
+              elle::reactor::wait(round->done);
+            };
+            if (round->error)
+              std::rethrow_exception(round->error);
+            return round->digests[index];
+          }
+          auto round = this->_round = std::make_shared<Round>();
+          round->messages.emplace_back(message);
+          // Other threads of the batch wait for this round, let it complete.
+          elle::With<elle::reactor::Thread::NonInterruptible>() << [&]
+          {
+            // Let the other threads of the batch queue their messages.
+            elle::reactor::yield();
+            this->_round.reset();
+            ELLE_DEBUG("digest a batch of %s messages",
+                       round->messages.size());
+            try
+            {
+              round->digests = sha256::digest(round->messages);
+            }
+            catch (elle::Error const&)
+            {
+              round->error = std::current_exception();
+            }
+            round->done.open();
+          };
+          if (round->error)
+            std::rethrow_exception(round->error);
+          return round->digests[0];
+        }
+
+        Batch::Scope::Scope(Batch& batch)
+          : _batch(batch)
+          , _thread(elle::reactor::scheduler().current())
+        {
+          this->_batch._threads.insert(this->_thread);
+        }
+
+        Batch::Scope::~Scope()
+        {
+          this->_batch._threads.erase(this->_thread);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <elle/Buffer.hh>
+#include <elle/attribute.hh>
+#include <elle/reactor/fwd.hh>
+
+namespace infinit
+{
+  namespace model
+  {
+    namespace doughnut
+    {
+      /// SHA-256 of block contents.
+      ///
+      /// Digests are computed on the given buffers directly, without
+      /// concatenating them nor going through streams. The compression
+      /// function is OpenSSL's, which uses the SHA extensions or AVX2 when
+      /// the CPU supports them.
+      namespace sha256
+      {
+        /// A message to digest, as consecutive parts.
+        using Message = std::vector<elle::ConstWeakBuffer>;
+
+        /// The fastest instruction set this CPU offers for SHA-256: "sha-ni",
+        /// "avx2" or "generic". OpenSSL picks it unless OPENSSL_ia32cap
+        /// masks it.
+        std::string const&
+        backend();
+        /// The digest of @a message.
+        elle::Buffer
+        digest(Message const& message);
+        /// The digests of @a messages, hashed in parallel on the background
+        /// pool when running in a scheduler.
+        std::vector<elle::Buffer>
+        digest(std::vector<Message> const& messages);
+
+        /// Messages digested together by concurrent threads.
+        ///
+        /// Threads within a Scope queue their messages instead of hashing
+        /// them right away. The first one lets the others run, then digests
+        /// every queued message at once, in parallel when large enough.
+        class Batch
+        {
+        public:
+          Batch();
+          ~Batch();
+          Batch(Batch const&) = delete;
+          /// The digest of @a message, batched if the current thread is
+          /// within a Scope.
+          elle::Buffer
+          digest(Message const& message);
+
+          /// Batch the digests of the current thread while alive.
+          class Scope
+          {
+          public:
+            Scope(Batch& batch);
+            Scope(Scope const&) = delete;
+            ~Scope();
+          private:
+            ELLE_ATTRIBUTE(Batch&, batch);
+            ELLE_ATTRIBUTE(elle::reactor::Thread*, thread);
+          };
+
+        private:
+          struct Round;
+          ELLE_ATTRIBUTE(std::shared_ptr<Round>, round);
+          ELLE_ATTRIBUTE((std::unordered_set<elle::reactor::Thread*>),
+                         threads);
+        };
+      }
+    }
+  }
+}
@@ -141,6 +141,12 @@ namespace infinit
       }
     }
 
+    bool
+    Overlay::computed_placement() const
+    {
+      return false;
+    }
+
     void
     Overlay::_store(bool storing)
     {}
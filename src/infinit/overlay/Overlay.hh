@@ -84,6 +84,13 @@ namespace infinit
     public:
       /// Whether we accept new blocks.
       ELLE_ATTRIBUTE_Rw(bool, storing, virtual);
+      /// Whether owners are computed from the members rather than looked up.
+      ///
+      /// Members that joined after a block was stored may then rank first for
+      /// it without holding it, and fetches must try the next ranked members.
+      virtual
+      bool
+      computed_placement() const;
     protected:
       virtual
       void
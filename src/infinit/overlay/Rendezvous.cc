@@ -0,0 +1,462 @@
+#include <infinit/overlay/Rendezvous.hh>
+
+#include <algorithm>
+
+#include <elle/err.hh>
+#include <elle/log.hh>
+#include <elle/make-vector.hh>
+#include <elle/os/environ.hh>
+#include <elle/utils.hh>
+
+#include <elle/reactor/network/Error.hh>
+#include <elle/reactor/scheduler.hh>
+
+#include <infinit/model/doughnut/Doughnut.hh>
+#include <infinit/model/doughnut/Local.hh>
+
+ELLE_LOG_COMPONENT("infinit.overlay.Rendezvous");
+
+namespace infinit
+{
+  namespace overlay
+  {
+    namespace
+    {
+      /// Interval between reconnection attempts to disconnected members.
+      auto const reconnect_interval = std::chrono::seconds(
+        elle::os::getenv("INFINIT_RENDEZVOUS_RECONNECT_INTERVAL", 10));
+
+      using Advertise = auto (NodeLocations const&) -> NodeLocations;
+
+      uint64_t
+      load64(uint8_t const* p)
+      {
+        auto res = uint64_t(0);
+        for (int i = 7; i >= 0; --i)
+          res = res << 8 | p[i];
+        return res;
+      }
+
+      // SplitMix64 finalizer.
+      uint64_t
+      mix(uint64_t h)
+      {
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+        return h ^ (h >> 31);
+      }
+    }
+
+    /*-------------.
+    | Construction |
+    `-------------*/
+
+    Rendezvous::Rendezvous(model::doughnut::Doughnut* dht,
+                           std::shared_ptr<Local> local,
+                           std::chrono::seconds eviction_delay)
+      : Overlay(dht, local)
+      , _cleaning(false)
+      , _eviction_delay(eviction_delay)
+      , _evict_thread(new elle::reactor::Thread(
+                        elle::sprintf("%s: evict", this),
+                        [this] { this->_evict(); }))
+    {
+      ELLE_TRACE_SCOPE("%s: construct", this);
+      if (local)
+        this->_register_local(local);
+      this->_connections.emplace_back(
+        this->doughnut()->dock().on_peer().connect(
+          [this] (std::shared_ptr<Remote> peer)
+          {
+            peer->connected().connect(
+              [this, p = std::weak_ptr<Remote>(peer)]
+              {
+                this->_peer_connected(ELLE_ENFORCE(p.lock()));
+              });
+            peer->disconnected().connect(
+              [this, p = std::weak_ptr<Remote>(peer)]
+              {
+                this->_peer_disconnected(ELLE_ENFORCE(p.lock()));
+              });
+            this->_peer_connected(peer);
+          }));
+    }
+
+    void
+    Rendezvous::_register_local(std::shared_ptr<Local> local)
+    {
+      this->_peers.emplace(local->id(), local);
+      this->_members.emplace_back(local->id(), local->server_endpoints());
+      this->_connections.emplace_back(local->on_connect().connect(
+        [this] (RPCServer& rpcs)
+        {
+          // Exchange members: learn the caller's and return ours.
+          rpcs.add(
+            "rendezvous_advertise",
+            [this] (NodeLocations const& members)
+            {
+              this->_add_members(members);
+              this->_discover(members);
+              return this->_members;
+            });
+        }));
+    }
+
+    Rendezvous::~Rendezvous()
+    {
+      ELLE_TRACE_SCOPE("%s: destruct", this);
+      this->_evict_thread->terminate_now();
+      // Disconnect peers manually, as Kouncil does, so their disconnection
+      // callbacks do not run from their destructor.
+      auto remotes = std::vector<Member>{};
+      for (auto const& p: this->_peers)
+        if (dynamic_cast<Remote*>(p.second.get()))
+          remotes.emplace_back(p.second);
+      for (auto const& peer: remotes)
+        peer->cleanup();
+    }
+
+    void
+    Rendezvous::_cleanup()
+    {
+      this->_cleaning = true;
+      this->_disconnected.clear();
+    }
+
+    /*--------.
+    | Hashing |
+    `--------*/
+
+    uint64_t
+    Rendezvous::score(Address const& node, Address const& block)
+    {
+      // Read addresses as little endian words so all members agree.
+      auto res = uint64_t(0);
+      for (int i = 0; i < 4; ++i)
+        res = mix(res ^ load64(node.value() + 8 * i) ^
+                  mix(load64(block.value() + 8 * i)));
+      return res;
+    }
+
+    NodeLocations
+    Rendezvous::owners(NodeLocations const& members,
+                       Address const& block,
+                       int n)
+    {
+      auto ranked = elle::make_vector(
+        members,
+        [&] (NodeLocation const& m)
+        {
+          return std::make_pair(score(m.id(), block), &m);
+        });
+      auto const count = std::min(n, signed(ranked.size()));
+      std::partial_sort(
+        ranked.begin(), ranked.begin() + count, ranked.end(),
+        [] (auto const& a, auto const& b)
+        {
+          if (a.first != b.first)
+            return a.first > b.first;
+          return a.second->id() < b.second->id();
+        });
+      auto res = NodeLocations{};
+      res.reserve(count);
+      for (int i = 0; i < count; ++i)
+        res.emplace_back(*ranked[i].second);
+      return res;
+    }
+
+    /*--------.
+    | Members |
+    `--------*/
+
+    void
+    Rendezvous::_discover(NodeLocations const& peers)
+    {
+      ELLE_TRACE_SCOPE("%s: discover %s nodes", this, peers.size());
+      for (auto const& peer: peers)
+        if (peer.id() != this->id() && !this->_peers.count(peer.id()))
+          ELLE_TRACE("connect to %f", peer)
+            this->doughnut()->dock().connect(peer);
+    }
+
+    bool
+    Rendezvous::_discovered(Address id)
+    {
+      return this->_peers.count(id);
+    }
+
+    bool
+    Rendezvous::_member(Address const& id) const
+    {
+      return std::any_of(
+        this->_members.begin(), this->_members.end(),
+        [&] (NodeLocation const& m) { return m.id() == id; });
+    }
+
+    void
+    Rendezvous::_add_members(NodeLocations const& locations)
+    {
+      for (auto const& l: locations)
+      {
+        if (!l.id() || l.id() == this->id())
+          continue;
+        auto it = std::find_if(
+          this->_members.begin(), this->_members.end(),
+          [&] (NodeLocation const& m) { return m.id() == l.id(); });
+        if (it == this->_members.end())
+        {
+          ELLE_TRACE("%s: new member %f", this, l);
+          this->_members.emplace_back(l);
+          if (!this->_peers.count(l.id()))
+            this->_disconnected.emplace(l.id(), Clock::now());
+        }
+        else if (!l.endpoints().empty())
+          it->endpoints() = l.endpoints();
+      }
+    }
+
+    void
+    Rendezvous::_advertise(Remote& r)
+    {
+      ELLE_TRACE_SCOPE("%s: exchange members with %f", this, r);
+      try
+      {
+        auto advertise = r.make_rpc<Advertise>("rendezvous_advertise");
+        auto members = advertise(
+          this->local() ? this->_members : NodeLocations());
+        ELLE_DEBUG("fetched %s members", members.size());
+        this->_add_members(members);
+        this->_discover(members);
+      }
+      catch (elle::reactor::network::Error const& e)
+      {
+        ELLE_TRACE("%s: network exception advertising %s: %s", this, r, e);
+        // nothing to do, disconnected() will be emited and handled.
+      }
+      catch (elle::Error const& e)
+      {
+        // Clients do not serve the RPC.
+        ELLE_DEBUG("%s: unable to advertise %s: %s", this, r, e);
+      }
+    }
+
+    void
+    Rendezvous::_peer_connected(std::shared_ptr<Remote> peer)
+    {
+      ELLE_TRACE_SCOPE("%s: %f connected", this, peer);
+      ELLE_ASSERT(peer->id());
+      this->_peers[peer->id()] = peer;
+      this->_disconnected.erase(peer->id());
+      this->_advertise(*peer);
+      if (this->_member(peer->id()))
+        this->on_discovery()(peer->connection()->location(), false);
+    }
+
+    void
+    Rendezvous::_peer_disconnected(std::shared_ptr<Remote> peer)
+    {
+      ELLE_TRACE_SCOPE("%s: %f disconnected", this, peer);
+      auto const id = peer->id();
+      this->_peers.erase(id);
+      peer.reset();
+      if (this->_member(id))
+      {
+        if (!this->_cleaning)
+          this->_disconnected[id] = Clock::now();
+        this->on_disappearance()(id, false);
+      }
+    }
+
+    void
+    Rendezvous::_evict()
+    {
+      while (true)
+      {
+        elle::reactor::sleep(
+          boost::posix_time::seconds(reconnect_interval.count()));
+        auto const now = Clock::now();
+        // Connecting may yield and let members come back: work on a copy.
+        auto const disconnected = elle::make_vector(this->_disconnected);
+        for (auto const& d: disconnected)
+        {
+          auto member = std::find_if(
+            this->_members.begin(), this->_members.end(),
+            [&] (NodeLocation const& m) { return m.id() == d.first; });
+          if (member == this->_members.end())
+            this->_disconnected.erase(d.first);
+          else if (now - d.second > this->_eviction_delay)
+          {
+            ELLE_LOG("%s: evict %f, disconnected for more than %s",
+                     this, d.first, this->_eviction_delay);
+            this->_members.erase(member);
+            this->_disconnected.erase(d.first);
+          }
+          else if (this->_disconnected.count(d.first))
+          {
+            ELLE_DEBUG("%s: reconnect to %f", this, *member);
+            this->doughnut()->dock().connect(*member);
+          }
+        }
+      }
+    }
+
+    /*-------.
+    | Lookup |
+    `-------*/
+
+    bool
+    Rendezvous::computed_placement() const
+    {
+      return true;
+    }
+
+    auto
+    Rendezvous::_allocate(Address address, int n) const
+      -> MemberGenerator
+    {
+      auto members = this->_members;
+      if (!this->storing())
+        members.erase(
+          std::remove_if(
+            members.begin(), members.end(),
+            [this] (NodeLocation const& m) { return m.id() == this->id(); }),
+          members.end());
+      return this->_owners(std::move(members), address, n);
+    }
+
+    auto
+    Rendezvous::_lookup(Address address, int n, bool) const
+      -> MemberGenerator
+    {
+      return this->_owners(this->_members, address, n);
+    }
+
+    auto
+    Rendezvous::_owners(NodeLocations members, Address address, int n) const
+      -> MemberGenerator
+    {
+      return [this, members = std::move(members), address, n]
+        (MemberGenerator::yielder const& yield)
+        {
+          for (auto const& owner: owners(members, address, n))
+          {
+            ELLE_DEBUG("%s: yield %f", this, owner);
+            yield(this->_make_member(owner));
+          }
+        };
+    }
+
+    auto
+    Rendezvous::_lookup_node(Address id) const
+      -> WeakMember
+    {
+      auto it = this->_peers.find(id);
+      if (it != this->_peers.end())
+        return it->second;
+      auto member = std::find_if(
+        this->_members.begin(), this->_members.end(),
+        [&] (NodeLocation const& m) { return m.id() == id; });
+      if (member != this->_members.end())
+        return this->_make_member(*member);
+      return {};
+    }
+
+    auto
+    Rendezvous::_make_member(NodeLocation const& location) const
+      -> WeakMember
+    {
+      auto it = this->_peers.find(location.id());
+      if (it != this->_peers.end())
+        return it->second;
+      else
+        return this->doughnut()->dock().make_peer(location);
+    }
+
+    /*-----------.
+    | Monitoring |
+    `-----------*/
+
+    std::string
+    Rendezvous::type_name() const
+    {
+      return "rendezvous";
+    }
+
+    elle::json::Array
+    Rendezvous::peer_list() const
+    {
+      auto res = elle::json::Array{};
+      for (auto const& m: this->_members)
+        if (m.id() != this->id())
+          res.push_back(elle::json::Object{
+            { "id", elle::sprintf("%x", m.id()) },
+            { "endpoints", elle::sprintf("%s", m.endpoints()) },
+            { "connected", bool(this->_peers.count(m.id())) },
+          });
+      return res;
+    }
+
+    elle::json::Object
+    Rendezvous::stats() const
+    {
+      return {
+        {"type", this->type_name()},
+        {"members", this->_members.size()},
+        {"connected", this->_peers.size()},
+        {"disconnected", this->_disconnected.size()},
+      };
+    }
+
+    elle::json::Json
+    Rendezvous::query(std::string const& k,
+                      boost::optional<std::string> const& v)
+    {
+      if (k == "stats")
+      {
+        auto res = this->stats();
+        res["peers"] = this->peer_list();
+        return res;
+      }
+      return Super::query(k, v);
+    }
+
+    /*--------------.
+    | Configuration |
+    `--------------*/
+
+    RendezvousConfiguration::RendezvousConfiguration(
+      std::chrono::seconds eviction_delay)
+      : Super()
+      , eviction_delay(eviction_delay)
+    {}
+
+    RendezvousConfiguration::RendezvousConfiguration(
+      elle::serialization::SerializerIn& input)
+      : Super(input)
+    {
+      this->serialize(input);
+    }
+
+    void
+    RendezvousConfiguration::serialize(elle::serialization::Serializer& s)
+    {
+      Super::serialize(s);
+      s.serialize("eviction_delay", this->eviction_delay);
+    }
+
+    std::unique_ptr<infinit::overlay::Overlay>
+    RendezvousConfiguration::make(std::shared_ptr<model::doughnut::Local> local,
+                                  model::doughnut::Doughnut* dht)
+    {
+      return std::make_unique<Rendezvous>(
+        dht, std::move(local), this->eviction_delay);
+    }
+
+    namespace
+    {
+      auto const res =
+        elle::serialization::Hierarchy<Configuration>
+        ::Register<RendezvousConfiguration>("rendezvous");
+    }
+  }
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <chrono>
+#include <unordered_map>
+
+#include <elle/reactor/Thread.hh>
+
+#include <infinit/model/doughnut/Remote.hh>
+#include <infinit/overlay/Overlay.hh>
+
+namespace infinit
+{
+  namespace overlay
+  {
+    /// An overlay for mostly static clusters, placing blocks by rendezvous
+    /// hashing.
+    ///
+    /// Members rank storage nodes for a block by hashing their id with the
+    /// block address, the owners being the best ranked nodes. Lookups are
+    /// therefore computed locally: no network hop, no per-block state.
+    ///
+    /// Members are learned from peers upon connection and kept while
+    /// disconnected, until the eviction delay expires, so that short outages
+    /// do not change owners. Blocks do not move when members join: a new
+    /// member ranking first for a block stored before it joined does not hold
+    /// it, and fetches fall back to the next ranked members, see
+    /// Overlay::computed_placement. Mutable blocks are then redirected to
+    /// their Paxos quorum.
+    class Rendezvous
+      : public Overlay
+    {
+    /*------.
+    | Types |
+    `------*/
+    public:
+      using Self = Rendezvous;
+      using Super = Overlay;
+      using Address = model::Address;
+      using Local = model::doughnut::Local;
+      using Remote = model::doughnut::Remote;
+      using Clock = std::chrono::steady_clock;
+
+    /*-------------.
+    | Construction |
+    `-------------*/
+    public:
+      /// Construct a Rendezvous overlay.
+      ///
+      /// @arg dht             The owning Doughnut.
+      /// @arg local           The local server, null if pure client.
+      /// @arg eviction_delay  How long a disconnected member keeps its blocks.
+      Rendezvous(model::doughnut::Doughnut* dht,
+                 std::shared_ptr<Local> local,
+                 std::chrono::seconds eviction_delay);
+      ~Rendezvous() override;
+    protected:
+      void
+      _cleanup() override;
+    private:
+      void
+      _register_local(std::shared_ptr<Local> local);
+      ELLE_ATTRIBUTE(bool, cleaning);
+      ELLE_ATTRIBUTE(std::vector<boost::signals2::scoped_connection>,
+                     connections);
+
+    /*--------.
+    | Hashing |
+    `--------*/
+    public:
+      /// Rank of @a node for @a block, the higher the better. Identical on
+      /// every platform.
+      static
+      uint64_t
+      score(Address const& node, Address const& block);
+      /// The @a n best ranked of @a members for @a block, best first.
+      static
+      NodeLocations
+      owners(NodeLocations const& members, Address const& block, int n);
+
+    /*--------.
+    | Members |
+    `--------*/
+    public:
+      /// Storage nodes, including ourself if we serve blocks.
+      ELLE_ATTRIBUTE_R(NodeLocations, members);
+      /// Members and clients we are connected to, including ourself.
+      ELLE_ATTRIBUTE_R((std::unordered_map<Address, Member>), peers);
+      ELLE_ATTRIBUTE_R(std::chrono::seconds, eviction_delay);
+
+    protected:
+      void
+      _discover(NodeLocations const& peers) override;
+      bool
+      _discovered(Address id) override;
+    private:
+      /// Record @a locations as members.
+      void
+      _add_members(NodeLocations const& locations);
+      /// Exchange members with @a r.
+      void
+      _advertise(Remote& r);
+      void
+      _peer_connected(std::shared_ptr<Remote> peer);
+      void
+      _peer_disconnected(std::shared_ptr<Remote> peer);
+      /// Periodically reconnect to disconnected members and forget those
+      /// gone for longer than the eviction delay.
+      void
+      _evict();
+      bool
+      _member(Address const& id) const;
+      /// Disconnected members, by disconnection date.
+      ELLE_ATTRIBUTE((std::unordered_map<Address, Clock::time_point>),
+                     disconnected);
+      ELLE_ATTRIBUTE(elle::reactor::Thread::unique_ptr, evict_thread);
+
+    /*-------.
+    | Lookup |
+    `-------*/
+    public:
+      bool
+      computed_placement() const override;
+    protected:
+      MemberGenerator
+      _allocate(Address address, int n) const override;
+      MemberGenerator
+      _lookup(Address address, int n, bool fast) const override;
+      WeakMember
+      _lookup_node(Address address) const override;
+    private:
+      MemberGenerator
+      _owners(NodeLocations members, Address address, int n) const;
+      WeakMember
+      _make_member(NodeLocation const& location) const;
+
+    /*-----------.
+    | Monitoring |
+    `-----------*/
+    public:
+      std::string
+      type_name() const override;
+      elle::json::Array
+      peer_list() const override;
+      elle::json::Object
+      stats() const override;
+      elle::json::Json
+      query(std::string const& k,
+            boost::optional<std::string> const& v) override;
+    };
+
+    struct RendezvousConfiguration
+      : public Configuration
+    {
+      using Self = infinit::overlay::RendezvousConfiguration;
+      using Super = infinit::overlay::Configuration;
+
+      RendezvousConfiguration(
+        std::chrono::seconds eviction_delay = std::chrono::seconds{200 * 60});
+      RendezvousConfiguration(elle::serialization::SerializerIn& input);
+      ELLE_CLONABLE();
+      void
+      serialize(elle::serialization::Serializer& s) override;
+      std::unique_ptr<infinit::overlay::Overlay>
+      make(std::shared_ptr<model::doughnut::Local> local,
+           model::doughnut::Doughnut* doughnut) override;
+
+      std::chrono::seconds eviction_delay;
+    };
+  }
+}
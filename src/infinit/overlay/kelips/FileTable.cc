@@ -0,0 +1,474 @@
+#include <infinit/overlay/kelips/FileTable.hh>
+
+#include <algorithm>
+#include <cstring>
+
+#include <elle/assert.hh>
+
+namespace infinit
+{
+  namespace overlay
+  {
+    namespace kelips
+    {
+      namespace
+      {
+        /// Initial number of slots, must be a power of two.
+        auto const initial_capacity = std::size_t(16);
+
+        uint32_t
+        to_seconds(Time const& t)
+        {
+          auto const res = std::chrono::duration_cast<std::chrono::seconds>(
+            t.time_since_epoch()).count();
+          return uint32_t(std::max<decltype(res)>(
+            0, std::min<decltype(res)>(res, 0xffffffff)));
+        }
+
+        Time
+        from_seconds(uint32_t seconds)
+        {
+          return Time(std::chrono::seconds(seconds));
+        }
+
+        /// Append @a e, growing by a quarter rather than doubling: the table
+        /// is large and long lived, slack matters more than copies.
+        template <typename T>
+        void
+        push(std::vector<T>& v, T const& e)
+        {
+          if (v.size() == v.capacity())
+            v.reserve(v.capacity() + v.capacity() / 4 + 16);
+          v.push_back(e);
+        }
+      }
+
+      FileTable::Index constexpr FileTable::none;
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+
+      FileTable::FileTable()
+        : _size(0)
+        , _slots(initial_capacity, none)
+        , _free_replicas(none)
+      {}
+
+      /*--------.
+      | Content |
+      `--------*/
+
+      bool
+      FileTable::insert(File const& file)
+      {
+        if (this->_replica(file.address, file.home_node))
+          return false;
+        // Keep the load factor under 75%.
+        if ((this->_entries.size() + 1) * 4 > this->_slots.size() * 3)
+          this->_grow();
+        auto const home = this->_intern(file.home_node);
+        auto& slot = this->_slots[this->_find(file.address.value())];
+        if (slot == none)
+        {
+          auto entry = Entry{};
+          std::memcpy(entry.address, file.address.value(),
+                      sizeof(Address::Value));
+          entry.head = none;
+          slot = Index(this->_entries.size());
+          push(this->_entries, entry);
+        }
+        auto const replica = Replica{
+          this->_entries[slot].head,
+          home,
+          to_seconds(file.last_seen),
+          to_seconds(file.last_gossip),
+          uint16_t(std::min(std::max(file.gossip_count, 0), 0xffff)),
+        };
+        auto index = this->_free_replicas;
+        if (index == none)
+        {
+          index = Index(this->_replicas.size());
+          push(this->_replicas, replica);
+        }
+        else
+        {
+          this->_free_replicas = this->_replicas[index].next;
+          this->_replicas[index] = replica;
+        }
+        this->_entries[slot].head = index;
+        ++this->_node_sizes[home];
+        ++this->_size;
+        return true;
+      }
+
+      bool
+      FileTable::erase(Address const& file, Address const& home)
+      {
+        auto it = this->_node_indexes.find(home);
+        if (it == this->_node_indexes.end())
+          return false;
+        auto const slot = this->_slots[this->_find(file.value())];
+        if (slot == none)
+          return false;
+        for (auto* link = &this->_entries[slot].head;
+             *link != none;
+             link = &this->_replicas[*link].next)
+          if (this->_replicas[*link].home == it->second)
+          {
+            this->_remove_replica(*link);
+            if (this->_entries[slot].head == none)
+              this->_remove_entry(slot);
+            return true;
+          }
+        return false;
+      }
+
+      int
+      FileTable::erase_if(std::function<bool (File const&)> const& predicate)
+      {
+        auto res = 0;
+        // Walk backward so removed entries are replaced by visited ones.
+        for (auto position = Index(this->_entries.size()); position-- > 0;)
+        {
+          auto* link = &this->_entries[position].head;
+          while (*link != none)
+            if (predicate(this->_file(this->_entries[position],
+                                      this->_replicas[*link])))
+            {
+              this->_remove_replica(*link);
+              ++res;
+            }
+            else
+              link = &this->_replicas[*link].next;
+          if (this->_entries[position].head == none)
+            this->_remove_entry(position);
+        }
+        return res;
+      }
+
+      void
+      FileTable::clear()
+      {
+        this->_size = 0;
+        this->_slots = std::vector<Index>(initial_capacity, none);
+        this->_entries.clear();
+        this->_replicas.clear();
+        this->_free_replicas = none;
+        this->_nodes.clear();
+        this->_node_sizes.clear();
+        this->_node_indexes.clear();
+        this->_free_nodes.clear();
+      }
+
+      bool
+      FileTable::contains(Address const& file, Address const& home) const
+      {
+        return bool(this->find(file, home));
+      }
+
+      boost::optional<File>
+      FileTable::find(Address const& file, Address const& home) const
+      {
+        auto it = this->_node_indexes.find(home);
+        if (it == this->_node_indexes.end())
+          return boost::none;
+        if (auto const entry = this->_entry(file))
+          for (auto i = entry->head; i != none; i = this->_replicas[i].next)
+            if (this->_replicas[i].home == it->second)
+              return this->_file(*entry, this->_replicas[i]);
+        return boost::none;
+      }
+
+      std::vector<File>
+      FileTable::replicas(Address const& file) const
+      {
+        auto res = std::vector<File>{};
+        if (auto const entry = this->_entry(file))
+          for (auto i = entry->head; i != none; i = this->_replicas[i].next)
+            res.emplace_back(this->_file(*entry, this->_replicas[i]));
+        return res;
+      }
+
+      int
+      FileTable::count(Address const& file) const
+      {
+        auto res = 0;
+        if (auto const entry = this->_entry(file))
+          for (auto i = entry->head; i != none; i = this->_replicas[i].next)
+            ++res;
+        return res;
+      }
+
+      bool
+      FileTable::seen(Address const& file, Address const& home, Time time)
+      {
+        if (auto replica = this->_replica(file, home))
+        {
+          replica->last_seen = std::max(replica->last_seen, to_seconds(time));
+          return true;
+        }
+        return false;
+      }
+
+      void
+      FileTable::seen(Address const& home, Time time)
+      {
+        auto it = this->_node_indexes.find(home);
+        if (it == this->_node_indexes.end())
+          return;
+        auto const t = to_seconds(time);
+        for (auto& r: this->_replicas)
+          if (r.home == it->second)
+            r.last_seen = std::max(r.last_seen, t);
+      }
+
+      bool
+      FileTable::gossiped(Address const& file, Address const& home, Time time)
+      {
+        if (auto replica = this->_replica(file, home))
+        {
+          if (replica->gossip_count < 0xffff)
+            ++replica->gossip_count;
+          replica->last_gossip = to_seconds(time);
+          return true;
+        }
+        return false;
+      }
+
+      FileTable::const_iterator
+      FileTable::begin() const
+      {
+        return const_iterator(*this, 0);
+      }
+
+      FileTable::const_iterator
+      FileTable::end() const
+      {
+        return const_iterator(*this, Index(this->_entries.size()));
+      }
+
+      std::size_t
+      FileTable::files_count() const
+      {
+        return this->_entries.size();
+      }
+
+      /*-----------.
+      | Monitoring |
+      `-----------*/
+
+      std::size_t
+      FileTable::footprint() const
+      {
+        // Hash map nodes cost a next pointer and the cached hash on top of the
+        // value.
+        auto const node_overhead = 2 * sizeof(void*);
+        auto res = sizeof(*this);
+        res += this->_slots.capacity() * sizeof(Index);
+        res += this->_entries.capacity() * sizeof(Entry);
+        res += this->_replicas.capacity() * sizeof(Replica);
+        res += this->_nodes.capacity() * sizeof(Address);
+        res += this->_node_sizes.capacity() * sizeof(std::size_t);
+        res += this->_node_indexes.bucket_count() * sizeof(void*);
+        res += this->_node_indexes.size() *
+          (sizeof(decltype(this->_node_indexes)::value_type) + node_overhead);
+        res += this->_free_nodes.capacity() * sizeof(NodeIndex);
+        return res;
+      }
+
+      /*--------.
+      | Details |
+      `--------*/
+
+      File
+      FileTable::_file(Entry const& entry, Replica const& replica) const
+      {
+        // Flags are recovered from the address itself, as when deserializing.
+        return File{
+          Address(entry.address),
+          this->_nodes[replica.home],
+          from_seconds(replica.last_seen),
+          from_seconds(replica.last_gossip),
+          replica.gossip_count,
+        };
+      }
+
+      uint64_t
+      FileTable::_hash(Address::Value const& file)
+      {
+        // Addresses are mostly hashes already, only mix their first bytes in
+        // case they are not.
+        uint64_t a;
+        uint64_t b;
+        std::memcpy(&a, file, sizeof a);
+        std::memcpy(&b, file + sizeof a, sizeof b);
+        auto h = (a ^ (b * 0x9e3779b97f4a7c15ull)) * 0x9e3779b97f4a7c15ull;
+        return h ^ (h >> 32);
+      }
+
+      std::size_t
+      FileTable::_home(Address::Value const& file) const
+      {
+        return _hash(file) & (this->_slots.size() - 1);
+      }
+
+      std::size_t
+      FileTable::_find(Address::Value const& file) const
+      {
+        auto const mask = this->_slots.size() - 1;
+        auto pos = this->_home(file);
+        while (this->_slots[pos] != none &&
+               std::memcmp(this->_entries[this->_slots[pos]].address, file,
+                           sizeof(Address::Value)) != 0)
+          pos = (pos + 1) & mask;
+        return pos;
+      }
+
+      FileTable::Entry const*
+      FileTable::_entry(Address const& file) const
+      {
+        auto const slot = this->_slots[this->_find(file.value())];
+        if (slot == none)
+          return nullptr;
+        return &this->_entries[slot];
+      }
+
+      FileTable::Replica*
+      FileTable::_replica(Address const& file, Address const& home)
+      {
+        auto it = this->_node_indexes.find(home);
+        if (it == this->_node_indexes.end())
+          return nullptr;
+        if (auto const entry = this->_entry(file))
+          for (auto i = entry->head; i != none; i = this->_replicas[i].next)
+            if (this->_replicas[i].home == it->second)
+              return &this->_replicas[i];
+        return nullptr;
+      }
+
+      void
+      FileTable::_remove_replica(Index& link)
+      {
+        auto const index = link;
+        auto& replica = this->_replicas[index];
+        link = replica.next;
+        if (--this->_node_sizes[replica.home] == 0)
+          this->_release(replica.home);
+        replica.next = this->_free_replicas;
+        this->_free_replicas = index;
+        --this->_size;
+      }
+
+      void
+      FileTable::_remove_entry(Index position)
+      {
+        auto const mask = this->_slots.size() - 1;
+        // Backward shift deletion: move back following slots of the cluster
+        // unless that would put them before their home slot.
+        auto hole = this->_find(this->_entries[position].address);
+        ELLE_ASSERT_EQ(this->_slots[hole], position);
+        for (auto i = (hole + 1) & mask;
+             this->_slots[i] != none;
+             i = (i + 1) & mask)
+        {
+          auto const home = this->_home(this->_entries[this->_slots[i]].address);
+          if (((i - home) & mask) >= ((i - hole) & mask))
+          {
+            this->_slots[hole] = this->_slots[i];
+            hole = i;
+          }
+        }
+        this->_slots[hole] = none;
+        // Keep entries dense: move the last one in the hole.
+        auto const last = Index(this->_entries.size() - 1);
+        if (position != last)
+        {
+          this->_slots[this->_find(this->_entries[last].address)] = position;
+          this->_entries[position] = this->_entries[last];
+        }
+        this->_entries.pop_back();
+      }
+
+      void
+      FileTable::_grow()
+      {
+        this->_slots = std::vector<Index>(this->_slots.size() * 2, none);
+        for (auto i = Index(0); i < this->_entries.size(); ++i)
+          this->_slots[this->_find(this->_entries[i].address)] = i;
+      }
+
+      FileTable::NodeIndex
+      FileTable::_intern(Address const& node)
+      {
+        auto it = this->_node_indexes.find(node);
+        if (it != this->_node_indexes.end())
+          return it->second;
+        auto index = NodeIndex(0);
+        if (this->_free_nodes.empty())
+        {
+          index = NodeIndex(this->_nodes.size());
+          this->_nodes.emplace_back(node);
+          this->_node_sizes.emplace_back(0);
+        }
+        else
+        {
+          index = this->_free_nodes.back();
+          this->_free_nodes.pop_back();
+          this->_nodes[index] = node;
+          this->_node_sizes[index] = 0;
+        }
+        this->_node_indexes.emplace(node, index);
+        return index;
+      }
+
+      void
+      FileTable::_release(NodeIndex node)
+      {
+        this->_node_indexes.erase(this->_nodes[node]);
+        this->_free_nodes.emplace_back(node);
+      }
+
+      /*---------.
+      | Iterator |
+      `---------*/
+
+      FileTable::const_iterator::const_iterator(FileTable const& table,
+                                                Index entry)
+        : _table(&table)
+        , _entry(entry)
+        , _replica(entry < table._entries.size() ?
+                   table._entries[entry].head : none)
+      {}
+
+      File
+      FileTable::const_iterator::operator *() const
+      {
+        return this->_table->_file(this->_table->_entries[this->_entry],
+                                   this->_table->_replicas[this->_replica]);
+      }
+
+      FileTable::const_iterator&
+      FileTable::const_iterator::operator ++()
+      {
+        this->_replica = this->_table->_replicas[this->_replica].next;
+        if (this->_replica == none &&
+            ++this->_entry < this->_table->_entries.size())
+          this->_replica = this->_table->_entries[this->_entry].head;
+        return *this;
+      }
+
+      bool
+      FileTable::const_iterator::operator ==(const_iterator const& other) const
+      {
+        return this->_entry == other._entry && this->_replica == other._replica;
+      }
+
+      bool
+      FileTable::const_iterator::operator !=(const_iterator const& other) const
+      {
+        return !(*this == other);
+      }
+    }
+  }
+}
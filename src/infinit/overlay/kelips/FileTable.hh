@@ -0,0 +1,212 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <elle/attribute.hh>
+
+#include <infinit/model/Address.hh>
+
+namespace infinit
+{
+  namespace overlay
+  {
+    namespace kelips
+    {
+      using Time = std::chrono::time_point<std::chrono::system_clock>;
+
+      /// A replica of a file, as known by the group.
+      struct File
+      {
+        model::Address address;
+        model::Address home_node;
+        Time last_seen;
+        Time last_gossip;
+        int gossip_count;
+      };
+
+      /// The files of a group and their home nodes.
+      ///
+      /// Files are stored densely, indexed by an open addressing table of
+      /// 32-bit positions. Each file heads a chain of replicas, one per home
+      /// node. Home nodes are interned as 32-bit indexes and times are kept
+      /// with a one second resolution, so a replica costs 20 bytes on top of
+      /// the 36 bytes of its file, where a multimap of File costs more than
+      /// 150 bytes per replica.
+      ///
+      /// Entries are handed out as File values, times and gossip counts are
+      /// updated through seen and gossiped.
+      class FileTable
+      {
+      /*------.
+      | Types |
+      `------*/
+      public:
+        using Self = FileTable;
+        using Address = model::Address;
+        class const_iterator;
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+      public:
+        FileTable();
+
+      /*--------.
+      | Content |
+      `--------*/
+      public:
+        /// Record the replica @a file, unless its home node is already known
+        /// to hold it.
+        ///
+        /// @return Whether the entry was added.
+        bool
+        insert(File const& file);
+        /// Forget that @a home holds @a file.
+        ///
+        /// @return Whether the entry existed.
+        bool
+        erase(Address const& file, Address const& home);
+        /// Forget every entry matching @a predicate.
+        ///
+        /// @return The number of entries removed.
+        int
+        erase_if(std::function<bool (File const&)> const& predicate);
+        void
+        clear();
+        bool
+        contains(Address const& file, Address const& home) const;
+        boost::optional<File>
+        find(Address const& file, Address const& home) const;
+        /// The replicas of @a file.
+        std::vector<File>
+        replicas(Address const& file) const;
+        /// The number of replicas of @a file.
+        int
+        count(Address const& file) const;
+        /// Raise the last seen time of @a file on @a home to @a time.
+        ///
+        /// @return Whether the entry exists.
+        bool
+        seen(Address const& file, Address const& home, Time time);
+        /// Raise the last seen time of all files on @a home to @a time.
+        void
+        seen(Address const& home, Time time);
+        /// Account for @a file on @a home being gossiped at @a time.
+        ///
+        /// @return Whether the entry exists.
+        bool
+        gossiped(Address const& file, Address const& home, Time time);
+        const_iterator
+        begin() const;
+        const_iterator
+        end() const;
+        /// Number of distinct files.
+        std::size_t
+        files_count() const;
+        /// Number of (file, home node) entries.
+        ELLE_ATTRIBUTE_R(std::size_t, size);
+
+      /*-----------.
+      | Monitoring |
+      `-----------*/
+      public:
+        /// Approximate number of bytes used.
+        std::size_t
+        footprint() const;
+
+      /*--------.
+      | Details |
+      `--------*/
+      private:
+        using Index = uint32_t;
+        using NodeIndex = uint32_t;
+        static Index constexpr none = 0xffffffff;
+        struct Entry
+        {
+          Address::Value address;
+          Index head;
+        };
+        struct Replica
+        {
+          Index next;
+          NodeIndex home;
+          /// Seconds since the epoch.
+          uint32_t last_seen;
+          uint32_t last_gossip;
+          uint16_t gossip_count;
+        };
+        File
+        _file(Entry const& entry, Replica const& replica) const;
+        static
+        uint64_t
+        _hash(Address::Value const& file);
+        std::size_t
+        _home(Address::Value const& file) const;
+        /// Position in the slots of @a file, or of the free slot to insert it.
+        std::size_t
+        _find(Address::Value const& file) const;
+        /// The entry of @a file, if any.
+        Entry const*
+        _entry(Address const& file) const;
+        /// The replica of @a file on @a home, if any.
+        Replica*
+        _replica(Address const& file, Address const& home);
+        /// Unlink and free @a replica, following @a link.
+        void
+        _remove_replica(Index& link);
+        /// Remove the file at @a position of the dense entries.
+        void
+        _remove_entry(Index position);
+        void
+        _grow();
+        NodeIndex
+        _intern(Address const& node);
+        void
+        _release(NodeIndex node);
+        /// Positions in the entries, none for free slots.
+        ELLE_ATTRIBUTE(std::vector<Index>, slots);
+        ELLE_ATTRIBUTE(std::vector<Entry>, entries);
+        ELLE_ATTRIBUTE(std::vector<Replica>, replicas);
+        /// Head of the free replicas list, chained through next.
+        ELLE_ATTRIBUTE(Index, free_replicas);
+        ELLE_ATTRIBUTE(std::vector<Address>, nodes);
+        /// Number of entries per node, to recycle indexes.
+        ELLE_ATTRIBUTE(std::vector<std::size_t>, node_sizes);
+        ELLE_ATTRIBUTE((std::unordered_map<Address, NodeIndex>), node_indexes);
+        ELLE_ATTRIBUTE(std::vector<NodeIndex>, free_nodes);
+      };
+
+      /// Iterator over the entries of a FileTable, yielding File values.
+      class FileTable::const_iterator
+      {
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = File;
+        using difference_type = std::ptrdiff_t;
+        using pointer = File const*;
+        using reference = File;
+        const_iterator(FileTable const& table, Index entry);
+        File
+        operator *() const;
+        const_iterator&
+        operator ++();
+        bool
+        operator ==(const_iterator const& other) const;
+        bool
+        operator !=(const_iterator const& other) const;
+
+      private:
+        ELLE_ATTRIBUTE(FileTable const*, table);
+        ELLE_ATTRIBUTE(Index, entry);
+        ELLE_ATTRIBUTE(Index, replica);
+      };
+    }
+  }
+}
@@ -19,6 +19,7 @@
 
 #include <elle/algorithm.hh>
 #include <elle/bench.hh>
+#include <elle/err.hh>
 #include <elle/find.hh>
 #include <elle/make-vector.hh>
 #include <elle/network/Interface.hh>
@@ -247,6 +248,8 @@ namespace infinit
       {
         static auto disable_compression
           = elle::os::getenv("KELIPS_DISABLE_COMPRESSION", false);
+        static auto disable_compact
+          = elle::os::getenv("KELIPS_DISABLE_COMPACT", false);
         struct CompressPeerLocations{};
 
         template<typename T>
@@ -793,6 +796,104 @@ namespace infinit
         REGISTER(PutFileReply, "putReply");
 
 #undef REGISTER
+
+        /*--------------.
+        | Compact codec |
+        `--------------*/
+
+        // Frame types of the compact wire format. The sender and observer
+        // flag are carried once per datagram.
+        enum class Compact: uint8_t
+        {
+          ping = 1,
+          pong = 2,
+          gossip = 3,
+          get = 4,
+        };
+
+        /// Append @a p to @a w as a compact frame.
+        ///
+        /// @return Whether @a p has a compact form.
+        static
+        bool
+        compact_write(wire::Writer& w, Packet const& p)
+        {
+          // Match exact types: Pong is a Ping and PutFileRequest a
+          // GetFileRequest.
+          auto const& type = typeid(p);
+          if (type == typeid(Ping))
+            w.end_frame(w.begin_frame(uint8_t(Compact::ping)));
+          else if (type == typeid(Pong))
+          {
+            auto frame = w.begin_frame(uint8_t(Compact::pong));
+            w.endpoint(static_cast<Pong const&>(p).remote_endpoint);
+            w.end_frame(frame);
+          }
+          else if (type == typeid(Gossip))
+          {
+            auto const& g = static_cast<Gossip const&>(p);
+            auto frame = w.begin_frame(uint8_t(Compact::gossip));
+            w.contacts(g.contacts);
+            w.files(g.files);
+            w.end_frame(frame);
+          }
+          else if (type == typeid(GetFileRequest))
+          {
+            auto const& r = static_cast<GetFileRequest const&>(p);
+            auto frame = w.begin_frame(uint8_t(Compact::get));
+            w.svarint(r.request_id);
+            w.address(r.originAddress);
+            w.endpoints(r.originEndpoints);
+            w.address(r.fileAddress);
+            w.svarint(r.ttl);
+            w.svarint(r.count);
+            w.locations(r.result);
+            w.byte(r.query_node);
+            w.end_frame(frame);
+          }
+          else
+            return false;
+          return true;
+        }
+
+        /// Decode a compact frame of type @a type.
+        static
+        std::unique_ptr<Packet>
+        compact_read(uint8_t type, wire::Reader& r)
+        {
+          switch (Compact(type))
+          {
+            case Compact::ping:
+              return std::make_unique<Ping>();
+            case Compact::pong:
+            {
+              auto res = std::make_unique<Pong>();
+              res->remote_endpoint = r.endpoint();
+              return std::move(res);
+            }
+            case Compact::gossip:
+            {
+              auto res = std::make_unique<Gossip>();
+              res->contacts = r.contacts();
+              res->files = r.files();
+              return std::move(res);
+            }
+            case Compact::get:
+            {
+              auto res = std::make_unique<GetFileRequest>();
+              res->request_id = r.svarint();
+              res->originAddress = r.address();
+              res->originEndpoints = r.endpoints();
+              res->fileAddress = r.address();
+              res->ttl = r.svarint();
+              res->count = r.svarint();
+              res->result = r.locations();
+              res->query_node = r.byte();
+              return std::move(res);
+            }
+          }
+          elle::err("unknown compact Kelips packet type: %s", int(type));
+        }
       }
 
       struct PendingRequest
@@ -837,6 +938,23 @@ namespace infinit
         }
       }
 
+      namespace
+      {
+        using elle::os::getenv;
+        /// Datagram size above which queued compact packets are sent.
+        auto const batch_size = getenv("INFINIT_KELIPS_BATCH_SIZE", 1200);
+        /// How long compact packets wait for others to the same peer. With
+        /// 0, packets sent during the same scheduler round are grouped.
+        auto const batch_delay_ms = getenv("INFINIT_KELIPS_BATCH_DELAY_MS", 0);
+        auto const flag_encrypted = uint8_t(1);
+        auto const flag_observer = uint8_t(2);
+        /// Number of threads handling received packets.
+        auto const workers_count = getenv("INFINIT_KELIPS_WORKERS", 4);
+        /// Received packets waiting for the workers, above which gossip and
+        /// requests are dropped. Shared evenly between the workers.
+        auto const queue_size = getenv("INFINIT_KELIPS_QUEUE_SIZE", 1024);
+      }
+
       Node::Node(Configuration const& config,
                  std::shared_ptr<Local> local,
                  infinit::model::doughnut::Doughnut* doughnut)
@@ -894,7 +1012,7 @@ namespace infinit
                       res.first.emplace(c.second.address,
                                         to_endpoints(c.second.endpoints));
                   for (auto const& f: this->_state.files)
-                    res.second.emplace_back(f.second.address, f.second.home_node);
+                    res.second.emplace_back(f.address, f.home_node);
                   // OH THE UGLY HACK, we need a place to store our own address
                   res.second.emplace_back(Address::null, _self);
                   return res;
@@ -915,7 +1033,7 @@ namespace infinit
                     }
                   auto ofiles = std::multimap<Address, Address>{}; // ordered fileId -> owner
                   for (auto const& f: this->_state.files)
-                    ofiles.emplace(f.second.address, f.second.home_node);
+                    ofiles.emplace(f.address, f.home_node);
                   auto prev = Address::null;
                   for (auto const& f: ofiles)
                   {
@@ -983,8 +1101,12 @@ namespace infinit
         ELLE_TRACE_SCOPE("%s: destruct", this);
         this->_terminating = true;
         this->doughnut()->dock().utp_server().socket()->unregister_reader("KELIPSGS");
+        this->doughnut()->dock().utp_server().socket()->unregister_reader(
+          std::string(wire::magic, sizeof wire::magic));
         _emitter_thread.reset();
         _pinger_thread.reset();
+        this->_batch_flusher.reset();
+        this->_workers.clear();
         elle::reactor::wait(_in_use);
         this->_state.contacts.clear();
       }
@@ -1067,15 +1189,18 @@ namespace infinit
       }
 
       void
-      Node::onPacket(elle::ConstWeakBuffer nbuf, Endpoint source)
+      Node::onPacket(elle::ConstWeakBuffer nbuf, Endpoint source, bool compact)
       {
         auto lock = this->_in_use.lock();
         ELLE_DUMP("Received %s bytes packet from %s", nbuf.size(), source);
-        auto buf = elle::Buffer(nbuf.contents()+8, nbuf.size()-8);
-        static auto async = elle::os::getenv("INFINIT_KELIPS_ASYNC", false);
-        elle::reactor::run(async,
-                           "process",
-                           [=] { this->process(buf, source);});
+        // Packets are decoded and authenticated here, then handled by the
+        // workers.
+        if (compact)
+          // Packets are decoded before any yield, no need to copy.
+          this->_process_compact(nbuf.range(8), source);
+        else
+          this->process(elle::Buffer(nbuf.contents()+8, nbuf.size()-8),
+                        source);
       }
 
       void
@@ -1188,11 +1313,30 @@ namespace infinit
         ELLE_TRACE_SCOPE("%s: start serving", this);
         if (!_observer)
           this->bootstrap();
+        auto const workers = std::max(1, workers_count);
+        // Round up so every worker can queue at least one packet.
+        auto const capacity = std::max(1, (queue_size + workers - 1) / workers);
+        for (int i = 0; i < workers; ++i)
+        {
+          this->_queues.emplace_back(
+            std::make_unique<PacketQueue<QueuedPacket>>(capacity));
+          auto& queue = *this->_queues.back();
+          this->_workers.emplace_back(
+            new elle::reactor::Thread(
+              elle::sprintf("worker %s", i),
+              [this, &queue] { this->_worker(queue); }));
+        }
         this->doughnut()->dock().utp_server().socket()->register_reader(
           "KELIPSGS", [this](elle::ConstWeakBuffer nbuf, Endpoint source)
           {
             this->onPacket(nbuf, source);
           });
+        this->doughnut()->dock().utp_server().socket()->register_reader(
+          std::string(wire::magic, sizeof wire::magic),
+          [this](elle::ConstWeakBuffer nbuf, Endpoint source)
+          {
+            this->onPacket(nbuf, source, true);
+          });
         ELLE_LOG("%s: listening on %s",
           this, this->doughnut()->dock().utp_server().local_endpoint());
         this->_pinger_thread.reset(
@@ -1275,6 +1419,16 @@ namespace infinit
         elle::Buffer b;
         bool send_key_request = false;
         auto key = getKey(address);
+        // Once the peer is reachable and keys are exchanged, batch frequent
+        // packets in compact datagrams.
+        if (!is_crypto && this->_compact() && p.sender == this->_self &&
+            (!this->_config.encrypt || key.first))
+        {
+          auto const target = ep ? ep :
+            c->validated_endpoint ? &c->validated_endpoint->first : nullptr;
+          if (target && this->_send_compact(p, address, *target))
+            return;
+        }
         if (is_crypto
             || !_config.encrypt
             || (!key.first && _config.accept_plain)
@@ -1586,18 +1740,24 @@ namespace infinit
           onContactSeen(packet->sender, source, packet->observer);
           return;
         } // keyreply
+        this->_enqueue(std::move(packet), source, was_crypted);
+      }
+
+      void
+      Node::dispatch(packet::Packet& packet, Endpoint source, bool was_crypted)
+      {
         if (!was_crypted && !_config.accept_plain)
         {
           ELLE_WARN("%s: rejecting plain packet from %s : %s",
-            *this, source, packet->sender);
+            *this, source, packet.sender);
           return;
         }
 
-        onContactSeen(packet->sender, source, packet->observer);
+        onContactSeen(packet.sender, source, packet.observer);
         // TRAP: some packets inherit from each other, so most specific ones
         // must be first
         #define CASE(type) \
-        else if (packet::type* p = dynamic_cast<packet::type*>(packet.get()))
+        else if (packet::type* p = dynamic_cast<packet::type*>(&packet))
           if (false) {}
         CASE(Pong)
         {
@@ -1630,30 +1790,302 @@ namespace infinit
         CASE(GetFileReply)
         onGetFileReply(p);
         else
-          ELLE_WARN("%s: Unknown packet type %s", *this, typeid(*p).name());
+          ELLE_WARN("%s: Unknown packet type %s", *this, typeid(packet).name());
         #undef CASE
-      };
+      }
+
+      /*---------------.
+      | Compact format |
+      `---------------*/
+
+      bool
+      Node::_compact() const
+      {
+        return !packet::disable_compact &&
+          this->doughnut()->version() >= elle::Version(0, 9, 0);
+      }
+
+      bool
+      Node::_send_compact(packet::Packet const& p,
+                          Address const& address,
+                          Endpoint const& endpoint)
+      {
+        auto it = this->_batches.find(address);
+        if (it != this->_batches.end() && it->second.endpoint != endpoint)
+        {
+          this->_flush(address);
+          it = this->_batches.find(address);
+        }
+        if (it == this->_batches.end())
+          it = this->_batches.emplace(
+            address, Batch{endpoint, this->_buffers.acquire(), 0}).first;
+        auto& batch = it->second;
+        auto const previous = batch.frames.size();
+        auto w = wire::Writer(batch.frames);
+        auto written = false;
+        try
+        {
+          written = packet::compact_write(w, p);
+        }
+        catch (elle::Error const& e)
+        {
+          // The partial frame was dropped, use the generic encoding.
+          ELLE_DEBUG("%s: unable to encode %s compactly: %s",
+                     this, typeid(p).name(), e);
+        }
+        if (!written)
+        {
+          if (batch.count == 0)
+          {
+            this->_buffers.release(std::move(batch.frames));
+            this->_batches.erase(it);
+          }
+          return false;
+        }
+        ++batch.count;
+        if (signed(batch.frames.size()) > batch_size && previous != 0)
+        {
+          // Send what was queued before and keep the new frame for the next
+          // datagram.
+          auto next = this->_buffers.acquire();
+          next.append(batch.frames.contents() + previous,
+                      batch.frames.size() - previous);
+          batch.frames.size(previous);
+          --batch.count;
+          auto full = std::move(batch);
+          it->second = Batch{endpoint, std::move(next), 1};
+          this->_send_batch(address, std::move(full));
+        }
+        if (!this->_batch_flusher || this->_batch_flusher->done())
+          this->_batch_flusher.reset(new elle::reactor::Thread(
+            "flusher",
+            [this]
+            {
+              if (batch_delay_ms > 0)
+                elle::reactor::sleep(
+                  boost::posix_time::milliseconds(batch_delay_ms));
+              else
+                elle::reactor::yield();
+              while (!this->_batches.empty())
+                this->_flush(this->_batches.begin()->first);
+            }));
+        return true;
+      }
 
-      template <typename T, typename C, typename U>
       void
-      filterAndInsert(std::vector<Address> files, int target_count,
-                      std::unordered_map<Address, std::pair<Time, T>>& res,
-                      C& data,
-                      T U::*access)
+      Node::_flush(Address address)
       {
-        if (signed(files.size()) > target_count)
+        auto it = this->_batches.find(address);
+        if (it == this->_batches.end())
+          return;
+        auto batch = std::move(it->second);
+        this->_batches.erase(it);
+        this->_send_batch(address, std::move(batch));
+      }
+
+      void
+      Node::_send_batch(Address const& address, Batch batch)
+      {
+        auto datagram = this->_buffers.acquire();
+        auto w = wire::Writer(datagram);
+        w.raw(wire::magic, sizeof wire::magic);
+        w.address(this->_self);
+        auto const observer = this->_observer ? flag_observer : uint8_t(0);
+        if (this->_config.encrypt)
+        {
+          auto key = this->getKey(address);
+          if (!key.first)
+          {
+            ELLE_DEBUG("%s: dropping %s packets to %s: no key available",
+                       this, batch.count, address);
+            this->_buffers.release(std::move(batch.frames));
+            this->_buffers.release(std::move(datagram));
+            return;
+          }
+          w.byte(flag_encrypted | observer);
+          static auto bench = elle::Bench("kelips.encrypt", 10s);
+          elle::Bench::BenchScope bs(bench);
+          auto const cipher = key.first->encipher(
+            batch.frames,
+            elle::cryptography::Cipher::aes256,
+            elle::cryptography::Mode::cbc,
+            elle::cryptography::Oneway::sha256);
+          w.raw(cipher.contents(), cipher.size());
+        }
+        else
         {
-          if (target_count < signed(files.size()) - target_count)
-            files = pick_n(files, target_count);
+          w.byte(observer);
+          w.raw(batch.frames.contents(), batch.frames.size());
+        }
+        this->_buffers.release(std::move(batch.frames));
+        {
+          static auto bench = elle::Bench("kelips.batch_count", 5s);
+          bench.add(batch.count);
+        }
+        {
+          static auto bench = elle::Bench("kelips.packet_size", 5s);
+          bench.add(datagram.size());
+        }
+        ELLE_DUMP("%s: sending %s packets in %s bytes to %s",
+                  this, batch.count, datagram.size(), batch.endpoint);
+        {
+          elle::reactor::Lock l(_udp_send_mutex);
+          auto& sock = this->doughnut()->dock().utp_server().socket();
+          try
+          {
+            sock->send_to(elle::ConstWeakBuffer(datagram),
+                          batch.endpoint.udp());
+          }
+          catch (elle::reactor::network::Error const& e)
+          {
+            ELLE_TRACE("network exception sending to %s: %s",
+                       batch.endpoint, e);
+          }
+        }
+        this->_buffers.release(std::move(datagram));
+      }
+
+      void
+      Node::_process_compact(elle::ConstWeakBuffer buf, Endpoint source)
+      {
+        auto packets = std::vector<std::unique_ptr<packet::Packet>>{};
+        auto sender = Address();
+        auto encrypted = false;
+        // Whether the sender key was exchanged as an observer.
+        auto observer_key = false;
+        try
+        {
+          auto header = wire::Reader(buf);
+          sender = header.address();
+          auto const flags = header.byte();
+          encrypted = flags & flag_encrypted;
+          auto const observer = bool(flags & flag_observer);
+          auto plain = elle::Buffer();
+          auto frames = header;
+          if (encrypted)
+          {
+            auto key = this->getKey(sender);
+            if (!key.first)
+            {
+              ELLE_WARN("%s: key unknown for %s : %s", this, source, sender);
+              packet::RequestKey rk(make_key_request());
+              send(rk, source, sender);
+              return;
+            }
+            observer_key = key.second;
+            if (observer < key.second)
+            {
+              ELLE_WARN("%s: sender %s is observer and sent a misflaged packet",
+                        this, sender);
+              return;
+            }
+            try
+            {
+              static elle::Bench bench("kelips.decrypt", 10s);
+              elle::Bench::BenchScope bs(bench);
+              plain = key.first->decipher(
+                header.rest(),
+                elle::cryptography::Cipher::aes256,
+                elle::cryptography::Mode::cbc,
+                elle::cryptography::Oneway::sha256);
+            }
+            catch (elle::cryptography::Error const& e)
+            {
+              ELLE_DEBUG("%s: decryption with %s from %s : %s failed: %s",
+                         this, key_hash(*key.first), source, sender, e);
+              packet::RequestKey rk(make_key_request());
+              send(rk, source, sender);
+              return;
+            }
+            frames = wire::Reader(plain);
+          }
+          while (!frames.empty())
+          {
+            uint8_t type;
+            auto payload = frames.frame(type);
+            auto p = packet::compact_read(type, payload);
+            if (observer_key && dynamic_cast<packet::Gossip*>(p.get()))
+            {
+              ELLE_WARN("%s: sender %s is observer and sent a non-observer "
+                        "packet", this, sender);
+              return;
+            }
+            p->sender = sender;
+            p->observer = observer;
+            p->endpoint = source;
+            packets.emplace_back(std::move(p));
+          }
+        }
+        catch (elle::Error const& e)
+        {
+          ELLE_WARN("%s: failed to decode compact packet from %s: %s",
+                    this, source, e);
+          return;
+        }
+        for (auto& p: packets)
+          this->_enqueue(std::move(p), source, encrypted);
+      }
+
+      /*-----------------.
+      | Packet pipeline  |
+      `-----------------*/
+
+      namespace
+      {
+        PacketClass
+        packet_class(packet::Packet const& p)
+        {
+          if (dynamic_cast<packet::Pong const*>(&p) ||
+              dynamic_cast<packet::GetFileReply const*>(&p) ||
+              dynamic_cast<packet::MultiGetFileReply const*>(&p) ||
+              dynamic_cast<packet::PutFileReply const*>(&p))
+            return PacketClass::reply;
+          else if (dynamic_cast<packet::Gossip const*>(&p))
+            return PacketClass::gossip;
           else
-            files = remove_n(files, files.size() - target_count);
+            return PacketClass::request;
         }
-        for (auto const& f: files)
+      }
+
+      // Packets from a given sender all go to the same worker, which handles
+      // them one at a time in arrival order within a PacketClass. Replies and
+      // requests may still overtake earlier gossip from the same sender,
+      // which is harmless: gossiped contacts and files carry their own
+      // timestamps and are merged by recency.
+      void
+      Node::_enqueue(std::unique_ptr<packet::Packet> packet,
+                     Endpoint source,
+                     bool was_crypted)
+      {
+        auto const c = packet_class(*packet);
+        auto& queue = *this->_queues[
+          std::hash<Address>()(packet->sender) % this->_queues.size()];
+        if (!queue.push(
+              c, QueuedPacket{std::move(packet), source, was_crypted}))
+          ELLE_DEBUG("%s: queue full, drop packet from %s", this, source);
+      }
+
+      void
+      Node::_worker(PacketQueue<QueuedPacket>& queue)
+      {
+        while (true)
         {
-          auto& fd = data.find(f)->second;
-          res.emplace(f, std::make_pair(fd.last_seen, fd.*access));
-          fd.last_gossip = now();
-          fd.gossip_count++;
+          auto queued = queue.pop();
+          if (!queued)
+          {
+            elle::reactor::wait(queue.queued());
+            continue;
+          }
+          try
+          {
+            this->dispatch(*queued->packet, queued->source,
+                           queued->was_crypted);
+          }
+          catch (elle::Error const& e)
+          {
+            ELLE_WARN("%s: error processing packet from %s: %s",
+                      this, queued->source, e);
+          }
         }
       }
 
@@ -1678,15 +2110,6 @@ namespace infinit
         }
       }
 
-      void
-      Node::filterAndInsert(
-        std::vector<Address> files, int target_count,
-        std::unordered_map<Address, std::pair<Time, Address>>& res)
-      {
-        kelips::filterAndInsert(files, target_count, res, _state.files,
-                                &File::home_node);
-      }
-
       void
       filterAndInsert2(
         std::vector<Contact*> new_contacts, unsigned int max_new,
@@ -1820,16 +2243,15 @@ namespace infinit
         ELLE_ASSERT_EQ(max_new + max_old, _config.gossip.files);
         auto const timeout = std::chrono::milliseconds(_config.gossip.old_threshold_ms);
         // update self file last seen, this will avoid us some ifs at other places
+        _state.files.seen(_self, current_time);
         int new_candidates = 0;
         int old_candidates = 0;
-        for (auto& f: _state.files)
+        for (auto const& f: _state.files)
         {
-          if (f.second.home_node == _self)
-            f.second.last_seen = current_time;
-          if (f.second.gossip_count < _config.gossip.new_threshold)
+          if (f.gossip_count < _config.gossip.new_threshold)
             new_candidates++;
-          if (f.second.home_node == _self
-              && current_time - f.second.last_gossip > timeout)
+          if (f.home_node == _self
+              && current_time - f.last_gossip > timeout)
             old_candidates++;
         }
         {
@@ -1847,16 +2269,16 @@ namespace infinit
           auto indexes = elle::pick_n(max_new, new_candidates);
           int ipos = 0;
           int idx = 0;
-          for (auto& f: _state.files)
+          for (auto const& f: _state.files)
           {
             if (ipos >= signed(indexes.size()))
               break;
-            if (f.second.gossip_count < _config.gossip.new_threshold)
+            if (f.gossip_count < _config.gossip.new_threshold)
             {
               if (idx == indexes[ipos])
               {
-                res.emplace(f.first,
-                            std::make_pair(f.second.last_seen, f.second.home_node));
+                res.emplace(f.address,
+                            std::make_pair(f.last_seen, f.home_node));
                 ipos++;
               }
               ++idx;
@@ -1870,9 +2292,9 @@ namespace infinit
           auto new_files = std::vector<std::pair<Address, std::pair<Time, Address>>>{};
           for (auto const& f: _state.files)
           {
-            if (f.second.gossip_count < _config.gossip.new_threshold)
-            new_files.emplace_back(f.first,
-              std::make_pair(f.second.last_seen, f.second.home_node));
+            if (f.gossip_count < _config.gossip.new_threshold)
+            new_files.emplace_back(f.address,
+              std::make_pair(f.last_seen, f.home_node));
           }
           if (signed(new_files.size()) > max_new)
           {
@@ -1890,17 +2312,17 @@ namespace infinit
           auto indexes = elle::pick_n(max_old, old_candidates);
           int ipos = 0;
           int idx = 0;
-          for (auto& f: _state.files)
+          for (auto const& f: _state.files)
           {
             if (ipos >= signed(indexes.size()))
               break;
-            if (f.second.home_node == _self
-                && current_time - f.second.last_gossip > timeout)
+            if (f.home_node == _self
+                && current_time - f.last_gossip > timeout)
             {
               if (idx == indexes[ipos])
               {
-                res.emplace(f.first,
-                            std::make_pair(f.second.last_seen, f.second.home_node));
+                res.emplace(f.address,
+                            std::make_pair(f.last_seen, f.home_node));
                 ipos++;
               }
               ++idx;
@@ -1911,11 +2333,11 @@ namespace infinit
         {
           // insert old files, only our own for which we can update the last_seen value
           auto old_files = std::vector<std::pair<Address, std::pair<Time, Address>>>{};
-          for (auto& f: _state.files)
-            if (f.second.home_node == _self
-                && (current_time - f.second.last_gossip > timeout)
-                && !has(res, f.first, f.second.home_node))
-              old_files.emplace_back(f.first, std::make_pair(f.second.last_seen, f.second.home_node));
+          for (auto const& f: _state.files)
+            if (f.home_node == _self
+                && (current_time - f.last_gossip > timeout)
+                && !has(res, f.address, f.home_node))
+              old_files.emplace_back(f.address, std::make_pair(f.last_seen, f.home_node));
           if (signed(old_files.size()) > max_old)
           {
             if (max_old < signed(old_files.size()) - max_old)
@@ -1936,8 +2358,8 @@ namespace infinit
           std::vector<std::pair<Address, std::pair<Time, Address>>> available;
           for (auto const& f: _state.files)
           {
-            if (!has(res, f.first, f.second.home_node))
-              available.emplace_back(f.first, std::make_pair(f.second.last_seen, f.second.home_node));
+            if (!has(res, f.address, f.home_node))
+              available.emplace_back(f.address, std::make_pair(f.last_seen, f.home_node));
           }
           if (available.size() > unsigned(n))
           {
@@ -1952,13 +2374,7 @@ namespace infinit
           }
         }
         for (auto const& r: res)
-        {
-          auto its = _state.files.equal_range(r.first);
-          auto it = boost::find_if(its,
-            [&](auto const& e) { return r.second.second == e.second.home_node;});
-          it->second.gossip_count++;
-          it->second.last_gossip = current_time;
-        }
+          _state.files.gossiped(r.first, r.second.second, current_time);
         assert(res.size() == unsigned(_config.gossip.files) || res.size() == _state.files.size());
         return res;
       }
@@ -1977,7 +2393,6 @@ namespace infinit
           p.contacts.clear();
           p.files.clear();
           p.contacts = pickContacts();
-          elle::Buffer buf = serialize(p, *this->doughnut());
           auto targets = pickOutsideTargets();
           for (auto const& a: targets)
           {
@@ -1987,7 +2402,6 @@ namespace infinit
           }
           // Add some files, just for group targets
           p.files = pickFiles();
-          buf = serialize(p, *this->doughnut());
           targets = pickGroupTargets();
           if (p.files.size() && targets.empty())
             ELLE_TRACE("%s: have files but no group member known", *this);
@@ -2111,14 +2525,12 @@ namespace infinit
           bool changed = false;
           for (auto const& f: p->files)
           {
-            auto its = _state.files.equal_range(f.first);
-            auto it = boost::find_if(its, [&](auto const& i) {
-                return i.second.home_node == f.second.second;});
-            if (it == its.second)
+            auto const known = _state.files.find(f.first, f.second.second);
+            if (!known)
             {
               changed = true;
-              _state.files.emplace(f.first,
-                                   File{f.first, f.second.second, f.second.first, Time(), 0});
+              _state.files.insert(
+                File{f.first, f.second.second, f.second.first, Time(), 0});
               ELLE_DUMP("%s: registering %f live since %s (%s)", *this,
                          f.first,
                          std::chrono::duration_cast<std::chrono::seconds>(now() - f.second.first).count(),
@@ -2127,11 +2539,11 @@ namespace infinit
             else
             {
               ELLE_DUMP("%s: %s %s %s %x", *this,
-                       it->second.last_seen < f.second.first,
-                       serialize_time(it->second.last_seen),
+                       known->last_seen < f.second.first,
+                       serialize_time(known->last_seen),
                        serialize_time(f.second.first),
                        f.first);
-              it->second.last_seen = std::max(it->second.last_seen, f.second.first);
+              _state.files.seen(f.first, f.second.second, f.second.first);
             }
           }
           if (changed)
@@ -2256,30 +2668,26 @@ namespace infinit
         static elle::Bench nlocalhit("kelips.localhit", 10s);
         int nhit = 0;
         int const fg = group_of(p->fileAddress);
-        auto const iterators = [&]
+        auto const replicas = [&]
           {
-            auto its = _state.files.equal_range(p->fileAddress);
-            auto res = std::vector<decltype(its.first)>{};
-            for (auto it = its.first; it != its.second; ++it)
-              res.push_back(it);
+            auto res = _state.files.replicas(p->fileAddress);
             // Shuffle the match list.
             elle::shuffle(res);
             return res;
           }();
-        for (auto it: iterators)
+        for (auto const& file: replicas)
         {
           ++nhit;
-          auto& file = *it;
           // Check if this one is already in results
           if (any_of(p->result,
                      [&](NodeLocation const& r) {
-                       return r.id() == file.second.home_node;
+                       return r.id() == file.home_node;
                      }))
             continue;
           // find the corresponding endpoints
           auto endpoints = Endpoints{};
           bool found = false;
-          if (file.second.home_node == _self)
+          if (file.home_node == _self)
           {
             ELLE_DEBUG("%s: found self", *this);
             if (_local_endpoints.empty())
@@ -2294,18 +2702,18 @@ namespace infinit
             found = true;
           }
           else if (auto contact_it
-                     = elle::find(_state.contacts[fg], file.second.home_node))
+                     = elle::find(_state.contacts[fg], file.home_node))
           {
             endpoints = to_endpoints(contact_it->second.endpoints);
             ELLE_DEBUG("%s: found other at %f:%s",
-                       *this, file.second.home_node, endpoints);
+                       *this, file.home_node, endpoints);
             found = true;
           }
           else
             ELLE_TRACE("%s: have file but not node", *this);
           if (found)
           {
-            auto res = NodeLocation{file.second.home_node, endpoints};
+            auto res = NodeLocation{file.home_node, endpoints};
             p->result.push_back(res);
             if (yield)
               (*yield)(res);
@@ -2526,11 +2934,7 @@ namespace infinit
           // check if we didn't already accept this file
           {
             // Check if we already have the block
-            auto its = _state.files.equal_range(p->fileAddress);
-            auto it = boost::find_if(its, [&](auto const& i) {
-                return i.second.home_node == _self;
-              });
-            if (it == its.second)
+            if (!_state.files.contains(p->fileAddress, _self))
             { // Nope, insert here
               // That makes us a home node for this address, but
               // wait until we get the RPC to store anything
@@ -2723,12 +3127,8 @@ namespace infinit
           if (!query_node && fg == _group && !ignore_local_cache)
           {
             // check if we have it locally
-            auto its = _state.files.equal_range(file);
-            auto it_us = boost::find_if(its,
-              [&](std::pair<const infinit::model::Address, File> const& f) {
-                return f.second.home_node == _self;
-              });
-            if (it_us != its.second && (n == 1 || local_override || fast_mode))
+            if (_state.files.contains(file, _self)
+                && (n == 1 || local_override || fast_mode))
             {
               ELLE_DEBUG("get satifsfied locally");
               yield(NodeLocation(this->id(), {}));
@@ -2796,16 +3196,8 @@ namespace infinit
               {
                 if (fg == _group && !query_node)
                 { // oportunistically add the entry to our tables
-                  auto its = _state.files.equal_range(file);
-                  auto it_r = boost::find_if(its,
-                    [&](std::pair<const infinit::model::Address, File> const& f) {
-                      return f.second.home_node == e.id();
-                    });
-                  if (it_r == its.second)
-                  {
-                    _state.files.emplace(file, File{file, e.id(), now(), Time(), 0});
+                  if (_state.files.insert(File{file, e.id(), now(), Time(), 0}))
                     this->_update_reachable_blocks();
-                  }
                 }
                 if (result_set.insert(e.id()).second)
                   yield(e);
@@ -3086,22 +3478,17 @@ namespace infinit
       Node::cleanup()
       {
         static auto bench = elle::Bench("kelips.cleared_files", 10s);
-        auto it = _state.files.begin();
         auto t = now();
         auto file_timeout = std::chrono::milliseconds(_config.file_timeout_ms);
-        int cleared = 0;
-        while (it != _state.files.end())
-        {
-          if (it->second.home_node != _self
-              && t - it->second.last_seen > file_timeout)
+        int cleared = _state.files.erase_if([&] (File const& f)
           {
-            ELLE_DUMP("%s: erase file %x", *this, it->first);
-            it = _state.files.erase(it);
-            ++cleared;
-          }
-          else
-            ++it;
-        }
+            if (f.home_node != _self && t - f.last_seen > file_timeout)
+            {
+              ELLE_DUMP("%s: erase file %x", *this, f.address);
+              return true;
+            }
+            return false;
+          });
         if (cleared)
           this->_update_reachable_blocks();
         bench.add(cleared);
@@ -3196,15 +3583,9 @@ namespace infinit
       void
       Node::store(infinit::model::blocks::Block const& block)
       {
-        if (none_of(elle::as_range(_state.files.equal_range(block.address())),
-                    [&](Files::value_type const& f) {
-                      return f.second.home_node == _self;
-                    }))
-        {
-          _state.files.emplace(block.address(),
-                               File{block.address(), _self, now(), Time(), 0});
+        if (_state.files.insert(
+              File{block.address(), _self, now(), Time(), 0}))
           this->_update_reachable_blocks();
-        }
         auto itp = boost::range::find(_promised_files, block.address());
         if (itp != _promised_files.end())
         {
@@ -3216,16 +3597,8 @@ namespace infinit
       void
       Node::remove(Address address)
       {
-        auto its = _state.files.equal_range(address);
-        for (auto it = its.first; it != its.second; ++it)
-        {
-          if (it->second.home_node == _self)
-          {
-            _state.files.erase(it);
-            this->_update_reachable_blocks();
-            break;
-          }
-        }
+        if (_state.files.erase(address, _self))
+          this->_update_reachable_blocks();
       }
 
       Overlay::WeakMember
@@ -3348,7 +3721,7 @@ namespace infinit
         auto keys = l.storage()->list();
         for (auto const& k: keys)
         {
-          _state.files.emplace(k,
+          _state.files.insert(
             File{k, _self, now(), now(), _config.gossip.new_threshold + 1});
           //ELLE_DUMP("%s: reloaded %x", *this, k);
         }
@@ -3413,13 +3786,8 @@ namespace infinit
           if (group_of(f.first) == _group
               && f.second != _self)
           {
-            auto its = _state.files.equal_range(f.first);
-            auto it = boost::find_if(its, [&](auto const& i) {
-                return i.second.home_node == f.second;});
-            if (it == its.second)
-              _state.files.emplace(f.first,
-                                   File{f.first, f.second, now(), now(),
-                                       this->_config.gossip.new_threshold + 1});
+            _state.files.insert(File{f.first, f.second, now(), now(),
+                                     this->_config.gossip.new_threshold + 1});
           }
         this->_update_reachable_blocks();
       }
@@ -3664,10 +4032,10 @@ namespace infinit
           std::vector<int> counts;
           std::set<Address> processed;
           for (auto const& f: files)
-            if (!processed.count(f.first))
+            if (!processed.count(f.address))
             {
-              processed.insert(f.first);
-              auto const count = boost::size(files.equal_range(f.first));
+              processed.insert(f.address);
+              auto const count = unsigned(files.count(f.address));
               if (counts.size() <= count)
                 counts.resize(count + 1, 0);
               counts[count]++;
@@ -3717,12 +4085,12 @@ namespace infinit
           std::set<Address> processed;
           // get addresses with copy count < factor
           for (auto const& f: files)
-            if (!processed.count(f.first))
+            if (!processed.count(f.address))
             {
-              processed.insert(f.first);
-              auto const count = boost::size(files.equal_range(f.first));
+              processed.insert(f.address);
+              auto const count = unsigned(files.count(f.address));
               if (count < factor)
-                to_scan.push_back(f.first);
+                to_scan.push_back(f.address);
             }
           std::vector<int> counts;
           auto scanner = [&]
@@ -3836,6 +4204,29 @@ namespace infinit
       elle::json::Object
       Node::stats() const
       {
+        auto packets = [this] (PacketClass c)
+          {
+            auto queued = 0;
+            auto stats = PacketQueue<QueuedPacket>::Statistics{};
+            for (auto const& q: this->_queues)
+            {
+              auto const& s = q->statistics(c);
+              queued += q->size(c);
+              stats.processed += s.processed;
+              stats.dropped += s.dropped;
+              stats.delay += s.delay;
+              stats.max_delay = std::max(stats.max_delay, s.max_delay);
+            }
+            return elle::json::Object
+              {
+                {"queued", queued},
+                {"processed", stats.processed},
+                {"dropped", stats.dropped},
+                {"average_delay_us",
+                 stats.processed ? stats.delay.count() / stats.processed : 0},
+                {"max_delay_us", stats.max_delay.count()},
+              };
+          };
         auto rb = reachable_blocks();
         return
           {
@@ -3844,11 +4235,19 @@ namespace infinit
             {"group", this->_group},
             {"statistics", elle::json::Object{
                 { "files", this->_state.files.size() },
+                { "files_footprint", this->_state.files.footprint() },
                 { "dropped_puts", this->_dropped_puts },
                 { "dropped_gets", this->_dropped_gets },
                 { "failed_puts", this->_failed_puts },
               }
             },
+            {"packets", elle::json::Object{
+                {"workers", this->_workers.size()},
+                {"replies", packets(PacketClass::reply)},
+                {"requests", packets(PacketClass::request)},
+                {"gossips", packets(PacketClass::gossip)},
+              }
+            },
             {"mutable_blocks", rb.mutable_blocks},
               {"immutable_blocks", rb.immutable_blocks},
               {"underreplicated_immutable_blocks", rb.underreplicated_immutable_blocks},
@@ -3871,10 +4270,10 @@ namespace infinit
         std::unordered_map<Address, int> ids_mutable, ids_immutable;
         for (auto const& entry: this->_state.files)
         {
-          if (entry.second.address.mutable_block())
-            ids_mutable[entry.second.address] += 1;
+          if (entry.address.mutable_block())
+            ids_mutable[entry.address] += 1;
           else
-            ids_immutable[entry.second.address] += 1;
+            ids_immutable[entry.address] += 1;
         }
         Overlay::ReachableBlocks res {0,0,0,0,0,0,0};
         res.total_blocks = ids_mutable.size() + ids_immutable.size();
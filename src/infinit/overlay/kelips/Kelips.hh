@@ -15,6 +15,9 @@
 #include <infinit/model/doughnut/Local.hh>
 #include <infinit/model/doughnut/Remote.hh>
 #include <infinit/overlay/Overlay.hh>
+#include <infinit/overlay/kelips/FileTable.hh>
+#include <infinit/overlay/kelips/PacketQueue.hh>
+#include <infinit/overlay/kelips/Wire.hh>
 #include <infinit/silo/Silo.hh>
 
 namespace std
@@ -37,7 +40,6 @@ namespace infinit
       using Endpoints = model::Endpoints;
       using NodeLocation = model::NodeLocation;
       using Address = infinit::model::Address;
-      using Time = std::chrono::time_point<std::chrono::system_clock>;
       using Duration = Time::duration;
       //using Duration = std::chrono::duration<long, std::ratio<1, 1000000>>;
 
@@ -62,20 +64,10 @@ namespace infinit
       std::ostream&
       operator << (std::ostream& output, Contact const& contact);
 
-      struct File
-      {
-        Address address;
-        Address home_node;
-        Time last_seen;
-        Time last_gossip;
-        int gossip_count;
-      };
-
-      using Files = std::unordered_multimap<Address, File>;
       using Contacts = std::unordered_map<Address, Contact>;
       struct State
       {
-        Files files;
+        FileTable files;
         //contacts from all groups. We will allow contacts[_group] to grow more
         std::vector<Contacts> contacts; //contacts from other groups
         Contacts observers;
@@ -272,10 +264,6 @@ namespace infinit
         void
         onPutFileReply(packet::PutFileReply*);
         void
-        filterAndInsert(
-          std::vector<Address> files, int target_count,
-          std::unordered_map<Address, std::pair<Time, Address>>& p);
-        void
         filterAndInsert(
           std::vector<Address> files, int target_count, int group,
           std::unordered_map<Address, std::vector<TimedEndpoint>>& p);
@@ -332,8 +320,50 @@ namespace infinit
         // Establish contact with peer and flush buffer.
         void
         contact(Address address);
-        void onPacket(elle::ConstWeakBuffer buf, Endpoint source);
+        void onPacket(elle::ConstWeakBuffer buf, Endpoint source,
+                      bool compact = false);
         void process(elle::Buffer const& buf, Endpoint source);
+        /// Compact frames waiting to be sent to a peer.
+        struct Batch
+        {
+          Endpoint endpoint;
+          elle::Buffer frames;
+          int count;
+        };
+        /// Handle a decoded and authenticated packet.
+        void
+        dispatch(packet::Packet& packet, Endpoint source, bool was_crypted);
+        /// Whether to send packets in the compact batched wire format.
+        bool
+        _compact() const;
+        /// Queue @a p for @a address at @a endpoint in a compact datagram.
+        ///
+        /// @return Whether @a p has a compact form.
+        bool
+        _send_compact(packet::Packet const& p,
+                      Address const& address,
+                      Endpoint const& endpoint);
+        /// Send the packets queued for @a address.
+        void
+        _flush(Address address);
+        void
+        _send_batch(Address const& address, Batch batch);
+        void
+        _process_compact(elle::ConstWeakBuffer buf, Endpoint source);
+        /// A received packet waiting for a worker.
+        struct QueuedPacket
+        {
+          std::unique_ptr<packet::Packet> packet;
+          Endpoint source;
+          bool was_crypted;
+        };
+        /// Queue @a packet for dispatching by the worker of its sender.
+        void
+        _enqueue(std::unique_ptr<packet::Packet> packet,
+                 Endpoint source,
+                 bool was_crypted);
+        void
+        _worker(PacketQueue<QueuedPacket>& queue);
         Contact*
         get_or_make(Address address, bool observer,
                     Endpoints const& endpoints, bool make=true);
@@ -382,6 +412,13 @@ namespace infinit
           _bootstraper_threads;
         elle::reactor::MultiLockBarrier _in_use;
         bool _terminating;
+        ELLE_ATTRIBUTE(wire::BufferPool, buffers);
+        ELLE_ATTRIBUTE((std::unordered_map<Address, Batch>), batches);
+        ELLE_ATTRIBUTE(elle::reactor::Thread::unique_ptr, batch_flusher);
+        /// Received packets, one queue per worker.
+        ELLE_ATTRIBUTE(
+          std::vector<std::unique_ptr<PacketQueue<QueuedPacket>>>, queues);
+        ELLE_ATTRIBUTE(std::vector<elle::reactor::Thread::unique_ptr>, workers);
       };
     }
   }
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+#include <boost/optional.hpp>
+
+#include <elle/attribute.hh>
+#include <elle/reactor/signal.hh>
+
+namespace infinit
+{
+  namespace overlay
+  {
+    namespace kelips
+    {
+      /// Processing priority of received packets, most urgent first.
+      ///
+      /// Replies answer our own queries and are never dropped. Requests
+      /// include pings, bootstrap and file requests. Gossip is dropped
+      /// oldest first when overloaded, as fresher gossip supersedes it.
+      enum class PacketClass
+      {
+        reply,
+        request,
+        gossip,
+      };
+
+      /// Bounded queue of received packets, popped by PacketClass priority
+      /// and in arrival order within a class.
+      ///
+      /// When full, the oldest gossip makes room for the new packet. Without
+      /// gossip to drop, new requests and gossip are rejected, replies are
+      /// always queued.
+      template <typename T>
+      class PacketQueue
+      {
+      /*------.
+      | Types |
+      `------*/
+      public:
+        using Self = PacketQueue;
+        using Clock = std::chrono::steady_clock;
+        struct Statistics
+        {
+          int64_t processed;
+          int64_t dropped;
+          /// Total queueing delay of processed packets.
+          std::chrono::microseconds delay;
+          std::chrono::microseconds max_delay;
+        };
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+      public:
+        PacketQueue(int capacity);
+
+      /*--------.
+      | Content |
+      `--------*/
+      public:
+        /// Queue @a packet of class @a c.
+        ///
+        /// @return Whether the packet was queued.
+        bool
+        push(PacketClass c, T packet);
+        /// The most urgent packet, if any.
+        boost::optional<T>
+        pop();
+        /// Number of queued packets.
+        int
+        size() const;
+        /// Number of queued packets of class @a c.
+        int
+        size(PacketClass c) const;
+        /// Statistics for packets of class @a c.
+        Statistics const&
+        statistics(PacketClass c) const;
+        ELLE_ATTRIBUTE_R(int, capacity);
+        /// Signaled when a packet is queued.
+        ELLE_ATTRIBUTE_RX(elle::reactor::Signal, queued);
+      private:
+        using Queued = std::pair<T, Clock::time_point>;
+        ELLE_ATTRIBUTE((std::array<std::deque<Queued>, 3>), queues);
+        ELLE_ATTRIBUTE((std::array<Statistics, 3>), statistics);
+      };
+    }
+  }
+}
+
+#include <infinit/overlay/kelips/PacketQueue.hxx>
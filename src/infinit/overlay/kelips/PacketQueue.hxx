@@ -0,0 +1,96 @@
+#include <algorithm>
+
+namespace infinit
+{
+  namespace overlay
+  {
+    namespace kelips
+    {
+      /*-------------.
+      | Construction |
+      `-------------*/
+
+      template <typename T>
+      PacketQueue<T>::PacketQueue(int capacity)
+        : _capacity(std::max(1, capacity))
+        , _queued()
+        , _queues()
+        , _statistics()
+      {}
+
+      /*--------.
+      | Content |
+      `--------*/
+
+      template <typename T>
+      bool
+      PacketQueue<T>::push(PacketClass c, T packet)
+      {
+        if (this->size() >= this->_capacity)
+        {
+          auto& gossips = this->_queues[int(PacketClass::gossip)];
+          if (!gossips.empty())
+          {
+            gossips.pop_front();
+            ++this->_statistics[int(PacketClass::gossip)].dropped;
+          }
+          else if (c != PacketClass::reply)
+          {
+            ++this->_statistics[int(c)].dropped;
+            return false;
+          }
+        }
+        this->_queues[int(c)].emplace_back(std::move(packet), Clock::now());
+        this->_queued.signal_one();
+        return true;
+      }
+
+      template <typename T>
+      boost::optional<T>
+      PacketQueue<T>::pop()
+      {
+        for (int c = 0; c < signed(this->_queues.size()); ++c)
+        {
+          auto& queue = this->_queues[c];
+          if (queue.empty())
+            continue;
+          auto res = std::move(queue.front());
+          queue.pop_front();
+          auto& stats = this->_statistics[c];
+          auto const delay =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+              Clock::now() - res.second);
+          ++stats.processed;
+          stats.delay += delay;
+          stats.max_delay = std::max(stats.max_delay, delay);
+          return std::move(res.first);
+        }
+        return boost::none;
+      }
+
+      template <typename T>
+      int
+      PacketQueue<T>::size() const
+      {
+        auto res = 0;
+        for (auto const& q: this->_queues)
+          res += q.size();
+        return res;
+      }
+
+      template <typename T>
+      int
+      PacketQueue<T>::size(PacketClass c) const
+      {
+        return this->_queues[int(c)].size();
+      }
+
+      template <typename T>
+      typename PacketQueue<T>::Statistics const&
+      PacketQueue<T>::statistics(PacketClass c) const
+      {
+        return this->_statistics[int(c)];
+      }
+    }
+  }
+}
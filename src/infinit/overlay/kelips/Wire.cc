@@ -0,0 +1,424 @@
+#include <infinit/overlay/kelips/Wire.hh>
+
+#include <cstring>
+
+#include <elle/assert.hh>
+#include <elle/err.hh>
+
+namespace infinit
+{
+  namespace overlay
+  {
+    namespace kelips
+    {
+      namespace wire
+      {
+        char const magic[8] = {'K', 'E', 'L', 'I', 'P', 'S', 'G', 'B'};
+
+        namespace
+        {
+          int64_t
+          milliseconds(Time const& t)
+          {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+              t.time_since_epoch()).count();
+          }
+
+          // IPv4 or IPv6 tag, address bytes and port.
+          auto const min_endpoint_size = 1 + 4 + 2;
+        }
+
+        /*-------.
+        | Writer |
+        `-------*/
+
+        Writer::Writer(elle::Buffer& buffer)
+          : _buffer(buffer)
+        {}
+
+        uint8_t*
+        Writer::_grow(std::size_t size)
+        {
+          auto const offset = this->_buffer.size();
+          this->_buffer.size(offset + size);
+          return this->_buffer.mutable_contents() + offset;
+        }
+
+        void
+        Writer::byte(uint8_t b)
+        {
+          *this->_grow(1) = b;
+        }
+
+        void
+        Writer::varint(uint64_t v)
+        {
+          uint8_t encoded[10];
+          auto size = 0;
+          do
+          {
+            encoded[size++] = (v & 0x7f) | (v > 0x7f ? 0x80 : 0);
+            v >>= 7;
+          }
+          while (v);
+          this->raw(encoded, size);
+        }
+
+        void
+        Writer::svarint(int64_t v)
+        {
+          this->varint((uint64_t(v) << 1) ^ uint64_t(v >> 63));
+        }
+
+        void
+        Writer::raw(void const* data, std::size_t size)
+        {
+          std::memcpy(this->_grow(size), data, size);
+        }
+
+        void
+        Writer::address(Address const& address)
+        {
+          this->raw(address.value(), sizeof(Address::Value));
+        }
+
+        void
+        Writer::endpoint(Endpoint const& endpoint)
+        {
+          if (endpoint.address().is_v4())
+          {
+            this->byte(4);
+            auto const bytes = endpoint.address().to_v4().to_bytes();
+            this->raw(bytes.data(), bytes.size());
+          }
+          else
+          {
+            this->byte(6);
+            auto const bytes = endpoint.address().to_v6().to_bytes();
+            this->raw(bytes.data(), bytes.size());
+          }
+          auto const port = uint16_t(endpoint.port());
+          this->byte(port & 0xff);
+          this->byte(port >> 8);
+        }
+
+        void
+        Writer::endpoints(std::vector<Endpoint> const& endpoints)
+        {
+          this->varint(endpoints.size());
+          for (auto const& e: endpoints)
+            this->endpoint(e);
+        }
+
+        void
+        Writer::locations(model::NodeLocations const& locations)
+        {
+          this->varint(locations.size());
+          for (auto const& l: locations)
+          {
+            this->address(l.id());
+            this->varint(l.endpoints().size());
+            for (auto const& e: l.endpoints())
+              this->endpoint(e);
+          }
+        }
+
+        void
+        Writer::contacts(Contacts const& contacts)
+        {
+          this->varint(contacts.size());
+          auto previous = int64_t(0);
+          for (auto const& c: contacts)
+          {
+            this->address(c.first);
+            this->varint(c.second.size());
+            for (auto const& e: c.second)
+            {
+              this->endpoint(e.first);
+              auto const t = milliseconds(e.second);
+              this->svarint(t - previous);
+              previous = t;
+            }
+          }
+        }
+
+        void
+        Writer::files(Files const& files)
+        {
+          // Few nodes are home to many files, index them.
+          auto homes = std::unordered_map<Address, int>{};
+          auto indexes = std::vector<int>{};
+          indexes.reserve(files.size());
+          for (auto const& f: files)
+            indexes.push_back(
+              homes.emplace(f.second.second, homes.size()).first->second);
+          auto ordered = std::vector<Address const*>(homes.size());
+          for (auto const& h: homes)
+            ordered[h.second] = &h.first;
+          this->varint(ordered.size());
+          for (auto h: ordered)
+            this->address(*h);
+          this->varint(files.size());
+          auto previous = int64_t(0);
+          auto index = indexes.begin();
+          for (auto const& f: files)
+          {
+            this->address(f.first);
+            auto const t = milliseconds(f.second.first);
+            this->svarint(t - previous);
+            previous = t;
+            this->varint(*index++);
+          }
+        }
+
+        std::size_t
+        Writer::begin_frame(uint8_t type)
+        {
+          auto const res = this->_buffer.size();
+          auto header = this->_grow(3);
+          header[0] = type;
+          return res;
+        }
+
+        void
+        Writer::end_frame(std::size_t frame)
+        {
+          auto const size = this->_buffer.size() - frame - 3;
+          if (size > std::size_t(max_frame_size))
+          {
+            // Leave the frames before untouched.
+            this->_buffer.size(frame);
+            elle::err("Kelips frame too large: %s bytes", size);
+          }
+          auto header = this->_buffer.mutable_contents() + frame;
+          header[1] = size & 0xff;
+          header[2] = size >> 8;
+        }
+
+        /*-------.
+        | Reader |
+        `-------*/
+
+        Reader::Reader(elle::ConstWeakBuffer buffer)
+          : _position(buffer.contents())
+          , _end(buffer.contents() + buffer.size())
+        {}
+
+        bool
+        Reader::empty() const
+        {
+          return this->_position == this->_end;
+        }
+
+        elle::ConstWeakBuffer
+        Reader::rest() const
+        {
+          return elle::ConstWeakBuffer(this->_position,
+                                       this->_end - this->_position);
+        }
+
+        uint8_t const*
+        Reader::_take(std::size_t size)
+        {
+          if (std::size_t(this->_end - this->_position) < size)
+            elle::err("truncated Kelips packet");
+          auto const res = this->_position;
+          this->_position += size;
+          return res;
+        }
+
+        uint8_t
+        Reader::byte()
+        {
+          return *this->_take(1);
+        }
+
+        uint64_t
+        Reader::varint()
+        {
+          auto res = uint64_t(0);
+          for (int shift = 0; shift < 64; shift += 7)
+          {
+            auto const b = this->byte();
+            res |= uint64_t(b & 0x7f) << shift;
+            if (!(b & 0x80))
+              return res;
+          }
+          elle::err("invalid varint in Kelips packet");
+        }
+
+        int64_t
+        Reader::svarint()
+        {
+          auto const v = this->varint();
+          return int64_t(v >> 1) ^ -int64_t(v & 1);
+        }
+
+        elle::ConstWeakBuffer
+        Reader::raw(std::size_t size)
+        {
+          return elle::ConstWeakBuffer(this->_take(size), size);
+        }
+
+        std::size_t
+        Reader::count(std::size_t min_element_size)
+        {
+          auto const res = this->varint();
+          if (res > std::size_t(this->_end - this->_position) / min_element_size)
+            elle::err("invalid element count in Kelips packet: %s", res);
+          return res;
+        }
+
+        Address
+        Reader::address()
+        {
+          return Address(this->_take(sizeof(Address::Value)));
+        }
+
+        Endpoint
+        Reader::endpoint()
+        {
+          auto address = boost::asio::ip::address{};
+          switch (this->byte())
+          {
+            case 4:
+            {
+              auto bytes = boost::asio::ip::address_v4::bytes_type{};
+              std::memcpy(bytes.data(), this->_take(bytes.size()),
+                          bytes.size());
+              address = boost::asio::ip::address_v4(bytes);
+              break;
+            }
+            case 6:
+            {
+              auto bytes = boost::asio::ip::address_v6::bytes_type{};
+              std::memcpy(bytes.data(), this->_take(bytes.size()),
+                          bytes.size());
+              address = boost::asio::ip::address_v6(bytes);
+              break;
+            }
+            default:
+              elle::err("invalid endpoint in Kelips packet");
+          }
+          auto const port = this->_take(2);
+          return Endpoint(address, port[0] | port[1] << 8);
+        }
+
+        std::vector<Endpoint>
+        Reader::endpoints()
+        {
+          auto res = std::vector<Endpoint>{};
+          auto const count = this->count(min_endpoint_size);
+          res.reserve(count);
+          for (std::size_t i = 0; i < count; ++i)
+            res.emplace_back(this->endpoint());
+          return res;
+        }
+
+        model::NodeLocations
+        Reader::locations()
+        {
+          auto res = model::NodeLocations{};
+          auto const count = this->count(sizeof(Address::Value) + 1);
+          res.reserve(count);
+          for (std::size_t i = 0; i < count; ++i)
+          {
+            auto id = this->address();
+            auto endpoints = model::Endpoints{};
+            auto const n = this->count(min_endpoint_size);
+            for (std::size_t j = 0; j < n; ++j)
+              endpoints.insert(this->endpoint());
+            res.emplace_back(id, std::move(endpoints));
+          }
+          return res;
+        }
+
+        Contacts
+        Reader::contacts()
+        {
+          auto res = Contacts{};
+          auto const count = this->count(sizeof(Address::Value) + 1);
+          res.reserve(count);
+          auto t = int64_t(0);
+          for (std::size_t i = 0; i < count; ++i)
+          {
+            auto& endpoints = res[this->address()];
+            auto const n = this->count(min_endpoint_size + 1);
+            endpoints.reserve(n);
+            for (std::size_t j = 0; j < n; ++j)
+            {
+              auto e = this->endpoint();
+              t += this->svarint();
+              endpoints.emplace_back(
+                std::move(e), Time(std::chrono::milliseconds(t)));
+            }
+          }
+          return res;
+        }
+
+        Files
+        Reader::files()
+        {
+          auto homes = std::vector<Address>{};
+          auto const homes_count = this->count(sizeof(Address::Value));
+          homes.reserve(homes_count);
+          for (std::size_t i = 0; i < homes_count; ++i)
+            homes.emplace_back(this->address());
+          auto res = Files{};
+          auto const count = this->count(sizeof(Address::Value) + 2);
+          res.reserve(count);
+          auto t = int64_t(0);
+          for (std::size_t i = 0; i < count; ++i)
+          {
+            auto address = this->address();
+            t += this->svarint();
+            auto const home = this->varint();
+            if (home >= homes.size())
+              elle::err("invalid home node index in Kelips packet: %s", home);
+            res.emplace(std::move(address),
+                        std::make_pair(Time(std::chrono::milliseconds(t)),
+                                       homes[home]));
+          }
+          return res;
+        }
+
+        Reader
+        Reader::frame(uint8_t& type)
+        {
+          type = this->byte();
+          auto const size_bytes = this->_take(2);
+          auto const size = std::size_t(size_bytes[0] | size_bytes[1] << 8);
+          return Reader(elle::ConstWeakBuffer(this->_take(size), size));
+        }
+
+        /*-----------.
+        | BufferPool |
+        `-----------*/
+
+        BufferPool::BufferPool(int size)
+          : _size(size)
+        {}
+
+        elle::Buffer
+        BufferPool::acquire()
+        {
+          if (this->_free.empty())
+            return {};
+          auto res = std::move(this->_free.back());
+          this->_free.pop_back();
+          return res;
+        }
+
+        void
+        BufferPool::release(elle::Buffer buffer)
+        {
+          if (signed(this->_free.size()) >= this->_size)
+            return;
+          // Keep the storage, drop the content.
+          buffer.size(0);
+          this->_free.emplace_back(std::move(buffer));
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <elle/Buffer.hh>
+#include <elle/attribute.hh>
+
+#include <infinit/model/Address.hh>
+#include <infinit/model/Endpoints.hh>
+
+namespace infinit
+{
+  namespace overlay
+  {
+    namespace kelips
+    {
+      /// Compact binary encoding of the most frequent Kelips packets.
+      ///
+      /// The generic serializer spells field names and sizes out for every
+      /// packet. This format only writes values: addresses as their 32 raw
+      /// bytes, integers as varints and times as deltas from the previous
+      /// one. Several packets can be packed in the same datagram as frames,
+      /// each being a type byte, the 16-bit little endian size of the payload
+      /// and the payload.
+      namespace wire
+      {
+        using Address = model::Address;
+        using Endpoint = model::Endpoint;
+        using Time = std::chrono::time_point<std::chrono::system_clock>;
+        using TimedEndpoint = std::pair<Endpoint, Time>;
+        /// Gossiped contacts: address -> endpoints.
+        using Contacts =
+          std::unordered_map<Address, std::vector<TimedEndpoint>>;
+        /// Gossiped files: address -> (last seen, home node).
+        using Files =
+          std::unordered_multimap<Address, std::pair<Time, Address>>;
+
+        /// Magic of datagrams holding compact frames.
+        extern char const magic[8];
+        /// Largest frame payload.
+        static int constexpr max_frame_size = 0xffff;
+
+        /*-------.
+        | Writer |
+        `-------*/
+
+        /// Encoder appending to a buffer, typically reused from a BufferPool.
+        class Writer
+        {
+        public:
+          Writer(elle::Buffer& buffer);
+          void
+          byte(uint8_t b);
+          void
+          varint(uint64_t v);
+          /// Zigzag encoded varint.
+          void
+          svarint(int64_t v);
+          void
+          raw(void const* data, std::size_t size);
+          void
+          address(Address const& address);
+          void
+          endpoint(Endpoint const& endpoint);
+          void
+          endpoints(std::vector<Endpoint> const& endpoints);
+          void
+          locations(model::NodeLocations const& locations);
+          void
+          contacts(Contacts const& contacts);
+          void
+          files(Files const& files);
+          /// Start a frame of type @a type.
+          ///
+          /// @return The frame position, to be passed to end_frame.
+          std::size_t
+          begin_frame(uint8_t type);
+          /// Patch the size of the frame started at @a frame.
+          ///
+          /// @throw elle::Error if the payload exceeds max_frame_size, after
+          ///        dropping the frame from the buffer.
+          void
+          end_frame(std::size_t frame);
+          ELLE_ATTRIBUTE(elle::Buffer&, buffer);
+
+        private:
+          uint8_t*
+          _grow(std::size_t size);
+        };
+
+        /*-------.
+        | Reader |
+        `-------*/
+
+        /// Decoder over a buffer, throwing elle::Error on malformed input.
+        class Reader
+        {
+        public:
+          Reader(elle::ConstWeakBuffer buffer);
+          bool
+          empty() const;
+          /// The input left.
+          elle::ConstWeakBuffer
+          rest() const;
+          uint8_t
+          byte();
+          uint64_t
+          varint();
+          int64_t
+          svarint();
+          elle::ConstWeakBuffer
+          raw(std::size_t size);
+          Address
+          address();
+          Endpoint
+          endpoint();
+          std::vector<Endpoint>
+          endpoints();
+          model::NodeLocations
+          locations();
+          Contacts
+          contacts();
+          Files
+          files();
+          /// Read the next frame.
+          ///
+          /// @return A reader over the frame payload.
+          Reader
+          frame(uint8_t& type);
+          /// Number of elements announced by a varint, bounded by what the
+          /// remaining input could hold.
+          std::size_t
+          count(std::size_t min_element_size);
+
+        private:
+          uint8_t const*
+          _take(std::size_t size);
+          ELLE_ATTRIBUTE(uint8_t const*, position);
+          ELLE_ATTRIBUTE(uint8_t const*, end);
+        };
+
+        /*-----------.
+        | BufferPool |
+        `-----------*/
+
+        /// Recycle buffers so encoding does not allocate once warm.
+        class BufferPool
+        {
+        public:
+          BufferPool(int size = 64);
+          /// An empty buffer, reusing a released one if any.
+          elle::Buffer
+          acquire();
+          /// Give @a buffer back for reuse.
+          void
+          release(elle::Buffer buffer);
+          ELLE_ATTRIBUTE(std::vector<elle::Buffer>, free);
+          ELLE_ATTRIBUTE_R(int, size);
+        };
+      }
+    }
+  }
+}
@@ -1,9 +1,20 @@
 #include <infinit/overlay/koordinate/Koordinate.hh>
 
+#include <unordered_set>
+
+#include <elle/log.hh>
 #include <elle/make-vector.hh>
+#include <elle/utils.hh>
+
+#include <elle/reactor/Scope.hh>
+#include <elle/reactor/signal.hh>
 
 #include <boost/algorithm/cxx11/all_of.hpp>
 
+#include <infinit/model/doughnut/Peer.hh>
+
+ELLE_LOG_COMPONENT("infinit.overlay.koordinate.Koordinate");
+
 namespace infinit
 {
   namespace overlay
@@ -20,6 +31,7 @@ namespace infinit
         Backends backends)
         : Overlay(dht, std::move(local))
         , _backends(std::move(backends))
+        , _backend_stats(this->_backends.size())
       {
         this->_validate();
       }
@@ -71,7 +83,52 @@ namespace infinit
         -> MemberGenerator
       {
         this->_validate();
-        return (*begin(this->_backends))->allocate(address, n);
+        if (this->_backends.size() == 1)
+          return this->_backends.front()->allocate(address, n);
+        return [this, address, n] (MemberGenerator::yielder const& yield)
+        {
+          // Query all backends in parallel, then merge their members in
+          // backends order.
+          auto found = std::vector<Found>(this->_backends.size());
+          auto error = std::exception_ptr{};
+          auto failures = 0;
+          elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& s)
+          {
+            for (int i = 0; i < signed(this->_backends.size()); ++i)
+              s.run_background(
+                elle::sprintf("%s: allocate on %s",
+                              this, this->_backends[i]->type_name()),
+                [&, i]
+                {
+                  try
+                  {
+                    for (auto m: this->_backends[i]->allocate(address, n))
+                      found[i].emplace_back(std::move(m));
+                  }
+                  catch (elle::Error const& e)
+                  {
+                    ELLE_TRACE("%s: %s failed to allocate: %s",
+                               this, this->_backends[i]->type_name(), e);
+                    if (!error)
+                      error = std::current_exception();
+                    ++failures;
+                  }
+                });
+            elle::reactor::wait(s);
+          };
+          if (failures == signed(this->_backends.size()))
+            std::rethrow_exception(error);
+          auto yielded = std::unordered_set<model::Address>{};
+          for (auto& members: found)
+            for (auto& m: members)
+            {
+              if (signed(yielded.size()) >= n)
+                return;
+              if (auto p = m.lock())
+                if (yielded.insert(p->id()).second)
+                  yield(std::move(m));
+            }
+        };
       }
 
       auto
@@ -88,7 +145,22 @@ namespace infinit
         -> MemberGenerator
       {
         this->_validate();
-        return (*begin(this->_backends))->lookup(address, n, fast);
+        if (this->_backends.size() == 1)
+          return this->_backends.front()->lookup(address, n, fast);
+        return [this, address, n, fast] (MemberGenerator::yielder const& yield)
+        {
+          auto const found = this->_race(
+            "lookup", n,
+            [&] (Overlay const& backend)
+            {
+              auto res = Found{};
+              for (auto m: backend.lookup(address, n, fast))
+                res.emplace_back(std::move(m));
+              return res;
+            });
+          for (auto m: found)
+            yield(std::move(m));
+        };
       }
 
       auto
@@ -96,7 +168,105 @@ namespace infinit
         -> WeakMember
       {
         this->_validate();
-        return (*begin(this->_backends))->lookup_node(address);
+        if (this->_backends.size() == 1)
+          return this->_backends.front()->lookup_node(address);
+        auto const found = this->_race(
+          "lookup node", 1,
+          [&] (Overlay const& backend)
+          {
+            try
+            {
+              auto res = Found{};
+              res.emplace_back(backend.lookup_node(address));
+              return res;
+            }
+            catch (NodeNotFound const&)
+            {
+              return Found{};
+            }
+          });
+        if (found.empty())
+          return {};
+        else
+          return found.front();
+      }
+
+      auto
+      Koordinate::_race(std::string const& name,
+                        int n,
+                        std::function<Found (Overlay const&)> const& query)
+        const
+        -> Found
+      {
+        auto& stats = elle::unconst(this)->_backend_stats;
+        auto const size = signed(this->_backends.size());
+        auto res = Found{};
+        auto ids = std::unordered_set<model::Address>{};
+        auto complete = [&] { return signed(res.size()) >= n; };
+        auto running = size;
+        auto done = std::vector<bool>(size, false);
+        auto error = std::exception_ptr{};
+        auto answered = elle::reactor::Signal{};
+        auto const start = Clock::now();
+        elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& s)
+        {
+          for (int i = 0; i < size; ++i)
+          {
+            ++stats[i].lookups;
+            s.run_background(
+              elle::sprintf("%s: %s on %s",
+                            this, name, this->_backends[i]->type_name()),
+              [&, i]
+              {
+                try
+                {
+                  // Merge partial answers until n members are found.
+                  auto added = 0;
+                  for (auto& m: query(*this->_backends[i]))
+                  {
+                    if (complete())
+                      break;
+                    if (auto p = m.lock())
+                      if (ids.insert(p->id()).second)
+                      {
+                        res.emplace_back(std::move(m));
+                        ++added;
+                      }
+                  }
+                  if (added)
+                  {
+                    ELLE_DEBUG("%s: %s found %s members to %s",
+                               this, this->_backends[i]->type_name(),
+                               added, name);
+                    ++stats[i].hits;
+                    stats[i].latency += Clock::now() - start;
+                  }
+                  else
+                    ++stats[i].misses;
+                }
+                catch (elle::Error const& e)
+                {
+                  ELLE_TRACE("%s: %s failed to %s: %s",
+                             this, this->_backends[i]->type_name(), name, e);
+                  ++stats[i].misses;
+                  if (!error)
+                    error = std::current_exception();
+                }
+                done[i] = true;
+                --running;
+                answered.signal();
+              });
+          }
+          while (!complete() && running > 0)
+            elle::reactor::wait(answered);
+          s.terminate_now();
+        };
+        for (int i = 0; i < size; ++i)
+          if (!done[i])
+            ++stats[i].cancelled;
+        if (res.empty() && error)
+          std::rethrow_exception(error);
+        return res;
       }
 
       /*-----------.
@@ -124,6 +294,22 @@ namespace infinit
       elle::json::Object
       Koordinate::stats() const
       {
+        auto backends = elle::json::Array{};
+        for (int i = 0; i < signed(this->_backends.size()); ++i)
+        {
+          auto const& stats = this->_backend_stats[i];
+          auto const latency =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+              stats.latency).count();
+          backends.push_back(elle::json::Object{
+              {"type", this->_backends[i]->type_name()},
+              {"lookups", stats.lookups},
+              {"hits", stats.hits},
+              {"misses", stats.misses},
+              {"cancelled", stats.cancelled},
+              {"average_latency_us", stats.hits ? latency / stats.hits : 0},
+            });
+        }
         return
           {
             {"type", this->type_name()},
@@ -132,6 +318,7 @@ namespace infinit
                                         {
                                           return backend->type_name();
                                         })},
+            {"backends", backends},
             };
       }
     }
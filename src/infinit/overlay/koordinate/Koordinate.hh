@@ -1,5 +1,8 @@
 #pragma once
 
+#include <chrono>
+#include <functional>
+
 #include <infinit/overlay/Overlay.hh>
 
 namespace infinit
@@ -10,9 +13,12 @@ namespace infinit
     {
       /// An overlay that aggregates several underlying overlays.
       ///
-      /// Koordinate lets a node serve several overlays for others to query,
-      /// and forwards local requets to the first one.  Future evolutions may
-      /// enable to leverage several backend overlays depending on policies.
+      /// Koordinate lets a node serve several overlays for others to query.
+      /// Local lookups are raced on all backends and their answers merged
+      /// until enough members are found, the remaining backends being
+      /// cancelled, so that a combination of backends is as fast as the
+      /// fastest complete one, e.g. during migrations. Allocations merge the
+      /// members of every backend.
       class Koordinate
         : public Overlay
       {
@@ -28,6 +34,8 @@ namespace infinit
         using Backend = std::unique_ptr<Overlay>;
         /// Set of underlying overlays.
         using Backends = std::vector<Backend>;
+        /// A clock.
+        using Clock = std::chrono::steady_clock;
 
       /*-------------.
       | Construction |
@@ -80,6 +88,18 @@ namespace infinit
 
         WeakMember
         _lookup_node(model::Address address) const override;
+      private:
+        using Found = std::vector<WeakMember>;
+        /// Run @a query on all backends in parallel.
+        ///
+        /// @return The distinct members found, in answer order, until @a n
+        ///         are found and other backends are cancelled, or all
+        ///         backends answered.
+        /// @throw  The first error if all backends failed.
+        Found
+        _race(std::string const& name,
+              int n,
+              std::function<Found (Overlay const&)> const& query) const;
 
       /*-----------.
       | Monitoring |
@@ -91,6 +111,22 @@ namespace infinit
         peer_list() const override;
         elle::json::Object
         stats() const override;
+        /// Lookup statistics of a backend.
+        struct BackendStats
+        {
+          /// Lookups raced on the backend.
+          int lookups = 0;
+          /// Lookups it contributed members to.
+          int hits = 0;
+          /// Lookups it failed or found nothing for.
+          int misses = 0;
+          /// Lookups cancelled because other backends found enough members.
+          int cancelled = 0;
+          /// Cumulated answer time of hits.
+          Clock::duration latency = {};
+        };
+        /// Statistics of each backend, in the same order.
+        ELLE_ATTRIBUTE_R(std::vector<BackendStats>, backend_stats);
       };
     }
   }
@@ -0,0 +1,474 @@
+#include <infinit/overlay/kouncil/AddressBook.hh>
+
+#include <algorithm>
+#include <cstring>
+
+#include <elle/assert.hh>
+
+namespace infinit
+{
+  namespace overlay
+  {
+    namespace kouncil
+    {
+      namespace
+      {
+        /// Initial number of slots, must be a power of two.
+        auto const initial_capacity = std::size_t(16);
+      }
+
+      int constexpr AddressBook::digest_buckets;
+      int constexpr AddressBook::digest_version;
+      int constexpr AddressBook::inline_owners;
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+
+      AddressBook::AddressBook()
+        : _size(0)
+        , _blocks_count(0)
+        , _slots(initial_capacity)
+        , _suspended_count(0)
+      {}
+
+      /*--------.
+      | Content |
+      `--------*/
+
+      bool
+      AddressBook::insert(Address const& node, Address const& block)
+      {
+        // Keep the load factor under 80%.
+        if ((this->_blocks_count + 1) * 5 > this->_slots.size() * 4)
+          this->_grow();
+        auto const index = this->_intern(node);
+        auto& slot = this->_slots[this->_find(block.value())];
+        if (slot.count == 0)
+        {
+          std::memcpy(slot.block, block.value(), sizeof(Address::Value));
+          slot.mutable_block = block.mutable_block();
+          ++this->_blocks_count;
+        }
+        else
+        {
+          auto const end =
+            slot.owners + std::min<int>(slot.count, inline_owners);
+          if (std::find(slot.owners, end, index) != end)
+            return false;
+          if (slot.count > inline_owners)
+          {
+            auto const& overflow = this->_overflow.at(block);
+            if (std::find(overflow.begin(), overflow.end(), index) !=
+                overflow.end())
+              return false;
+          }
+        }
+        if (slot.count < inline_owners)
+          slot.owners[slot.count] = index;
+        else
+          this->_overflow[block].push_back(index);
+        ++slot.count;
+        ++this->_node_sizes[index];
+        this->_node_digests[index][bucket(block)] += _hash(block.value());
+        ++this->_size;
+        return true;
+      }
+
+      bool
+      AddressBook::erase(Address const& node, Address const& block)
+      {
+        auto it = this->_node_indexes.find(node);
+        if (it == this->_node_indexes.end())
+          return false;
+        auto const index = it->second;
+        auto const pos = this->_find(block.value());
+        if (this->_slots[pos].count == 0)
+          return false;
+        if (!this->_remove_owner(pos, index))
+          return false;
+        --this->_size;
+        this->_node_digests[index][bucket(block)] -= _hash(block.value());
+        if (--this->_node_sizes[index] == 0)
+          this->_release(index);
+        if (this->_slots[pos].count == 0)
+        {
+          this->_remove_slot(pos);
+          --this->_blocks_count;
+        }
+        return true;
+      }
+
+      std::size_t
+      AddressBook::erase(Address const& node)
+      {
+        auto res = std::size_t(0);
+        for (auto const& block: this->blocks(node))
+          if (this->erase(node, block))
+            ++res;
+        return res;
+      }
+
+      void
+      AddressBook::clear()
+      {
+        this->_size = 0;
+        this->_blocks_count = 0;
+        this->_slots = std::vector<Slot>(initial_capacity);
+        this->_overflow.clear();
+        this->_nodes.clear();
+        this->_node_sizes.clear();
+        this->_node_digests.clear();
+        this->_node_suspended.clear();
+        this->_suspended_count = 0;
+        this->_node_indexes.clear();
+        this->_free_nodes.clear();
+      }
+
+      bool
+      AddressBook::suspend(Address const& node)
+      {
+        auto it = this->_node_indexes.find(node);
+        if (it == this->_node_indexes.end())
+          return false;
+        if (!this->_node_suspended[it->second])
+        {
+          this->_node_suspended[it->second] = true;
+          ++this->_suspended_count;
+        }
+        return true;
+      }
+
+      bool
+      AddressBook::resume(Address const& node)
+      {
+        auto it = this->_node_indexes.find(node);
+        if (it == this->_node_indexes.end() ||
+            !this->_node_suspended[it->second])
+          return false;
+        this->_node_suspended[it->second] = false;
+        --this->_suspended_count;
+        return true;
+      }
+
+      bool
+      AddressBook::suspended(Address const& node) const
+      {
+        auto it = this->_node_indexes.find(node);
+        return it != this->_node_indexes.end() &&
+          this->_node_suspended[it->second];
+      }
+
+      bool
+      AddressBook::contains(Address const& node, Address const& block) const
+      {
+        auto it = this->_node_indexes.find(node);
+        if (it == this->_node_indexes.end())
+          return false;
+        auto const& slot = this->_slots[this->_find(block.value())];
+        if (slot.count == 0)
+          return false;
+        auto const end = slot.owners + std::min<int>(slot.count, inline_owners);
+        if (std::find(slot.owners, end, it->second) != end)
+          return true;
+        if (slot.count > inline_owners)
+        {
+          auto const& overflow = this->_overflow.at(block);
+          return std::find(overflow.begin(), overflow.end(), it->second) !=
+            overflow.end();
+        }
+        return false;
+      }
+
+      std::vector<model::Address>
+      AddressBook::owners(Address const& block) const
+      {
+        auto res = std::vector<Address>{};
+        auto const& slot = this->_slots[this->_find(block.value())];
+        if (slot.count == 0)
+          return res;
+        res.reserve(slot.count);
+        auto const add = [&] (NodeIndex index)
+          {
+            if (!this->_suspended_count || !this->_node_suspended[index])
+              res.emplace_back(this->_nodes[index]);
+          };
+        for (int i = 0; i < std::min<int>(slot.count, inline_owners); ++i)
+          add(slot.owners[i]);
+        if (slot.count > inline_owners)
+          for (auto index: this->_overflow.at(block))
+            add(index);
+        return res;
+      }
+
+      std::vector<model::Address>
+      AddressBook::blocks(Address const& node) const
+      {
+        auto res = std::vector<Address>{};
+        auto it = this->_node_indexes.find(node);
+        if (it == this->_node_indexes.end())
+          return res;
+        auto const index = it->second;
+        res.reserve(this->_node_sizes[index]);
+        for (auto const& slot: this->_slots)
+        {
+          if (slot.count == 0)
+            continue;
+          auto const end =
+            slot.owners + std::min<int>(slot.count, inline_owners);
+          if (std::find(slot.owners, end, index) != end)
+            res.emplace_back(this->_address(slot));
+          else if (slot.count > inline_owners)
+          {
+            auto address = this->_address(slot);
+            auto const& overflow = this->_overflow.at(address);
+            if (std::find(overflow.begin(), overflow.end(), index) !=
+                overflow.end())
+              res.emplace_back(std::move(address));
+          }
+        }
+        return res;
+      }
+
+      AddressBook::Digest
+      AddressBook::digest(Address const& node) const
+      {
+        auto it = this->_node_indexes.find(node);
+        if (it == this->_node_indexes.end())
+          return Digest(digest_buckets, 0);
+        return this->_node_digests[it->second];
+      }
+
+      AddressBook::Digest
+      AddressBook::digest(std::vector<Address> const& blocks)
+      {
+        auto res = Digest(digest_buckets, 0);
+        for (auto const& b: blocks)
+          res[bucket(b)] += _hash(b.value());
+        return res;
+      }
+
+      int64_t
+      AddressBook::digest_root(Digest const& digest)
+      {
+        auto res = uint64_t(0);
+        for (auto h: digest)
+          res = (res ^ uint64_t(h)) * 0x100000001b3ull;
+        return res;
+      }
+
+      int
+      AddressBook::bucket(Address const& block)
+      {
+        return block.value()[0];
+      }
+
+      void
+      AddressBook::for_each(
+        std::function<void (Address const&, int)> const& f) const
+      {
+        for (auto const& slot: this->_slots)
+        {
+          if (slot.count == 0)
+            continue;
+          if (!this->_suspended_count)
+          {
+            f(this->_address(slot), slot.count);
+            continue;
+          }
+          auto const address = this->_address(slot);
+          auto count = 0;
+          for (int i = 0; i < std::min<int>(slot.count, inline_owners); ++i)
+            if (!this->_node_suspended[slot.owners[i]])
+              ++count;
+          if (slot.count > inline_owners)
+            for (auto index: this->_overflow.at(address))
+              if (!this->_node_suspended[index])
+                ++count;
+          if (count)
+            f(address, count);
+        }
+      }
+
+      /*-----------.
+      | Monitoring |
+      `-----------*/
+
+      std::size_t
+      AddressBook::footprint() const
+      {
+        // Hash map nodes cost a next pointer and the cached hash on top of the
+        // value.
+        auto const node_overhead = 2 * sizeof(void*);
+        auto res = sizeof(*this);
+        res += this->_slots.capacity() * sizeof(Slot);
+        res += this->_overflow.bucket_count() * sizeof(void*);
+        for (auto const& e: this->_overflow)
+          res += sizeof(e) + node_overhead +
+            e.second.capacity() * sizeof(NodeIndex);
+        res += this->_nodes.capacity() * sizeof(Address);
+        res += this->_node_sizes.capacity() * sizeof(std::size_t);
+        res += this->_node_digests.capacity() * sizeof(Digest);
+        res += this->_node_suspended.capacity() / 8;
+        for (auto const& d: this->_node_digests)
+          res += d.capacity() * sizeof(int64_t);
+        res += this->_node_indexes.bucket_count() * sizeof(void*);
+        res += this->_node_indexes.size() *
+          (sizeof(decltype(this->_node_indexes)::value_type) + node_overhead);
+        res += this->_free_nodes.capacity() * sizeof(NodeIndex);
+        return res;
+      }
+
+      /*--------.
+      | Details |
+      `--------*/
+
+      model::Address
+      AddressBook::_address(Slot const& slot) const
+      {
+        return Address(slot.block,
+                       slot.mutable_block ?
+                       model::flags::mutable_block :
+                       model::flags::immutable_block,
+                       false);
+      }
+
+      uint64_t
+      AddressBook::_hash(Address::Value const& block)
+      {
+        // Addresses are mostly hashes already, only mix their first bytes in
+        // case they are not.
+        uint64_t a;
+        uint64_t b;
+        std::memcpy(&a, block, sizeof a);
+        std::memcpy(&b, block + sizeof a, sizeof b);
+        auto h = (a ^ (b * 0x9e3779b97f4a7c15ull)) * 0x9e3779b97f4a7c15ull;
+        return h ^ (h >> 32);
+      }
+
+      std::size_t
+      AddressBook::_home(Address::Value const& block) const
+      {
+        return _hash(block) & (this->_slots.size() - 1);
+      }
+
+      std::size_t
+      AddressBook::_find(Address::Value const& block) const
+      {
+        auto const mask = this->_slots.size() - 1;
+        auto pos = this->_home(block);
+        while (this->_slots[pos].count != 0 &&
+               std::memcmp(this->_slots[pos].block, block,
+                           sizeof(Address::Value)) != 0)
+          pos = (pos + 1) & mask;
+        return pos;
+      }
+
+      bool
+      AddressBook::_remove_owner(std::size_t pos, NodeIndex node)
+      {
+        auto& slot = this->_slots[pos];
+        auto const inline_count = std::min<int>(slot.count, inline_owners);
+        auto const it = std::find(slot.owners, slot.owners + inline_count, node);
+        if (slot.count <= inline_owners)
+        {
+          if (it == slot.owners + inline_count)
+            return false;
+          std::copy(it + 1, slot.owners + inline_count, it);
+          --slot.count;
+          return true;
+        }
+        auto const address = this->_address(slot);
+        auto overflow = this->_overflow.find(address);
+        ELLE_ASSERT(overflow != this->_overflow.end());
+        auto& extra = overflow->second;
+        if (it != slot.owners + inline_count)
+          // Refill the inline owner from the overflow.
+          *it = extra.back();
+        else
+        {
+          auto const found = std::find(extra.begin(), extra.end(), node);
+          if (found == extra.end())
+            return false;
+          *found = extra.back();
+        }
+        extra.pop_back();
+        if (extra.empty())
+          this->_overflow.erase(overflow);
+        --slot.count;
+        return true;
+      }
+
+      void
+      AddressBook::_remove_slot(std::size_t pos)
+      {
+        // Backward shift deletion: move back following entries of the cluster
+        // unless that would put them before their home slot.
+        auto const mask = this->_slots.size() - 1;
+        auto hole = pos;
+        for (auto i = (pos + 1) & mask;
+             this->_slots[i].count != 0;
+             i = (i + 1) & mask)
+        {
+          auto const home = this->_home(this->_slots[i].block);
+          if (((i - home) & mask) >= ((i - hole) & mask))
+          {
+            this->_slots[hole] = this->_slots[i];
+            hole = i;
+          }
+        }
+        this->_slots[hole].count = 0;
+      }
+
+      void
+      AddressBook::_grow()
+      {
+        auto previous = std::move(this->_slots);
+        this->_slots = std::vector<Slot>(previous.size() * 2);
+        for (auto const& slot: previous)
+          if (slot.count != 0)
+            this->_slots[this->_find(slot.block)] = slot;
+      }
+
+      AddressBook::NodeIndex
+      AddressBook::_intern(Address const& node)
+      {
+        auto it = this->_node_indexes.find(node);
+        if (it != this->_node_indexes.end())
+          return it->second;
+        auto index = NodeIndex(0);
+        if (this->_free_nodes.empty())
+        {
+          index = NodeIndex(this->_nodes.size());
+          this->_nodes.emplace_back(node);
+          this->_node_sizes.emplace_back(0);
+          this->_node_digests.emplace_back(digest_buckets, 0);
+          this->_node_suspended.emplace_back(false);
+        }
+        else
+        {
+          index = this->_free_nodes.back();
+          this->_free_nodes.pop_back();
+          this->_nodes[index] = node;
+          this->_node_sizes[index] = 0;
+          this->_node_digests[index].assign(digest_buckets, 0);
+          this->_node_suspended[index] = false;
+        }
+        this->_node_indexes.emplace(node, index);
+        return index;
+      }
+
+      void
+      AddressBook::_release(NodeIndex node)
+      {
+        if (this->_node_suspended[node])
+        {
+          this->_node_suspended[node] = false;
+          --this->_suspended_count;
+        }
+        this->_node_indexes.erase(this->_nodes[node]);
+        this->_free_nodes.emplace_back(node);
+      }
+    }
+  }
+}
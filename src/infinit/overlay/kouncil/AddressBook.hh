@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <elle/attribute.hh>
+
+#include <infinit/model/Address.hh>
+
+namespace infinit
+{
+  namespace overlay
+  {
+    namespace kouncil
+    {
+      /// Which nodes hold which blocks.
+      ///
+      /// Node addresses are interned as 32-bit indexes. Blocks are stored in a
+      /// flat open addressing table keyed by their address, holding up to
+      /// three owners inline and any further owner in an overflow map. Slots
+      /// take 48 bytes and the table is kept 40% to 80% full, so a block with
+      /// up to three owners costs 60 to 120 bytes, that is 20 to 40 bytes per
+      /// replica with the usual three replicas. A container of (node, block)
+      /// pairs costs more than 100 bytes per replica.
+      class AddressBook
+      {
+      /*------.
+      | Types |
+      `------*/
+      public:
+        using Self = AddressBook;
+        using Address = model::Address;
+        /// Order independent summary of the blocks held by a node.
+        ///
+        /// Blocks are split in buckets by the first byte of their address,
+        /// each bucket being the sum of the hashes of its blocks. Digests are
+        /// updated incrementally, and comparing two of them tells which
+        /// buckets hold different blocks.
+        using Digest = std::vector<int64_t>;
+        static int constexpr digest_buckets = 256;
+        /// Version of the digest layout and hashing, exchanged with digests
+        /// so peers computing them differently fall back to full transfers.
+        static int constexpr digest_version = 1;
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+      public:
+        AddressBook();
+
+      /*--------.
+      | Content |
+      `--------*/
+      public:
+        /// Record that @a node holds @a block.
+        ///
+        /// @return Whether the entry was added.
+        bool
+        insert(Address const& node, Address const& block);
+        /// Forget that @a node holds @a block.
+        ///
+        /// @return Whether the entry existed.
+        bool
+        erase(Address const& node, Address const& block);
+        /// Forget all blocks held by @a node.
+        ///
+        /// @return The number of removed entries.
+        std::size_t
+        erase(Address const& node);
+        /// Forget everything.
+        void
+        clear();
+        /// Hide the blocks of @a node from owners and for_each, while keeping
+        /// them and their digest until it is resumed or erased.
+        ///
+        /// @return Whether @a node holds blocks.
+        bool
+        suspend(Address const& node);
+        /// Show the blocks of a suspended @a node again.
+        ///
+        /// @return Whether @a node was suspended.
+        bool
+        resume(Address const& node);
+        /// Whether @a node is suspended.
+        bool
+        suspended(Address const& node) const;
+        /// Whether @a node holds @a block.
+        bool
+        contains(Address const& node, Address const& block) const;
+        /// The nodes holding @a block, suspended ones aside.
+        std::vector<Address>
+        owners(Address const& block) const;
+        /// The blocks held by @a node.
+        std::vector<Address>
+        blocks(Address const& node) const;
+        /// Call @a f with every block held by a node that is not suspended,
+        /// and its number of such owners.
+        void
+        for_each(std::function<void (Address const&, int)> const& f) const;
+        /// Digest of the blocks held by @a node.
+        Digest
+        digest(Address const& node) const;
+        /// Digest of @a blocks.
+        static
+        Digest
+        digest(std::vector<Address> const& blocks);
+        /// Single value summarizing @a digest.
+        static
+        int64_t
+        digest_root(Digest const& digest);
+        /// The digest bucket of @a block.
+        static
+        int
+        bucket(Address const& block);
+        /// Number of (node, block) entries.
+        ELLE_ATTRIBUTE_R(std::size_t, size);
+        /// Number of distinct blocks.
+        ELLE_ATTRIBUTE_R(std::size_t, blocks_count);
+
+      /*-----------.
+      | Monitoring |
+      `-----------*/
+      public:
+        /// Approximate memory used, in bytes.
+        std::size_t
+        footprint() const;
+
+      /*--------.
+      | Details |
+      `--------*/
+      private:
+        using NodeIndex = uint32_t;
+        static int constexpr inline_owners = 3;
+        struct Slot
+        {
+          Address::Value block;
+          bool mutable_block;
+          /// Number of owners, 0 for an empty slot.
+          uint16_t count;
+          NodeIndex owners[inline_owners];
+        };
+        Address
+        _address(Slot const& slot) const;
+        static
+        uint64_t
+        _hash(Address::Value const& block);
+        std::size_t
+        _home(Address::Value const& block) const;
+        /// The slot holding @a block, or the empty slot where to insert it.
+        std::size_t
+        _find(Address::Value const& block) const;
+        bool
+        _remove_owner(std::size_t pos, NodeIndex node);
+        /// Remove the slot at @a pos, shifting back the following entries.
+        void
+        _remove_slot(std::size_t pos);
+        void
+        _grow();
+        NodeIndex
+        _intern(Address const& node);
+        void
+        _release(NodeIndex node);
+        ELLE_ATTRIBUTE(std::vector<Slot>, slots);
+        /// Owners beyond the inline ones, by block.
+        ELLE_ATTRIBUTE((std::unordered_map<Address, std::vector<NodeIndex>>),
+                       overflow);
+        ELLE_ATTRIBUTE(std::vector<Address>, nodes);
+        /// Number of entries per node, to recycle indexes.
+        ELLE_ATTRIBUTE(std::vector<std::size_t>, node_sizes);
+        ELLE_ATTRIBUTE(std::vector<Digest>, node_digests);
+        ELLE_ATTRIBUTE(std::vector<bool>, node_suspended);
+        /// Number of suspended nodes, to skip checking them when there are
+        /// none.
+        ELLE_ATTRIBUTE(int, suspended_count);
+        ELLE_ATTRIBUTE((std::unordered_map<Address, NodeIndex>), node_indexes);
+        ELLE_ATTRIBUTE(std::vector<NodeIndex>, free_nodes);
+      };
+    }
+  }
+}
@@ -3,15 +3,21 @@
 #include <boost/range/algorithm/sort.hpp>
 #include <boost/range/algorithm_ext/iota.hpp>
 
+#include <elle/err.hh>
 #include <elle/find.hh>
 #include <elle/log.hh>
 #include <elle/make-vector.hh>
+#include <elle/os/environ.hh>
 #include <elle/random.hh>
 #include <elle/range.hh>
+#include <elle/utils.hh>
 
 #include <elle/das/tuple.hh>
 
+#include <elle/reactor/Scope.hh>
 #include <elle/reactor/network/Error.hh>
+#include <elle/reactor/scheduler.hh>
+#include <elle/reactor/signal.hh>
 
 // FIXME: can be avoided with a `Dock` accessor in `Overlay`
 #include <infinit/model/doughnut/Doughnut.hh>
@@ -32,6 +38,7 @@ namespace infinit
       /// A set of Address, used in RPCs.
       using AddressSet = std::unordered_set<Address>;
       using EntryChangeSet = std::unordered_map<Address, bool>;
+      using Digest = AddressBook::Digest;
       /// Peer configuration
       using Configuration = elle::das::tuple<
         decltype(symbols::storing)::Formal<bool>>;
@@ -44,44 +51,20 @@ namespace infinit
           return std::chrono::duration_cast<std::chrono::milliseconds>(
                 t.time_since_epoch()).count();
         }
-      }
-
-      /*------.
-      | Entry |
-      `------*/
-
-      Kouncil::Entry::Entry(Address node, Address block)
-        : _node(std::move(node))
-        , _block(std::move(block))
-      {}
-
-      static
-      std::size_t
-      hash_value(Kouncil::Entry const& entry)
-      {
-        std::size_t seed = 0;
-        boost::hash_combine(seed, entry.node());
-        boost::hash_combine(seed, entry.block());
-        return seed;
-      }
 
-      static
-      bool
-      operator ==(Kouncil::Entry const& lhs, Kouncil::Entry const& rhs)
-      {
-        return lhs.node() == rhs.node() && lhs.block() == rhs.block();
-      }
-
-// This is unused, but could prove useful while debugging.
-#if 0
-      static
-      std::ostream&
-      operator <<(std::ostream& os, Kouncil::Entry const& e)
-      {
-        return elle::fprintf(os, is_fixed(os) ? "%f @ %f" : "%s @ %s",
-                             e.block(), e.node());
+        /// Delay to accumulate entry changes before broadcasting them.
+        auto const broadcast_delay = boost::posix_time::milliseconds(
+          elle::os::getenv("INFINIT_KOUNCIL_BROADCAST_DELAY_MS", 0));
+        /// Number of peers queried in parallel for unknown blocks.
+        auto const lookup_fanout =
+          elle::os::getenv("INFINIT_KOUNCIL_LOOKUP_FANOUT", 3);
+        /// Delay after which another peer is queried for unknown blocks.
+        auto const lookup_hedge_delay = boost::posix_time::milliseconds(
+          elle::os::getenv("INFINIT_KOUNCIL_LOOKUP_HEDGE_DELAY_MS", 200));
+        /// Delay between two anti-entropy rounds.
+        auto const anti_entropy_interval = boost::posix_time::seconds(
+          elle::os::getenv("INFINIT_KOUNCIL_ANTI_ENTROPY_INTERVAL", 60));
       }
-#endif
 
       /*-------------.
       | Construction |
@@ -95,6 +78,9 @@ namespace infinit
         , _broadcast_thread(new elle::reactor::Thread(
                               elle::sprintf("%s: broadcast", this),
                               [this] { this->_broadcast(); }))
+        , _anti_entropy_thread(new elle::reactor::Thread(
+                                 elle::sprintf("%s: anti-entropy", this),
+                                 [this] { this->_anti_entropy(); }))
         , _eviction_delay(
           eviction_delay.value_or(std::chrono::seconds{200 * 60}))
       {
@@ -133,12 +119,9 @@ namespace infinit
                   {
                     for (auto const& entry: entries)
                       if (entry.second)
-                        this->_address_book.emplace(r.id(), entry.first);
+                        this->_address_book.insert(r.id(), entry.first);
                       else
-                      {
-                        Entry e(r.id(), entry.first);
-                        this->_address_book.get<2>().erase(e);
-                      }
+                        this->_address_book.erase(r.id(), entry.first);
                     ELLE_TRACE("%s: added/removed %s entries from %f",
                                this, entries.size(), r.id());
                     this->_update_reachable_blocks();
@@ -149,7 +132,7 @@ namespace infinit
                   [this, &r] (AddressSet const& entries)
                   {
                     for (auto const& addr: entries)
-                      this->_address_book.emplace(r.id(), addr);
+                      this->_address_book.insert(r.id(), addr);
                     ELLE_TRACE("%s: added %s entries from %f",
                                this, entries.size(), r.id());
                     this->_update_reachable_blocks();
@@ -197,7 +180,7 @@ namespace infinit
        this->_infos.emplace(local->id(), local_endpoints, Clock::now(),
                             LamportAge(), this->storing());
        for (auto const& key: local->storage()->list())
-         this->_address_book.emplace(this->id(), key);
+         this->_address_book.insert(this->id(), key);
        this->_update_reachable_blocks();
        ELLE_DEBUG("loaded %s entries from storage",
                   this->_address_book.size());
@@ -205,7 +188,7 @@ namespace infinit
          [this] (model::blocks::Block const& b)
          {
            ELLE_DEBUG("%s: register new block %f", this, b.address());
-           this->_address_book.emplace(this->id(), b.address());
+           this->_address_book.insert(this->id(), b.address());
            this->_new_entries.emplace(b.address(), true);
            this->_update_reachable_blocks();
          }));
@@ -213,8 +196,7 @@ namespace infinit
          [this] (model::blocks::Block const& b)
          {
            ELLE_DEBUG("%s: unregister block %f", this, b.address());
-           auto entry = Entry(this->id(), b.address());
-           ELLE_ENFORCE_EQ(this->_address_book.get<2>().erase(entry), 1u);
+           ELLE_ENFORCE(this->_address_book.erase(this->id(), b.address()));
            this->_new_entries.emplace(b.address(), false);
            this->_update_reachable_blocks();
          }));
@@ -227,9 +209,41 @@ namespace infinit
              "kouncil_fetch_entries",
              [this] ()
              {
+               auto const blocks = this->_address_book.blocks(this->id());
+               return AddressSet(blocks.begin(), blocks.end());
+             });
+           // Digest version and digest of the blocks owned by this node. The
+           // digest is empty if it matches the given root, or if it is
+           // computed differently than the caller's.
+           rpcs.add(
+             "kouncil_entries_digest",
+             [this] (int version, int64_t root)
+             {
+               auto res = std::make_pair(AddressBook::digest_version,
+                                         Digest{});
+               if (version != AddressBook::digest_version)
+                 return res;
+               res.second = this->_address_book.digest(this->id());
+               if (AddressBook::digest_root(res.second) == root)
+                 res.second.clear();
+               return res;
+             });
+           // List blocks owned by this node in the given digest buckets.
+           rpcs.add(
+             "kouncil_fetch_entries_buckets",
+             [this] (std::vector<int> const& buckets)
+             {
+               auto wanted = std::vector<bool>(AddressBook::digest_buckets);
+               for (auto b: buckets)
+               {
+                 if (b < 0 || b >= AddressBook::digest_buckets)
+                   elle::err("invalid digest bucket: %s", b);
+                 wanted[b] = true;
+               }
                auto res = AddressSet{};
-               for (auto const& e: elle::equal_range(this->_address_book, this->id()))
-                 res.emplace(e.block());
+               for (auto const& b: this->_address_book.blocks(this->id()))
+                 if (wanted[AddressBook::bucket(b)])
+                   res.emplace(b);
                return res;
              });
            // Lookup owners of a block on this node.
@@ -237,9 +251,22 @@ namespace infinit
              "kouncil_lookup",
              [this] (Address const& addr)
              {
-               auto res = AddressSet{};
-               for (auto const& e: elle::equal_range(_address_book.get<1>(), addr))
-                 res.emplace(e.node());
+               auto const owners = this->_address_book.owners(addr);
+               return AddressSet(owners.begin(), owners.end());
+             });
+           // Lookup owners of several blocks on this node, omitting unknown
+           // ones.
+           rpcs.add(
+             "kouncil_lookup_batch",
+             [this] (std::vector<Address> const& addresses)
+             {
+               auto res = Owners{};
+               for (auto const& addr: addresses)
+               {
+                 auto const owners = this->_address_book.owners(addr);
+                 if (!owners.empty())
+                   res.emplace(addr, AddressSet(owners.begin(), owners.end()));
+               }
                return res;
              });
            // Send known peers to this node and retrieve its known peers.
@@ -280,6 +307,7 @@ namespace infinit
         ELLE_TRACE_SCOPE("%s: destruct", this);
         // Stop all background operations.
         this->_broadcast_thread->terminate_now();
+        this->_anti_entropy_thread->terminate_now();
         {
           // Make sure none of the tasks will wake up during the
           // clear() and try to push a new task.
@@ -379,15 +407,23 @@ namespace infinit
       {
         while (true)
         {
-          // Get all the available new entries, waiting for at least one.
+          // Wait for a first change, and let more of them accumulate to send
+          // them at once.
+          auto first = this->_new_entries.get();
+          if (broadcast_delay.total_milliseconds() > 0)
+            elle::reactor::sleep(broadcast_delay);
           if (this->doughnut()->version() >= elle::Version(0, 8, 0))
           {
             auto entries = [&]
               {
                 auto res = EntryChangeSet{};
-                do
-                  res.emplace(this->_new_entries.get());
-                while (!this->_new_entries.empty());
+                // The last change of a block wins.
+                res[first.first] = first.second;
+                while (!this->_new_entries.empty())
+                {
+                  auto e = this->_new_entries.get();
+                  res[e.first] = e.second;
+                }
                 return res;
               }();
             ELLE_TRACE("%s: broadcast entry changes: %f", this, entries);
@@ -399,13 +435,14 @@ namespace infinit
             auto entries = [&]
               {
                 auto res = AddressSet{};
-                do
+                if (first.second)
+                  res.emplace(first.first);
+                while (!this->_new_entries.empty())
                 {
                   auto e = this->_new_entries.get();
                   if (e.second)
                     res.emplace(e.first);
                 }
-                while (!this->_new_entries.empty());
                 return res;
               }();
             ELLE_TRACE("%s: broadcast new entry: %f", this, entries);
@@ -415,6 +452,90 @@ namespace infinit
         }
       }
 
+      void
+      Kouncil::_synchronize_entries(Remote& r)
+      {
+        ELLE_TRACE_SCOPE("%s: synchronize entries of %f", this, r);
+        auto const local = this->_address_book.digest(r.id());
+        auto digest =
+          r.make_rpc<auto (int, int64_t) -> std::pair<int, Digest>>(
+            "kouncil_entries_digest");
+        auto const remote =
+          digest(AddressBook::digest_version, AddressBook::digest_root(local));
+        auto differ = std::vector<bool>(local.size(), true);
+        auto entries = AddressSet{};
+        if (remote.first != AddressBook::digest_version)
+        {
+          ELLE_DEBUG("fetch all entries, digest version %s differs",
+                     remote.first);
+          auto fetch =
+            r.make_rpc<auto () -> AddressSet>("kouncil_fetch_entries");
+          entries = fetch();
+        }
+        else if (remote.second.empty())
+        {
+          ELLE_DEBUG("entries are up to date");
+          return;
+        }
+        else
+        {
+          if (remote.second.size() != local.size())
+            elle::err("invalid digest size from %f: %s",
+                      r, remote.second.size());
+          auto buckets = std::vector<int>{};
+          for (int i = 0; i < signed(local.size()); ++i)
+            if (local[i] != remote.second[i])
+              buckets.emplace_back(i);
+            else
+              differ[i] = false;
+          ELLE_DEBUG("fetch %s differing buckets out of %s",
+                     buckets.size(), local.size());
+          auto fetch =
+            r.make_rpc<auto (std::vector<int> const&) -> AddressSet>(
+              "kouncil_fetch_entries_buckets");
+          entries = fetch(buckets);
+        }
+        auto removed = 0;
+        for (auto const& b: this->_address_book.blocks(r.id()))
+          if (differ[AddressBook::bucket(b)] && !entries.count(b))
+          {
+            this->_address_book.erase(r.id(), b);
+            ++removed;
+          }
+        auto added = 0;
+        for (auto const& b: entries)
+          if (this->_address_book.insert(r.id(), b))
+            ++added;
+        ELLE_DEBUG("added %s and removed %s entries", added, removed);
+        if (added || removed)
+          this->_update_reachable_blocks();
+      }
+
+      void
+      Kouncil::_anti_entropy()
+      {
+        if (this->doughnut()->version() < elle::Version(0, 9, 0))
+          return;
+        while (true)
+        {
+          elle::reactor::sleep(anti_entropy_interval);
+          auto remotes = std::vector<std::shared_ptr<Remote>>{};
+          for (auto const& peer: this->_peers)
+            if (auto r = std::dynamic_pointer_cast<Remote>(peer))
+              remotes.emplace_back(std::move(r));
+          for (auto r: elle::pick_n(std::min<int>(1, remotes.size()), remotes))
+            try
+            {
+              this->_synchronize_entries(**r);
+            }
+            catch (elle::Error const& e)
+            {
+              ELLE_TRACE("%s: unable to synchronize entries of %f: %s",
+                         this, **r, e.what());
+            }
+        }
+      }
+
       /*------.
       | Peers |
       `------*/
@@ -514,7 +635,12 @@ namespace infinit
               pi.storing(boost::none);
             });
         this->_peers.erase(id);
-        this->_address_book.erase(id);
+        // Keep the entries of the peer aside, to synchronize them by digest
+        // if it comes back.
+        if (this->doughnut()->version() >= elle::Version(0, 9, 0))
+          this->_address_book.suspend(id);
+        else
+          this->_address_book.erase(id);
         this->_update_reachable_blocks();
         peer.reset();
         if (!this->_cleaning)
@@ -606,62 +732,196 @@ namespace infinit
       }
 
       auto
-      Kouncil::_lookup(Address address, int n, bool) const
-        -> MemberGenerator
+      Kouncil::_lookup(std::vector<Address> const& addresses, int n) const
+        -> LocationGenerator
       {
-        return [this, address, n](MemberGenerator::yielder const& yield)
+        return [this, addresses, n] (LocationGenerator::yielder const& yield)
           {
-            int count = 0;
-            for (auto const& entry:
-                   elle::equal_range(this->_address_book.get<1>(), address))
-              if (auto p = elle::find(this->peers(), entry.node()))
+            auto missing = std::vector<Address>{};
+            for (auto const& address: addresses)
+            {
+              int count = 0;
+              for (auto const& p: this->_connected_owners(address))
               {
-                yield(*p);
+                yield(std::make_pair(address, WeakMember(p)));
                 if (++count >= n)
                   break;
               }
+              if (count == 0)
+                missing.emplace_back(address);
+            }
+            if (missing.empty())
+              return;
+            ELLE_TRACE_SCOPE("%s: %s blocks not found, checking peers",
+                             this, missing.size());
+            for (auto const& owners: this->_lookup_missing(missing))
+            {
+              int count = 0;
+              for (auto const& node: owners.second)
+                try
+                {
+                  yield(std::make_pair(owners.first, this->lookup_node(node)));
+                  if (++count >= n)
+                    break;
+                }
+                catch (NodeNotFound const&)
+                {
+                  ELLE_WARN("node %f is said to hold block %f "
+                            "but is unknown to us", node, owners.first);
+                }
+            }
+          };
+      }
+
+      auto
+      Kouncil::_lookup(Address address, int n, bool) const
+        -> MemberGenerator
+      {
+        return [this, address, n](MemberGenerator::yielder const& yield)
+          {
+            int count = 0;
+            for (auto const& p: this->_connected_owners(address))
+            {
+              yield(p);
+              if (++count >= n)
+                break;
+            }
             if (count == 0)
             {
-              ELLE_TRACE_SCOPE("%s: block %f not found, checking all %s peers",
-                               this, address, this->peers().size());
-              for (auto peer: this->peers())
-              {
-                // FIXME: handle local!
-                if (auto r = std::dynamic_pointer_cast<Remote>(peer))
+              ELLE_TRACE_SCOPE("%s: block %f not found, checking peers",
+                               this, address);
+              auto const found = this->_lookup_missing({address});
+              if (found.empty())
+                return;
+              for (auto const& node: found.begin()->second)
+                try
+                {
+                  yield(this->lookup_node(node));
+                  if (++count >= n)
+                    break;
+                }
+                catch (NodeNotFound const&)
+                {
+                  ELLE_WARN("node %f is said to hold block %f "
+                            "but is unknown to us", node, address);
+                }
+            }
+          };
+      }
+
+      auto
+      Kouncil::_connected_owners(Address const& address) const
+        -> Members
+      {
+        auto res = Members{};
+        for (auto const& node: this->_address_book.owners(address))
+          if (auto p = elle::find(this->peers(), node))
+            res.emplace_back(*p);
+        model::doughnut::sort_by_latency(res);
+        return res;
+      }
+
+      auto
+      Kouncil::_lookup_missing(std::vector<Address> const& addresses) const
+        -> Owners
+      {
+        auto res = Owners{};
+        auto pending = AddressSet(addresses.begin(), addresses.end());
+        // FIXME: handle local!
+        auto remotes = std::vector<std::shared_ptr<Remote>>{};
+        for (auto const& peer: this->peers())
+          if (auto r = std::dynamic_pointer_cast<Remote>(peer))
+            remotes.emplace_back(std::move(r));
+        // Spread the load of misses over peers.
+        elle::shuffle(remotes);
+        ELLE_DEBUG_SCOPE("query up to %s peers, %s at once",
+                         remotes.size(), lookup_fanout);
+        auto next = 0;
+        auto running = 0;
+        auto answered = elle::reactor::Signal{};
+        elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& s)
+        {
+          auto query = [&]
+            {
+              auto r = remotes[next++];
+              ++running;
+              auto wanted = std::vector<Address>(pending.begin(), pending.end());
+              s.run_background(
+                elle::sprintf("%s: lookup on %f", this, r),
+                [&, r, wanted = std::move(wanted)]
                 {
-                  using Lookup = auto (Address) -> AddressSet;
-                  auto lookup = r->make_rpc<Lookup>("kouncil_lookup");
                   try
                   {
-                    for (auto node: lookup(address))
+                    for (auto& owners: this->_lookup_remote(*r, wanted))
                     {
-                      try
-                      {
-                        ELLE_DEBUG("peer %f says node %f holds block %f",
-                                   r->id(), node, address);
-                        yield(this->lookup_node(node));
-                        if (++count >= n)
-                          break;
-                      }
-                      catch (NodeNotFound const&)
-                      {
-                        ELLE_WARN("node %f is said to hold block %f "
-                                  "but is unknown to us", node, address);
-                      }
+                      ELLE_DEBUG("peer %f says nodes %f hold block %f",
+                                 r->id(), owners.second, owners.first);
+                      pending.erase(owners.first);
+                      res[owners.first].insert(owners.second.begin(),
+                                               owners.second.end());
                     }
                   }
-                  catch (elle::reactor::network::Error const& e)
+                  catch (elle::Error const& e)
                   {
-                    ELLE_DEBUG("skipping peer with network issue: %s (%s)",
-                               peer, e);
-                    continue;
+                    // Whatever the peer failure, others may know.
+                    ELLE_DEBUG("skipping peer failing to look up: %s (%s)",
+                               r, e);
                   }
-                  if (count > 0)
-                    return;
-                }
-              }
+                  --running;
+                  answered.signal();
+                });
+            };
+          while (!pending.empty())
+          {
+            while (running < lookup_fanout && next < signed(remotes.size()))
+              query();
+            if (running == 0)
+              break;
+            if (!elle::reactor::wait(answered, lookup_hedge_delay) &&
+                running < 2 * lookup_fanout && next < signed(remotes.size()))
+            {
+              ELLE_DEBUG("peers are slow to answer, hedge with another one");
+              query();
             }
-          };
+          }
+          s.terminate_now();
+        };
+        // Remember owners we are connected to.
+        auto& book = elle::unconst(this)->_address_book;
+        auto cached = false;
+        for (auto const& owners: res)
+          for (auto const& node: owners.second)
+            if (elle::find(this->peers(), node))
+              cached |= book.insert(node, owners.first);
+        if (cached)
+          elle::unconst(this)->_update_reachable_blocks();
+        return res;
+      }
+
+      auto
+      Kouncil::_lookup_remote(Remote& r,
+                              std::vector<Address> const& addresses) const
+        -> Owners
+      {
+        auto res = Owners{};
+        if (addresses.size() > 1 &&
+            this->doughnut()->version() >= elle::Version(0, 9, 0))
+        {
+          using LookupBatch = auto (std::vector<Address> const&) -> Owners;
+          res = r.make_rpc<LookupBatch>("kouncil_lookup_batch")(addresses);
+        }
+        else
+        {
+          using Lookup = auto (Address) -> AddressSet;
+          auto lookup = r.make_rpc<Lookup>("kouncil_lookup");
+          for (auto const& address: addresses)
+          {
+            auto owners = lookup(address);
+            if (!owners.empty())
+              res.emplace(address, std::move(owners));
+          }
+        }
+        return res;
       }
 
       auto
@@ -808,11 +1068,19 @@ namespace infinit
       Kouncil::_fetch_entries(Remote& r)
       {
         ELLE_TRACE_SCOPE("%f: fetch_entries of %f", this, r);
+        ELLE_ASSERT(r.id());
+        if (this->_address_book.resume(r.id()))
+        {
+          // Restore what we knew of the peer and only fetch the difference.
+          ELLE_DEBUG("restored entries of %f", r);
+          this->_synchronize_entries(r);
+          this->_update_reachable_blocks();
+          return;
+        }
         auto fetch = r.make_rpc<auto () -> AddressSet>("kouncil_fetch_entries");
         auto entries = fetch();
-        ELLE_ASSERT(r.id());
         for (auto const& b: entries)
-          this->_address_book.emplace(r.id(), b);
+          this->_address_book.insert(r.id(), b);
         ELLE_DEBUG("added %s entries from %f", entries.size(), r);
         this->_update_reachable_blocks();
       }
@@ -821,13 +1089,14 @@ namespace infinit
       Kouncil::_compute_reachable_blocks() const
       {
         std::unordered_map<Address, int> ids_mutable, ids_immutable;
-        for (auto const& entry: this->_address_book.get<2>())
-        {
-          if (entry.block().mutable_block())
-            ids_mutable[entry.block()] += 1;
-          else
-            ids_immutable[entry.block()] += 1;
-        }
+        this->_address_book.for_each(
+          [&] (Address const& block, int owners)
+          {
+            if (block.mutable_block())
+              ids_mutable[block] = owners;
+            else
+              ids_immutable[block] = owners;
+          });
         Overlay::ReachableBlocks res {0,0,0,0,0,0,0};
         res.total_blocks = ids_mutable.size() + ids_immutable.size();
         res.mutable_blocks = ids_mutable.size();
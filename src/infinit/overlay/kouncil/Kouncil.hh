@@ -15,6 +15,7 @@
 
 #include <infinit/model/doughnut/Peer.hh>
 #include <infinit/overlay/Overlay.hh>
+#include <infinit/overlay/kouncil/AddressBook.hh>
 
 namespace infinit
 {
@@ -67,27 +68,6 @@ namespace infinit
 
         /// Node and blocks address.
         using Address = model::Address;
-        /// Address book entry.
-        class Entry
-        {
-        public:
-          Entry(Address node, Address block);
-          ELLE_ATTRIBUTE_R(Address, node);
-          ELLE_ATTRIBUTE_R(Address, block);
-        };
-
-        /// Node / owned block addresses mapping.
-        using AddressBook = bmi::multi_index_container<
-          Entry,
-          bmi::indexed_by<
-            bmi::hashed_non_unique<
-              bmi::const_mem_fun<
-                Entry, Address const&, &Entry::node>>,
-            bmi::hashed_non_unique<
-              bmi::const_mem_fun<
-                Entry, Address const&, &Entry::block>>,
-            bmi::hashed_unique<
-              bmi::identity<Entry>>>>;
         /// Peers by id.
         using Peer = Overlay::Member;
         using Peers =
@@ -164,6 +144,19 @@ namespace infinit
         ELLE_ATTRIBUTE((elle::reactor::Channel<std::pair<Address, bool>>),
                        new_entries);
         ELLE_ATTRIBUTE(elle::reactor::Thread::unique_ptr, broadcast_thread);
+        /// Fetch the blocks of @a r that differ from our address book, by
+        /// comparing digests.
+        ///
+        /// The blocks of disconnected peers are suspended in the address book
+        /// until they are evicted, so they only need to be synchronized when
+        /// the peers come back.
+        void
+        _synchronize_entries(Remote& r);
+        /// Periodically synchronize entries with a random peer, to repair
+        /// lost broadcasts.
+        void
+        _anti_entropy();
+        ELLE_ATTRIBUTE(elle::reactor::Thread::unique_ptr, anti_entropy_thread);
 
       /*------.
       | Peers |
@@ -312,10 +305,28 @@ namespace infinit
       protected:
         MemberGenerator
         _allocate(Address address, int n) const override;
+        LocationGenerator
+        _lookup(std::vector<Address> const& addresses, int n) const override;
         MemberGenerator
         _lookup(Address address, int n, bool fast) const override;
         WeakMember
         _lookup_node(Address address) const override;
+      private:
+        /// Owners of @a address we are connected to, closest first.
+        Members
+        _connected_owners(Address const& address) const;
+        /// Owners of blocks, by block.
+        using Owners = std::unordered_map<Address, std::unordered_set<Address>>;
+        /// Ask peers for the owners of blocks missing from our address book.
+        ///
+        /// A few peers are queried in parallel, and another one is queried
+        /// whenever they are too slow to answer, until every block is found or
+        /// all peers were asked. Owners found are cached in the address book.
+        Owners
+        _lookup_missing(std::vector<Address> const& addresses) const;
+        /// Ask @a r for the owners of @a addresses.
+        Owners
+        _lookup_remote(Remote& r, std::vector<Address> const& addresses) const;
 
       /*-----------.
       | Monitoring |
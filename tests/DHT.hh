@@ -7,6 +7,7 @@
 #include <infinit/model/doughnut/Doughnut.hh>
 #include <infinit/model/doughnut/Local.hh>
 #include <infinit/model/doughnut/consensus/Paxos.hh>
+#include <infinit/overlay/Rendezvous.hh>
 #include <infinit/overlay/kelips/Kelips.hh>
 #include <infinit/overlay/kouncil/Kouncil.hh>
 #include <infinit/silo/Memory.hh>
@@ -559,6 +560,14 @@ get_kouncil(DHT& client)
     (client.dht->overlay().get());
 }
 
+/// The Rendezvous node in this client.
+auto*
+get_rendezvous(DHT& client)
+{
+  return dynamic_cast<infinit::overlay::Rendezvous*>
+    (client.dht->overlay().get());
+}
+
 
 /// An Address easy to read in the logs.
 infinit::model::Address
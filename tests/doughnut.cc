@@ -4,6 +4,7 @@
 #include <boost/signals2/connection.hpp>
 
 #include <elle/cast.hh>
+#include <elle/cryptography/hash.hh>
 #include <elle/filesystem/TemporaryDirectory.hh>
 #include <elle/find.hh>
 #include <elle/log.hh>
@@ -23,18 +24,23 @@
 #include <infinit/model/blocks/ImmutableBlock.hh>
 #include <infinit/model/blocks/MutableBlock.hh>
 #include <infinit/model/doughnut/ACB.hh>
+#include <infinit/model/doughnut/BlockCodec.hh>
 #include <infinit/model/doughnut/Cache.hh>
 #include <infinit/model/doughnut/Doughnut.hh>
 #include <infinit/model/doughnut/Group.hh>
+#include <infinit/model/doughnut/KeyTable.hh>
 #include <infinit/model/doughnut/Local.hh>
 #include <infinit/model/doughnut/NB.hh>
 #include <infinit/model/doughnut/Remote.hh>
+#include <infinit/model/doughnut/SecretCache.hh>
 #include <infinit/model/doughnut/UB.hh>
 #include <infinit/model/doughnut/User.hh>
 #include <infinit/model/doughnut/ValidationFailed.hh>
 #include <infinit/model/doughnut/consensus/Paxos.hh>
+#include <infinit/model/doughnut/sha256.hh>
 #include <infinit/overlay/Stonehenge.hh>
 #include <infinit/silo/Memory.hh>
+#include <infinit/silo/MissingKey.hh>
 
 #include "DHT.hh"
 
@@ -2234,6 +2240,560 @@ ELLE_TEST_SCHEDULED(disabled_crypto)
   BOOST_CHECK_EQUAL(bic->data(), "canard");
 }
 
+ELLE_TEST_SCHEDULED(rpc_latency)
+{
+  DHTs dhts(false);
+  auto remote = std::dynamic_pointer_cast<dht::Remote>(
+    dhts.dht_a->overlay()->lookup_node(dhts.dht_b->id()).lock());
+  BOOST_REQUIRE(remote);
+  auto block =
+    dhts.dht_a->make_block<blocks::ImmutableBlock>(elle::Buffer("latency"));
+  block->seal();
+  dhts.dht_b->local()->store(*block, infinit::model::STORE_INSERT);
+  ELLE_LOG("failed requests are not measured")
+  {
+    auto const count = remote->rtt_count();
+    auto const rtt = remote->rtt();
+    BOOST_CHECK_THROW(remote->fetch(Address::random(0), boost::none),
+                      infinit::model::MissingBlock);
+    BOOST_CHECK_EQUAL(remote->rtt_count(), count);
+    BOOST_CHECK(remote->rtt() == rtt);
+    BOOST_CHECK_EQUAL(remote->in_flight(), 0);
+  }
+  ELLE_LOG("successful requests are measured")
+  {
+    auto const count = remote->rtt_count();
+    BOOST_CHECK_EQUAL(remote->fetch(block->address(), boost::none)->data(),
+                      "latency");
+    BOOST_CHECK_EQUAL(remote->rtt_count(), count + 1);
+    BOOST_CHECK_GT(remote->rtt().count(), 0);
+    BOOST_CHECK_EQUAL(remote->in_flight(), 0);
+  }
+}
+
+ELLE_TEST_SCHEDULED(bulk_connection_failure)
+{
+  DHTs dhts(false);
+  auto& local = *dhts.dht_b->local();
+  auto bulk_fetches = 0;
+  local.on_connect().connect(
+    [&] (infinit::RPCServer& rpcs)
+    {
+      rpcs.add(
+        "fetch",
+        [&] (Address address, boost::optional<int> local_version)
+        {
+          for (auto const& c: local.peers())
+            if (c->bulk() && &c->rpcs() == &rpcs)
+            {
+              ELLE_LOG("close bulk connection %s", c);
+              ++bulk_fetches;
+              namespace net = elle::reactor::network;
+              if (auto s = dynamic_cast<net::TCPSocket*>(c->stream().get()))
+                s->close();
+              else if (auto s =
+                       dynamic_cast<net::UTPSocket*>(c->stream().get()))
+                s->close();
+            }
+          return local.fetch(address, local_version);
+        });
+    });
+  auto block =
+    dhts.dht_a->make_block<blocks::ImmutableBlock>(elle::Buffer("bulk"));
+  block->seal();
+  local.store(*block, infinit::model::STORE_INSERT);
+  auto remote = std::dynamic_pointer_cast<dht::Remote>(
+    dhts.dht_a->overlay()->lookup_node(dhts.dht_b->id()).lock());
+  BOOST_REQUIRE(remote);
+  remote->connect();
+  while (!remote->bulk_connection() || !remote->bulk_connection()->connected())
+    elle::reactor::sleep(10_ms);
+  auto const control = remote->connection();
+  auto disconnections = 0;
+  remote->disconnected().connect([&] { ++disconnections; });
+  auto& metrics = dhts.dht_a->dock().metrics(dht::Dock::Traffic::bulk);
+  auto const failures = metrics.failures;
+  ELLE_LOG("fetch through the bulk connection")
+    BOOST_CHECK_EQUAL(remote->fetch(block->address(), boost::none)->data(),
+                      "bulk");
+  BOOST_CHECK_EQUAL(bulk_fetches, 1);
+  BOOST_CHECK_EQUAL(metrics.failures, failures + 1);
+  ELLE_LOG("check the control connection is still up")
+  {
+    BOOST_CHECK_EQUAL(remote->connection(), control);
+    BOOST_CHECK(control->connected());
+    BOOST_CHECK(!control->disconnected());
+    BOOST_CHECK_EQUAL(disconnections, 0);
+  }
+}
+
+ELLE_TEST_SCHEDULED(secret_cache)
+{
+  auto const key = elle::cryptography::rsa::keypair::generate(512).K();
+  auto const other = elle::cryptography::rsa::keypair::generate(512).K();
+  auto unwraps = 0;
+  auto unwrap = [&] (std::string secret)
+    {
+      return [&unwraps, secret]
+        {
+          ++unwraps;
+          return elle::Buffer(secret);
+        };
+    };
+  auto wiped = std::vector<elle::Buffer>{};
+  auto zeroed = [] (elle::Buffer const& b)
+    {
+      return std::all_of(b.begin(), b.end(), [] (auto c) { return c == 0; });
+    };
+  ELLE_LOG("evict least recently used secrets")
+  {
+    auto cache = dht::SecretCache(2);
+    cache.on_wipe().connect(
+      [&] (elle::Buffer const& b) { wiped.emplace_back(b); });
+    BOOST_CHECK_EQUAL(cache.get(elle::Buffer("a"), key, unwrap("secret a")),
+                      "secret a");
+    BOOST_CHECK_EQUAL(cache.get(elle::Buffer("b"), key, unwrap("secret b")),
+                      "secret b");
+    BOOST_CHECK_EQUAL(cache.get(elle::Buffer("a"), key, unwrap("other")),
+                      "secret a");
+    BOOST_CHECK_EQUAL(unwraps, 2);
+    BOOST_CHECK_EQUAL(cache.hits(), 1);
+    BOOST_CHECK_EQUAL(cache.get(elle::Buffer("c"), key, unwrap("secret c")),
+                      "secret c");
+    BOOST_CHECK_EQUAL(cache.size(), 2u);
+    BOOST_CHECK_EQUAL(cache.evictions(), 1);
+    ELLE_LOG("evicted secrets are wiped")
+    {
+      BOOST_REQUIRE_EQUAL(wiped.size(), 1u);
+      BOOST_CHECK_EQUAL(wiped[0].size(), 8u);
+      BOOST_CHECK(zeroed(wiped[0]));
+    }
+    BOOST_CHECK_EQUAL(cache.get(elle::Buffer("a"), key, unwrap("other")),
+                      "secret a");
+    BOOST_CHECK_EQUAL(cache.get(elle::Buffer("b"), key, unwrap("secret b")),
+                      "secret b");
+    BOOST_CHECK_EQUAL(unwraps, 4);
+    ELLE_LOG("tokens are bound to their key")
+      BOOST_CHECK_EQUAL(
+        cache.get(elle::Buffer("b"), other, unwrap("secret b'")),
+        "secret b'");
+    BOOST_CHECK_EQUAL(unwraps, 5);
+    ELLE_LOG("shrink")
+    {
+      cache.capacity(1);
+      BOOST_CHECK_EQUAL(cache.size(), 1u);
+    }
+  }
+  ELLE_LOG("remaining secrets are wiped on destruction")
+  {
+    BOOST_CHECK_EQUAL(wiped.size(), 5u);
+    for (auto const& b: wiped)
+      BOOST_CHECK(zeroed(b));
+  }
+  ELLE_LOG("capacity 0 disables the cache")
+  {
+    auto cache = dht::SecretCache(0);
+    unwraps = 0;
+    for (int i = 0; i < 2; ++i)
+      BOOST_CHECK_EQUAL(cache.get(elle::Buffer("a"), key, unwrap("secret a")),
+                        "secret a");
+    BOOST_CHECK_EQUAL(unwraps, 2);
+    BOOST_CHECK_EQUAL(cache.size(), 0u);
+    BOOST_CHECK_EQUAL(cache.hits(), 0);
+    cache.capacity(-1);
+    BOOST_CHECK_EQUAL(cache.capacity(), 0);
+  }
+}
+
+ELLE_TEST_SCHEDULED(trusted_storage, (bool, paxos))
+{
+  auto dht = DHT(::paxos = paxos);
+  auto& local = *dht.dht->local();
+  local.trusted_storage(true);
+  auto block =
+    dht.dht->make_block<blocks::ImmutableBlock>(elle::Buffer("trusted"));
+  auto const address = block->address();
+  dht.dht->seal_and_insert(*block);
+  {
+    auto fetched = local.fetch(address, boost::none);
+    BOOST_CHECK(fetched->validated());
+    BOOST_CHECK_EQUAL(fetched->data(), "trusted");
+  }
+  // Headers are still stripped once storage is not trusted anymore.
+  local.trusted_storage(false);
+  {
+    auto fetched = local.fetch(address, boost::none);
+    BOOST_CHECK(!fetched->validated());
+    BOOST_CHECK_EQUAL(fetched->data(), "trusted");
+  }
+  BOOST_CHECK_EQUAL(dht.dht->fetch(address)->data(), "trusted");
+  // Blocks stored untrusted bear no header, whatever their content.
+  auto const content = elle::Buffer(std::string(64, '\xfe'));
+  auto lookalike = dht.dht->make_block<blocks::ImmutableBlock>(content);
+  dht.dht->seal_and_insert(*lookalike);
+  BOOST_CHECK_NE(
+    local.storage()->get(lookalike->address()).contents()[0], 0xfe);
+  local.trusted_storage(true);
+  {
+    auto fetched = local.fetch(lookalike->address(), boost::none);
+    BOOST_CHECK(!fetched->validated());
+    BOOST_CHECK_EQUAL(fetched->data(), content);
+  }
+  // A header not matching the content is not trusted.
+  auto stored = local.storage()->get(address);
+  BOOST_CHECK_EQUAL(stored.contents()[0], 0xfe);
+  stored.mutable_contents()[1] ^= 1;
+  local.storage()->set(address, stored, false, true);
+  {
+    auto fetched = local.fetch(address, boost::none);
+    BOOST_CHECK(!fetched->validated());
+    BOOST_CHECK_EQUAL(fetched->data(), "trusted");
+  }
+}
+
+ELLE_TEST_SCHEDULED(signature_cache)
+{
+  DHTs dhts(true);
+  auto block = dhts.dht_a->make_block<blocks::ACLBlock>();
+  block->data(elle::Buffer("cached"));
+  dhts.dht_a->seal_and_insert(*block);
+  auto& cache = dhts.dht_b->signature_cache();
+  BOOST_CHECK_EQUAL(dhts.dht_b->fetch(block->address())->data(), "cached");
+  auto const misses = cache.misses();
+  auto const hits = cache.hits();
+  BOOST_CHECK_EQUAL(dhts.dht_b->fetch(block->address())->data(), "cached");
+  BOOST_CHECK_EQUAL(cache.misses(), misses);
+  BOOST_CHECK_GT(cache.hits(), hits);
+  // Invalid signatures are never cached.
+  auto const kp = elle::cryptography::rsa::keypair::generate(key_size());
+  auto const data = elle::Buffer("data");
+  auto const signature = kp.k().sign(data);
+  dht::SignatureCache other(16);
+  BOOST_CHECK(other.verify(kp.K(), signature, data));
+  BOOST_CHECK(other.verify(kp.K(), signature, data));
+  BOOST_CHECK_EQUAL(other.hits(), 1);
+  BOOST_CHECK(!other.verify(kp.K(), signature, elle::Buffer("atad")));
+  BOOST_CHECK(!other.verify(kp.K(), signature, elle::Buffer("atad")));
+  BOOST_CHECK_EQUAL(other.failures(), 2);
+  BOOST_CHECK_EQUAL(other.size(), 1);
+  ELLE_LOG("verify in the background")
+  {
+    dht::SignatureCache::Background background(other);
+    auto const signed_ = kp.k().sign(elle::Buffer("background"));
+    BOOST_CHECK(other.verify(kp.K(), signed_, elle::Buffer("background")));
+    BOOST_CHECK(!other.verify(kp.K(), signed_, elle::Buffer("foreground")));
+    BOOST_CHECK_EQUAL(other.failures(), 3);
+    BOOST_CHECK_EQUAL(other.size(), 2);
+  }
+  ELLE_LOG("verify fetched blocks concurrently")
+  {
+    auto addresses = std::vector<infinit::model::Model::AddressVersion>{};
+    for (int i = 0; i < 10; ++i)
+    {
+      auto b = dhts.dht_a->make_block<blocks::ACLBlock>();
+      b->data(elle::Buffer("batch"));
+      dhts.dht_a->seal_and_insert(*b);
+      addresses.emplace_back(b->address(), boost::none);
+    }
+    cache.clear();
+    auto const fetch_misses = cache.misses();
+    auto fetched = 0;
+    auto const receive = [&] (infinit::model::Address,
+                              std::unique_ptr<blocks::Block> b,
+                              std::exception_ptr e)
+      {
+        BOOST_CHECK(!e);
+        if (b && b->data() == "batch")
+          ++fetched;
+      };
+    dhts.dht_b->multifetch(addresses, receive);
+    BOOST_CHECK_EQUAL(fetched, 10);
+    BOOST_CHECK_GE(cache.misses() - fetch_misses, 10);
+    BOOST_CHECK_EQUAL(cache.failures(), 0);
+    auto const fetch_hits = cache.hits();
+    dhts.dht_b->multifetch(addresses, receive);
+    BOOST_CHECK_EQUAL(fetched, 20);
+    BOOST_CHECK_GE(cache.hits() - fetch_hits, 10);
+  }
+}
+
+ELLE_TEST_SCHEDULED(sha256_digest)
+{
+  namespace sha256 = dht::sha256;
+  auto const salt = elle::Buffer("salt");
+  auto messages = std::vector<sha256::Message>{};
+  auto contents = std::vector<elle::Buffer>{};
+  for (auto size: {0, 1, 64, 1000, 1024 * 1024})
+    contents.emplace_back(std::string(size, 'x'));
+  for (auto const& c: contents)
+    messages.emplace_back(sha256::Message{salt, c});
+  auto const digests = sha256::digest(messages);
+  BOOST_CHECK_EQUAL(digests.size(), contents.size());
+  for (auto i = 0u; i < contents.size(); ++i)
+  {
+    auto concatenated = elle::Buffer(salt);
+    concatenated.append(contents[i].contents(), contents[i].size());
+    auto const expected = elle::cryptography::hash(
+      concatenated, elle::cryptography::Oneway::sha256);
+    BOOST_CHECK_EQUAL(sha256::digest(messages[i]), expected);
+    BOOST_CHECK_EQUAL(digests[i], expected);
+  }
+  ELLE_LOG("batch concurrent digests")
+  {
+    sha256::Batch batch;
+    auto batched = std::vector<elle::Buffer>(messages.size());
+    elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& s)
+    {
+      for (auto i = 0u; i < messages.size(); ++i)
+        s.run_background(
+          elle::sprintf("digest %s", i),
+          [&, i]
+          {
+            sha256::Batch::Scope scope(batch);
+            batched[i] = batch.digest(messages[i]);
+          });
+      elle::reactor::wait(s);
+    };
+    for (auto i = 0u; i < messages.size(); ++i)
+      BOOST_CHECK_EQUAL(batched[i], digests[i]);
+    // Outside a scope, digests are not batched.
+    BOOST_CHECK_EQUAL(batch.digest(messages.back()), digests.back());
+  }
+}
+
+ELLE_TEST_SCHEDULED(batch_seal)
+{
+  DHTs dhts(true);
+  auto sealed = std::vector<std::unique_ptr<blocks::MutableBlock>>{};
+  auto pointers = std::vector<blocks::Block*>{};
+  for (int i = 0; i < 4; ++i)
+  {
+    auto b = dhts.dht_a->make_block<blocks::ACLBlock>();
+    b->data(elle::Buffer(elle::sprintf("block %s", i)));
+    pointers.emplace_back(b.get());
+    sealed.emplace_back(std::move(b));
+  }
+  dhts.dht_a->seal(pointers);
+  for (int i = 0; i < 4; ++i)
+  {
+    // Sealing again does not bump the version.
+    auto const version = sealed[i]->version();
+    dhts.dht_a->seal_and_insert(*sealed[i]);
+    auto fetched = elle::cast<blocks::MutableBlock>::runtime(
+      dhts.dht_b->fetch(sealed[i]->address()));
+    BOOST_CHECK_EQUAL(fetched->data(),
+                      elle::Buffer(elle::sprintf("block %s", i)));
+    BOOST_CHECK_EQUAL(fetched->version(), version);
+  }
+}
+
+ELLE_TEST_SCHEDULED(key_table)
+{
+  auto& table = dht::KeyTable::instance();
+  auto const kp = elle::cryptography::rsa::keypair::generate(key_size());
+  auto const interned = table.intern(kp.K());
+  BOOST_CHECK_EQUAL(
+    table.intern(elle::cryptography::rsa::PublicKey(kp.K())).get(),
+    interned.get());
+  BOOST_CHECK_EQUAL(table.find(dht::KeyTable::hash(kp.K())).get(),
+                    interned.get());
+  // Known keys are found by their DER encoding without parsing it.
+  auto const hits = table.hits();
+  BOOST_CHECK_EQUAL(
+    table.intern_der(
+      elle::cryptography::rsa::publickey::der::encode(kp.K())).get(),
+    interned.get());
+  BOOST_CHECK_EQUAL(table.hits(), hits + 1);
+  // Keys failing to parse are not interned.
+  {
+    auto const garbage = elle::Buffer("not a key");
+    auto const hash = Address(
+      dht::sha256::digest(dht::sha256::Message{garbage}).contents());
+    BOOST_CHECK_THROW(table.intern_der(garbage), elle::Error);
+    BOOST_CHECK(!table.find(hash));
+    BOOST_CHECK_THROW(table.intern_der(garbage), elle::Error);
+  }
+  // Serialized keys read the PublicKey layout.
+  {
+    auto const data = elle::serialization::binary::serialize(kp.K());
+    auto const key = elle::serialization::binary::deserialize<
+      dht::KeyTable::Serialized>(data);
+    BOOST_CHECK_EQUAL(key.key.get(), interned.get());
+    auto serialized = dht::KeyTable::Serialized(interned);
+    BOOST_CHECK_EQUAL(elle::serialization::binary::serialize(serialized),
+                      data);
+  }
+  // Blocks deserialized separately share their owner key.
+  DHTs dhts(true);
+  auto block = dhts.dht_a->make_block<blocks::ACLBlock>();
+  block->data(elle::Buffer("interned"));
+  dhts.dht_a->seal_and_insert(*block);
+  auto first = elle::cast<dht::ACB>::runtime(
+    dhts.dht_b->fetch(block->address()));
+  auto second = elle::cast<dht::ACB>::runtime(
+    dhts.dht_b->fetch(block->address()));
+  BOOST_CHECK_EQUAL(first->owner_key().get(), second->owner_key().get());
+}
+
+ELLE_TEST_SCHEDULED(group_key_cache)
+{
+  DHTs dhts(true);
+  auto const gkey = [&]
+    {
+      dht::Group g(*dhts.dht_a, "g");
+      g.create();
+      g.add_member(dht::User(dhts.keys_b->K(), "bob"));
+      return g.public_control_key();
+    }();
+  auto block = dhts.dht_a->make_block<blocks::ACLBlock>();
+  block->data(elle::Buffer("shared"));
+  block->set_permissions(dht::User(gkey, "@g"), true, false);
+  dhts.dht_a->seal_and_insert(*block);
+  auto& cache = dhts.dht_b->group_key_cache();
+  BOOST_CHECK_EQUAL(dhts.dht_b->fetch(block->address())->data(), "shared");
+  BOOST_CHECK_EQUAL(cache.size(), 1);
+  auto const hits = cache.hits();
+  BOOST_CHECK_EQUAL(dhts.dht_b->fetch(block->address())->data(), "shared");
+  BOOST_CHECK_GT(cache.hits(), hits);
+  // Versions past the cached keys are not served.
+  BOOST_CHECK(cache.get(gkey, 0, true));
+  BOOST_CHECK(!cache.get(gkey, 1, true));
+  // Evicted key pairs are wiped.
+  auto wiped = 0;
+  cache.on_wipe().connect([&] (auto const&) { ++wiped; });
+  auto const gkey2 = [&]
+    {
+      dht::Group g(*dhts.dht_a, "g2");
+      g.create();
+      g.add_member(dht::User(dhts.keys_b->K(), "bob"));
+      return g.public_control_key();
+    }();
+  auto other = dhts.dht_a->make_block<blocks::ACLBlock>();
+  other->data(elle::Buffer("other"));
+  other->set_permissions(dht::User(gkey2, "@g2"), true, false);
+  dhts.dht_a->seal_and_insert(*other);
+  BOOST_CHECK(cache.get(gkey, 0, true));
+  cache.capacity(1);
+  BOOST_CHECK_EQUAL(dhts.dht_b->fetch(other->address())->data(), "other");
+  BOOST_CHECK_EQUAL(cache.size(), 1);
+  BOOST_CHECK(!cache.get(gkey, 0, false));
+  BOOST_CHECK_EQUAL(wiped, 1);
+  // Removing a member rotates the key and invalidates the admin's cache.
+  auto& admin_cache = dhts.dht_a->group_key_cache();
+  BOOST_CHECK(admin_cache.get(gkey, 0, false));
+  {
+    dht::Group g(*dhts.dht_a, "g");
+    g.remove_member(dht::User(dhts.keys_b->K(), "bob"));
+  }
+  BOOST_CHECK(!admin_cache.get(gkey, 0, false));
+}
+
+ELLE_TEST_SCHEDULED(block_codec)
+{
+  namespace codec = dht::codec;
+  DHTs dhts(true);
+  auto chb = dhts.dht_a->make_block<blocks::ImmutableBlock>(
+    elle::Buffer("content"));
+  chb->seal();
+  auto nb = std::make_unique<dht::NB>(
+    *dhts.dht_a, "name", elle::Buffer("named"));
+  nb->seal();
+  auto const passport = dht::Passport(
+    dhts.keys_b->K(), "network-name", *dhts.keys_a);
+  auto const ub = std::make_unique<dht::UB>(dhts.dht_a.get(), "b", passport);
+  auto const rub = std::make_unique<dht::UB>(
+    dhts.dht_a.get(), "b", dhts.keys_b->K(), true);
+  for (auto const* block: std::vector<blocks::Block const*>{
+         chb.get(), nb.get(), ub.get(), rub.get()})
+  {
+    BOOST_CHECK(codec::supported(*block));
+    auto const data = codec::encode(*block);
+    BOOST_CHECK(codec::compact(data));
+    auto const decoded = codec::deserialize(data, *dhts.dht_b);
+    BOOST_CHECK(typeid(*decoded) == typeid(*block));
+    BOOST_CHECK_EQUAL(decoded->address(), block->address());
+    BOOST_CHECK_EQUAL(decoded->data(), block->data());
+    BOOST_CHECK(decoded->validate(*dhts.dht_b, false));
+    BOOST_CHECK_EQUAL(codec::encode(*decoded), data);
+    BOOST_CHECK_THROW(
+      codec::decode(elle::ConstWeakBuffer(data.contents(), data.size() - 1),
+                    *dhts.dht_b),
+      elle::Error);
+  }
+  auto decoded = codec::deserialize(codec::encode(*nb), *dhts.dht_b);
+  auto const decoded_nb = elle::cast<dht::NB>::runtime(decoded);
+  BOOST_CHECK_EQUAL(*decoded_nb->owner(), *nb->owner());
+  BOOST_CHECK_EQUAL(decoded_nb->name(), "name");
+  BOOST_CHECK_EQUAL(decoded_nb->signature(), nb->signature());
+  {
+    auto decoded = codec::deserialize(codec::encode(*ub), *dhts.dht_b);
+    auto const decoded_ub = elle::cast<dht::UB>::runtime(decoded);
+    BOOST_CHECK_EQUAL(decoded_ub->name(), "b");
+    BOOST_CHECK_EQUAL(decoded_ub->key(), dhts.keys_b->K());
+    BOOST_CHECK(!decoded_ub->reverse());
+    BOOST_REQUIRE(decoded_ub->passport());
+    BOOST_CHECK(decoded_ub->passport()->verify(dhts.keys_a->K()));
+    auto reversed = codec::deserialize(codec::encode(*rub), *dhts.dht_b);
+    BOOST_CHECK(elle::cast<dht::UB>::runtime(reversed)->reverse());
+  }
+  // Blocks stored in the generic format remain readable.
+  auto const generic = elle::serialization::binary::serialize(
+    static_cast<blocks::Block*>(chb.get()), dhts.dht_a->version());
+  BOOST_CHECK(!codec::compact(generic));
+  BOOST_CHECK_EQUAL(
+    codec::deserialize(generic, *dhts.dht_b)->address(), chb->address());
+  // Mutable blocks are not compacted.
+  auto acb = dhts.dht_a->make_block<blocks::ACLBlock>();
+  acb->data(elle::Buffer("mutable"));
+  acb->seal();
+  BOOST_CHECK(!codec::supported(*acb));
+  BOOST_CHECK(!codec::compact(codec::serialize(*acb, *dhts.dht_a)));
+  // Paxos stores immutable blocks compact as well.
+  auto stored =
+    dhts.dht_a->make_block<blocks::ImmutableBlock>(elle::Buffer("paxos"));
+  auto const address = stored->address();
+  dhts.dht_a->seal_and_insert(*stored);
+  auto copies = 0;
+  for (auto* dht: {dhts.dht_a.get(), dhts.dht_b.get(), dhts.dht_c.get()})
+    try
+    {
+      BOOST_CHECK(codec::compact(dht->local()->storage()->get(address)));
+      ++copies;
+    }
+    catch (infinit::silo::MissingKey const&)
+    {}
+  BOOST_CHECK_GT(copies, 0);
+  BOOST_CHECK_EQUAL(dhts.dht_b->fetch(address)->data(), "paxos");
+}
+
+ELLE_TEST_SCHEDULED(acb_lazy_permissions)
+{
+  DHTs dhts(true);
+  auto block = dhts.dht_a->make_block<blocks::ACLBlock>();
+  block->data(elle::Buffer("lazy"));
+  block->set_permissions(dht::User(dhts.keys_b->K(), "bob"), true, false);
+  dhts.dht_a->seal_and_insert(*block);
+  auto const serialize = [&] (blocks::Block* b)
+    {
+      return elle::serialization::binary::serialize(b, dhts.dht_a->version());
+    };
+  auto const stored = serialize(block.get());
+  auto loaded = dht::codec::deserialize(stored, *dhts.dht_b);
+  // Permission tables nobody looked at are written back as read.
+  BOOST_CHECK_EQUAL(serialize(loaded.get()), stored);
+  auto acb = elle::cast<dht::ACB>::runtime(loaded);
+  BOOST_REQUIRE(acb);
+  BOOST_REQUIRE_EQUAL(acb->acl_entries().size(), 1);
+  BOOST_CHECK_EQUAL(acb->acl_entries()[0].key, dhts.keys_b->K());
+  BOOST_CHECK_EQUAL(serialize(acb.get()), stored);
+  BOOST_CHECK(acb->validate(*dhts.dht_b, false));
+  BOOST_CHECK_EQUAL(acb->data(), "lazy");
+  // Text serializers keep the tables inline.
+  auto const json = elle::serialization::json::serialize(
+    static_cast<blocks::Block*>(acb.get()), dhts.dht_a->version());
+  BOOST_CHECK(json.string().find("\"acl\"") != std::string::npos);
+}
+
 ELLE_TEST_SUITE()
 {
   auto& suite = boost::unit_test::framework::master_test_suite();
@@ -2263,6 +2823,7 @@ ELLE_TEST_SUITE()
   TEST(restart);
   TEST(cache);
   TEST(serialize);
+  TEST(trusted_storage);
 #ifndef INFINIT_WINDOWS
   TEST(monitoring);
 #endif
@@ -2280,6 +2841,16 @@ ELLE_TEST_SUITE()
 #undef TEST
   suite.add(BOOST_TEST_CASE(admin_keys), 0, valgrind(3));
   suite.add(BOOST_TEST_CASE(disabled_crypto), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(rpc_latency), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(bulk_connection_failure), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(secret_cache), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(signature_cache), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(sha256_digest), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(batch_seal), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(key_table), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(group_key_cache), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(block_codec), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(acb_lazy_permissions), 0, valgrind(3));
   {
     paxos->add(ELLE_TEST_CASE(&tests_paxos::wrong_quorum, "wrong_quorum"));
     paxos->add(ELLE_TEST_CASE(&tests_paxos::batch_quorum, "batch_quorum"));
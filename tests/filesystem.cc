@@ -20,6 +20,7 @@
 
 #include <cerrno>
 #include <random>
+#include <unordered_map>
 
 #include <boost/filesystem/fstream.hpp>
 
@@ -35,8 +36,12 @@
 #include <elle/test.hh>
 #include <elle/utils.hh>
 
+#include <elle/cryptography/random.hh>
+
 #include <elle/reactor/scheduler.hh>
 
+#include <infinit/filesystem/compression.hh>
+#include <infinit/filesystem/Directory.hh>
 #include <infinit/filesystem/filesystem.hh>
 #include <infinit/model/doughnut/Doughnut.hh>
 #include <infinit/model/doughnut/Local.hh>
@@ -1517,6 +1522,65 @@ ELLE_TEST_SCHEDULED(conflicts)
   h0->close();
 }
 
+ELLE_TEST_SCHEDULED(inline_conflicts)
+{
+  auto servers = DHTs(3, {}, dht::consensus_builder = no_cheat_consensus(), yielding_overlay = true);
+  auto client0 = servers.client(false, {}, user_name="user0", yielding_overlay = true);
+  auto& fs0 = client0.fs;
+  auto client1 = servers.client(true, {}, user_name="user1", yielding_overlay = true);
+  auto& fs1 = client1.fs;
+  auto ops = [] (auto& fs) -> ifs::FileSystem&
+    {
+      return dynamic_cast<ifs::FileSystem&>(*fs->operations());
+    };
+  ops(fs0).inline_file_size(64);
+  ops(fs1).inline_file_size(64);
+  auto root = [&] (auto& fs)
+    {
+      return std::dynamic_pointer_cast<ifs::Directory>(
+        ops(fs).path("/"))->data();
+    };
+  auto skey = serialize(client1.dht.dht->keys().K());
+  fs0->path("/")->setxattr("infinit.auth.setrw", skey, 0);
+  fs0->path("/")->setxattr("infinit.auth.inherit", "true", 0);
+  // directory conflict on inline creations
+  auto h0 = fs0->path("/file0")->create(O_CREAT|O_RDWR, 0600);
+  auto h1 = fs1->path("/file1")->create(O_CREAT|O_RDWR, 0600);
+  h0->write(elle::ConstWeakBuffer("foo", 3), 3, 0);
+  h1->write(elle::ConstWeakBuffer("bar", 3), 3, 0);
+  h0->close();
+  h1->close();
+  h0.reset();
+  h1.reset();
+  BOOST_CHECK(elle::contains(root(fs0)->inline_files(), "file0"));
+  BOOST_CHECK(elle::contains(root(fs1)->inline_files(), "file1"));
+  BOOST_CHECK_EQUAL(read_file(fs0->path("/file1")), "bar");
+  BOOST_CHECK_EQUAL(read_file(fs1->path("/file0")), "foo");
+  // inline file write conflict
+  h0 = fs0->path("/file0")->open(O_RDWR, 0600);
+  h1 = fs1->path("/file0")->open(O_RDWR, 0600);
+  h0->write(elle::ConstWeakBuffer("baz", 3), 3, 0);
+  h1->write(elle::ConstWeakBuffer("qux", 3), 3, 0);
+  h0->close();
+  h1->close();
+  h0.reset();
+  h1.reset();
+  BOOST_CHECK_EQUAL(read_file(fs0->path("/file0")), "qux");
+  BOOST_CHECK_EQUAL(read_file(fs1->path("/file0")), "qux");
+  // promotion conflicting with an inline write
+  auto const big = std::string(100, 'b');
+  h0 = fs0->path("/file1")->open(O_RDWR, 0600);
+  h1 = fs1->path("/file1")->open(O_RDWR, 0600);
+  h0->write(elle::ConstWeakBuffer(big), big.size(), 0);
+  h1->write(elle::ConstWeakBuffer("bar", 3), 3, 0);
+  h0->close();
+  h1->close();
+  h0.reset();
+  h1.reset();
+  BOOST_CHECK_EQUAL(read_file(fs0->path("/file1")),
+                    read_file(fs1->path("/file1")));
+}
+
 ELLE_TEST_SCHEDULED(group_description)
 {
   auto servers = DHTs(-1);
@@ -1789,6 +1853,438 @@ ELLE_TEST_SCHEDULED(block_size)
   BOOST_CHECK(check_file(client2.fs->path("/foo2")));
 }
 
+ELLE_TEST_SCHEDULED(compression)
+{
+  auto const lz4 = ifs::Compression::lz4;
+  auto const data = elle::Buffer(std::string(4096, 'a') + "tail");
+  auto const compressed = ifs::compress(lz4, data);
+  BOOST_REQUIRE(compressed);
+  BOOST_CHECK_LT(compressed->size(), data.size());
+  BOOST_CHECK_EQUAL(ifs::decompress(lz4, *compressed), data);
+  auto const block = ifs::encode_data_block(data, true, lz4);
+  BOOST_CHECK_EQUAL(ifs::fat_key_compression(block.second), lz4);
+  BOOST_CHECK_EQUAL(ifs::decode_data_block(block.first, block.second), data);
+  // Incompressible data is stored as is.
+  auto const random =
+    elle::cryptography::random::generate<elle::Buffer>(4096);
+  BOOST_CHECK(!ifs::compress(lz4, random));
+  auto const plain = ifs::encode_data_block(random, false, lz4);
+  BOOST_CHECK_EQUAL(ifs::fat_key_compression(plain.second),
+                    ifs::Compression::none);
+  BOOST_CHECK_EQUAL(plain.first, random);
+  // Corrupted payloads are rejected.
+  BOOST_CHECK_THROW(
+    ifs::decompress(
+      lz4, elle::ConstWeakBuffer(compressed->contents(), 3)),
+    elle::Error);
+  BOOST_CHECK_THROW(
+    ifs::decompress(
+      lz4,
+      elle::ConstWeakBuffer(compressed->contents(), compressed->size() - 1)),
+    elle::Error);
+  // So are size prefixes the payload cannot possibly expand to, before
+  // allocating them.
+  auto oversized = elle::Buffer(compressed->contents(), compressed->size());
+  for (int i = 0; i < 4; ++i)
+    oversized[i] = 0xff;
+  BOOST_CHECK_THROW(ifs::decompress(lz4, oversized), elle::Error);
+}
+
+ELLE_TEST_SCHEDULED(large_fat)
+{
+  // Use small blocks so the FAT is split in indirect pages, and compressible
+  // data so blocks are compressed on the way.
+  int const chunk = 1024;
+  int const chunks = 2500;
+  auto content = std::string(chunk * chunks, 'a');
+  for (unsigned int i = 0; i < content.size(); ++i)
+    content[i] = "infinit"[(i / chunk + i) % 7];
+  auto servers = DHTs(1);
+  auto writer = DHTs::Client("volume", servers.dht(false, {}),
+                             ifs::block_size = chunk,
+                             ifs::compression = ifs::Compression::lz4);
+  auto reader = DHTs::Client("volume", servers.dht(false, {}));
+  auto check = [&] (DHTs::Client& client, int size)
+    {
+      auto h = client.fs->path("/big")->open(O_RDONLY, 0);
+      char buf[chunk];
+      for (int i = 0; i * chunk < size; ++i)
+      {
+        auto const expected = std::min(chunk, size - i * chunk);
+        BOOST_CHECK_EQUAL(
+          h->read(elle::WeakBuffer(buf, chunk), chunk, i * chunk), expected);
+        BOOST_CHECK_EQUAL(std::string(buf, expected),
+                          content.substr(i * chunk, expected));
+      }
+      h->close();
+    };
+  auto write = [&] (DHTs::Client& client)
+    {
+      auto h = client.fs->path("/big")->create(O_RDWR | O_CREAT, 0644);
+      for (int i = 0; i < chunks; ++i)
+        h->write(elle::ConstWeakBuffer(content.data() + i * chunk, chunk),
+                 chunk, i * chunk);
+      h->close();
+    };
+  // The number of indirect pages referenced by the file block.
+  auto pages = [&] (DHTs::Client& client)
+    {
+      std::stringstream input(
+        client.fs->path("/big")->getxattr("user.infinit.block.address"));
+      auto const address = infinit::model::Address::from_string(
+        boost::any_cast<std::string>(elle::json::read(input)));
+      auto block = client.dht.dht->fetch(address);
+      return ifs::FileData("/big", *block, {true, true}, chunk)
+        .fat_pages().size();
+    };
+  write(writer);
+  BOOST_CHECK_GT(pages(writer), 1u);
+  auto fat = get_fat(writer.fs->path("/big")->getxattr("user.infinit.fat"));
+  BOOST_CHECK_EQUAL(signed(fat.size()), chunks);
+  check(reader, chunk * chunks);
+  // Rewrite a single block: only its FAT entry changes.
+  {
+    content[chunk * 2000] = 'x';
+    auto h = writer.fs->path("/big")->open(O_RDWR, 0);
+    h->write(elle::ConstWeakBuffer(content.data() + chunk * 2000, chunk),
+             chunk, chunk * 2000);
+    h->close();
+  }
+  auto updated =
+    get_fat(reader.fs->path("/big")->getxattr("user.infinit.fat"));
+  BOOST_CHECK_EQUAL(signed(updated.size()), chunks);
+  for (int i = 0; i < chunks; ++i)
+    if (i != 2000)
+      BOOST_CHECK_EQUAL(fat[i], updated[i]);
+  BOOST_CHECK_NE(fat[2000], updated[2000]);
+  check(reader, chunk * chunks);
+  // Shrink back to an inline FAT.
+  writer.fs->path("/big")->truncate(chunk * 10);
+  check(reader, chunk * 10);
+  BOOST_CHECK_EQUAL(pages(reader), 0u);
+  // Older networks keep the whole FAT in the file block.
+  {
+    auto const version = elle::Version(0, 8, 0);
+    auto old = DHTs(1, {}, ::version = version);
+    auto client = DHTs::Client("volume",
+                               old.dht(false, {}, ::version = version),
+                               ifs::block_size = chunk);
+    write(client);
+    BOOST_CHECK_EQUAL(pages(client), 0u);
+    check(client, chunk * chunks);
+  }
+}
+
+ELLE_TEST_SCHEDULED(prefetch)
+{
+  auto servers = DHTs(1);
+  auto client = servers.client(false, {}, with_cache = true);
+  auto& ops = dynamic_cast<ifs::FileSystem&>(*client.fs->operations());
+  client.fs->path("/d1")->mkdir(0755);
+  client.fs->path("/d1/d2")->mkdir(0755);
+  for (int i = 0; i < 3; ++i)
+    client.fs->path(elle::sprintf("/d1/f%s", i))
+      ->create(O_RDWR | O_CREAT, 0644)->close();
+  for (int i = 0; i < 2; ++i)
+    client.fs->path(elle::sprintf("/d1/d2/g%s", i))
+      ->create(O_RDWR | O_CREAT, 0644)->close();
+  struct stat st;
+  client.fs->path("/d1")->stat(&st);
+  auto const directory = [&] (std::string const& path)
+    {
+      for (auto const& d: ops.directory_cache())
+        if (d->path() == path)
+          return d;
+      BOOST_FAIL(elle::sprintf("%s is not cached", path));
+      return std::shared_ptr<ifs::DirectoryData>();
+    };
+  auto const root = directory("/");
+  auto const d1 = directory("/d1");
+  auto const prefetch = [&] (
+    ifs::DirectoryData const& d,
+    std::unordered_map<std::string, ifs::FileHeader> const& fetched = {})
+    {
+      auto const before = ops.prefetched();
+      ops.prefetch(d, fetched);
+      while (ops.prefetching())
+        elle::reactor::sleep(10_ms);
+      BOOST_CHECK(ops.prefetch_pending().empty());
+      return ops.prefetched() - before;
+    };
+  ELLE_LOG("recurse up to the maximum depth")
+  {
+    ops.prefetch_depth(1);
+    BOOST_CHECK_EQUAL(prefetch(*root), 1);
+    ops.prefetch_depth(2);
+    BOOST_CHECK_EQUAL(prefetch(*root), 5);
+    ops.prefetch_depth(3);
+    BOOST_CHECK_EQUAL(prefetch(*root), 7);
+  }
+  ELLE_LOG("skip fetched entries")
+  {
+    auto const headers = ops.fetch_headers(*root);
+    BOOST_CHECK(elle::contains(headers, "d1"));
+    // Only the entries of d1 are left to fetch.
+    ops.prefetch_depth(2);
+    BOOST_CHECK_EQUAL(prefetch(*root, headers), 4);
+    ops.prefetch_depth(1);
+    BOOST_CHECK_EQUAL(prefetch(*root, headers), 0);
+  }
+  ops.prefetch_depth(1);
+  ELLE_LOG("queue entries once")
+  {
+    auto const before = ops.prefetched();
+    ops.prefetch(*d1);
+    ops.prefetch(*d1);
+    BOOST_CHECK_EQUAL(ops.prefetch_pending().size(), 4u);
+    while (ops.prefetching())
+      elle::reactor::sleep(10_ms);
+    BOOST_CHECK_EQUAL(ops.prefetched() - before, 4);
+  }
+  ELLE_LOG("bound the queue")
+  {
+    ops.prefetch_queue_size(2);
+    BOOST_CHECK_EQUAL(prefetch(*d1), 2);
+  }
+}
+
+ELLE_TEST_SCHEDULED(list_directory_attributes)
+{
+  auto servers = DHTs(1);
+  auto writer = servers.client();
+  auto reader = servers.client();
+  int const count = 50;
+  ELLE_LOG("create entries")
+  {
+    writer.fs->path("/dir")->mkdir(0755);
+    for (int i = 0; i < count; ++i)
+    {
+      auto h = writer.fs->path(elle::sprintf("/file%s", i))
+        ->create(O_RDWR | O_CREAT, 0644);
+      auto const data = std::string(i, 'x');
+      h->write(elle::ConstWeakBuffer(data.data(), data.size()), i, 0);
+      h->close();
+    }
+  }
+  auto const list = [] (DHTs::Client& client)
+    {
+      auto res = std::unordered_map<std::string, struct stat>{};
+      client.fs->path("/")->list_directory(
+        [&] (std::string const& name, struct stat* st)
+        {
+          if (name != "." && name != "..")
+            res.emplace(name, *st);
+        });
+      return res;
+    };
+  ELLE_LOG("list entries with their attributes")
+  {
+    auto const entries = list(reader);
+    BOOST_CHECK_EQUAL(signed(entries.size()), count + 1);
+    BOOST_CHECK(S_ISDIR(entries.at("dir").st_mode));
+    for (int i = 0; i < count; ++i)
+    {
+      auto const name = elle::sprintf("file%s", i);
+      auto const& st = entries.at(name);
+      BOOST_CHECK(S_ISREG(st.st_mode));
+      BOOST_CHECK_EQUAL(st.st_size, i);
+      // Report what stat reports.
+      struct stat full;
+      reader.fs->path("/" + name)->stat(&full);
+      BOOST_CHECK_EQUAL(st.st_mode, full.st_mode);
+      BOOST_CHECK_EQUAL(st.st_nlink, full.st_nlink);
+      BOOST_CHECK_EQUAL(st.st_mtime, full.st_mtime);
+      BOOST_CHECK_EQUAL(st.st_dev, full.st_dev);
+      BOOST_CHECK_EQUAL(st.st_blksize, full.st_blksize);
+      BOOST_CHECK_EQUAL(st.st_blocks, full.st_blocks);
+    }
+  }
+  ELLE_LOG("list the size of open files")
+  {
+    auto h = writer.fs->path("/file0")->open(O_RDWR, 0644);
+    auto const data = std::string(100, 'y');
+    h->write(elle::ConstWeakBuffer(data.data(), data.size()), 100, 0);
+    BOOST_CHECK_EQUAL(list(writer).at("file0").st_size, 100);
+    h->close();
+  }
+  ELLE_LOG("check caches were populated")
+  {
+    auto& ops = dynamic_cast<ifs::FileSystem&>(*reader.fs->operations());
+    BOOST_CHECK_EQUAL(signed(ops.file_cache().size()), count);
+    BOOST_CHECK_EQUAL(signed(ops.directory_cache().size()), 2);
+  }
+}
+
+ELLE_TEST_SCHEDULED(cache_eviction)
+{
+  auto servers = DHTs(1);
+  auto client = servers.client();
+  auto& ops = dynamic_cast<ifs::FileSystem&>(*client.fs->operations());
+  int const count = 10;
+  for (int i = 0; i < count; ++i)
+    client.fs->path(elle::sprintf("/file%s", i))
+      ->create(O_RDWR | O_CREAT, 0644)->close();
+  struct stat st;
+  for (int i = 0; i < count; ++i)
+    client.fs->path(elle::sprintf("/file%s", i))->stat(&st);
+  ops.cache_evict();
+  BOOST_CHECK_EQUAL(signed(ops.file_cache().size()), count);
+  BOOST_CHECK_EQUAL(signed(ops.directory_cache().size()), 1);
+  ELLE_LOG("evict the least recently used entry")
+  {
+    ops.cache_size(ops.cache_bytes() - 1);
+    ops.cache_evict();
+    BOOST_CHECK_EQUAL(signed(ops.file_cache().size()), count - 1);
+    BOOST_CHECK_EQUAL(signed(ops.directory_cache().size()), 1);
+    for (auto const& f: ops.file_cache())
+      BOOST_CHECK_NE(f->path(), "/file0");
+    BOOST_CHECK_LE(ops.cache_bytes(), ops.cache_size());
+  }
+  ELLE_LOG("evict everything")
+  {
+    ops.cache_size(0);
+    ops.cache_evict();
+    BOOST_CHECK(ops.file_cache().empty());
+    BOOST_CHECK(ops.directory_cache().empty());
+    BOOST_CHECK_EQUAL(signed(ops.cache_bytes()), 0);
+  }
+  ELLE_LOG("fetch entries back")
+    for (int i = 0; i < count; ++i)
+      BOOST_CHECK_NO_THROW(
+        client.fs->path(elle::sprintf("/file%s", i))->stat(&st));
+}
+
+ELLE_TEST_SCHEDULED(inline_files)
+{
+  auto servers = DHTs(1);
+  auto writer = servers.client();
+  auto reader = servers.client();
+  auto& ops = dynamic_cast<ifs::FileSystem&>(*writer.fs->operations());
+  ops.inline_file_size(64);
+  writer.fs->path("/")->setxattr("infinit.auth.inherit", "true", 0);
+  auto root = [&]
+    {
+      return std::dynamic_pointer_cast<ifs::Directory>(ops.path("/"))->data();
+    };
+  ELLE_LOG("create small files in the directory")
+  {
+    write_file(writer.fs->path("/small"), "small");
+    write_file(writer.fs->path("/other"), "other");
+    BOOST_CHECK(elle::contains(root()->inline_files(), "small"));
+    BOOST_CHECK(elle::contains(root()->inline_files(), "other"));
+    BOOST_CHECK_EQUAL(root()->files().at("small").second,
+                      infinit::model::Address::null);
+    BOOST_CHECK_EQUAL(read_file(reader.fs->path("/small")), "small");
+    BOOST_CHECK_EQUAL(file_size(reader.fs->path("/small")), 5);
+    write_file(writer.fs->path("/small"), "smaller", O_RDWR, 0);
+    BOOST_CHECK_EQUAL(read_file(reader.fs->path("/small")), "smaller");
+  }
+  ELLE_LOG("rename in the directory")
+  {
+    writer.fs->path("/other")->rename("/renamed");
+    BOOST_CHECK(elle::contains(root()->inline_files(), "renamed"));
+    BOOST_CHECK_EQUAL(read_file(reader.fs->path("/renamed")), "other");
+  }
+  ELLE_LOG("promote on growth")
+  {
+    auto const big = std::string(100, 'b');
+    write_file(writer.fs->path("/small"), big, O_RDWR, 0);
+    BOOST_CHECK(!elle::contains(root()->inline_files(), "small"));
+    BOOST_CHECK_NE(root()->files().at("small").second,
+                   infinit::model::Address::null);
+    BOOST_CHECK_EQUAL(read_file(reader.fs->path("/small")), big);
+  }
+  ELLE_LOG("promote with open handles")
+  {
+    write_file(writer.fs->path("/open"), "open");
+    BOOST_CHECK(elle::contains(root()->inline_files(), "open"));
+    auto big = std::string(100, 'o');
+    auto first = writer.fs->path("/open")->open(O_RDWR, 0);
+    BOOST_CHECK_EQUAL(
+      first->write(elle::ConstWeakBuffer(big), big.size(), 0),
+      signed(big.size()));
+    first->fsync(true);
+    BOOST_CHECK(!elle::contains(root()->inline_files(), "open"));
+    // Reopening shares the buffer moved to the new address.
+    auto second = writer.fs->path("/open")->open(O_RDWR, 0);
+    BOOST_CHECK_EQUAL(signed(ops.file_buffers().size()), 1);
+    BOOST_CHECK_EQUAL(first->write(elle::ConstWeakBuffer("1"), 1, 0), 1);
+    BOOST_CHECK_EQUAL(second->write(elle::ConstWeakBuffer("2"), 1, 1), 1);
+    first->close();
+    second->close();
+    first.reset();
+    second.reset();
+    BOOST_CHECK(ops.file_buffers().empty());
+    big[0] = '1';
+    big[1] = '2';
+    BOOST_CHECK_EQUAL(read_file(reader.fs->path("/open")), big);
+  }
+  ELLE_LOG("promote on hard link")
+  {
+    writer.fs->path("/renamed")->link("/link");
+    BOOST_CHECK(!elle::contains(root()->inline_files(), "renamed"));
+    BOOST_CHECK_EQUAL(root()->files().at("renamed").second,
+                      root()->files().at("link").second);
+    BOOST_CHECK_EQUAL(read_file(reader.fs->path("/link")), "other");
+  }
+  ELLE_LOG("promote past the directory budget")
+  {
+    ops.inline_directory_size(100);
+    auto const content = std::string(40, 'f');
+    write_file(writer.fs->path("/f1"), content);
+    write_file(writer.fs->path("/f2"), content);
+    BOOST_CHECK(elle::contains(root()->inline_files(), "f1"));
+    BOOST_CHECK(elle::contains(root()->inline_files(), "f2"));
+    BOOST_CHECK_EQUAL(root()->inline_size(), 80u);
+    // The third file takes the inline files past the budget.
+    write_file(writer.fs->path("/f3"), content);
+    BOOST_CHECK(!elle::contains(root()->inline_files(), "f3"));
+    BOOST_CHECK_EQUAL(root()->inline_size(), 80u);
+    BOOST_CHECK_EQUAL(read_file(reader.fs->path("/f3")), content);
+    // New files get blocks of their own once the budget is used up.
+    ops.inline_directory_size(80);
+    write_file(writer.fs->path("/f4"), "f");
+    BOOST_CHECK(!elle::contains(root()->inline_files(), "f4"));
+    BOOST_CHECK_NE(root()->files().at("f4").second,
+                   infinit::model::Address::null);
+    BOOST_CHECK_EQUAL(read_file(reader.fs->path("/f4")), "f");
+    ops.inline_directory_size(64 * 1024);
+  }
+  ELLE_LOG("promote on directory permissions change")
+  {
+    write_file(writer.fs->path("/private"), "private");
+    write_file(writer.fs->path("/shared"), "shared");
+    BOOST_CHECK(elle::contains(root()->inline_files(), "private"));
+    BOOST_CHECK(elle::contains(root()->inline_files(), "shared"));
+    auto handle = writer.fs->path("/shared")->open(O_RDWR, 0);
+    auto const other = elle::cryptography::rsa::keypair::generate(512);
+    // All inline files are promoted at once.
+    writer.fs->path("/")->setxattr(
+      "infinit.auth.setr",
+      elle::serialization::json::serialize(other.K()).string(), 0);
+    BOOST_CHECK(root()->inline_files().empty());
+    BOOST_CHECK_NE(root()->files().at("private").second,
+                   infinit::model::Address::null);
+    BOOST_CHECK_NE(root()->files().at("shared").second,
+                   root()->files().at("private").second);
+    BOOST_CHECK_EQUAL(read_file(reader.fs->path("/private")), "private");
+    // The open handle follows its file.
+    BOOST_CHECK_EQUAL(handle->write(elle::ConstWeakBuffer("S"), 1, 0), 1);
+    handle->close();
+    handle.reset();
+    BOOST_CHECK_EQUAL(read_file(reader.fs->path("/shared")), "Shared");
+  }
+  ELLE_LOG("unlink")
+  {
+    write_file(writer.fs->path("/gone"), "gone");
+    writer.fs->path("/gone")->unlink();
+    BOOST_CHECK(!elle::contains(root()->files(), "gone"));
+    BOOST_CHECK(!elle::contains(root()->inline_files(), "gone"));
+    struct stat st;
+    BOOST_CHECK_THROW(reader.fs->path("/gone")->stat(&st), rfs::Error);
+  }
+}
+
 ELLE_TEST_SUITE()
 {
   // This is needed to ignore child process exiting with nonzero
@@ -1824,4 +2320,11 @@ ELLE_TEST_SUITE()
   suite.add(BOOST_TEST_CASE(read_unlink_small), 0, valgrind(5));
   suite.add(BOOST_TEST_CASE(read_unlink_large), 0, valgrind(5));
   suite.add(BOOST_TEST_CASE(block_size), 0, valgrind(10));
+  suite.add(BOOST_TEST_CASE(compression), 0, valgrind(1));
+  suite.add(BOOST_TEST_CASE(large_fat), 0, valgrind(10));
+  suite.add(BOOST_TEST_CASE(prefetch), 0, valgrind(5));
+  suite.add(BOOST_TEST_CASE(list_directory_attributes), 0, valgrind(5));
+  suite.add(BOOST_TEST_CASE(cache_eviction), 0, valgrind(5));
+  suite.add(BOOST_TEST_CASE(inline_files), 0, valgrind(5));
+  suite.add(BOOST_TEST_CASE(inline_conflicts), 0, valgrind(10));
 }
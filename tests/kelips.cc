@@ -14,6 +14,8 @@
 #include <infinit/model/doughnut/Doughnut.hh>
 #include <infinit/model/doughnut/consensus/Paxos.hh>
 #include <infinit/overlay/kelips/Kelips.hh>
+#include <infinit/overlay/kelips/PacketQueue.hh>
+#include <infinit/overlay/kelips/Wire.hh>
 #include <infinit/silo/Filesystem.hh>
 #include <infinit/silo/Memory.hh>
 #include <infinit/silo/Silo.hh>
@@ -21,7 +23,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <cstddef>
 #include <cstdlib>
+#include <new>
 
 ELLE_LOG_COMPONENT("test");
 
@@ -941,6 +945,320 @@ ELLE_TEST_SCHEDULED(beyond_storage)
 }
 
 
+/// Received packets are popped by priority, in order within a class, and
+/// gossip makes room for other packets when full.
+static
+void
+packet_queue()
+{
+  using iok::PacketClass;
+  auto queue = iok::PacketQueue<int>(3);
+  BOOST_TEST(!queue.pop());
+  BOOST_TEST(queue.push(PacketClass::request, 1));
+  BOOST_TEST(queue.push(PacketClass::gossip, 2));
+  BOOST_TEST(queue.push(PacketClass::gossip, 3));
+  BOOST_TEST(queue.size() == 3);
+  ELLE_LOG("drop oldest gossip first")
+  {
+    BOOST_TEST(queue.push(PacketClass::reply, 4));
+    BOOST_TEST(queue.push(PacketClass::request, 5));
+    BOOST_TEST(queue.size(PacketClass::gossip) == 0);
+    BOOST_TEST(queue.statistics(PacketClass::gossip).dropped == 2);
+  }
+  ELLE_LOG("reject requests but never replies")
+  {
+    BOOST_TEST(!queue.push(PacketClass::request, 6));
+    BOOST_TEST(!queue.push(PacketClass::gossip, 7));
+    BOOST_TEST(queue.push(PacketClass::reply, 8));
+    BOOST_TEST(queue.size() == 4);
+    BOOST_TEST(queue.statistics(PacketClass::request).dropped == 1);
+    BOOST_TEST(queue.statistics(PacketClass::gossip).dropped == 3);
+    BOOST_TEST(queue.statistics(PacketClass::reply).dropped == 0);
+  }
+  ELLE_LOG("pop by priority")
+  {
+    auto popped = std::vector<int>{};
+    while (auto p = queue.pop())
+      popped.push_back(*p);
+    BOOST_TEST(popped == (std::vector<int>{4, 8, 1, 5}));
+    BOOST_TEST(queue.statistics(PacketClass::reply).processed == 2);
+    BOOST_TEST(queue.statistics(PacketClass::request).processed == 2);
+    BOOST_TEST(queue.statistics(PacketClass::gossip).processed == 0);
+  }
+  ELLE_LOG("a queue holds at least one packet")
+  {
+    auto empty = iok::PacketQueue<int>(0);
+    BOOST_TEST(empty.capacity() == 1);
+    BOOST_TEST(empty.push(PacketClass::gossip, 1));
+    BOOST_TEST(empty.push(PacketClass::request, 2));
+    BOOST_TEST(!empty.push(PacketClass::gossip, 3));
+    BOOST_TEST(*empty.pop() == 2);
+  }
+}
+
+/// Round trip the compact wire format, reject oversized frames without
+/// corrupting the datagram and fail cleanly on truncated input.
+static
+void
+wire_codec()
+{
+  namespace wire = iok::wire;
+  using infinit::model::Address;
+  auto const now = std::chrono::time_point_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now());
+  auto contacts = wire::Contacts{};
+  for (int i = 0; i < 4; ++i)
+    contacts[Address::random()] = {
+      {wire::Endpoint(boost::asio::ip::address_v4(0x0a000001 + i), 4242),
+       now - std::chrono::seconds(i)},
+      {wire::Endpoint(boost::asio::ip::address_v6::loopback(), 4243),
+       now + std::chrono::milliseconds(i)},
+    };
+  auto const home = Address::random();
+  auto files = wire::Files{};
+  for (int i = 0; i < 4; ++i)
+    files.emplace(Address::random(),
+                  std::make_pair(now - std::chrono::milliseconds(10 * i),
+                                 i % 2 ? home : Address::random()));
+  auto datagram = elle::Buffer{};
+  auto w = wire::Writer(datagram);
+  {
+    auto frame = w.begin_frame(1);
+    w.svarint(-42);
+    w.varint(uint64_t(1) << 40);
+    w.contacts(contacts);
+    w.files(files);
+    w.end_frame(frame);
+  }
+  ELLE_LOG("oversized frame")
+  {
+    auto const size = datagram.size();
+    auto frame = w.begin_frame(2);
+    auto const big = std::string(wire::max_frame_size + 1, 'x');
+    w.raw(big.data(), big.size());
+    BOOST_CHECK_THROW(w.end_frame(frame), elle::Error);
+    BOOST_TEST(datagram.size() == size);
+  }
+  {
+    auto frame = w.begin_frame(3);
+    w.endpoint(wire::Endpoint(boost::asio::ip::address_v4::loopback(), 1));
+    w.end_frame(frame);
+  }
+  ELLE_LOG("round trip")
+  {
+    auto r = wire::Reader(datagram);
+    uint8_t type;
+    auto first = r.frame(type);
+    BOOST_TEST(type == 1);
+    BOOST_TEST(first.svarint() == -42);
+    BOOST_TEST(first.varint() == uint64_t(1) << 40);
+    BOOST_CHECK(first.contacts() == contacts);
+    BOOST_CHECK(first.files() == files);
+    BOOST_TEST(first.empty());
+    auto second = r.frame(type);
+    BOOST_TEST(type == 3);
+    BOOST_TEST(second.endpoint() ==
+               wire::Endpoint(boost::asio::ip::address_v4::loopback(), 1));
+    BOOST_TEST(r.empty());
+  }
+  ELLE_LOG("truncated input")
+    for (auto size = std::size_t(0); size < datagram.size(); ++size)
+    {
+      auto r = wire::Reader(elle::ConstWeakBuffer(datagram.contents(), size));
+      BOOST_CHECK_THROW(
+        {
+          while (true)
+          {
+            uint8_t type;
+            auto frame = r.frame(type);
+            if (type == 1)
+            {
+              frame.svarint();
+              frame.varint();
+              frame.contacts();
+              frame.files();
+            }
+            else
+              frame.endpoint();
+          }
+        },
+        elle::Error);
+    }
+  ELLE_LOG("bogus counts")
+  {
+    auto bogus = elle::Buffer{};
+    wire::Writer(bogus).varint(uint64_t(1) << 60);
+    BOOST_CHECK_THROW(wire::Reader(bogus).contacts(), elle::Error);
+  }
+}
+
+static
+void
+file_table()
+{
+  using infinit::model::Address;
+  auto table = iok::FileTable{};
+  auto const at = [] (int s)
+    {
+      return iok::Time(std::chrono::seconds(s));
+    };
+  auto nodes = std::vector<Address>{};
+  for (int i = 0; i < 3; ++i)
+    nodes.emplace_back(Address::random());
+  auto files = std::vector<Address>{};
+  for (int i = 0; i < 100; ++i)
+    files.emplace_back(Address::random());
+  for (auto const& f: files)
+    for (auto const& n: nodes)
+      BOOST_TEST(table.insert(iok::File{f, n, at(10), iok::Time(), 0}));
+  BOOST_TEST(!table.insert(iok::File{files[0], nodes[0], at(20), at(20), 1}));
+  BOOST_TEST(table.size() == 300u);
+  BOOST_TEST(table.files_count() == 100u);
+  BOOST_TEST(std::distance(table.begin(), table.end()) == 300);
+  BOOST_TEST(table.count(files[0]) == 3);
+  BOOST_TEST(table.replicas(files[1]).size() == 3u);
+  BOOST_TEST(table.seen(files[0], nodes[1], at(30)));
+  BOOST_TEST(table.seen(files[0], nodes[1], at(25)));
+  BOOST_TEST(table.gossiped(files[0], nodes[1], at(40)));
+  {
+    auto const f = table.find(files[0], nodes[1]);
+    BOOST_REQUIRE(f);
+    BOOST_TEST(f->address == files[0]);
+    BOOST_TEST(f->address.mutable_block() == files[0].mutable_block());
+    BOOST_TEST(f->home_node == nodes[1]);
+    BOOST_TEST((f->last_seen == at(30)));
+    BOOST_TEST((f->last_gossip == at(40)));
+    BOOST_TEST(f->gossip_count == 1);
+  }
+  table.seen(nodes[2], at(50));
+  for (auto const& f: table)
+    BOOST_TEST((f.last_seen == at(f.home_node == nodes[2] ? 50 : 10) ||
+                (f.address == files[0] && f.home_node == nodes[1])));
+  BOOST_TEST(table.erase(files[0], nodes[0]));
+  BOOST_TEST(!table.erase(files[0], nodes[0]));
+  BOOST_TEST(!table.contains(files[0], nodes[0]));
+  BOOST_TEST(table.contains(files[0], nodes[1]));
+  BOOST_TEST(table.erase_if([&] (iok::File const& f)
+                            {
+                              return f.home_node != nodes[2];
+                            }) == 199);
+  BOOST_TEST(table.size() == 100u);
+  for (auto const& f: files)
+  {
+    auto const replicas = table.replicas(f);
+    BOOST_TEST(replicas.size() == 1u);
+    BOOST_TEST(replicas.at(0).home_node == nodes[2]);
+  }
+  for (auto const& f: files)
+    BOOST_TEST(table.erase(f, nodes[2]));
+  BOOST_TEST(table.size() == 0u);
+  BOOST_TEST(table.files_count() == 0u);
+  BOOST_TEST(!table.find(files[0], nodes[2]));
+}
+
+namespace
+{
+  /// Whether allocations are accounted for in allocated.
+  bool counting = false;
+  /// Bytes currently allocated while counting.
+  std::size_t allocated = 0;
+
+  /// Header of every allocation, keeping the allocation size and whether it
+  /// was accounted for. Padded to keep allocations aligned.
+  struct alignas(std::max_align_t) AllocationHeader
+  {
+    std::size_t size;
+    bool counted;
+  };
+}
+
+void*
+operator new(std::size_t size)
+{
+  auto header = static_cast<AllocationHeader*>(
+    std::malloc(sizeof(AllocationHeader) + size));
+  if (!header)
+    throw std::bad_alloc();
+  header->size = size;
+  header->counted = counting;
+  if (counting)
+    allocated += size;
+  return header + 1;
+}
+
+void
+operator delete(void* p) noexcept
+{
+  if (!p)
+    return;
+  auto header = static_cast<AllocationHeader*>(p) - 1;
+  if (header->counted)
+    allocated -= header->size;
+  std::free(header);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+  ::operator delete(p);
+}
+
+/// Run @a f and return the bytes it left allocated.
+template <typename F>
+static
+std::size_t
+allocation(F const& f)
+{
+  auto const before = allocated;
+  counting = true;
+  f();
+  counting = false;
+  return allocated - before;
+}
+
+/// Compare the memory taken by the file table and by a multimap of File as
+/// the group grows, with three replicas per file. Both are measured by
+/// counting the bytes they allocate.
+static
+void
+file_table_footprint()
+{
+  using infinit::model::Address;
+  auto const replication = 3;
+  auto nodes = std::vector<Address>{};
+  for (int i = 0; i < 20; ++i)
+    nodes.emplace_back(Address::random());
+  for (auto count: {1000, 10000, 100000})
+  {
+    auto files = std::vector<iok::File>{};
+    for (int i = 0; i < count; ++i)
+    {
+      auto const address = Address::random();
+      for (int r = 0; r < replication; ++r)
+        files.emplace_back(iok::File{
+          address, nodes[(i + r) % nodes.size()], iok::Time(), iok::Time(), 0});
+    }
+    auto table = iok::FileTable{};
+    auto reference = std::unordered_multimap<Address, iok::File>{};
+    auto const table_bytes = allocation([&]
+      {
+        for (auto const& f: files)
+          table.insert(f);
+      });
+    auto const reference_bytes = allocation([&]
+      {
+        for (auto const& f: files)
+          reference.emplace(f.address, f);
+      });
+    ELLE_LOG("%s files: table takes %s bytes (estimated %s), multimap %s bytes",
+             count, table_bytes, table.footprint(), reference_bytes);
+    BOOST_TEST(table_bytes * 3 < reference_bytes);
+    // The estimate reported in the stats is in the right ballpark.
+    BOOST_TEST(table.footprint() < table_bytes * 2);
+    BOOST_TEST(table_bytes < table.footprint() * 2);
+  }
+}
+
 ELLE_TEST_SUITE()
 {
   srand(time(nullptr));
@@ -961,6 +1279,10 @@ ELLE_TEST_SUITE()
   suite.add(BOOST_TEST_CASE(beyond_observer_1), 0, valgrind(120));
   suite.add(BOOST_TEST_CASE(beyond_observer_2), 0, valgrind(120));
   suite.add(BOOST_TEST_CASE(beyond_storage), 0, valgrind(120));
+  suite.add(BOOST_TEST_CASE(packet_queue), 0, valgrind(1));
+  suite.add(BOOST_TEST_CASE(wire_codec), 0, valgrind(1));
+  suite.add(BOOST_TEST_CASE(file_table), 0, valgrind(1));
+  suite.add(BOOST_TEST_CASE(file_table_footprint), 0, valgrind(10));
   // suite.add(BOOST_TEST_CASE(killed_nodes), 0, 600);
   //suite.add(BOOST_TEST_CASE(killed_nodes_half_lenient), 0, 600);
   // suite.add(BOOST_TEST_CASE(killed_nodes_k2), 0, 600);
@@ -14,9 +14,12 @@
 #include <elle/reactor/network/udp-socket.hh>
 
 #include <infinit/model/MissingBlock.hh>
+#include <infinit/model/blocks/ImmutableBlock.hh>
 #include <infinit/model/blocks/MutableBlock.hh>
 #include <infinit/model/doughnut/ACB.hh>
+#include <infinit/overlay/Rendezvous.hh>
 #include <infinit/overlay/kelips/Kelips.hh>
+#include <infinit/overlay/koordinate/Koordinate.hh>
 #include <infinit/overlay/kouncil/Kouncil.hh>
 #include <infinit/silo/MissingKey.hh>
 
@@ -268,6 +271,15 @@ namespace
                   || boost::any_cast<bool>(o.at("discovered")));
         });
     }
+    else if (get_rendezvous(client))
+    {
+      // Members are kept while disconnected, only count connected ones.
+      auto peers = boost::any_cast<elle::json::Array>(ostats.at("peers"));
+      res = boost::count_if(peers, [&](auto& p) {
+          auto const& o = boost::any_cast<elle::json::Object>(p);
+          return boost::any_cast<bool>(o.at("connected"));
+        });
+    }
     else
     {
       assert(get_kouncil(client));
@@ -1944,6 +1956,595 @@ ELLE_TEST_SCHEDULED(not_storing, (TestConfiguration, config))
   }
 }
 
+ELLE_TEST_SCHEDULED(synchronize_entries, (TestConfiguration, config))
+{
+  using AddressSet = std::unordered_set<Address>;
+  auto const keys = elle::cryptography::rsa::keypair::generate(512);
+  auto storage_a = infinit::silo::Memory::Blocks();
+  auto const kept = Address::random(flags::immutable_block);
+  auto const removed = Address::random(flags::immutable_block);
+  storage_a[kept] = elle::Buffer("kept");
+  storage_a[removed] = elle::Buffer("removed");
+  auto port = 0;
+  auto make_a = [&]
+    {
+      return elle::make_unique<DHT>(
+        ::version = config.version,
+        ::id = special_id(10),
+        ::keys = keys,
+        ::storage = std::make_unique<infinit::silo::Memory>(storage_a),
+        ::make_overlay = config.overlay_builder,
+        ::port = port,
+        dht::consensus::rebalance_auto_expand = false);
+    };
+  auto a = make_a();
+  auto b = DHT(
+    ::version = config.version,
+    ::id = special_id(11),
+    ::keys = keys,
+    ::storage = nullptr,
+    ::make_overlay = config.overlay_builder,
+    dht::consensus::rebalance_auto_expand = false);
+  discover(b, *a, false, false, true, true);
+  auto const wait_entries = [&] (AddressSet const& expected)
+    {
+      auto const& book = get_kouncil(b)->address_book();
+      while (true)
+      {
+        auto const blocks = book.blocks(special_id(10));
+        if (AddressSet(blocks.begin(), blocks.end()) == expected)
+          break;
+        elle::reactor::sleep(50_ms);
+      }
+    };
+  ELLE_LOG("fetch entries")
+    wait_entries({kept, removed});
+  ELLE_LOG("reject invalid buckets")
+  {
+    using Book = infinit::overlay::kouncil::AddressBook;
+    auto r = std::dynamic_pointer_cast<Remote>(
+      b.dht->overlay()->lookup_node(special_id(10)).lock());
+    BOOST_REQUIRE(r);
+    auto fetch = r->make_rpc<auto (std::vector<int> const&) -> AddressSet>(
+      "kouncil_fetch_entries_buckets");
+    BOOST_CHECK_THROW(fetch(std::vector<int>{Book::digest_buckets}),
+                      elle::Error);
+    BOOST_CHECK_THROW(fetch(std::vector<int>{-1}), elle::Error);
+    BOOST_TEST(fetch(std::vector<int>{Book::bucket(kept)}).count(kept) == 1u);
+    // Digests computed differently are not sent.
+    auto digest = r->make_rpc<auto (int, int64_t)
+                              -> std::pair<int, Book::Digest>>(
+      "kouncil_entries_digest");
+    auto const res = digest(Book::digest_version + 1, 0);
+    BOOST_TEST(res.first == Book::digest_version);
+    BOOST_TEST(res.second.empty());
+  }
+  ELLE_LOG("stop DHT A")
+  {
+    port = a->dht->local()->server_endpoints().begin()->port();
+    auto disappeared = elle::reactor::waiter(
+      b.dht->overlay()->on_disappearance(),
+      [&] (Address id, bool) { return id == special_id(10); });
+    a.reset();
+    elle::reactor::wait(disappeared);
+  }
+  ELLE_LOG("suspend entries of A")
+  {
+    auto const& book = get_kouncil(b)->address_book();
+    BOOST_TEST(book.suspended(special_id(10)));
+    BOOST_TEST(book.owners(kept).empty());
+    BOOST_TEST(book.blocks(special_id(10)).size() == 2u);
+  }
+  // Change blocks behind B's back.
+  storage_a.erase(removed);
+  auto const added = Address::random(flags::immutable_block);
+  storage_a[added] = elle::Buffer("added");
+  ELLE_LOG("restart DHT A")
+  {
+    auto discovered = elle::reactor::waiter(
+      b.dht->overlay()->on_discovery(),
+      [&] (NodeLocation l, bool) { return l.id() == special_id(10); });
+    a = make_a();
+    elle::reactor::wait(discovered);
+  }
+  ELLE_LOG("synchronize differing buckets")
+    wait_entries({kept, added});
+  BOOST_TEST(!get_kouncil(b)->address_book().suspended(special_id(10)));
+  BOOST_TEST(get_kouncil(b)->address_book().owners(kept).size() == 1u);
+}
+
+ELLE_TEST_SCHEDULED(failing_lookup_peer, (TestConfiguration, config))
+{
+  using AddressSet = std::unordered_set<Address>;
+  using Owners = std::unordered_map<Address, AddressSet>;
+  auto const keys = elle::cryptography::rsa::keypair::generate(512);
+  auto storage_a = infinit::silo::Memory::Blocks();
+  auto const block = Address::random(flags::immutable_block);
+  storage_a[block] = elle::Buffer("block");
+  auto a = DHT(
+    ::version = config.version,
+    ::id = special_id(10),
+    ::keys = keys,
+    ::storage = std::make_unique<infinit::silo::Memory>(storage_a),
+    ::make_overlay = config.overlay_builder);
+  // Keep the client from learning the block from the address book.
+  a.dht->local()->on_connect().connect(
+    [] (infinit::RPCServer& rpcs)
+    {
+      rpcs.add("kouncil_fetch_entries", [] { return AddressSet{}; });
+    });
+  auto failing = DHT(
+    ::version = config.version,
+    ::id = special_id(11),
+    ::keys = keys,
+    ::make_overlay = config.overlay_builder);
+  failing.dht->local()->on_connect().connect(
+    [] (infinit::RPCServer& rpcs)
+    {
+      rpcs.add("kouncil_lookup",
+               [] (Address const&) -> AddressSet { elle::err("broken"); });
+      rpcs.add("kouncil_lookup_batch",
+               [] (std::vector<Address> const&) -> Owners
+               {
+                 elle::err("broken");
+               });
+    });
+  auto client = DHT(
+    ::version = config.version,
+    ::id = special_id(12),
+    ::keys = keys,
+    ::storage = nullptr,
+    ::make_overlay = config.overlay_builder);
+  discover(client, failing, false, false, true);
+  ELLE_LOG("look up an unknown block on the failing peer only")
+    BOOST_CHECK_THROW(client.dht->overlay()->lookup(block), MissingBlock);
+  discover(client, a, false, false, true);
+  ELLE_LOG("look up a block known to the other peer")
+  {
+    BOOST_TEST(get_kouncil(client)->address_book().owners(block).empty());
+    auto const owner = client.dht->overlay()->lookup(block).lock();
+    BOOST_REQUIRE(owner);
+    BOOST_TEST(owner->id() == special_id(10));
+  }
+}
+
+static
+void
+address_book()
+{
+  auto book = infinit::overlay::kouncil::AddressBook{};
+  auto nodes = std::vector<Address>{};
+  for (int i = 1; i <= 5; ++i)
+    nodes.emplace_back(special_id(i));
+  auto blocks = std::vector<Address>{};
+  for (int i = 0; i < 100; ++i)
+    blocks.emplace_back(Address::random(i % 2 ? flags::mutable_block
+                                              : flags::immutable_block));
+  // Every node owns every block, overflowing the inline owners.
+  for (auto const& b: blocks)
+    for (auto const& n: nodes)
+      BOOST_TEST(book.insert(n, b));
+  BOOST_TEST(!book.insert(nodes[0], blocks[0]));
+  BOOST_TEST(book.size() == 500u);
+  BOOST_TEST(book.blocks_count() == 100u);
+  for (auto const& b: blocks)
+  {
+    auto const owners = book.owners(b);
+    BOOST_TEST(owners.size() == nodes.size());
+    for (auto const& n: nodes)
+      CHECK_IN(n, owners);
+  }
+  auto const held = book.blocks(nodes[3]);
+  BOOST_TEST(held.size() == blocks.size());
+  for (auto const& b: held)
+    BOOST_TEST(b.mutable_block() == bool(b.value()[Address::flag_byte] ==
+                                         flags::mutable_block));
+  using Book = infinit::overlay::kouncil::AddressBook;
+  BOOST_TEST(book.digest(nodes[1]) == Book::digest(blocks));
+  BOOST_TEST(book.erase(nodes[1], blocks[0]));
+  BOOST_TEST(!book.erase(nodes[1], blocks[0]));
+  {
+    auto const digest = book.digest(nodes[1]);
+    auto const expected = Book::digest(book.blocks(nodes[1]));
+    BOOST_TEST(digest == expected);
+    BOOST_TEST(Book::digest_root(digest) !=
+               Book::digest_root(Book::digest(blocks)));
+    auto const full = Book::digest(blocks);
+    for (int i = 0; i < Book::digest_buckets; ++i)
+      BOOST_TEST((digest[i] != full[i]) == (i == Book::bucket(blocks[0])));
+  }
+  BOOST_TEST(!book.contains(nodes[1], blocks[0]));
+  BOOST_TEST(book.contains(nodes[2], blocks[0]));
+  CHECK_NOT_IN(nodes[1], book.owners(blocks[0]));
+  {
+    BOOST_TEST(book.suspend(nodes[2]));
+    BOOST_TEST(book.suspended(nodes[2]));
+    CHECK_NOT_IN(nodes[2], book.owners(blocks[1]));
+    BOOST_TEST(book.owners(blocks[1]).size() == 4u);
+    auto counted = 0;
+    book.for_each(
+      [&] (Address const&, int owners)
+      {
+        ++counted;
+        BOOST_TEST(owners <= 4);
+      });
+    BOOST_TEST(counted == 100);
+    // Entries and digest are kept while suspended.
+    BOOST_TEST(book.blocks(nodes[2]).size() == blocks.size());
+    BOOST_TEST(book.digest(nodes[2]) == Book::digest(blocks));
+    BOOST_TEST(book.resume(nodes[2]));
+    BOOST_TEST(!book.resume(nodes[2]));
+    CHECK_IN(nodes[2], book.owners(blocks[1]));
+    BOOST_TEST(!book.suspend(special_id(6)));
+  }
+  BOOST_TEST(book.erase(nodes[0]) == 100u);
+  BOOST_TEST(book.blocks(nodes[0]).empty());
+  BOOST_TEST(book.owners(blocks[0]).size() == 3u);
+  for (auto const& n: nodes)
+    book.erase(n);
+  BOOST_TEST(book.size() == 0u);
+  BOOST_TEST(book.blocks_count() == 0u);
+  for (auto const& b: blocks)
+    BOOST_TEST(book.owners(b).empty());
+}
+
+static
+void
+rendezvous_placement()
+{
+  auto members = NodeLocations{};
+  for (int i = 1; i <= 10; ++i)
+    members.emplace_back(special_id(i), Endpoints{});
+  auto shuffled = members;
+  std::reverse(shuffled.begin(), shuffled.end());
+  auto removed = members;
+  removed.erase(removed.begin() + 3);
+  auto ids = [] (NodeLocations const& locations)
+    {
+      return elle::make_vector(locations,
+                               [] (NodeLocation const& l) { return l.id(); });
+    };
+  auto load = std::unordered_map<Address, int>{};
+  for (int i = 0; i < 1000; ++i)
+  {
+    auto const block = Address::random();
+    auto const owners = ids(Rendezvous::owners(members, block, 3));
+    BOOST_TEST(owners.size() == 3u);
+    BOOST_TEST(owners[0] != owners[1]);
+    BOOST_TEST(owners[0] != owners[2]);
+    BOOST_TEST(owners[1] != owners[2]);
+    for (auto const& o: owners)
+      ++load[o];
+    // Placement does not depend on the order members were learned in.
+    BOOST_TEST(ids(Rendezvous::owners(shuffled, block, 3)) == owners);
+    // Losing a member only moves the blocks it owned.
+    auto const after = ids(Rendezvous::owners(removed, block, 3));
+    auto const lost = members[3].id();
+    if (std::find(owners.begin(), owners.end(), lost) == owners.end())
+      BOOST_TEST(after == owners);
+    else
+      for (auto const& o: owners)
+        if (o != lost)
+          CHECK_IN(o, after);
+  }
+  for (auto const& m: members)
+  {
+    BOOST_TEST(load[m.id()] > 200);
+    BOOST_TEST(load[m.id()] < 400);
+  }
+  BOOST_TEST(Rendezvous::owners(members, Address::random(), 20).size() ==
+             members.size());
+  BOOST_TEST(Rendezvous::owners({}, Address::random(), 3).empty());
+}
+
+ELLE_TEST_SCHEDULED(rendezvous_lookup, (TestConfiguration, config))
+{
+  auto const keys = elle::cryptography::rsa::keypair::generate(512);
+  auto a = elle::make_unique<DHT>(
+    ::version = config.version,
+    ::id = special_id(10),
+    ::keys = keys,
+    ::make_overlay = config.overlay_builder);
+  auto client = DHT(
+    ::version = config.version,
+    ::id = special_id(20),
+    ::keys = keys,
+    ::storage = nullptr,
+    ::make_overlay = config.overlay_builder);
+  discover(client, *a, false, false, true);
+  ELLE_LOG("compute the owner of a block nobody stored")
+  {
+    BOOST_TEST(get_rendezvous(client)->computed_placement());
+    BOOST_TEST(client.dht->overlay()->lookup(Address::random()).lock()->id() ==
+               special_id(10));
+  }
+  ELLE_LOG("keep disconnected members until eviction")
+  {
+    auto disappeared = elle::reactor::waiter(
+      client.dht->overlay()->on_disappearance(),
+      [&] (Address id, bool) { return id == special_id(10); });
+    a.reset();
+    elle::reactor::wait(disappeared);
+    BOOST_TEST(client.dht->overlay()->lookup(Address::random()).lock()->id() ==
+               special_id(10));
+  }
+}
+
+ELLE_TEST_SCHEDULED(rendezvous_join, (TestConfiguration, config))
+{
+  auto const keys = elle::cryptography::rsa::keypair::generate(512);
+  auto make_dht = [&] (int id)
+    {
+      return elle::make_unique<DHT>(
+        ::version = config.version,
+        ::id = special_id(id),
+        ::keys = keys,
+        ::make_overlay = config.overlay_builder,
+        dht::consensus::rebalance_auto_expand = false);
+    };
+  auto a = make_dht(10);
+  auto client = DHT(
+    ::version = config.version,
+    ::id = special_id(20),
+    ::keys = keys,
+    ::storage = nullptr,
+    ::make_overlay = config.overlay_builder);
+  discover(client, *a, false, false, true);
+  auto blocks = std::vector<std::unique_ptr<Block>>{};
+  ELLE_LOG("store blocks on the only member")
+    for (int i = 0; i < 20; ++i)
+    {
+      auto const data = elle::sprintf("block %s", i);
+      if (i % 2)
+        blocks.emplace_back(client.dht->make_block<MutableBlock>(data));
+      else
+        blocks.emplace_back(
+          client.dht->make_block<ImmutableBlock>(
+            elle::Buffer(data.data(), data.size())));
+      client.dht->seal_and_insert(*blocks.back(), tcr());
+    }
+  auto b = make_dht(11);
+  auto c = make_dht(12);
+  ELLE_LOG("add members")
+  {
+    discover(client, *b, false, false, true);
+    discover(client, *c, false, false, true);
+    BOOST_TEST(get_rendezvous(client)->members().size() == 3u);
+  }
+  auto const members = get_rendezvous(client)->members();
+  auto const moved = boost::count_if(
+    blocks,
+    [&] (std::unique_ptr<Block> const& block)
+    {
+      return Rendezvous::owners(members, block->address(), 1)[0].id() !=
+        special_id(10);
+    });
+  BOOST_TEST(moved > 0);
+  ELLE_LOG("fetch blocks ranking new members first")
+    for (auto const& block: blocks)
+      BOOST_TEST(client.dht->fetch(block->address())->data() ==
+                 block->data());
+  ELLE_LOG("fetch them by batch")
+  {
+    auto fetched = 0;
+    client.dht->multifetch(
+      elle::make_vector(
+        blocks,
+        [] (std::unique_ptr<Block> const& block)
+        {
+          return Model::AddressVersion(block->address(), boost::none);
+        }),
+      [&] (Address, std::unique_ptr<Block> block, std::exception_ptr e)
+      {
+        BOOST_TEST(!e);
+        if (block)
+          ++fetched;
+      });
+    BOOST_TEST(fetched == signed(blocks.size()));
+  }
+}
+
+namespace
+{
+  /// A Koordinate backend answering lookups with fixed members after a
+  /// delay.
+  class ScriptedOverlay
+    : public infinit::overlay::Overlay
+  {
+  public:
+    using Super = infinit::overlay::Overlay;
+
+    ScriptedOverlay(Doughnut* dht,
+                    std::string name,
+                    Members members,
+                    elle::reactor::Duration delay)
+      : Super(dht, nullptr)
+      , _name(std::move(name))
+      , _members(std::move(members))
+      , _delay(delay)
+    {}
+
+    std::string
+    type_name() const override
+    {
+      return this->_name;
+    }
+
+    elle::json::Array
+    peer_list() const override
+    {
+      return {};
+    }
+
+    elle::json::Object
+    stats() const override
+    {
+      return {{"type", this->type_name()}};
+    }
+
+  protected:
+    void
+    _discover(NodeLocations const&) override
+    {}
+
+    bool
+    _discovered(Address) override
+    {
+      return true;
+    }
+
+    MemberGenerator
+    _allocate(Address address, int n) const override
+    {
+      return this->_lookup(address, n, false);
+    }
+
+    MemberGenerator
+    _lookup(Address, int n, bool) const override
+    {
+      return [this, n] (MemberGenerator::yielder const& yield)
+        {
+          elle::reactor::sleep(this->_delay);
+          for (int i = 0; i < n && i < signed(this->_members.size()); ++i)
+            yield(this->_members[i]);
+        };
+    }
+
+    WeakMember
+    _lookup_node(Address id) const override
+    {
+      elle::reactor::sleep(this->_delay);
+      for (auto const& m: this->_members)
+        if (m->id() == id)
+          return m;
+      return {};
+    }
+
+    ELLE_ATTRIBUTE(std::string, name);
+    ELLE_ATTRIBUTE(Members, members);
+    ELLE_ATTRIBUTE(elle::reactor::Duration, delay);
+  };
+
+  struct Script
+  {
+    std::string name;
+    infinit::overlay::Overlay::Members members;
+    elle::reactor::Duration delay;
+  };
+
+  /// A client whose overlay is a Koordinate over scripted backends.
+  std::unique_ptr<DHT>
+  koordinate_client(elle::cryptography::rsa::KeyPair const& keys,
+                    std::vector<Script> scripts)
+  {
+    return std::make_unique<DHT>(
+      ::keys = keys,
+      ::storage = nullptr,
+      ::make_overlay =
+        [scripts] (Doughnut& dht, std::shared_ptr<Local> local)
+        {
+          auto backends = koordinate::Koordinate::Backends{};
+          for (auto const& s: scripts)
+            backends.emplace_back(std::make_unique<ScriptedOverlay>(
+              &dht, s.name, s.members, s.delay));
+          return std::make_unique<koordinate::Koordinate>(
+            &dht, local, std::move(backends));
+        });
+  }
+
+  std::vector<Address>
+  lookup_ids(DHT& client, Address address, int n)
+  {
+    auto res = std::vector<Address>{};
+    for (auto m: client.dht->overlay()->lookup(address, n))
+      res.emplace_back(m.lock()->id());
+    return res;
+  }
+
+  koordinate::Koordinate::BackendStats const&
+  backend_stats(DHT& client, int backend)
+  {
+    auto& k =
+      dynamic_cast<koordinate::Koordinate&>(*client.dht->overlay());
+    return k.backend_stats().at(backend);
+  }
+}
+
+ELLE_TEST_SCHEDULED(koordinate_slow_backend)
+{
+  auto const keys = elle::cryptography::rsa::keypair::generate(512);
+  auto servers = std::vector<std::unique_ptr<DHT>>{};
+  auto members = infinit::overlay::Overlay::Members{};
+  for (int i = 0; i < 3; ++i)
+  {
+    servers.emplace_back(
+      std::make_unique<DHT>(::id = special_id(10 + i), ::keys = keys));
+    members.emplace_back(servers.back()->dht->local());
+  }
+  auto const ids = elle::make_vector(
+    members, [] (auto const& m) { return m->id(); });
+  ELLE_LOG("a fast complete backend cancels the slow one")
+  {
+    auto client = koordinate_client(
+      keys, {{"fast", members, 0_sec}, {"slow", members, 10_sec}});
+    BOOST_TEST(lookup_ids(*client, Address::random(), 3) == ids);
+    BOOST_TEST(backend_stats(*client, 0).hits == 1);
+    BOOST_TEST(backend_stats(*client, 1).cancelled == 1);
+  }
+  ELLE_LOG("a slow complete backend completes a fast partial one")
+  {
+    auto client = koordinate_client(
+      keys,
+      {{"partial", {members[0]}, 0_sec}, {"slow", members, 100_ms}});
+    BOOST_TEST(lookup_ids(*client, Address::random(), 3) == ids);
+    BOOST_TEST(backend_stats(*client, 0).hits == 1);
+    BOOST_TEST(backend_stats(*client, 1).hits == 1);
+    BOOST_TEST(backend_stats(*client, 1).cancelled == 0);
+  }
+}
+
+ELLE_TEST_SCHEDULED(koordinate_partial_backend)
+{
+  auto const keys = elle::cryptography::rsa::keypair::generate(512);
+  auto servers = std::vector<std::unique_ptr<DHT>>{};
+  auto members = infinit::overlay::Overlay::Members{};
+  for (int i = 0; i < 3; ++i)
+  {
+    servers.emplace_back(
+      std::make_unique<DHT>(::id = special_id(10 + i), ::keys = keys));
+    members.emplace_back(servers.back()->dht->local());
+  }
+  ELLE_LOG("partial answers are merged without duplicates")
+  {
+    auto client = koordinate_client(
+      keys,
+      {{"first", {members[0]}, 0_sec},
+       {"second", {members[0], members[1]}, 50_ms}});
+    BOOST_TEST(lookup_ids(*client, Address::random(), 3) ==
+               (std::vector<Address>{members[0]->id(), members[1]->id()}));
+    BOOST_TEST(backend_stats(*client, 0).hits == 1);
+    BOOST_TEST(backend_stats(*client, 1).hits == 1);
+  }
+  ELLE_LOG("backends finding nothing are misses")
+  {
+    auto client = koordinate_client(
+      keys, {{"empty", {}, 0_sec}, {"single", {members[2]}, 0_sec}});
+    BOOST_TEST(lookup_ids(*client, Address::random(), 2) ==
+               (std::vector<Address>{members[2]->id()}));
+    BOOST_TEST(backend_stats(*client, 0).misses == 1);
+    BOOST_TEST(backend_stats(*client, 1).hits == 1);
+  }
+  ELLE_LOG("node lookups only need one answer")
+  {
+    auto client = koordinate_client(
+      keys, {{"fast", members, 0_sec}, {"slow", members, 10_sec}});
+    BOOST_TEST(
+      client->dht->overlay()->lookup_node(members[1]->id()).lock()->id() ==
+      members[1]->id());
+    BOOST_TEST(backend_stats(*client, 1).cancelled == 1);
+  }
+}
+
 ELLE_TEST_SUITE()
 {
   static int windows_factor =
@@ -1985,6 +2586,13 @@ ELLE_TEST_SUITE()
     = TestConfiguration{make_kouncil, infinit::version()};
   auto const kouncil_0_7_config
     = TestConfiguration{make_kouncil, elle::Version(0, 7, 0)};
+  auto const rendezvous_config = TestConfiguration{
+    [] (Doughnut& dht, std::shared_ptr<Local> local)
+    {
+      return std::make_unique<Rendezvous>(
+        &dht, local, std::chrono::seconds{valgrind(1, 5) * 10});
+    },
+    infinit::version()};
 
 
 #define TEST(Suite, Overlay, Name, Timeout, Function, ...)              \
@@ -2007,12 +2615,16 @@ ELLE_TEST_SUITE()
 #define TEST_NAMED(Overlay, Name, Func, Timeout, ...)                   \
   TEST(Overlay, Overlay, #Name, Timeout, Func, ##__VA_ARGS__)           \
 
-#define OVERLAY(Name)                                                   \
+  // Lookups: whether owners are looked up, rather than computed so that
+  // lookups of missing blocks do not fail.
+#define OVERLAY(Name, Lookups)                                          \
   auto Name = BOOST_TEST_SUITE(#Name);                                  \
   master.add(Name);                                                     \
-  TEST_ANON(Name, basics, basics, 5);                                   \
+  if (Lookups)                                                          \
+    TEST_ANON(Name, basics, basics, 5);                                 \
   TEST_ANON(Name, dead_peer, dead_peer, 5);                             \
-  TEST_ANON(Name, discover_endpoints, discover_endpoints, 10);          \
+  if (Lookups)                                                          \
+    TEST_ANON(Name, discover_endpoints, discover_endpoints, 10);        \
   TEST_ANON(Name, reciprocate, reciprocate, 10);                        \
   TEST_ANON(Name, key_cache_invalidation, key_cache_invalidation, 10);  \
   TEST_ANON(Name, data_spread, data_spread, 30);                        \
@@ -2036,9 +2648,10 @@ ELLE_TEST_SUITE()
   TEST_NAMED(Name, churn, churn, 600, false, true, true);               \
   TEST_NAMED(Name, churn_socket, churn_socket, 600);                    \
 
-  OVERLAY(kelips);
-  OVERLAY(kouncil);
-  OVERLAY(kouncil_0_7);
+  OVERLAY(kelips, true);
+  OVERLAY(kouncil, true);
+  OVERLAY(kouncil_0_7, true);
+  OVERLAY(rendezvous, false);
 #undef OVERLAY
 
   TEST_NAMED(kouncil, eviction, eviction, 600);
@@ -2048,4 +2661,17 @@ ELLE_TEST_SUITE()
   TEST(kouncil, kouncil, "remove", 5, remove, false);
   TEST(kouncil, kouncil, "remove_disconnected", 5, remove_disconnected, false);
   TEST(kouncil, kouncil, "not_storing", 5, not_storing);
+  TEST(kouncil, kouncil, "synchronize_entries", 10, synchronize_entries);
+  TEST(kouncil, kouncil, "failing_lookup_peer", 10, failing_lookup_peer);
+  kouncil->add(BOOST_TEST_CASE(address_book), 0, valgrind(1));
+  rendezvous->add(BOOST_TEST_CASE(rendezvous_placement), 0, valgrind(1));
+  TEST(rendezvous, rendezvous, "lookup", 10, rendezvous_lookup);
+  TEST(rendezvous, rendezvous, "join", 10, rendezvous_join);
+  {
+    auto koordinate = BOOST_TEST_SUITE("koordinate");
+    master.add(koordinate);
+    koordinate->add(BOOST_TEST_CASE(koordinate_slow_backend), 0, valgrind(5));
+    koordinate->add(
+      BOOST_TEST_CASE(koordinate_partial_backend), 0, valgrind(5));
+  }
 }